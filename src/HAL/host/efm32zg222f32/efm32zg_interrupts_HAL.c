@@ -30,6 +30,72 @@
 #include "efm32zg_types_HAL.h"
 
 
+static ZG_irq_hook zg_irq_hook[ZG_IRQ_SOURCES];
+
+void zg_IrqHook(uint32_t source, uint32_t flags);
+
+
+/***************************************************************************************************
+ *
+ *										Interrupt Hooks
+ *
+ ***************************************************************************************************/
+
+/****************************************************************************
+ * @brief Attach fn(context, flags) to an interrupt source, NULL detaches
+ *
+ * The handler's NVIC line is switched on with the hook (the timer's is left
+ * alone, the ms tick lives on it). Which pins or flags fire is still down
+ * to the peripheral's own IEN.
+
+*****************************************************************************/
+
+void zg_IrqAttach(uint32_t source, int(*fn)(), void* context)
+{
+  if(source >= ZG_IRQ_SOURCES){
+    return;
+  }
+
+  zg_irq_hook[source].fn = NULL;
+  zg_irq_hook[source].context = context;
+  zg_irq_hook[source].fn = fn;
+
+  if(source == ZG_IRQ_GPIO){
+    if(fn != NULL){
+      NVIC_ClearPendingIRQ(GPIO_EVEN_IRQn);
+      NVIC_ClearPendingIRQ(GPIO_ODD_IRQn);
+      NVIC_EnableIRQ(GPIO_EVEN_IRQn);
+      NVIC_EnableIRQ(GPIO_ODD_IRQn);
+    } else {
+      NVIC_DisableIRQ(GPIO_EVEN_IRQn);
+      NVIC_DisableIRQ(GPIO_ODD_IRQn);
+    }
+  } else if(source == ZG_IRQ_USART_TX){
+    if(fn != NULL){
+      NVIC_ClearPendingIRQ(USART1_TX_IRQn);
+      NVIC_EnableIRQ(USART1_TX_IRQn);
+    } else {
+      NVIC_DisableIRQ(USART1_TX_IRQn);
+    }
+  } else if(source == ZG_IRQ_USART_RX){
+    if(fn != NULL){
+      NVIC_ClearPendingIRQ(USART1_RX_IRQn);
+      NVIC_EnableIRQ(USART1_RX_IRQn);
+    } else {
+      NVIC_DisableIRQ(USART1_RX_IRQn);
+    }
+  }
+}
+
+void zg_IrqHook(uint32_t source, uint32_t flags)
+{
+  int(*fn)() = zg_irq_hook[source].fn;
+
+  if(fn != NULL){
+    fn(zg_irq_hook[source].context, flags);
+  }
+}
+
 
 /***************************************************************************************************
  *
@@ -130,6 +196,62 @@ void USART1_RX_IRQHandler(void)
   	  zg_usartWrite(usart_txint);
 }*/
 
+/****************************************************************************
+ * @brief USART1 RX IRQ Handler
+ *
+ * RXDATAV is level, the hook has to read RXDATA (or drop RXDATAV from IEN)
+ * before returning.
+*****************************************************************************/
+
+void USART1_RX_IRQHandler(void)
+{
+  zg_IrqHook(ZG_IRQ_USART_RX, usart->IF & usart->IEN);
+}
+
+/****************************************************************************
+ * @brief USART1 TX IRQ Handler
+ *
+ * usart_Data() arms TXC once the last frame is in the buffer, this goes 
+ * off when it has shifted out. One shot, TXC is disarmed again here.
+ * TXBL is level like RXDATAV, whoever enabled it feeds TXDATA or turns it
+ * off from the hook.
+*****************************************************************************/
+
+void USART1_TX_IRQHandler(void)
+{
+  uint32_t flags = usart->IF & usart->IEN;
+
+  if(flags & USART_IF_TXC){
+    usart->IEN &= ~USART_IEN_TXC;
+    usart->IFC = USART_IFC_TXC;
+  }
+  if(flags){
+    zg_IrqHook(ZG_IRQ_USART_TX, flags);
+  }
+}
+
+
+/**********************************************
+ *          GPIO INTERRUPTS
+ *********************************************/
+
+//flags are the pins, e.g. the DW1000 IRQ line
+void GPIO_EVEN_IRQHandler(void)
+{
+  uint32_t flags = GPIO->IF & GPIO->IEN & 0x5555;
+
+  GPIO->IFC = flags;
+  zg_IrqHook(ZG_IRQ_GPIO, flags);
+}
+
+void GPIO_ODD_IRQHandler(void)
+{
+  uint32_t flags = GPIO->IF & GPIO->IEN & 0xAAAA;
+
+  GPIO->IFC = flags;
+  zg_IrqHook(ZG_IRQ_GPIO, flags);
+}
+
 
 /**********************************************
  *          TIMER0 INTERRUPT
@@ -138,7 +260,29 @@ void USART1_RX_IRQHandler(void)
 void TIMER0_IRQHandler(void){
 
   //TIMER_TypeDef* timer_0 = TIMER0;
-  timer0_ms_ticks++;
-  timer0->IFC = TIMER_IFC_OF;
+  uint32_t flags = timer0->IF;
+
+  //cc0 input capture (1PPS). If the overflow is pending alongside it and
+  //the capture is low in the count, the edge came after the wrap 
+  //
+  if(flags & TIMER_IF_CC0){
+    uint32_t ccv = timer0->CC[TIMER_CHANNEL_0].CCV;
+    uint32_t ticks = timer0_ms_ticks;
+
+    if((flags & TIMER_IF_OF) && ccv < (timer0->TOP >> 1)){
+      ticks++;
+    }
+    timer0_cc0_ticks = ticks;
+    timer0_cc0_ccv = ccv;
+    timer0_cc0_count++;
+    timer0->IFC = TIMER_IFC_CC0;
+  }
+
+  if(flags & TIMER_IF_OF){
+    timer0_ms_ticks++;
+    timer0->IFC = TIMER_IFC_OF;
+  }
+
+  zg_IrqHook(ZG_IRQ_TIMER, flags);
 }
 
@@ -2,6 +2,29 @@
 #define _EFM32ZG_INT_HAL_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************//**
+ * @brief Interrupt hooks
+ *
+ * fn(context, flags) is called from the handler for that source once its
+ * flags are cleared. Sources line up with MPI_IRQ_* in mpi_port.h, past
+ * those are the host's own (USART_RX, the adaptor's async transfers).
+
+*****************************************************************************/
+
+#define ZG_IRQ_GPIO       0
+#define ZG_IRQ_USART_TX   1
+#define ZG_IRQ_TIMER      2
+#define ZG_IRQ_USART_RX   3
+#define ZG_IRQ_SOURCES    4
+
+typedef struct {
+  int(* volatile fn)();
+  void* volatile context;
+}ZG_irq_hook;
+
+void zg_IrqAttach(uint32_t source, int(*fn)(), void* context);
 
 /**************************************************************************//**
  * @brief USART1 RX IRQ Handler Setup
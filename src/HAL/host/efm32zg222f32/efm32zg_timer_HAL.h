@@ -15,6 +15,7 @@
 
 #define EFM32ZG_TIMER_CMD_START   0x01
 #define EFM32ZG_TIMER_CMD_STOP    0x02
+#define EFM32ZG_TIMER_STATUS_RUNNING  0x01
 
 #define TIMER_READ_WRITE_CLEAR 3
 #define TIMER_CHANNEL_0 0
@@ -377,8 +377,11 @@ typedef struct {
 //#define TIMERn_TOPus 
 
 
-volatile uint16_t timer0_ms_ticks;
+volatile uint32_t timer0_ms_ticks;   //free running from timer_Init()
 volatile uint16_t timer0_us_ticks;
+volatile uint32_t timer0_cc0_ticks;  //timer0_ms_ticks at the last cc0 capture (1PPS)
+volatile uint32_t timer0_cc0_ccv;    //cnt at the last cc0 capture
+volatile uint32_t timer0_cc0_count;  //captures so far
 volatile uint16_t timer1_ms_ticks;
 volatile uint16_t timer1_us_ticks;
 
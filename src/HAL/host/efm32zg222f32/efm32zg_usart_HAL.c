@@ -146,7 +146,8 @@ int zg_usartClkdivRead(USART_periphconf* MPI_conf)
 
 int zg_usartClkdivWrite(USART_periphconf* MPI_conf)
 {
-	usart->CLKDIV |= MPI_conf->clkdiv;
+	//a divider, not a set of flags: replace it so the baud rate can be changed after init
+	usart->CLKDIV = MPI_conf->clkdiv;
 	return 0;
 }
 
@@ -0,0 +1,194 @@
+ /* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+ 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpi_port.h"
+#include "dw1000_types.h"
+#include "dw1000_regs.h"
+#include "dw1000_commRxTx.h"
+#include "dw1000_cir.h"
+
+/*******************************************************
+ *        CHANNEL IMPULSE RESPONSE / RX DIAGNOSTICS
+ ******************************************************/
+
+/*
+ * Usage:
+ *
+ *  - after a good frame is received (and before rx is re-enabled) call
+ *    dw_cirStart() with a caller owned buffer
+ *  - call dw_cirStep() once per idle slot until it returns DW_CIR_DONE,
+ *    each call is one bounded burst of DW_CIR_CHUNK_SAMPLES samples so
+ *    the readout never holds the bus for longer than a slot
+ *
+ * The first step pulls this frame's first path data (dw_cirDiagnostics(),
+ * 0x10/0x12/0x15) and forces the accumulator clocks on, PMSC_CTRL0 FACE
+ * and AMCE, without which the accumulator reads back as zeros. PMSC_CTRL0
+ * is put back as it was once the step returns DW_CIR_DONE or fails; a
+ * failed step can be retried and picks up where it left off.
+ *
+ * The peak is tracked while the chunks arrive so no second pass over
+ * the buffer is needed. fp_to_peak is filled in on the last chunk.
+ */
+
+uint32_t dw_cirClocks(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_cir* dw_cir, uint32_t force);
+
+uint32_t dw_cirClocks(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_cir* dw_cir, uint32_t force){
+
+  uint8_t ctrl0[DW_CIR_CLOCKS_LEN];
+
+  if(!force){
+    dw_cir->clocks_forced = 0;
+    return dw_TxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[pwr_mgmt_sys_ctrl], PMSC_CTRL0_OFFSET, 
+                    dw_cir->pmsc_ctrl0, DW_CIR_CLOCKS_LEN);
+  }
+
+  if(dw_RxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[pwr_mgmt_sys_ctrl], PMSC_CTRL0_OFFSET, 
+              dw_cir->pmsc_ctrl0, DW_CIR_CLOCKS_LEN) != EXIT_SUCCESS){
+    return ERROR;
+  }
+  ctrl0[0] = (dw_cir->pmsc_ctrl0[0] & ~(DW_CIR_CLOCKS_RXCLKS_MASK | PMSC_CTRL0_FACE)) | PMSC_CTRL0_FACE | PMSC_CTRL0_RXCLKS_125M;
+  ctrl0[1] = dw_cir->pmsc_ctrl0[1] | (PMSC_CTRL0_AMCE >> SINGLE_BYTE_SHIFT);
+  dw_cir->clocks_forced = 1;
+
+  return dw_TxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[pwr_mgmt_sys_ctrl], PMSC_CTRL0_OFFSET, 
+                  ctrl0, DW_CIR_CLOCKS_LEN);
+}
+
+uint32_t dw_cirStart(DW_cir* dw_cir, int16_t* samples, uint32_t sample_count){
+
+  if((samples == NULL) || (sample_count == 0) || (sample_count > DW_CIR_SAMPLES_64M)){
+    return ERROR;
+  }
+
+  dw_cir->samples = samples;
+  dw_cir->sample_count = sample_count;
+  dw_cir->next_sample = 0;
+  dw_cir->clocks_forced = 0;
+  dw_cir->peak_index = 0;
+  dw_cir->peak_magnitude = 0;
+  dw_cir->fp_index = 0;
+  dw_cir->fp_index_fraction = 0;
+  dw_cir->fp_to_peak = 0;
+  dw_cir->state = DW_CIR_PENDING;
+
+  return EXIT_SUCCESS;
+}
+
+
+uint32_t dw_cirStep(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_cir* dw_cir){
+
+  if(dw_cir->state != DW_CIR_PENDING){
+    return dw_cir->state;
+  }
+
+  uint8_t chunk[DW_CIR_DUMMY_LEN + (DW_CIR_CHUNK_SAMPLES * DW_CIR_SAMPLE_LEN)];
+
+  uint32_t first = dw_cir->next_sample;
+  uint32_t count = dw_cir->sample_count - first;
+  if(count > DW_CIR_CHUNK_SAMPLES){
+    count = DW_CIR_CHUNK_SAMPLES;
+  }
+
+  if(first == 0 && dw_cirDiagnostics(host_object, host_usart, ext_dev_object, dw_cir) != EXIT_SUCCESS){
+    return ERROR;
+  }
+  if(!dw_cir->clocks_forced && dw_cirClocks(host_object, host_usart, ext_dev_object, dw_cir, 1) != EXIT_SUCCESS){
+    if(dw_cir->clocks_forced){
+      dw_cirClocks(host_object, host_usart, ext_dev_object, dw_cir, 0);
+    }
+    return ERROR;
+  }
+
+  uint32_t ret = dw_RxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[accum_read], first * DW_CIR_SAMPLE_LEN, 
+                          chunk, DW_CIR_DUMMY_LEN + (count * DW_CIR_SAMPLE_LEN));
+  if(ret != EXIT_SUCCESS){
+    dw_cirClocks(host_object, host_usart, ext_dev_object, dw_cir, 0);
+    return ERROR;
+  }
+
+  uint8_t* raw = &chunk[DW_CIR_DUMMY_LEN];
+
+  for(uint32_t i = 0; i < count; i++){
+
+    int16_t re = (int16_t)(raw[0] | (raw[1] << SINGLE_BYTE_SHIFT));
+    int16_t im = (int16_t)(raw[2] | (raw[3] << SINGLE_BYTE_SHIFT));
+    raw += DW_CIR_SAMPLE_LEN;
+
+    dw_cir->samples[(first + i) * 2]     = re;
+    dw_cir->samples[(first + i) * 2 + 1] = im;
+
+    //|re|+|im| ranks samples the same way as the true magnitude near
+    //the peak and costs no multiply
+    uint32_t magnitude = (re < 0 ? -re : re) + (im < 0 ? -im : im);
+    if(magnitude > dw_cir->peak_magnitude){
+      dw_cir->peak_magnitude = magnitude;
+      dw_cir->peak_index = first + i;
+    }
+  }
+
+  dw_cir->next_sample = first + count;
+
+  if(dw_cir->next_sample >= dw_cir->sample_count){
+    dw_cir->fp_to_peak = (int16_t)dw_cir->peak_index - (int16_t)dw_cir->fp_index;
+    dw_cir->state = DW_CIR_DONE;
+    if(dw_cirClocks(host_object, host_usart, ext_dev_object, dw_cir, 0) != EXIT_SUCCESS){
+      return ERROR;
+    }
+  }
+
+  return dw_cir->state;
+}
+
+
+uint32_t dw_cirDiagnostics(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_cir* dw_cir){
+
+  uint8_t fqual[RX_FQUAL_LEN];
+  uint8_t fp[RX_TIME_FP_LEN];
+  uint8_t finfo[RX_FINFO_LEN];
+
+  //0x12: std_noise, fp_ampl2, fp_ampl3, cir_pwr
+  if(dw_RxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[rx_frame_qual], 0, fqual, RX_FQUAL_LEN) != EXIT_SUCCESS){
+    return ERROR;
+  }
+  //0x15:05 fp_index (10.6 fixed point), fp_ampl1
+  if(dw_RxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[rx_arrival_time], RX_TIME_FP_INDEX_OFFSET, fp, RX_TIME_FP_LEN) != EXIT_SUCCESS){
+    return ERROR;
+  }
+  //0x10: rxpacc
+  if(dw_RxReg(host_object, host_usart, ext_dev_object, dw_reg_id_table[rx_frame_info], 0, finfo, RX_FINFO_LEN) != EXIT_SUCCESS){
+    return ERROR;
+  }
+
+  dw_cir->std_noise = fqual[0] | (fqual[1] << SINGLE_BYTE_SHIFT);
+  dw_cir->fp_ampl2  = fqual[2] | (fqual[3] << SINGLE_BYTE_SHIFT);
+  dw_cir->fp_ampl3  = fqual[4] | (fqual[5] << SINGLE_BYTE_SHIFT);
+  dw_cir->cir_pwr   = fqual[6] | (fqual[7] << SINGLE_BYTE_SHIFT);
+
+  uint16_t fp_index_raw = fp[0] | (fp[1] << SINGLE_BYTE_SHIFT);
+  dw_cir->fp_index = fp_index_raw >> DW_FP_INDEX_FRACTION_BITS;
+  dw_cir->fp_index_fraction = fp_index_raw & ((1 << DW_FP_INDEX_FRACTION_BITS) - 1);
+  dw_cir->fp_ampl1 = fp[2] | (fp[3] << SINGLE_BYTE_SHIFT);
+
+  uint32_t rx_finfo = finfo[0] | (finfo[1] << SINGLE_BYTE_SHIFT) | (finfo[2] << DOUBLE_BYTE_SHIFT) | ((uint32_t)finfo[3] << TRIPLE_BYTE_SHIFT);
+  dw_cir->rxpacc = (rx_finfo & RX_FINFO_RXPACC_MASK) >> RX_FINFO_RXPACC_SHIFT;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,12 @@
+#ifndef DW1000_CIR_H_
+#define DW1000_CIR_H_
+
+#include <stdint.h>
+
+#include "dw1000_types.h"
+
+uint32_t dw_cirStart(DW_cir* dw_cir, int16_t* samples, uint32_t sample_count);
+uint32_t dw_cirStep(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_cir* dw_cir);
+uint32_t dw_cirDiagnostics(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_cir* dw_cir);
+
+#endif
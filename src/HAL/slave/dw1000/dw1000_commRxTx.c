@@ -16,6 +16,7 @@
  *
  */
  
+#include <stddef.h>
 #include <stdint.h>
 
 #include "mpi_port.h"
@@ -48,6 +49,23 @@
  *
  */
 
+/*
+ * CS of the device the host is set up for (mpi_busSelect()), one window
+ * per transaction. Nothing if the host has no _usart_cs.
+ *
+ * Hosts with a _usart_transfer get the whole transaction in one call and
+ * handle CS themselves, in hardware where they can (AUTOCS on the 
+ * efm32zg222f32), so dw_Cs() is only for the ones without.
+ */
+void dw_Cs(void* host_object, uint32_t level){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_cs = host_ptr->_periph_periphconf._usart_cs;
+
+  if(host_cs != NULL){
+    host_cs(host_object, level);
+  }
+}
 
 
 uint32_t dw_Tx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t* buffer_out, uint32_t buffer_len){
@@ -55,20 +73,18 @@ uint32_t dw_Tx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint
   //MPI_ext_dev* ext_dev_ptr = (MPI_ext_dev*)ext_dev_object;
   //DW_config* dw_config = (DW_config*)ext_dev_ptr->MPI_conf[DW_CONFIG_INDEX];
   //DW_nodelist* dw_nodelist = (DW_nodelist*)ext_dev_ptr->MPI_data[NODE_LIST_INDEX];
-  
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_transfer = host_ptr->_periph_periphconf._usart_transfer;
+
+  if(host_transfer != NULL){
+    return host_transfer(host_object, WRITE, buffer_out, buffer_len, NULL, 0);
+  }
 
   /*************************************************************************/
   //  de-assert CS line here
   /*************************************************************************/
-
-/*
- * INSERT CONDITIONAL TO CHECK IF AUTOCS IS ENABLED
- *
-  MPI_host* host_object_ptr = (MPI_host*)host_object;
-  volatile int(*host_spi_cs)() = host_object_ptr->_periph_periphconf._gpio_data;
-  
-   host_spi_cs(host_object, WRITE, 0, 5);
-*/
+  dw_Cs(host_object, MPI_CS_ASSERT);
 
   //callback to host usart
   //
@@ -77,11 +93,7 @@ uint32_t dw_Tx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint
   /*************************************************************************/
   //  re-assert CS line here
   /*************************************************************************/
-/*
- * INSERT CONDITIONAL TO CHECK IF AUTOCS IS ENABLED
- 
- host_spi_cs(host_object, TGL, 0, 5);
-*/
+  dw_Cs(host_object, MPI_CS_DEASSERT);
 
   return ret;
 }
@@ -96,18 +108,20 @@ uint32_t dw_Rx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint
   //build message that requests a read from a given register (pre-configured in reg_id_index)
   int frame_len = dw_buildMessageHeader(dw_nodelist, dw_config, DW_READ);
   //int frame_len = 5;
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_transfer = host_ptr->_periph_periphconf._usart_transfer;
+
+  //request and frame in the one CS window
+  //
+  if(host_transfer != NULL){
+    return host_transfer(host_object, READ, dw_nodelist->frame_out, frame_len, buffer_in, buffer_len);
+  }
     
   /*************************************************************************/
   //de-assert CS line here
   /*************************************************************************/
-/*
- * INSERT CONDITIONAL TO CHECK IF AUTOCS IS ENABLED
- *
-  MPI_host* host_object_ptr = (MPI_host*)host_object;
-  volatile int(*host_spi_cs)() = host_object_ptr->_periph_periphconf._gpio_data;
-
-  host_spi_cs(host_object, WRITE, 0, 5);
-*/
+  dw_Cs(host_object, MPI_CS_ASSERT);
   
   //make tx call to request frame
   host_usart(host_object, WRITE, dw_nodelist->frame_out, frame_len);
@@ -119,11 +133,89 @@ uint32_t dw_Rx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint
   /*************************************************************************/
   //re-assert CS line here
   /*************************************************************************/
+  dw_Cs(host_object, MPI_CS_DEASSERT);
+
+  return ret;
+}
+
+
+/***********************************************************
+ *              Direct register access
+ **********************************************************/
+
 /*
- * INSERT CONDITIONAL TO CHECK IF AUTOCS IS ENABLED
- *
-  host_spi_cs(host_object, TGL, 0, 5);
-*/
+ * dw_Rx/dw_Tx take their header from dw_config and the header builders,
+ * which only carry a 7-bit sub-address. These take the register id and
+ * a full 15-bit offset directly (accumulator, AON, PMSC, OTP...).
+ */
+
+uint32_t dw_regHeader(uint8_t* header, uint32_t read_write, uint8_t reg_id, uint16_t offset){
+
+  uint32_t header_len = 1;
+
+  header[0] = dw_rw_bool_table[read_write] | reg_id;
+
+  if(offset > 0){
+    header[0] |= (MSG_SUB_ADDR_TRUE);
+    header[1] = offset & DW_REG_SHORT_OFFSET_MAX;
+    header_len++;
+
+    if(offset > DW_REG_SHORT_OFFSET_MAX){
+      header[1] |= (MSG_EXT_ADDR_TRUE);
+      header[2] = (offset >> DW_REG_EXT_OFFSET_SHIFT) & SINGLE_BYTE;
+      header_len++;
+    }
+  }
+  return header_len;
+}
+
+uint32_t dw_RxReg(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t reg_id, uint16_t offset, uint8_t* buffer_in, uint32_t buffer_len){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_transfer = host_ptr->_periph_periphconf._usart_transfer;
+
+  uint8_t header[DW_REG_HEADER_MAX];
+  uint32_t header_len = dw_regHeader(header, DW_READ, reg_id, offset);
+
+  //header and data in the one CS window if the host can do it
+  //
+  if(host_transfer != NULL){
+    return host_transfer(host_object, READ, header, header_len, buffer_in, buffer_len);
+  }
+
+  dw_Cs(host_object, MPI_CS_ASSERT);
+  host_usart(host_object, WRITE, header, header_len);
+  uint32_t ret = host_usart(host_object, READ, buffer_in, buffer_len);
+  dw_Cs(host_object, MPI_CS_DEASSERT);
+
+  return ret;
+}
+
+uint32_t dw_TxReg(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t reg_id, uint16_t offset, uint8_t* buffer_out, uint32_t buffer_len){
+
+  if(buffer_len > DW_REG_TX_MAX){
+    return ERROR;
+  }
+
+  //header and data go out in one transfer so CS stays asserted
+  uint8_t frame[DW_REG_HEADER_MAX + DW_REG_TX_MAX];
+  uint32_t frame_len = dw_regHeader(frame, DW_WRITE, reg_id, offset);
+
+  for(uint32_t i = 0; i < buffer_len; i++){
+    frame[frame_len++] = buffer_out[i];
+  }
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_transfer = host_ptr->_periph_periphconf._usart_transfer;
+
+  if(host_transfer != NULL){
+    return host_transfer(host_object, WRITE, frame, frame_len, NULL, 0);
+  }
+
+  dw_Cs(host_object, MPI_CS_ASSERT);
+  uint32_t ret = host_usart(host_object, WRITE, frame, frame_len);
+  dw_Cs(host_object, MPI_CS_DEASSERT);
+
   return ret;
 }
 
@@ -9,7 +9,11 @@ extern uint32_t(*dw_comm_table[])();
 extern void(* dw_PolAlphaDeAssert[DW_SPI_POLALPA_VARIANTS])();
 extern void(* dw_PolAlphaAssert[DW_SPI_POLALPA_VARIANTS])();
 
+void dw_Cs(void* host_object, uint32_t level);
 uint32_t dw_Rx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t* buffer_in, uint32_t buffer_len);
 uint32_t dw_Tx(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t* buffer_in, uint32_t buffer_len);
+uint32_t dw_regHeader(uint8_t* header, uint32_t read_write, uint8_t reg_id, uint16_t offset);
+uint32_t dw_RxReg(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t reg_id, uint16_t offset, uint8_t* buffer_in, uint32_t buffer_len);
+uint32_t dw_TxReg(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t reg_id, uint16_t offset, uint8_t* buffer_out, uint32_t buffer_len);
 
 #endif
@@ -88,14 +88,23 @@ uint32_t dw_nodeCreate(DW_nodelist* dw_nodelist, uint8_t* tag_id){
    */
   uint32_t i = 0;
 
-  while((dw_nodelist->list[i].dev_status == DW_DEV_ACTIVE) && (++i < NODELIST_LEN)){
+  //dw_nodeSort keeps the active nodes packed at the bottom of the list
+  //
+  while((i < NODELIST_LEN) && (dw_nodelist->list[i].dev_status == DW_DEV_ACTIVE)){
     ++i;
   }
+  if(i == NODELIST_LEN){
+    return ERROR;
+  }
 
   for(int j = 0; j < BLINK_SRC_ADDR_LEN; j++){
     dw_nodelist->list[i].tag_id[j] = tag_id[j];
   }
   dw_nodelist->list[i].dev_status = DW_DEV_ACTIVE;
+
+  //a reused slot still has the last tag's track in it, seed from this tag's first range
+  //
+  dw_nodelist->list[i].filter.state = DW_RANGE_FILTER_EMPTY;
  
   return i; 
 }  
@@ -103,11 +112,12 @@ uint32_t dw_nodeCreate(DW_nodelist* dw_nodelist, uint8_t* tag_id){
 
 uint32_t dw_nodeSort(DW_nodelist* dw_nodelist, uint32_t node_index){
 
-  uint32_t i = 0; //node_index;
+  uint32_t i = node_index;
 
-  while((dw_nodelist->list[i].dev_status == DW_DEV_ACTIVE) && (i < NODELIST_LEN)){
+  //close the gap at node_index, returns the slot left empty at the top
+  //
+  while((i + 1 < NODELIST_LEN) && (dw_nodelist->list[i+1].dev_status == DW_DEV_ACTIVE)){
     memcpy(&dw_nodelist->list[i], &dw_nodelist->list[i+1], sizeof(DW_data));
-    //dw_nodelist->list[i] = dw_nodelist->list[i+1];
     ++i;
   }
   return i;
@@ -127,16 +137,27 @@ uint32_t dw_nodeDelete(DW_nodelist* dw_nodelist, uint8_t* tag_id){
   
   if(node_index <= NODELIST_LEN_COUNT){
     dw_nodelist->list[node_index].dev_status = DW_DEV_DISABLED;
+    dw_nearestRemove(dw_nodelist, node_index);
   
     uint32_t(* node_sort)() = node_list_table[DW_NODE_SORT];
     uint32_t index = node_sort(dw_nodelist, node_index);
     dw_nodelist->list[index].dev_status = DW_DEV_DISABLED;
+
+    //node_sort shifted every record above node_index down by one,
+    //so shift the heap references with them
+    for(uint32_t i = 0; i < dw_nodelist->nearest_len; i++){
+      if(dw_nodelist->nearest_heap[i] > node_index){
+        dw_nodelist->nearest_heap[i]--;
+      }
+    }
+    for(uint32_t i = node_index; i + 1 < NODELIST_LEN; i++){
+      dw_nodelist->nearest_pos[i] = dw_nodelist->nearest_pos[i+1];
+    }
+    dw_nodelist->nearest_pos[NODELIST_LEN - 1] = DW_NEAREST_NONE;
     return EXIT_SUCCESS; 
-  } else {
-    dw_nodelist->list[node_index].dev_status = DW_DEV_DISABLED;
   }
 
-  return EXIT_SUCCESS;
+  return ERROR;
 }
 
 
@@ -168,24 +189,213 @@ uint32_t dw_nodeSearch(DW_nodelist* dw_nodelist, uint8_t* tag_id){
   
   uint32_t node_index = 0; 
 
-  while((dw_nodelist->list[node_index].dev_status == DW_DEV_ACTIVE) && (node_index < NODELIST_LEN)){
-    for(int j = 0; j < EUI_64_LEN; j++){
-      if((dw_nodelist->list[node_index].tag_id[j] & tag_id[j]) == 0){
-        if(j == EUI_64_LEN){
-          return node_index;
-        }
-        continue;
-      } else {
-        ++node_index;
-        j = 0;
-      }
-    } //end for loop
-  } //end while loop
+  while((node_index < NODELIST_LEN) && (dw_nodelist->list[node_index].dev_status == DW_DEV_ACTIVE)){
+    if(memcmp(dw_nodelist->list[node_index].tag_id, tag_id, EUI_64_LEN) == 0){
+      return node_index;
+    }
+    ++node_index;
+  }
 
   return ERROR; 
 }
 
 
+/*******************************************************
+ *             NEAREST-N VIEW (INDEX MIN-HEAP)
+ ******************************************************/
+
+/*
+ * The nodelist keeps a binary min-heap of list[] indices ordered by
+ * .distance, plus the reverse map nearest_pos[] so a node can be found
+ * in the heap without searching. Only 16-bit indices are moved around,
+ * the DW_data records themselves never are.
+ *
+ *  - dw_nearestUpdate:  O(log N), call after a node's distance changes
+ *  - dw_nearestRemove:  O(log N), call before a node is deleted
+ *  - dw_nearestQuery:   nearest K in ascending order, O(K log K) and
+ *                       independent of how many nodes are tracked. K is
+ *                       at most DW_NEAREST_MAX, the frontier never holds
+ *                       more than K slots
+ */
+
+static float dw_nearestKey(DW_nodelist* dw_nodelist, uint32_t heap_slot){
+  return dw_nodelist->list[dw_nodelist->nearest_heap[heap_slot]].distance;
+}
+
+static void dw_nearestSwap(DW_nodelist* dw_nodelist, uint32_t a, uint32_t b){
+  uint16_t tmp = dw_nodelist->nearest_heap[a];
+  dw_nodelist->nearest_heap[a] = dw_nodelist->nearest_heap[b];
+  dw_nodelist->nearest_heap[b] = tmp;
+  dw_nodelist->nearest_pos[dw_nodelist->nearest_heap[a]] = a;
+  dw_nodelist->nearest_pos[dw_nodelist->nearest_heap[b]] = b;
+}
+
+static void dw_nearestSift(DW_nodelist* dw_nodelist, uint32_t slot){
+
+  //up
+  while(slot > 0){
+    uint32_t parent = (slot - 1) >> 1;
+    if(dw_nearestKey(dw_nodelist, parent) <= dw_nearestKey(dw_nodelist, slot)){
+      break;
+    }
+    dw_nearestSwap(dw_nodelist, parent, slot);
+    slot = parent;
+  }
+
+  //down
+  for(;;){
+    uint32_t left = (slot << 1) + 1;
+    uint32_t right = left + 1;
+    uint32_t smallest = slot;
+
+    if((left < dw_nodelist->nearest_len) && (dw_nearestKey(dw_nodelist, left) < dw_nearestKey(dw_nodelist, smallest))){
+      smallest = left;
+    }
+    if((right < dw_nodelist->nearest_len) && (dw_nearestKey(dw_nodelist, right) < dw_nearestKey(dw_nodelist, smallest))){
+      smallest = right;
+    }
+    if(smallest == slot){
+      break;
+    }
+    dw_nearestSwap(dw_nodelist, slot, smallest);
+    slot = smallest;
+  }
+}
+
+uint32_t dw_nearestUpdate(DW_nodelist* dw_nodelist, uint32_t node_index){
+
+  if(node_index >= NODELIST_LEN){
+    return ERROR;
+  }
+
+  uint32_t slot = dw_nodelist->nearest_pos[node_index];
+
+  if(slot == DW_NEAREST_NONE){
+    slot = dw_nodelist->nearest_len++;
+    dw_nodelist->nearest_heap[slot] = node_index;
+    dw_nodelist->nearest_pos[node_index] = slot;
+  }
+
+  dw_nearestSift(dw_nodelist, slot);
+  return EXIT_SUCCESS;
+}
+
+uint32_t dw_nearestRemove(DW_nodelist* dw_nodelist, uint32_t node_index){
+
+  if(node_index >= NODELIST_LEN){
+    return ERROR;
+  }
+
+  uint32_t slot = dw_nodelist->nearest_pos[node_index];
+
+  if(slot == DW_NEAREST_NONE){
+    return EXIT_SUCCESS;
+  }
+
+  uint32_t last = --dw_nodelist->nearest_len;
+
+  if(slot != last){
+    dw_nearestSwap(dw_nodelist, slot, last);
+  }
+  dw_nodelist->nearest_pos[node_index] = DW_NEAREST_NONE;
+
+  if(slot != last){
+    dw_nearestSift(dw_nodelist, slot);
+  }
+  return EXIT_SUCCESS;
+}
+
+static void dw_nearestFrontierPush(DW_nodelist* dw_nodelist, uint16_t* frontier, uint32_t* frontier_len, uint16_t slot){
+
+  uint32_t i = (*frontier_len)++;
+  frontier[i] = slot;
+
+  while(i > 0){
+    uint32_t parent = (i - 1) >> 1;
+    if(dw_nearestKey(dw_nodelist, frontier[parent]) <= dw_nearestKey(dw_nodelist, frontier[i])){
+      break;
+    }
+    uint16_t tmp = frontier[parent];
+    frontier[parent] = frontier[i];
+    frontier[i] = tmp;
+    i = parent;
+  }
+}
+
+static uint16_t dw_nearestFrontierPop(DW_nodelist* dw_nodelist, uint16_t* frontier, uint32_t* frontier_len){
+
+  uint16_t top = frontier[0];
+  frontier[0] = frontier[--(*frontier_len)];
+
+  uint32_t i = 0;
+  for(;;){
+    uint32_t left = (i << 1) + 1;
+    uint32_t smallest = i;
+
+    if((left < *frontier_len) && (dw_nearestKey(dw_nodelist, frontier[left]) < dw_nearestKey(dw_nodelist, frontier[smallest]))){
+      smallest = left;
+    }
+    if((left + 1 < *frontier_len) && (dw_nearestKey(dw_nodelist, frontier[left + 1]) < dw_nearestKey(dw_nodelist, frontier[smallest]))){
+      smallest = left + 1;
+    }
+    if(smallest == i){
+      break;
+    }
+    uint16_t tmp = frontier[smallest];
+    frontier[smallest] = frontier[i];
+    frontier[i] = tmp;
+    i = smallest;
+  }
+  return top;
+}
+
+/*
+ * Copy the indexes of the k nearest nodes into node_indexes[], closest
+ * first. Walks the heap with a second small heap of candidate slots (at
+ * most k+1 of them) instead of touching the whole list.
+ *
+ * returns the number of indexes written
+ */
+uint32_t dw_nearestQuery(DW_nodelist* dw_nodelist, uint16_t* node_indexes, uint32_t k){
+
+  uint16_t frontier[DW_NEAREST_MAX];
+  uint32_t frontier_len = 0;
+  uint32_t count = 0;
+
+  if(k > DW_NEAREST_MAX){
+    return 0;
+  }
+  if(k > dw_nodelist->nearest_len){
+    k = dw_nodelist->nearest_len;
+  }
+  if(k == 0){
+    return 0;
+  }
+
+  dw_nearestFrontierPush(dw_nodelist, frontier, &frontier_len, 0);
+
+  while(count < k){
+
+    uint32_t slot = dw_nearestFrontierPop(dw_nodelist, frontier, &frontier_len);
+    node_indexes[count++] = dw_nodelist->nearest_heap[slot];
+
+    //its children are the only new candidates, none needed after the last
+    uint32_t left = (slot << 1) + 1;
+    if(count == k){
+      break;
+    }
+    if(left < dw_nodelist->nearest_len){
+      dw_nearestFrontierPush(dw_nodelist, frontier, &frontier_len, left);
+    }
+    if(left + 1 < dw_nodelist->nearest_len){
+      dw_nearestFrontierPush(dw_nodelist, frontier, &frontier_len, left + 1);
+    }
+  }
+
+  return count;
+}
+
+
 uint32_t(* node_list_table[DW_NODE_TABLE_LEN])() = {
   dw_nodeSearch,
   dw_nodeCreate,
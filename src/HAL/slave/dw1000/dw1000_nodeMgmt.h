@@ -8,6 +8,10 @@
 
 uint32_t(* node_list_table[DW_NODE_TABLE_LEN])();
 
+uint32_t dw_nearestUpdate(DW_nodelist* dw_nodelist, uint32_t node_index);
+uint32_t dw_nearestRemove(DW_nodelist* dw_nodelist, uint32_t node_index);
+uint32_t dw_nearestQuery(DW_nodelist* dw_nodelist, uint16_t* node_indexes, uint32_t k);
+
 
 #endif
 
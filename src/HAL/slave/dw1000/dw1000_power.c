@@ -0,0 +1,242 @@
+ /* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+ 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpi_port.h"
+#include "dw1000_types.h"
+#include "dw1000_regs.h"
+#include "dw1000_commRxTx.h"
+#include "dw1000_power.h"
+
+/*******************************************************
+ *            SLEEP / WAKEUP / AON CONFIG
+ ******************************************************/
+
+/*
+ * Sequence for a duty cycled tag/anchor:
+ *
+ *  - dw_aonConfigure() writes AON_WCFG/CFG0/CFG1 and uploads them to the
+ *    AON block, only when they differ from what was last uploaded
+ *  - dw_aonEnterSleep() forces TRXOFF then AON_CTRL.SAVE, the DW1000
+ *    copies its host registers into AON memory and goes to sleep
+ *  - dw_spiWake() holds SPICSn low with a dummy read, then polls DEV_ID
+ *    until the part answers. ONW_LDC restores the register set so no
+ *    dw_Init() is needed, ONW_LLDE reloads LDE only in DW_MODE_LEVEL_TWR.
+ *    The wake is timed off the host's _timer_now, or _timer_stamp, when
+ *    it has one; the poll count is kept either way
+ */
+
+uint32_t dw_writeU32(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t reg_id, uint16_t offset, uint32_t value, uint32_t len);
+void dw_hostDelay(void* host_object, uint32_t delay_ms);
+uint32_t dw_hostClock(void* host_object, uint64_t* now, uint32_t* hz);
+
+uint32_t dw_writeU32(void* host_object, int(*host_usart)(), void* ext_dev_object, uint8_t reg_id, uint16_t offset, uint32_t value, uint32_t len){
+
+  uint8_t buffer[4];
+
+  for(uint32_t i = 0; i < len; i++){
+    buffer[i] = (value >> (i * SINGLE_BYTE_SHIFT)) & SINGLE_BYTE;
+  }
+  return dw_TxReg(host_object, host_usart, ext_dev_object, reg_id, offset, buffer, len);
+}
+
+void dw_hostDelay(void* host_object, uint32_t delay_ms){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_timer_delay = host_ptr->_periph_periphconf._timer_delay;
+
+  if(host_timer_delay != NULL){
+    host_timer_delay(delay_ms);
+  }
+}
+
+/*
+ * A reading off the host's clock and its rate, ns off _timer_now or the
+ * free running count off _timer_stamp. ERROR if the host has neither.
+ */
+uint32_t dw_hostClock(void* host_object, uint64_t* now, uint32_t* hz){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_timer_now = host_ptr->_periph_periphconf._timer_now;
+  int_callback host_timer_stamp = host_ptr->_periph_periphconf._timer_stamp;
+
+  if(host_timer_now != NULL){
+    *hz = DW_NS_PER_S;
+    return (host_timer_now(host_object, now) == 0 ? EXIT_SUCCESS : ERROR);
+  }
+  if(host_timer_stamp != NULL){
+    *now = (uint32_t)host_timer_stamp(hz);
+    return (*hz != 0 ? EXIT_SUCCESS : ERROR);
+  }
+  return ERROR;
+}
+
+
+uint32_t dw_trxOff(void* host_object, int(*host_usart)(), void* ext_dev_object){
+  return dw_writeU32(host_object, host_usart, ext_dev_object, SYS_CTRL_ID, 0, SYS_CTRL_TRXOFF, SYS_CTRL_LEN);
+}
+
+
+uint32_t dw_aonConfigure(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power, uint32_t aon_state){
+
+  uint32_t wcfg = AON_WCFG_PRES_SLEEP | AON_WCFG_ONW_LDC | AON_WCFG_ONW_RADC;
+  uint32_t cfg0 = AON_CFG0_SLEEP_EN | AON_CFG0_WAKE_SPI | AON_CFG0_WAKE_PIN;
+  uint32_t cfg1 = 0;
+
+  if(dw_power->mode_level == DW_MODE_LEVEL_TWR){
+    wcfg |= AON_WCFG_ONW_LLDE;
+  }
+
+  if(aon_state == DW_AON_TIMED){
+    cfg0 |= AON_CFG0_WAKE_CNT | AON_CFG0_LPDIV_EN;
+    cfg0 |= ((uint32_t)dw_power->lp_clk_div << AON_CFG0_LPCLKDIVA_SHIFT) & AON_CFG0_LPCLKDIVA_MASK;
+    cfg0 |= ((uint32_t)dw_power->sleep_count << AON_CFG0_SLEEP_SHIFT) & AON_CFG0_SLEEP_TIM;
+    cfg1 = AON_CFG1_SLEEP_CEN;
+  }
+
+  //cfg1 follows from aon_state
+  //
+  if((dw_power->aon_state == aon_state) && (dw_power->aon_wcfg == wcfg) && (dw_power->aon_cfg0 == cfg0)){
+    return EXIT_SUCCESS;
+  }
+
+  dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_WCFG_OFFSET, wcfg, AON_WCFG_LEN);
+  dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CFG0_OFFSET, cfg0, AON_CFG0_LEN);
+  dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CFG1_OFFSET, cfg1, AON_CFG1_LEN);
+
+  //upload CFG0/CFG1 into the AON block
+  dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CTRL_OFFSET, 0, AON_CTRL_LEN);
+  int ret = dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CTRL_OFFSET, AON_CTRL_UPL_CFG, AON_CTRL_LEN);
+  dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CTRL_OFFSET, 0, AON_CTRL_LEN);
+
+  if(ret != EXIT_SUCCESS){
+    dw_power->aon_state = DW_AON_NONE;
+    return ERROR;
+  }
+
+  dw_power->aon_state = aon_state;
+  dw_power->aon_wcfg = wcfg;
+  dw_power->aon_cfg0 = cfg0;
+  return EXIT_SUCCESS;
+}
+
+
+uint32_t dw_aonEnterSleep(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power){
+
+  dw_trxOff(host_object, host_usart, ext_dev_object);
+
+  dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CTRL_OFFSET, 0, AON_CTRL_LEN);
+  int ret = dw_writeU32(host_object, host_usart, ext_dev_object, AON_ID, AON_CTRL_OFFSET, AON_CTRL_SAVE, AON_CTRL_LEN);
+
+  if(ret != EXIT_SUCCESS){
+    return ERROR;
+  }
+
+  //LDE code RAM does not survive sleep
+  dw_power->lde_loaded = false;
+  dw_power->asleep = true;
+  return EXIT_SUCCESS;
+}
+
+
+uint32_t dw_spiWake(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power){
+
+  uint8_t wake[DW_WAKE_SPI_LEN];
+  uint8_t dev_id[DEVICE_ID_LEN];
+  uint64_t start = 0;
+  uint64_t end = 0;
+  uint32_t hz = 0;
+  uint32_t timed = (dw_hostClock(host_object, &start, &hz) == EXIT_SUCCESS);
+
+  //long read keeps SPICSn low for long enough to wake the part
+  dw_RxReg(host_object, host_usart, ext_dev_object, DEV_ID_ID, 0, wake, DW_WAKE_SPI_LEN);
+  dw_hostDelay(host_object, DW_WAKE_SETTLE_MS);
+
+  for(uint32_t polls = 1; polls <= DW_WAKE_POLLS; polls++){
+
+    dw_RxReg(host_object, host_usart, ext_dev_object, DEV_ID_ID, 0, dev_id, DEVICE_ID_LEN);
+
+    uint32_t id = dev_id[0] | (dev_id[1] << SINGLE_BYTE_SHIFT) | (dev_id[2] << DOUBLE_BYTE_SHIFT) | ((uint32_t)dev_id[3] << TRIPLE_BYTE_SHIFT);
+
+    if(id == DW_DEV_ID_VALUE){
+      dw_power->asleep = false;
+      dw_power->wake_polls = polls;
+      dw_power->wake_latency_us = 0;
+
+      //stamps are 32 bits and wrap, ns from _timer_now don't
+      //
+      if(timed && dw_hostClock(host_object, &end, &hz) == EXIT_SUCCESS){
+        uint64_t elapsed = (hz == DW_NS_PER_S ? end - start : (uint32_t)(end - start));
+
+        dw_power->wake_latency_us = (uint32_t)((elapsed * DW_US_PER_S) / hz);
+      }
+      if(dw_power->wake_latency_us > dw_power->wake_latency_max_us){
+        dw_power->wake_latency_max_us = dw_power->wake_latency_us;
+      }
+      //ONW_LLDE reloaded the microcode on the way up
+      dw_power->lde_loaded = (dw_power->mode_level == DW_MODE_LEVEL_TWR);
+      return EXIT_SUCCESS;
+    }
+
+    dw_hostDelay(host_object, 1);
+  }
+
+  return ERROR;
+}
+
+
+uint32_t dw_ldeLoad(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power){
+
+  if(dw_power->lde_loaded){
+    return EXIT_SUCCESS;
+  }
+
+  dw_writeU32(host_object, host_usart, ext_dev_object, PMSC_ID, PMSC_CTRL0_OFFSET, PMSC_CTRL0_LDE_LOAD, 2);
+  dw_writeU32(host_object, host_usart, ext_dev_object, OTP_IF_ID, OTP_CTRL, OTP_CTRL_LDELOAD, OTP_CTRL_LEN);
+  dw_hostDelay(host_object, DW_LDE_LOAD_MS);
+  int ret = dw_writeU32(host_object, host_usart, ext_dev_object, PMSC_ID, PMSC_CTRL0_OFFSET, PMSC_CTRL0_LDE_DONE, 2);
+
+  if(ret != EXIT_SUCCESS){
+    return ERROR;
+  }
+
+  dw_power->lde_loaded = true;
+  return EXIT_SUCCESS;
+}
+
+
+uint32_t dw_softReset(void* host_object, int(*host_usart)(), void* ext_dev_object){
+
+  uint8_t ctrl0[PMSC_CTRL0_LEN];
+
+  //clocks to xti, then pulse SOFTRESET (PMSC_CTRL0 bits 28-31), leaving
+  //the rx/tx clock selects and the rest of the register as they were
+  //
+  if(dw_RxReg(host_object, host_usart, ext_dev_object, PMSC_ID, PMSC_CTRL0_OFFSET, ctrl0, PMSC_CTRL0_LEN) != EXIT_SUCCESS){
+    return ERROR;
+  }
+  ctrl0[0] = (ctrl0[0] & ~PMSC_CTRL0_SYSCLKS_MASK) | PMSC_CTRL0_SYSCLKS_19M;
+  ctrl0[3] &= ~PMSC_CTRL0_SOFTRESET_BYTE;
+
+  dw_writeU32(host_object, host_usart, ext_dev_object, PMSC_ID, PMSC_CTRL0_OFFSET, ctrl0[0], 1);
+  dw_writeU32(host_object, host_usart, ext_dev_object, PMSC_ID, PMSC_CTRL0_OFFSET + 3, ctrl0[3], 1);
+  dw_hostDelay(host_object, 1);
+  return dw_writeU32(host_object, host_usart, ext_dev_object, PMSC_ID, PMSC_CTRL0_OFFSET + 3, ctrl0[3] | PMSC_CTRL0_SOFTRESET_BYTE, 1);
+}
@@ -0,0 +1,15 @@
+#ifndef DW1000_POWER_H_
+#define DW1000_POWER_H_
+
+#include <stdint.h>
+
+#include "dw1000_types.h"
+
+uint32_t dw_trxOff(void* host_object, int(*host_usart)(), void* ext_dev_object);
+uint32_t dw_aonConfigure(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power, uint32_t aon_state);
+uint32_t dw_aonEnterSleep(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power);
+uint32_t dw_spiWake(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power);
+uint32_t dw_ldeLoad(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_power* dw_power);
+uint32_t dw_softReset(void* host_object, int(*host_usart)(), void* ext_dev_object);
+
+#endif
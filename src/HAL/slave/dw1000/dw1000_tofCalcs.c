@@ -24,6 +24,7 @@
 #include "dw1000_tofCalcs.h"
 #include "dw1000_types.h"
 #include "dw1000_commRxTx.h"
+#include "dw1000_nodeMgmt.h"
 
 /*
  *  RANGING AND TIMESTAMP FUNCTIONS
@@ -56,6 +57,7 @@ void dw_tx_resp_ts(void* host_object, int(*host_usart)(), void* ext_dev_object,
 void dw_tx_final_ts(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t nodelist_index);
 void dw_tof_dist(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t nodelist_index);
 uint32_t dw_deviceStore(DW_nodelist* dw_nodelist, uint32_t node_index);
+uint32_t dw_rangeFilter(DW_range_filter* filter, float measured_range);
 
 
 void dw_tx_poll_ts(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t nodelist_index){
@@ -102,9 +104,8 @@ void dw_tx_resp_ts(void* host_object, int(*host_usart)(), void* ext_dev_object,
   tx_antenna_delay = (tx_antenna_delay << SINGLE_BYTE_SHIFT) | dw_config->tx_ant_delay[0];
   
   //store resp_tx_time in the config struct and then write to device
-  dw_config->rf_tx_delay[0] = (resp_tx_delay & SINGLE_BYTE);
-  for(int i = 1; i < 8; i++){
-    dw_config->rf_tx_delay[i] |= (resp_tx_delay >> SINGLE_BYTE_SHIFT) & SINGLE_BYTE;
+  for(int i = 0; i < RF_TX_DELAY_LEN; i++){
+    dw_config->rf_tx_delay[i] = (resp_tx_delay >> (i * SINGLE_BYTE_SHIFT)) & SINGLE_BYTE;
   }
 
 
@@ -114,8 +115,7 @@ void dw_tx_resp_ts(void* host_object, int(*host_usart)(), void* ext_dev_object,
   dw_config->sub_addr_index = 0;
 
   //put the data in the config buffer
-  void(*config_member_ptr)() = config_table[(int)enum_member]; 
-  config_member_ptr(dw_config, enum_member);
+  dw_regConfig(dw_config, enum_member);
   
   //build the spi transaction header and frame
   volatile uint32_t(* build_msg_ptr)() = dw_decode_build_table[WRITE];
@@ -151,9 +151,8 @@ void dw_tx_final_ts(void* host_object, int(*host_usart)(), void* ext_dev_object,
   tx_antenna_delay = (tx_antenna_delay << SINGLE_BYTE_SHIFT) | dw_config->tx_ant_delay[0];
 
   //store resp_tx_time in the config struct and then write to device
-  dw_config->rf_tx_delay[0] = (final_tx_delay & SINGLE_BYTE);
-  for(int i = 1; i < 8; i++){
-    dw_config->rf_tx_delay[i] |= (final_tx_delay >> SINGLE_BYTE_SHIFT) & SINGLE_BYTE;
+  for(int i = 0; i < RF_TX_DELAY_LEN; i++){
+    dw_config->rf_tx_delay[i] = (final_tx_delay >> (i * SINGLE_BYTE_SHIFT)) & SINGLE_BYTE;
   }
 
   //Build the message header and transmit configuration to device 
@@ -162,8 +161,7 @@ void dw_tx_final_ts(void* host_object, int(*host_usart)(), void* ext_dev_object,
   dw_config->sub_addr_index = 0;
 
   //put the data in the config buffer
-  void(*config_member_ptr)() = config_table[(int)enum_member]; 
-  config_member_ptr(dw_config, enum_member);
+  dw_regConfig(dw_config, enum_member);
   
   //build the spi transaction header and frame
   volatile uint32_t(* build_msg_ptr)() = dw_decode_build_table[WRITE];
@@ -220,72 +218,59 @@ uint32_t dw_deviceStore(DW_nodelist* dw_nodelist, uint32_t nodelist_index){
     return ERROR;
   }
 
- uint32_t node_index = nodelist_index;
-
-//UNCOMMENT ALL CODE FOR STORING AND AGGREGATING DEVICES IN NEW DEVICE LIST
+  uint32_t node_index = nodelist_index;
 
-// DW_data dw_data;
-// memcpy(&dw_data, &dw_nodelist->list[node_index], sizeof(DW_data))
+  //raw distance stays in tof.final_distance, publish the filtered range
+  //
+  DW_data* dw_data = &dw_nodelist->list[node_index];
+  dw_rangeFilter(&dw_data->filter, (float)dw_data->tof.final_distance);
+  dw_data->distance = dw_data->filter.range;
 
- DW_nodelist* node_list = dw_nodelist;
-// DW_network_dev* dev_list = &dw_nodelist->devices[0];
-  
-// DW_network_dev tmp_1;
-// DW_network_dev tmp_2;
- 
-//double new_distance = dw_data.tof.final_distance;
-// float active_distance = dev_list[0].distance;
+  //keep the nearest-N view ordered, only node indexes move
+  //
+  return dw_nearestUpdate(dw_nodelist, node_index);
+}
 
-dw_nodelist->list[node_index].distance = dw_nodelist->list[node_index].tof.final_distance;
+/*******************************************************
+ *              RANGE FILTER (ALPHA-BETA)
+ ******************************************************/
 
 /*
- int i = 0; 
- 
- while(active_distance <= new_distance){
-   i++;
-   active_distance = dev_list[i].distance;
- }
- 
- //memcpy(&tmp_1, &dev_list[i], sizeof(DW_network_dev));
- tmp_1 = dev_list[i];
-*/
+ * One predict/update step of the per-node alpha-beta filter. Fixed
+ * cost, no loops, so it can run on every final frame.
+ *
+ * returns EXIT_SUCCESS if the measurement was used, ERROR if it was
+ * gated out (filter->range then holds the prediction)
+ */
+uint32_t dw_rangeFilter(DW_range_filter* filter, float measured_range){
+
+  if(filter->state == DW_RANGE_FILTER_EMPTY){
+    filter->range = measured_range;
+    filter->velocity = 0;
+    filter->reject_count = 0;
+    filter->state = DW_RANGE_FILTER_SEEDED;
+    return EXIT_SUCCESS;
+  }
 
-/*
- for(int j = 0; j < BLINK_SHORT_ADDR_LEN; j++){
-  node_list->devices[i].tag_id[j] = dw_data.tag_id[j];
- }
- node_list->devices[i].distance = new_distance;
-*/
+  float predicted = filter->range + filter->velocity;
+  float innovation = measured_range - predicted;
+
+  if((innovation > DW_RANGE_FILTER_GATE) || (innovation < -DW_RANGE_FILTER_GATE)){
+    filter->reject_count++;
+    if(filter->reject_count >= DW_RANGE_FILTER_MAX_REJECTS){
+      //persistent jump, the tag really moved so start again from here
+      filter->state = DW_RANGE_FILTER_EMPTY;
+      return dw_rangeFilter(filter, measured_range);
+    }
+    filter->range = predicted;
+    return ERROR;
+  }
 
-/*
- if(i+1 != ACTIVE_DEVICES_LEN){
-  active_distance = dev_list[i+1].distance;
- } else {
-  return EXIT_SUCCESS;
- }
-*/
+  filter->reject_count = 0;
+  filter->range = predicted + (DW_RANGE_FILTER_ALPHA * innovation);
+  filter->velocity = filter->velocity + (DW_RANGE_FILTER_BETA * innovation);
 
-/*
- while(active_distance >= tmp_1.distance){
-   //memcpy(&tmp_2, &dev_list[i], sizeof(DW_network_dev));
-   //memcpy(&dev_list[i], &tmp_1, sizeof(DW_network_dev));
-   //memcpy(&tmp_1, &tmp_2, sizeof(DW_network_dev));
-   
-   tmp_2 = dev_list[i];
-   dev_list[i] = tmp_1;
-   tmp_1 = tmp_2;
-   
-   i++;
-   if((i) != ACTIVE_DEVICES_LEN){
-    active_distance = dev_list[i].distance;
-   } else {
-     return EXIT_SUCCESS;
-   }
- }
- 
- return ERROR;
- */
- return EXIT_SUCCESS;
+  return EXIT_SUCCESS;
 }
 
 void (* dw_ts_handler_table[TS_HANDLER_TABLE_LEN])() = {
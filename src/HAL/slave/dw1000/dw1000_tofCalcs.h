@@ -7,5 +7,6 @@
 
 extern void (* dw_ts_handler_table[])();
 uint32_t dw_deviceStore(DW_nodelist* dw_nodelist, uint32_t nodelist_index);
+uint32_t dw_rangeFilter(DW_range_filter* filter, float measured_range);
 
 #endif 
@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "mpi_port.h"
 
@@ -30,49 +31,12 @@
 #include "dw1000_commRxTx.h"
 #include "dw1000_tofCalcs.h"
 
+#define DW_REG_ID(name, reg_id, ...)  reg_id,
+
 uint8_t dw_reg_id_table[REG_IDS_LEN] = { 
-  
-  0x01, //eui
-  0x03, //pan addr
-  0x04, //sys cfg
-  0x08, //tx frame ctrl
-  0x0A, //delayed send or receive time
-  0x0D, //sys ctrl reg
-  0x0E, //sys event mask
-  0x0F, //sys event status
-  0x18, //ant delay
-  0x1A, //ack resp time
-  0x1D, //pulsed preamble rx config
-  0x1E, //tx power ctrl
-  0x1F, //channel ctrl
-  0x00, //device id 
-  0x0C, //rx frame wait timeout
-  0x12, //rx frame quality info
-  0x13, //rx time tracking interval
-  0x19, //sys state
-  
-  0x06, //sys time
-  0x09, //tx buffer,
-  0x10, //rx frame info
-  0x11, //rx data
-  0x14, //rx time tracking offset
-  0x15, //rx msg time of arrival
-  0x17, //tx message time of sending
-  
-  0x21, //user-defined SFD
-  0x23, //auto gain ctrl config
-  0x24, //ext sync
-  0x25, //accum read acces
-  0x26, //gpio ctrl 
-  0x27, //digital rx config
-  0x28, //analog rf config
-  0x2A, //tx calibration
-  0x2B, //freq synth ctrl 
-  0x2C, //AON reg
-  0x2D, //OTP
-  0x2E, //LDE ctrl
-  0x2F, //digital diagnostics
-  0x36, //power mgmt system ctrl 
+  DW_REG_CONFIG_LIST(DW_REG_ID)
+  DW_REG_QUERY_LIST(DW_REG_ID)
+  DW_REG_ACCESS_LIST(DW_REG_ID)
 };
 
 
@@ -100,482 +64,112 @@ const uint32_t dw_fn_code_table[DECODE_TABLE_LEN] = {
 
 
 
-uint32_t config_table_len[CONFIG_STRUCT_MEMBERS] = {
-  EUI_64_LEN,                   // config_unique_id
-  PAN_ID_LEN,                   // config_pan_id
-  SYS_CONFIG_LEN,               // config_sys_conf
-  TX_FRAME_CTRL_LEN,            // config_tx_frame_ctrl
-  RF_TX_DELAY_LEN,              // rf_tx_delay
-  SYS_CTRL_REG_LEN,             // sys_ctrl_reg
-  SYS_EVENT_MASK_LEN,           // sys_event_mask
-  SYS_EVENT_STATUS_LEN,         // sys_event_status
-  TX_ANT_DELAY_LEN,             // tx_ant_delay
-  ACK_RESP_TIME_LEN,            // ack_resp_time
-  PREAMBLE_RX_CONFIG_LEN,       // preamble_rx_config
-  TX_POWER_CTRL_LEN,            // tx_power_ctrl
-  CHAN_CTRL_LEN                 // chan_ctrl
-};
-
-/*
-  unique_id,
-  pan_id,
-  sys_conf,
-  tx_frame_ctrl,
-  rf_tx_delay,
-  sys_ctrl_reg,
-  sys_event_mask,
-  sys_event_status,
-  tx_ant_delay,
-  ack_resp_time,
-  preamble_rx_config,
-  tx_power_ctrl,
-  chan_ctrl,
-  device_id,
-  sys_time,
-  rx_frame_timeout,
-  rx_frame_qual,
-  rx_time_tracking_interval,
-  sys_state_info,
-  //end of config/query for loop, the remaining entries are for universal access via a single enum type
-  tx_buffer,
-  rx_frame_info,
-  rx_buffer,
-  rx_time_tracking_offset,
-  rx_arrival_time,
-  tx_send_time,
-  user_sfd,
-  auto_gain_ctrl_config,
-  ext_clk_sync,
-  accum_read,
-  gpio_ctrl,
-  digi_rx_config,
-  analog_rf_config,
-  tx_calib,
-  freq_synth_ctrl,
-  aon_reg,
-  otp,
-  lde_ctrl,
-  digi_diag,  
-  pwr_mgmt_sys_ctrl,
-*/
-
+/***************************************************************************************/
 
 /*
- *  config fns for message header
+ * REGISTER DESCRIPTOR TABLE
  */
 
-/*
-  uint8_t unique_id[EUI_64_LEN]; // device id (ieee unique 64-bit identifier)
-  uint8_t pan_id[PAN_ID_LEN];
-  uint8_t sys_conf[SYS_CFG_LEN];
-  uint8_t tx_frame_ctrl[TX_FRAME_CTRL_LEN]; 
-  uint8_t sys_ctrl_reg[4];
-  uint8_t sys_event_mask[4];
-  uint8_t sys_event_status[4];
-  uint8_t tx_ant_delay[2];
-  uint8_t sys_state_info[5];
-  uint8_t ack_resp_time[4];
-  uint8_t preamble_rx_config[4];
-  uint8_t tx_power_ctrl[4];
-  uint8_t chan_ctrl[4];
-*/
-
-void config_unique_id(DW_config* dw_config){
-  dw_config->reg_id_index = unique_id;
-  dw_config->config_buffer_len = config_table_len[EUI_64_LEN_INDEX]; //call to config_table_len[]
-  int len = EUI_64_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->unique_id[i];
-  }
-}
-
-void config_pan_id(DW_config* dw_config){
-  dw_config->reg_id_index = pan_id;
-  dw_config->config_buffer_len = config_table_len[PAN_ID_LEN_INDEX]; //call to config_table_len[]
-  int len = PAN_ID_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->pan_id[i];
-  } 
-}
-
-void config_sys_conf(DW_config* dw_config){
-  dw_config->reg_id_index = sys_conf;
-  dw_config->config_buffer_len = config_table_len[SYS_CONFIG_LEN_INDEX]; //call to config_table_len[]
-  int len = SYS_CFG_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->sys_conf[i];
-  } 
-}
-
-void config_tx_frame_ctrl(DW_config* dw_config){
-  dw_config->reg_id_index = tx_frame_ctrl;
-  dw_config->config_buffer_len = config_table_len[TX_FRAME_CTRL_LEN_INDEX]; //call to config_table_len[]
-  int len = TX_FRAME_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->tx_frame_ctrl[i];
-  }
-}
-
-void config_rf_tx_delay(DW_config* dw_config){
-  dw_config->reg_id_index = rf_tx_delay;
-  dw_config->config_buffer_len = config_table_len[RF_TX_DELAY_LEN_INDEX]; //call to config_table_len[]
-  int len = RF_TX_DELAY_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->rf_tx_delay[i];
-  }
-}
-
-void config_sys_ctrl_reg(DW_config* dw_config){
-  dw_config->reg_id_index = sys_ctrl_reg;
-  dw_config->config_buffer_len = config_table_len[SYS_CTRL_REG_LEN_INDEX]; //call to config_table_len[]
-  int len = SYS_CTRL_REG_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->sys_ctrl_reg[i];
-  }
-}
-
-void config_sys_event_mask(DW_config* dw_config){
-  dw_config->reg_id_index = sys_event_mask;
-  //write zero so we have no effect on this register
-  dw_config->config_buffer_len = config_table_len[SYS_EVENT_MASK_LEN_INDEX]; //call to config_table_len[]
-  int len = SYS_EVENT_MASK_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->sys_event_mask[i];
-  }
-}
-
-void config_sys_event_status(DW_config* dw_config){
-  dw_config->reg_id_index = sys_event_status;
-  //write zero so we have no effect on this register
-  dw_config->config_buffer_len = config_table_len[SYS_EVENT_STATUS_LEN_INDEX]; //call to config_table_len[]
-  int len = SYS_EVENT_STATUS_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->sys_event_status[i];
-  }
-}
-
-void config_tx_ant_delay(DW_config* dw_config){
-  dw_config->reg_id_index = tx_ant_delay;
-  dw_config->config_buffer_len = config_table_len[TX_ANT_DELAY_LEN_INDEX]; //call to config_table_len[]
-  int len = TX_ANT_DELAY_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->tx_ant_delay[i];
-  }
-}
-
-void config_ack_resp_time(DW_config* dw_config){
-  dw_config->reg_id_index = ack_resp_time;
-  dw_config->config_buffer_len = config_table_len[ACK_RESP_TIME_LEN_INDEX]; //call to config_table_len[]
-  int len = ACK_RESP_TIME_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->ack_resp_time[i];
-  }
-}
-
-void config_preamble_rx_config(DW_config* dw_config){
-  dw_config->reg_id_index = preamble_rx_config;
-  dw_config->config_buffer_len = config_table_len[PREAMBLE_RX_CONFIG_LEN_INDEX]; //call to config_table_len[]
-  int len = PREAMBLE_RX_CONFIG_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->preamble_rx_config[i];
-  }
-}
+#define DW_REG_DESC_MEMBER(name, reg_id, sub_addr, len, member, access) \
+  [name] = {reg_id, access, sub_addr, len, offsetof(DW_config, member)},
 
-void config_tx_power_ctrl(DW_config* dw_config){
-  dw_config->reg_id_index = tx_power_ctrl;
-  dw_config->config_buffer_len = config_table_len[TX_POWER_CTRL_LEN_INDEX]; //call to config_table_len[]
-  int len = TX_POWER_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->tx_power_ctrl[i];
-  }
-}
+#define DW_REG_DESC(name, reg_id, sub_addr, len, access) \
+  [name] = {reg_id, access, sub_addr, len, DW_REG_NO_MEMBER},
 
-void config_chan_ctrl(DW_config* dw_config){
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->config_buffer_len = config_table_len[CHAN_CTRL_LEN_INDEX]; //call to config_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-}
-
-
-void (*config_table[CONFIG_STRUCT_MEMBERS])() = {
-  &config_unique_id,
-  &config_pan_id,
-  &config_sys_conf,
-  &config_tx_frame_ctrl,
-  &config_rf_tx_delay,
-  &config_sys_ctrl_reg,
-  &config_sys_event_mask,
-  &config_sys_event_status,
-  &config_tx_ant_delay,
-  &config_ack_resp_time,
-  &config_preamble_rx_config,
-  &config_tx_power_ctrl,
-  &config_chan_ctrl
-};
-
-/***************************************************************************************/
-
-uint32_t query_table_len[QUERY_STRUCT_MEMBERS] = {
-  EUI_64_LEN,                   
-  PAN_ID_LEN,                  
-  SYS_CONFIG_LEN,             
-  TX_FRAME_CTRL_LEN,         
-  RF_TX_DELAY_LEN,          
-  SYS_CTRL_REG_LEN,      
-  SYS_EVENT_MASK_LEN,  
-  SYS_EVENT_STATUS_LEN,       
-  TX_ANT_DELAY_LEN,          
-  ACK_RESP_TIME_LEN,         
-  PREAMBLE_RX_CONFIG_LEN,    
-  TX_POWER_CTRL_LEN,         
-  CHAN_CTRL_LEN, 
-
-  DEVICE_ID_LEN,
-  SYSTEM_TIME_LEN,
-  RX_FRAME_TIMEOUT_LEN,
-  RX_FRAME_QUAL_LEN,
-  RX_TIME_INTERVAL_LEN,
-  SYS_STATE_INFO_LEN
+const DW_reg_desc dw_reg_desc_table[REG_IDS_LEN] = {
+  DW_REG_CONFIG_LIST(DW_REG_DESC_MEMBER)
+  DW_REG_QUERY_LIST(DW_REG_DESC_MEMBER)
+  DW_REG_ACCESS_LIST(DW_REG_DESC)
 };
 
 /*
- *  query fns for message header builder
+ * Compile time checks on the lists: a DW_config mirror has to be exactly as wide
+ * as the register it mirrors (the config/query path is a straight memcpy) and fit
+ * the config/query buffers, config rows have to be writable, and every row has to
+ * fit the transaction header.
  */
 
-void query_dev_id(DW_config* dw_config){
+#define DW_REG_ASSERT(name, reg_id, sub_addr, len, ...) \
+  _Static_assert((reg_id) <= DW_REG_ID_MAX, #name ": register id out of range"); \
+  _Static_assert((sub_addr) <= DW_REG_SUB_ADDR_MAX, #name ": sub address out of range");
 
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[DEVICE_ID_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
+#define DW_REG_ASSERT_MEMBER(name, reg_id, sub_addr, len, member, access) \
+  DW_REG_ASSERT(name, reg_id, sub_addr, len, access) \
+  _Static_assert(sizeof(((DW_config*)0)->member) == (len), #member ": size does not match register length"); \
+  _Static_assert((len) <= CONFIG_BUFFER_LEN && (len) <= QUERY_BUFFER_LEN, #member ": longer than the config/query buffers");
 
-}
-
-void query_sys_time(DW_config* dw_config){
-
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[SYS_TIME_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
+#define DW_REG_ASSERT_CONFIG(name, reg_id, sub_addr, len, member, access) \
+  DW_REG_ASSERT_MEMBER(name, reg_id, sub_addr, len, member, access) \
+  _Static_assert((access) & DW_REG_W, #name ": config row is not writable");
 
-}
+DW_REG_CONFIG_LIST(DW_REG_ASSERT_CONFIG)
+DW_REG_QUERY_LIST(DW_REG_ASSERT_MEMBER)
+DW_REG_ACCESS_LIST(DW_REG_ASSERT)
 
-void query_rx_frame_timeout(DW_config* dw_config){
+_Static_assert(sizeof(dw_reg_id_table) == REG_IDS_LEN, "dw_reg_id_table out of step with DW_reg_id_enum");
+_Static_assert(pwr_mgmt_sys_ctrl == REG_IDS_LEN -1, "DW_reg_id_enum out of step with the register lists");
 
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[RX_FRAME_TIMEOUT_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
 
-}
-
-void query_rx_frame_qual(DW_config* dw_config){
-
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[RX_FRAME_QUAL_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-
-}
-
-void query_rx_time_interval(DW_config* dw_config){
-
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[RX_TIME_INTERVAL_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-
-}
-
-void query_sys_state_info(DW_config* dw_config){
 /*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[SYS_STATE_INFO_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
-}
+ *  generic config/query path
+ *
+ *  dw_regConfig: copy the DW_config mirror into config_buffer and point the 
+ *                header builder at the register, ready for dw_buildMessageOut()
+ *  dw_regQuery:  point the header builder at the register and size query_buffer
+ *                for the following dw_Rx()
+ *  dw_regStore:  copy query_buffer back into the DW_config mirror
+ */
 
-void query_unique_id(DW_config* dw_config){
+uint32_t dw_regConfig(DW_config* dw_config, DW_reg_id_enum reg){
 
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[EUI_64_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
+  if(reg >= REG_IDS_LEN){
+    return ERROR;
   }
 
-}
-
-void query_pan_id(DW_config* dw_config){
-
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[PAN_ID_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
+  const DW_reg_desc* desc = &dw_reg_desc_table[reg];
+  if(desc->conf_offset == DW_REG_NO_MEMBER || !(desc->access & DW_REG_W)){
+    return ERROR;
   }
 
-}
+  dw_config->reg_id_index = reg;
+  dw_config->sub_addr_index = desc->sub_addr;
+  dw_config->config_buffer_len = desc->len;
+  memcpy(dw_config->config_buffer, (uint8_t*)dw_config + desc->conf_offset, desc->len);
 
-void query_sys_conf(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[SYS_CONFIG_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
-}
-
-void query_tx_frame_ctrl(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[TX_FRAME_CTRL_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
+  return EXIT_SUCCESS;
 }
 
-void query_rf_tx_delay(DW_config* dw_config){
+uint32_t dw_regQuery(DW_config* dw_config, DW_reg_id_enum reg){
 
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[RF_TX_DELAY_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
+  if(reg >= REG_IDS_LEN){
+    return ERROR;
   }
 
-}
-
-void query_sys_ctrl_reg(DW_config* dw_config){
-
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[SYS_CTRL_REG_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
+  const DW_reg_desc* desc = &dw_reg_desc_table[reg];
+  if(desc->conf_offset == DW_REG_NO_MEMBER || !(desc->access & DW_REG_R)){
+    return ERROR;
   }
 
-}
+  dw_config->reg_id_index = reg;
+  dw_config->sub_addr_index = desc->sub_addr;
+  dw_config->query_buffer_len = desc->len;
 
-void query_sys_event_mask(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[SYS_EVENT_MASK_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
+  return EXIT_SUCCESS;
 }
 
-void query_sys_event_status(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[SYS_EVENT_STATUS_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
-}
-
-void query_tx_ant_delay(DW_config* dw_config){
-
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[TX_ANT_DELAY_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-
-}
+uint32_t dw_regStore(DW_config* dw_config, DW_reg_id_enum reg){
 
-void query_ack_resp_time(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[ACK_RESP_TIME_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
+  if(reg >= REG_IDS_LEN){
+    return ERROR;
   }
-*/
-}
 
-void query_preamble_rx_config(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[PREAMBLE_RX_CONFIG_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
+  const DW_reg_desc* desc = &dw_reg_desc_table[reg];
+  if(desc->conf_offset == DW_REG_NO_MEMBER){
+    return ERROR;
   }
-*/
-}
 
-void query_tx_power_ctrl(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[TX_POWER_CTRL_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
-}
+  memcpy((uint8_t*)dw_config + desc->conf_offset, dw_config->query_buffer, desc->len);
 
-void query_chan_ctrl(DW_config* dw_config){
-/*
-  dw_config->reg_id_index = chan_ctrl;
-  dw_config->query_buffer_len = query_table_len[CHAN_CTRL_LEN_INDEX]; //call to query_table_len[]
-  int len = CHAN_CTRL_LEN;
-  for(int i = 0; i < len; i++){
-    dw_config->config_buffer[i] = dw_config->chan_ctrl[i];
-  }
-*/
+  return EXIT_SUCCESS;
 }
 
-
-void (*query_table[QUERY_STRUCT_MEMBERS +1])() = {
-  &query_unique_id,
-  &query_pan_id,
-  &query_sys_conf,
-  &query_tx_frame_ctrl,
-  &query_rf_tx_delay,
-  &query_sys_ctrl_reg,
-  &query_sys_event_mask,
-  &query_sys_event_status,
-  &query_tx_ant_delay,
-  &query_ack_resp_time,
-  &query_preamble_rx_config,
-  &query_tx_power_ctrl,
-  &query_chan_ctrl,
-  
-  &query_dev_id,
-  &query_sys_time,
-  &query_rx_frame_timeout,
-  &query_rx_frame_qual,
-  &query_rx_time_interval,
-  &query_sys_state_info,
-};
-
-
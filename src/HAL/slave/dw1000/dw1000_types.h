@@ -24,6 +24,8 @@
 
 #define SINGLE_BYTE             0xFF
 #define SINGLE_BYTE_SHIFT       8
+#define DOUBLE_BYTE_SHIFT       16
+#define TRIPLE_BYTE_SHIFT       24
 
 
 #define STD_FRAME_LEN           127
@@ -41,7 +43,6 @@
  * REG IDs
  */
 
-#define REG_IDS_LEN             40
 #define SUB_EXT_ADDR_LEN        32 
 
 #define REG_ID_
@@ -72,130 +73,99 @@
 #define TS_HANDLER_TABLE_LEN    7
 
 /*
- * config_table_len[] indexes
- */ 
-
-
-#define EUI_64_LEN_INDEX                  0                  
-#define PAN_ID_LEN_INDEX                  1
-#define SYS_CONFIG_LEN_INDEX              2   
-#define TX_FRAME_CTRL_LEN_INDEX           3
-#define RF_TX_DELAY_LEN_INDEX             4
-#define SYS_CTRL_REG_LEN_INDEX            5
-#define SYS_EVENT_MASK_LEN_INDEX          6
-#define SYS_EVENT_STATUS_LEN_INDEX        7
-#define TX_ANT_DELAY_LEN_INDEX            8
-#define ACK_RESP_TIME_LEN_INDEX           9
-#define PREAMBLE_RX_CONFIG_LEN_INDEX      10
-#define TX_POWER_CTRL_LEN_INDEX           11
-#define CHAN_CTRL_LEN_INDEX               12
-#define DEVICE_ID_LEN_INDEX               13
-#define SYS_TIME_LEN_INDEX                14
-#define RX_FRAME_TIMEOUT_LEN_INDEX        15
-#define RX_FRAME_QUAL_LEN_INDEX           16
-#define RX_TIME_INTERVAL_LEN_INDEX        17
-#define SYS_STATE_INFO_LEN_INDEX          18
-
-
-/*
- * REG ID INDEXES FOR JUMP TABLE
+ * REGISTER DESCRIPTORS
+ *
+ * One row per register file, in DW_reg_id_enum order. The enum, dw_reg_id_table,
+ * dw_reg_desc_table and the table lengths below are all expanded from these lists,
+ * so the ordering only lives here.
+ *
+ *   X(enum name, reg id, sub addr, length, DW_config member, access)
+ *
+ * CONFIG rows are written out by dw_Init and read back by dw_RegDump, QUERY rows
+ * are only read back. ACCESS rows have no mirror in DW_config (buffers, timestamps,
+ * accumulator, AON...) and are driven directly, so they drop the member column.
  */
 
+#define DW_REG_R                0x01
+#define DW_REG_W                0x02
+#define DW_REG_RO               DW_REG_R
+#define DW_REG_WO               DW_REG_W
+#define DW_REG_RW               (DW_REG_R | DW_REG_W)
+
+#define DW_REG_NO_MEMBER        0xFFFF
+#define DW_REG_ID_MAX           0x3F
+#define DW_REG_SUB_ADDR_MAX     0x7FFF
+
+#define DW_REG_CONFIG_LIST(X) \
+  X(unique_id,                 EUI_64_ID,      0x00, EUI_64_LEN,             unique_id,           DW_REG_RW) \
+  X(pan_id,                    PAN_ID_ID,      0x00, PAN_ID_LEN,             pan_id,              DW_REG_RW) \
+  X(sys_conf,                  SYS_CFG_ID,     0x00, SYS_CFG_LEN,            sys_conf,            DW_REG_RW) \
+  X(tx_frame_ctrl,             TX_FCTRL_ID,    0x00, TX_FRAME_CTRL_LEN,      tx_frame_ctrl,       DW_REG_RW) \
+  X(rf_tx_delay,               DX_TIME_ID,     0x00, RF_TX_DELAY_LEN,        rf_tx_delay,         DW_REG_RW) \
+  X(sys_ctrl_reg,              SYS_CTRL_ID,    0x00, SYS_CTRL_REG_LEN,       sys_ctrl_reg,        DW_REG_RW) \
+  X(sys_event_mask,            SYS_MASK_ID,    0x00, SYS_EVENT_MASK_LEN,     sys_event_mask,      DW_REG_RW) \
+  X(sys_event_status,          SYS_STATUS_ID,  0x00, SYS_EVENT_STATUS_LEN,   sys_event_status,    DW_REG_RW) \
+  X(tx_ant_delay,              TX_ANTD_ID,     0x00, TX_ANT_DELAY_LEN,       tx_ant_delay,        DW_REG_RW) \
+  X(ack_resp_time,             ACK_RESP_T_ID,  0x00, ACK_RESP_TIME_LEN,      ack_resp_time,       DW_REG_RW) \
+  X(preamble_rx_config,        RX_SNIFF_ID,    0x00, PREAMBLE_RX_CONFIG_LEN, preamble_rx_config,  DW_REG_RW) \
+  X(tx_power_ctrl,             TX_POWER_ID,    0x00, TX_POWER_CTRL_LEN,      tx_power_ctrl,       DW_REG_RW) \
+  X(chan_ctrl,                 CHAN_CTRL_ID,   0x00, CHAN_CTRL_LEN,          chan_ctrl,           DW_REG_RW)
+
+#define DW_REG_QUERY_LIST(X) \
+  X(device_id,                 DEV_ID_ID,      0x00, DEVICE_ID_LEN,          device_id,           DW_REG_RO) \
+  X(sys_time,                  SYS_TIME_ID,    0x00, SYS_TIME_LEN,           sys_time,            DW_REG_RO) \
+  X(rx_frame_timeout,          RX_FWTO_ID,     0x00, RX_FRAME_TIMEOUT_LEN,   rx_frame_timeout,    DW_REG_RW) \
+  X(rx_frame_qual,             RX_FQUAL_ID,    0x00, RX_FRAME_QUAL_LEN,      rx_frame_qual,       DW_REG_RO) \
+  X(rx_time_tracking_interval, RX_TTCKI_ID,    0x00, RX_TIME_INTERVAL_LEN,   rx_time_interval,    DW_REG_RO) \
+  X(sys_state_info,            SYS_STATE_ID,   0x00, SYS_STATE_INFO_LEN,     sys_state_info,      DW_REG_RO)
+
+#define DW_REG_ACCESS_LIST(X) \
+  X(tx_buffer,                 TX_BUFFER_ID,   0x00, TX_BUFFER_LEN,          DW_REG_WO) \
+  X(rx_frame_info,             RX_FINFO_ID,    0x00, RX_FINFO_LEN,           DW_REG_RO) \
+  X(rx_buffer,                 RX_BUFFER_ID,   0x00, RX_BUFFER_LEN,          DW_REG_RO) \
+  X(rx_time_tracking_offset,   RX_TTCKO_ID,    0x00, RX_TTCKO_LEN,           DW_REG_RO) \
+  X(rx_arrival_time,           RX_TIME_ID,     0x00, RX_TIME_LLEN,           DW_REG_RO) \
+  X(tx_send_time,              TX_TIME_ID,     0x00, TX_TIME_LLEN,           DW_REG_RO) \
+  X(user_sfd,                  USR_SFD_ID,     0x00, USR_SFD_LEN,            DW_REG_RW) \
+  X(auto_gain_ctrl_config,     AGC_CTRL_ID,    0x00, AGC_CTRL_LEN,           DW_REG_RW) \
+  X(ext_clk_sync,              EXT_SYNC_ID,    0x00, EXT_SYNC_LEN,           DW_REG_RW) \
+  X(accum_read,                ACC_MEM_ID,     0x00, ACC_MEM_LEN,            DW_REG_RO) \
+  X(gpio_ctrl,                 GPIO_CTRL_ID,   0x00, GPIO_CTRL_LEN,          DW_REG_RW) \
+  X(digi_rx_config,            DRX_CONF_ID,    0x00, DRX_CONF_LEN,           DW_REG_RW) \
+  X(analog_rf_config,          RF_CONF_ID,     0x00, RF_CONF_LEN,            DW_REG_RW) \
+  X(tx_calib,                  TX_CAL_ID,      0x00, TX_CAL_LEN,             DW_REG_RW) \
+  X(freq_synth_ctrl,           FS_CTRL_ID,     0x00, FS_CTRL_LEN,            DW_REG_RW) \
+  X(aon_reg,                   AON_ID,         0x00, AON_LEN,                DW_REG_RW) \
+  X(otp,                       OTP_IF_ID,      0x00, OTP_IF_LEN,             DW_REG_RW) \
+  X(lde_ctrl,                  LDE_IF_ID,      0x00, LDE_IF_LEN,             DW_REG_RW) \
+  X(digi_diag,                 DIG_DIAG_ID,    0x00, DIG_DIAG_LEN,           DW_REG_RW) \
+  X(pwr_mgmt_sys_ctrl,         PMSC_ID,        0x00, PMSC_LEN,               DW_REG_RW)
+
+#define DW_REG_ENUM(name, ...)  name,
+#define DW_REG_COUNT(name, ...) +1
+
+//config rows first, then query rows: dw_Init and dw_RegDump walk the enum from 0
+#define CONFIG_STRUCT_MEMBERS   (0 DW_REG_CONFIG_LIST(DW_REG_COUNT))
+#define QUERY_STRUCT_MEMBERS    (CONFIG_STRUCT_MEMBERS DW_REG_QUERY_LIST(DW_REG_COUNT))
+#define REG_IDS_LEN             (QUERY_STRUCT_MEMBERS DW_REG_ACCESS_LIST(DW_REG_COUNT))
+
 //register id addr table
 extern uint8_t dw_reg_id_table[];
 
-//initiate length = 11 starting at 0
-//regdump length = 17 starting at 0
-
-/*
- * register ids as indexed in 'dw_reg_id_table'
- * 
-  0x01, //eui
-  0x03, //pan addr
-  0x04, //sys cfg
-  0x08, //tx frame ctrl
-  0x0A, //delayed send or receive time
-  0x0D, //sys ctrl reg
-  0x0E, //sys event mask
-  0x0F, //sys event status
-  0x18, //ant delay
-  0x1A, //ack resp time
-  0x1D, //pulsed preamble rx config
-  0x1E, //tx power ctrl
-  0x1F, //channel ctrl
-  0x00, //device id 
-  0x0C, //rx frame wait timeout
-  0x12, //rx frame quality info
-  0x13, //rx time tracking interval
-  0x19, //sys state
-  
-  0x06, //sys time
-  0x09, //tx buffer,
-  0x10, //rx frame info
-  0x11, //rx data
-  0x14, //rx time tracking offset
-  0x15, //rx msg time of arrival
-  0x17, //tx message time of sending
-  
-  0x21, //user-defined SFD
-  0x23, //auto gain ctrl config
-  0x24, //ext sync
-  0x25, //accum read acces
-  0x26, //gpio ctrl 
-  0x27, //digital rx config
-  0x28, //analog rf config
-  0x2A, //tx calibration
-  0x2B, //freq synth ctrl 
-  0x2C, //AON reg
-  0x2D, //OTP
-  0x2E, //LDE ctrl
-  0x2F, //digital diagnostics
-  0x36, //power mgmt system ctrl 
-*/
-
 typedef enum {
-  unique_id,
-  pan_id,
-  sys_conf,
-  tx_frame_ctrl,
-  rf_tx_delay,
-  sys_ctrl_reg,
-  sys_event_mask,
-  sys_event_status,
-  tx_ant_delay,
-  ack_resp_time,
-  preamble_rx_config,
-  tx_power_ctrl,
-  chan_ctrl,
-  device_id,
-  sys_time,
-  rx_frame_timeout,
-  rx_frame_qual,
-  rx_time_tracking_interval,
-  sys_state_info,
-  //end of config/query for loop, the remaining entries are for universal access via a single enum type
-  tx_buffer,
-  rx_frame_info,
-  rx_buffer,
-  rx_time_tracking_offset,
-  rx_arrival_time,
-  tx_send_time,
-  user_sfd,
-  auto_gain_ctrl_config,
-  ext_clk_sync,
-  accum_read,
-  gpio_ctrl,
-  digi_rx_config,
-  analog_rf_config,
-  tx_calib,
-  freq_synth_ctrl,
-  aon_reg,
-  otp,
-  lde_ctrl,
-  digi_diag,
-  pwr_mgmt_sys_ctrl,
+  DW_REG_CONFIG_LIST(DW_REG_ENUM)
+  DW_REG_QUERY_LIST(DW_REG_ENUM)
+  DW_REG_ACCESS_LIST(DW_REG_ENUM)
 }DW_reg_id_enum;
 
+typedef struct{
+  uint8_t reg_id;
+  uint8_t access;
+  uint16_t sub_addr;
+  uint16_t len;
+  uint16_t conf_offset;   //offset of the mirror in DW_config, DW_REG_NO_MEMBER if none
+}DW_reg_desc;
+
 
 //Make this a member of the dw_nodelist struct and the conditional 
 //operand as part of building a transaction header
@@ -374,6 +344,7 @@ typedef enum {
 #endif
 
 #define NODE_LIST_INDEX   0
+#define DW_POWER_INDEX    1
 
 #define DECODE_TABLE_LEN                6
 #define HANDLER_TABLE_LEN               4
@@ -386,7 +357,9 @@ typedef enum {
 
 #define ACTIVE_DEVICES_LEN   32
 
+#ifndef NODELIST_LEN
 #define NODELIST_LEN          1 
+#endif
 #define NODELIST_LEN_COUNT    (NODELIST_LEN -1)
 
 #define NODELIST_INDEX  0
@@ -570,6 +543,11 @@ typedef int decaIrqStatus_t; // type for remembering IRQ status
 
 #define NOT_YET_RANGED   -1
 
+#define DW_NEAREST_NONE  0xFFFF
+#ifndef DW_NEAREST_MAX
+#define DW_NEAREST_MAX   8        //most dw_nearestQuery() returns at once, sizes its stack frontier
+#endif
+
 
 
 typedef union{
@@ -607,6 +585,32 @@ typedef struct{
 }DW_TOF;
 
 
+/*
+ * Per-node range filter (constant velocity alpha-beta)
+ *
+ * range and velocity are the filter state, velocity is in metres per
+ * ranging exchange rather than per second so no clock is needed.
+ * Measurements whose innovation is larger than DW_RANGE_FILTER_GATE are
+ * rejected and the prediction is published instead. After
+ * DW_RANGE_FILTER_MAX_REJECTS consecutive rejections the filter is
+ * re-seeded with the raw measurement so a tag that really moved is
+ * not locked out.
+ */
+#define DW_RANGE_FILTER_ALPHA         0.5f
+#define DW_RANGE_FILTER_BETA          0.1f
+#define DW_RANGE_FILTER_GATE          1.5f  //metres
+#define DW_RANGE_FILTER_MAX_REJECTS   3
+
+#define DW_RANGE_FILTER_EMPTY   0
+#define DW_RANGE_FILTER_SEEDED  1
+
+typedef struct{
+  float range;
+  float velocity;
+  uint8_t state;
+  uint8_t reject_count;
+}DW_range_filter;
+
 /* A device in a list of immediately registered devices */
 typedef struct {
   int dev_status;
@@ -624,6 +628,7 @@ typedef struct {
   uint8_t frame_in[FRAME_BUFFER_SIZE];
   uint8_t frame_out[FRAME_BUFFER_SIZE];
   DW_TOF  tof; 
+  DW_range_filter filter;
 }DW_data; 
 
 typedef struct{
@@ -641,99 +646,123 @@ typedef struct{
   uint32_t node_index;
   DW_data list[NODELIST_LEN];
   //DW_network_dev devices[NODELIST_LEN]; 
+  uint16_t nearest_heap[NODELIST_LEN]; //min-heap of list[] indices keyed on .distance
+  uint16_t nearest_pos[NODELIST_LEN];  //heap slot of each list[] index, DW_NEAREST_NONE if not ranged
+  uint32_t nearest_len;
 }DW_nodelist;
 
-#define QUERY_BUFFER_LEN    32
-#define CONFIG_BUFFER_LEN   32
-
 /*
- * NOTE: make sure you start the enums and config tables at 1 NOT zero!!! That way we can assign 0 to the 
- * sub_addr_index member of dw_config and it will signify that there is no sub address for that regfile
+ * CHANNEL IMPULSE RESPONSE (regfile 0x25)
+ *
+ * The accumulator holds 1016 complex samples (992 at 16MHz PRF), each
+ * sample is 16-bit real followed by 16-bit imaginary, little endian.
+ * Every accumulator read returns one dummy octet before the data.
  *
+ * DW_CIR_CHUNK_SAMPLES sets how much is read per dw_cirStep() call,
+ * 32 samples is 129 octets on the bus which is well under a ranging
+ * slot at 1Mbps+. Raise it on faster SPI clocks.
  */
+#define DW_CIR_SAMPLES_64M        1016
+#define DW_CIR_SAMPLES_16M        992
+#define DW_CIR_SAMPLE_LEN         4
+#define DW_CIR_DUMMY_LEN          1
+#define DW_CIR_CHUNK_SAMPLES      32
 
-#define CONFIG_STRUCT_MEMBERS   13 
-#define QUERY_STRUCT_MEMBERS    24 
+#define RX_TIME_FP_LEN            4   //fp_index + fp_ampl1 (see RX_TIME_FP_INDEX_OFFSET)
+#define DW_FP_INDEX_FRACTION_BITS 6
 
-/*
-  config_unique_id,
-  config_pan_id,
-  config_sys_conf,
-  config_tx_frame_ctrl,
-  config_tx_frame_ctrl_sub_reg_4,
-  config_rf_tx_delay,
-  config_sys_ctrl_reg,
-  config_sys_event_status,
-  config_tx_ant_delay,
-  config_ack_resp_time,
-  config_preamble_rx_config,
-  config_tx_power_ctrl,
-  config_chan_ctrl
-*/
-/*
-typedef enum {
-  config_unique_id,
-  config_pan_id,
-  config_sys_conf,
-  config_tx_frame_ctrl,
-  config_tx_frame_ctrl_sub_reg_4,
-  config_rf_tx_delay,
-  config_sys_ctrl_reg,
-  config_sys_event_status,
-  config_tx_ant_delay,
-  config_ack_resp_time,
-  config_preamble_rx_config,
-  config_tx_power_ctrl,
-  config_chan_ctrl
-}DW_config_index_enum;
-//regid for registers pertanent to config and query fns  
-*/
+//accumulator readout clocks, PMSC_CTRL0 bytes 0-1: FACE and the rx clock
+//forced on the 125MHz PLL in byte 0, AMCE in byte 1
+#define DW_CIR_CLOCKS_LEN         2
+#define DW_CIR_CLOCKS_RXCLKS_MASK 0x0C
+#define PMSC_CTRL0_AMCE           0x00008000UL    //Accumulator Memory Clock Enable
+
+#define DW_CIR_IDLE     0
+#define DW_CIR_PENDING  1
+#define DW_CIR_DONE     2
+
+typedef struct{
+  int16_t* samples;           //caller buffer, 2 entries (re, im) per sample
+  uint16_t sample_count;      //samples wanted, at most DW_CIR_SAMPLES_64M
+  uint16_t next_sample;       //next accumulator sample to read
+  uint8_t state;
+  uint8_t clocks_forced;      //FACE/AMCE on, pmsc_ctrl0 holds what to put back
+  uint8_t pmsc_ctrl0[DW_CIR_CLOCKS_LEN];
+  uint16_t peak_index;        //largest |re|+|im| seen so far
+  uint32_t peak_magnitude;
+  uint16_t fp_index;          //hardware first path index, integer part
+  uint8_t fp_index_fraction;  //in 1/64ths of a sample
+  uint16_t fp_ampl1;
+  uint16_t fp_ampl2;
+  uint16_t fp_ampl3;
+  uint16_t std_noise;
+  uint16_t cir_pwr;
+  uint16_t rxpacc;
+  int16_t fp_to_peak;         //samples between first path and peak, large values suggest NLOS
+}DW_cir;
 
 /*
-  query_dev_id,
-  query_sys_time,
-  query_rx_frame_timeout,
-  query_rx_frame_qual,
-  query_rx_time_interval,
-  query_rx_ts_sub_addr_5,
-  query_rx_ts_sub_addr_9,
-  query_tx_ts_sub_addr_5,
-  query_tx_frame_ctrl_sub_addr_4,
-  query_rx_time_interval_offset,
-  query_rx_frame_qual_sub_reg_4,
-  query_sys_status_sub_reg_4,
-  query_sys_state_info
-*/
+ * LONG-FORM REGISTER ACCESS (dw_RxReg / dw_TxReg)
+ */
+#define DW_REG_HEADER_MAX         3
+#define DW_REG_TX_MAX             16
+#define DW_REG_SHORT_OFFSET_MAX   0x7F
+#define DW_REG_EXT_OFFSET_SHIFT   7
+
 /*
-typedef enum {
-  query_unique_id,
-  query_pan_id,
-  query_sys_conf,
-  query_tx_frame_ctrl,
-  query_tx_frame_ctrl_sub_reg_4,
-  query_rf_tx_delay,
-  query_sys_ctrl_reg,
-  query_sys_event_status,
-  query_tx_ant_delay,
-  query_ack_resp_time,
-  query_preamble_rx_config,
-  query_tx_power_ctrl,
-  query_chan_ctrl,
-  query_device_id,
-  query_rx_frame_timeout,
-  query_rx_frame_qual,
-  query_rx_time_interval,
-  query_rx_ts_sub_addr_5,
-  query_rx_ts_sub_addr_9,
-  query_tx_ts_sub_addr_5,
-  query_tx_frame_ctrl_sub_addr_4,
-  query_rx_time_interval_offset,
-  query_rx_frame_qual_sub_reg_4,
-  query_sys_status_sub_reg_4,
-  query_sys_state_info
-}DW_query_index_enum;
-//regid for registers pertanent to config and query fns  
-*/
+ * SLEEP / WAKEUP DUTY CYCLING
+ *
+ * mode_level picks what the radio must be able to do after a wake:
+ *
+ *  - DW_MODE_LEVEL_TX_ONLY: blink/poll only, LDE microcode is not loaded
+ *  - DW_MODE_LEVEL_TWR:     rx timestamps needed, LDE reloaded on wake
+ *
+ * aon_state, aon_wcfg and aon_cfg0 record the sleep config in the AON
+ * block so the upload (AON_CTRL.UPL_CFG) only happens when it changes,
+ * including a new sleep_count or lp_clk_div for the same sleep type.
+ *
+ * DW_WAKE_SPI_LEN is the dummy read used to hold SPICSn low for the
+ * >500us the DW1000 needs to wake, 80 octets is 640us at 1Mbps. Scale
+ * it with the SPI clock.
+ */
+#define DW_MODE_LEVEL_TX_ONLY   0
+#define DW_MODE_LEVEL_TWR       1
+
+#define DW_AON_NONE             0
+#define DW_AON_TIMED            1   //sleep counter enabled (SLEEP)
+#define DW_AON_DEEP             2   //pin/spi wake only (DEEPSLEEP)
+
+#define DW_WAKE_SPI_LEN         80
+#define DW_WAKE_SETTLE_MS       2   //xtal start-up before the first poll
+#define DW_WAKE_TIMEOUT_MS      10
+#define DW_WAKE_POLLS           (DW_WAKE_TIMEOUT_MS - DW_WAKE_SETTLE_MS + 1)  //DEV_ID reads, 1ms apart
+#define DW_NS_PER_S             1000000000UL
+#define DW_US_PER_S             1000000UL
+#define DW_LDE_LOAD_MS          1   //LDELOAD needs 150us
+
+#define DW_DEV_ID_VALUE         0xDECA0130UL
+
+#define PMSC_CTRL0_LDE_LOAD     0x0301
+#define PMSC_CTRL0_LDE_DONE     0x0200
+#define PMSC_CTRL0_SYSCLKS_MASK 0x03    //byte 0
+#define PMSC_CTRL0_SOFTRESET_BYTE 0xF0  //byte 3, bits 28-31
+
+typedef struct{
+  uint8_t mode_level;
+  uint8_t aon_state;
+  uint8_t lde_loaded;
+  uint8_t asleep;
+  uint16_t sleep_count;         //AON_CFG0 SLEEP_TIM, sleep counter units
+  uint16_t lp_clk_div;          //AON_CFG0 LPCLKDIVA
+  uint16_t aon_wcfg;            //AON_WCFG and AON_CFG0 last uploaded
+  uint32_t aon_cfg0;
+  uint32_t wake_latency_us;     //last wake-to-ready off the host's _timer_now/_timer_stamp, 0 without either
+  uint32_t wake_latency_max_us;
+  uint32_t wake_polls;          //DEV_ID reads the last wake took, with or without a host clock
+}DW_power;
+
+#define QUERY_BUFFER_LEN    32
+#define CONFIG_BUFFER_LEN   32
 
 typedef struct {
   DW_reg_id_enum reg_id_index;
@@ -741,8 +770,8 @@ typedef struct {
   DW_ext_addr_enum ext_addr_index;
   bool config_query_bool;
   bool ranging_mode;            //discovery or twr phase
-  uint8_t query_buffer[32];
-  uint8_t config_buffer[32];
+  uint8_t query_buffer[QUERY_BUFFER_LEN];
+  uint8_t config_buffer[CONFIG_BUFFER_LEN];
   uint8_t config_buffer_len;
   uint8_t query_buffer_len;
   uint8_t device_id[DEVICE_ID_LEN]; 
@@ -752,7 +781,7 @@ typedef struct {
   uint8_t sys_time[SYS_TIME_LEN];
   uint8_t tx_frame_ctrl[TX_FRAME_CTRL_LEN]; 
   uint8_t tx_frame_ctrl_sub_reg_4;
-  uint32_t rf_tx_delay[RF_TX_DELAY_LEN];         // used to specficy a time in the future to turn on rx or send tx   
+  uint8_t rf_tx_delay[RF_TX_DELAY_LEN];         // used to specficy a time in the future to turn on rx or send tx   
   uint8_t rx_frame_timeout[RX_FRAME_TIMEOUT_LEN];
   uint8_t sys_ctrl_reg[SYS_CTRL_REG_LEN];
   uint8_t sys_event_mask[SYS_EVENT_MASK_LEN];
@@ -964,8 +993,11 @@ typedef struct {
 extern uint32_t (*dw_decode_build_table[3])(); 
 extern uint8_t dw_frame_ctrl_table[][2]; 
 extern const uint32_t dw_fn_code_table[]; 
-extern void (*config_table[])(); 
-extern void (*query_table[])();
+extern const DW_reg_desc dw_reg_desc_table[];
+
+uint32_t dw_regConfig(DW_config* dw_config, DW_reg_id_enum reg);
+uint32_t dw_regQuery(DW_config* dw_config, DW_reg_id_enum reg);
+uint32_t dw_regStore(DW_config* dw_config, DW_reg_id_enum reg);
 
 
 
@@ -20,6 +20,8 @@
 #include <stdint.h>
 
 #include "venus638.h"
+#include "venus638_nmea.h"
+#include "venus638_binary.h"
 #include "mpi_port.h"
 
 /**********************************************************
@@ -30,15 +32,6 @@
  *********************************************************/
 
 
-const uint8_t nmea_sent_len[ID_NMEA_LEN] = {
-  52, 
-  39, 
-  50,
-  34, 
-  55, 
-  22
-};  
-
 const uint8_t venus_nmea_id_table [ID_NMEA_LEN][ID_NMEA_LEN] = {
 
   {'G','P','G','G','A'},
@@ -49,8 +42,41 @@ const uint8_t venus_nmea_id_table [ID_NMEA_LEN][ID_NMEA_LEN] = {
   {'G','P','V','T','G'}
 
 };
+
+const uint32_t venus_baud_rate_table[VENUS_BAUD_CODES] = {
+
+  BR_4800,
+  BR_9600,
+  BR_19200,
+  BR_38400,
+  BR_57600,
+  BR_115200
+
+};
+
+//slot NMEA_HASH(id[1], id[2]) -> row of venus_nmea_id_table
+//
+const uint8_t venus_nmea_hash_table[NMEA_HASH_LEN] = {
+
+  NMEA_HASH_EMPTY,
+  GGA_INDEX,
+  VTG_INDEX,
+  RMC_INDEX,
+  GLL_INDEX,
+  GSA_INDEX,
+  NMEA_HASH_EMPTY,
+  GSV_INDEX
+
+};
+
+_Static_assert(sizeof(VENUS_eph_record) == EPH_RECORD_LEN, "VENUS_eph_record has to match the nvm record size");
+
+_Static_assert(NMEA_HASH('G','A') == 1 && NMEA_HASH('L','L') == 4 && NMEA_HASH('S','A') == 5 &&
+               NMEA_HASH('S','V') == 7 && NMEA_HASH('M','C') == 3 && NMEA_HASH('T','G') == 2,
+               "venus_nmea_hash_table is out of step with NMEA_HASH");
 int venus638_Tx(void* host_object, int (*host_usart)(), void* ext_dev_object);
 int venus638_Rx(void* host_object, int (*host_usart)(), void* ext_dev_object);
+int venus_rxChunk(void* host_object, int (*host_usart)(), uint8_t* chunk, uint32_t chunk_len);
 
 int(*const venus638_rx_tx_table[VENUS_READ_WRITE+1])() = {
   venus638_Rx,
@@ -58,13 +84,22 @@ int(*const venus638_rx_tx_table[VENUS_READ_WRITE+1])() = {
   NULL
 };
 
-void venus_nullMessageArray();
+//older name for the same table
+int(*const usart_rx_tx_table[VENUS_READ_WRITE+1])() = {
+  venus638_Rx,
+  venus638_Tx,
+  NULL
+};
+
+int venus_messagePut(VENUS_message_io* venus_message, uint8_t* bytes, uint32_t len);
 int venus_buildPlLen(VENUS_message_io* venus_message);
 int venus_makeChecksum(VENUS_message_io* venus_message);
 int venus_decodeNmeaId(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store);
 int venus_decodeNmeaMessage(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store);
+int venus_decodeBinaryMessage(VENUS_message_io* venus_message, VENUS_response_store* venus_response, VENUS_nmea_store* nmea_store);
 int venus_buildMessageOut(VENUS_message_io* venus_message, VENUS_config* venus_config);
 int venus_buildMessageBody(VENUS_message_io* venus_message, VENUS_config* venus_config);
+int venus_pipelineResolve(VENUS_pipeline* venus_pipeline, VENUS_command* command, VENUS_command_state state);
 
 int venus_sys_reset();
 int venus_query_sw_rev();
@@ -115,7 +150,9 @@ int venus638_Tx(void* host_object, int (*host_usart)(), void* ext_dev_object){
      if((venus_message == NULL) || (venus_response == NULL) || (venus_nmea == NULL) || (venus_config == NULL)){
          return -1;
      } else {
-        venus_buildMessageOut(venus_message, venus_config);
+        if(venus_buildMessageOut(venus_message, venus_config) != 0){
+          return -1;
+        }
     
         //Send the right parameters through to the usart
         //
@@ -127,70 +164,322 @@ int venus638_Tx(void* host_object, int (*host_usart)(), void* ext_dev_object){
 
 
 
+/*
+ * Bytes actually read into chunk, -1 if the read failed. Hosts return 0 
+ * for a full read; one that can come back short returns the count it got.
+ */
+int venus_rxChunk(void* host_object, int (*host_usart)(), uint8_t* chunk, uint32_t chunk_len){
+
+  int ret = host_usart(host_object, VENUS_READ, chunk, chunk_len);
+
+  if(ret < 0){
+    return -1;
+  }
+  return ((ret > 0 && ret < chunk_len) ? ret : chunk_len);
+}
+
 int venus638_Rx(void* host_object, int (*host_usart)(), void* ext_dev_object){
 
-  int read_write = VENUS_READ;
+  int status = EXIT_SUCCESS;
   MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
   
   VENUS_message_io* venus_message = venus_object->MPI_data[VENUS_MESSAGE_INDEX];  
   VENUS_response_store* venus_response = venus_object->MPI_data[VENUS_RESPONSE_INDEX];
   VENUS_nmea_store* venus_nmea = venus_object->MPI_data[VENUS_NMEA_INDEX];    
+  VENUS_pipeline* venus_pipeline = venus_object->MPI_data[VENUS_PIPELINE_INDEX];
   VENUS_op_mode* venus_mode = (VENUS_op_mode*)venus_object->MPI_conf[VENUS_OP_INDEX];
 
 
   //re-write this section to operate based on a mode i.e. command mode or 
 
   if(*venus_mode == nmea){
-       /* if the first byte is a nmea sentence begin, store the nmea sentence*/
-    if((venus_message->message_in[0] & NMEA_SENTENCE_BEGIN) == 0){
-    
-       //call to usart again to check which nmea sentence it is 
-       host_usart(host_object, read_write, venus_message->message_in, NMEA_LEN);  
-     
-       //Call to decoding nmea id fn
-       //
-       int ret = venus_decodeNmeaId(venus_message, venus_nmea);
-
-       if(ret){
-         return 1;
-       } 
-
-       host_usart(host_object, read_write, venus_message->message_in, venus_nmea->nmea_len);
-
-       //Call to decoding nmea sentence fn
-       //
-       ret = venus_decodeNmeaMessage(venus_message, venus_nmea);
-
-       if(ret){
-         return 1;
-       }
+
+    //pull the next chunk off the usart and run it through the sentence parser, 
+    //handling each sentence as it completes. Partial sentences carry over to
+    //the next call in the parser state.
+    //
+    int received = venus_rxChunk(host_object, host_usart, venus_message->message_in, NMEA_RX_CHUNK);
+
+    if(received < 0){
+      return -1;
+    }
+
+    uint32_t offset = 0;
+    while(offset < received){
+      uint32_t consumed = 0;
+      int ret = venus_nmeaParse(&venus_nmea->parser, &venus_message->message_in[offset], received - offset, &consumed);
+      offset += consumed;
+
+      if(ret == NMEA_PARSE_COMPLETE){
+
+        //Call to decoding nmea id fn
+        //
+        if(venus_decodeNmeaId(venus_message, venus_nmea) == 0){
+
+          //Call to decoding nmea sentence fn
+          //
+          venus_decodeNmeaMessage(venus_message, venus_nmea);
+        }
+      }
+    }
+  } else if(*venus_mode == binary || *venus_mode == command){
+
+    //command replies (ACK/NACK/status) come back in the same binary framing
+    //as nav data, so both modes run through the one frame parser. Same shape
+    //as nmea: chunk in, hand each frame on as it completes. The chunk sits 
+    //above the payload area since replies are handed to the response 
+    //handlers at the bottom of message_in mid-chunk
+    //
+    uint8_t* chunk = &venus_message->message_in[BINARY_PAYLOAD_MAX];
+    int received = venus_rxChunk(host_object, host_usart, chunk, BINARY_RX_CHUNK);
+
+    if(received < 0){
+      return -1;
+    }
+
+    uint32_t offset = 0;
+    while(offset < received){
+      uint32_t consumed = 0;
+      int ret = venus_binaryParse(&venus_nmea->binary_parser, &chunk[offset], received - offset, &consumed);
+      offset += consumed;
+
+      if(ret == BINARY_PARSE_COMPLETE){
+        if(venus_decodeBinaryMessage(venus_message, venus_response, venus_nmea) < 0){
+          status = -1;
+        }
+
+        //resolve whichever queued command this answers, see venus_pipelineRun()
+        //
+        if(venus_pipeline != NULL){
+          venus_pipelineMatch(venus_pipeline, venus_nmea->binary_parser.payload);
+        }
+      }
+    }
+  }
+  return status;
+}
+
+
+
+/*
+ * Append to message_out, final_message_len is the write cursor. Refuses
+ * anything that would run past the buffer rather than truncating.
+ */
+int venus_messagePut(VENUS_message_io* venus_message, uint8_t* bytes, uint32_t len){
+
+  if(venus_message->final_message_len + len > VENUS_MESSAGE_OUT_LEN){
+    return -1;
+  }
+  for(uint32_t i = 0; i < len; i++){
+    venus_message->message_out[venus_message->final_message_len++] = bytes[i];
+  }
+  return 0;
+}
+
+
+
+/*
+ * Send the command in venus_message->message_id and wait for its ACK/NACK.
+ *
+ * A one command pipeline. The receiver keeps streaming while we wait, so 
+ * reads never stall for long even at the wrong baud rate; garbage just fails
+ * to frame. Only the ACK is waited on, a status reply (if any) is still
+ * handled when it comes through but doesn't hold this up.
+ */
+int venus_commandReply(void* host_object, int (*host_usart)(), void* ext_dev_object){
+
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+
+  VENUS_message_io* venus_message = venus_object->MPI_data[VENUS_MESSAGE_INDEX];  
+  VENUS_pipeline* venus_pipeline = venus_object->MPI_data[VENUS_PIPELINE_INDEX];
+
+  if(venus_pipeline == NULL){
+    return VENUS_REPLY_NONE;
+  }
+
+  venus_pipelineReset(venus_pipeline);
+  venus_pipelineQueue(venus_pipeline, venus_message->message_id, VENUS_NO_RESPONSE);
+  venus_pipelineRun(host_object, host_usart, ext_dev_object);
+
+  switch(venus_pipeline->command[0].state){
+    case venus_cmd_done:
+      return VENUS_REPLY_ACK;
+    case venus_cmd_nacked:
+      return VENUS_REPLY_NACK;
+    default:
+      return VENUS_REPLY_NONE;
+  }
+}
+
+
+
+/*****************************************
+ *
+ *        Venus command pipeline
+ *
+ *****************************************/
+
+/*
+ * The receiver answers every command with an ACK/NACK carrying the command
+ * id, queries follow the ACK with their status message. Nothing stops us 
+ * putting the next command on the wire before the last one is answered, so
+ * init/regdump queue everything up front and venus_pipelineRun() keeps 
+ * VENUS_PIPELINE_WINDOW of them in flight, matching replies as the Rx path
+ * frames them:
+ *
+ *  ACK(id)       oldest sent command with that id -> done, or acked if a
+ *                status reply is still due (deadline re-armed)
+ *  NACK(id)      oldest sent command with that id -> nacked
+ *  status(rid)   oldest sent/acked command expecting rid -> done
+ *
+ * Anything else (nav data, replies to nobody) is left alone.
+ */
+
+int venus_pipelineReset(VENUS_pipeline* venus_pipeline){
+
+  venus_pipeline->count = 0;
+  venus_pipeline->next_tx = 0;
+  venus_pipeline->in_flight = 0;
+  venus_pipeline->unresolved = 0;
+  return 0;
+}
+
+int venus_pipelineQueue(VENUS_pipeline* venus_pipeline, uint8_t message_id, uint8_t response_id){
+
+  if(venus_pipeline->count == VENUS_PIPELINE_LEN){
+    return -1;
+  }
+
+  VENUS_command* command = &venus_pipeline->command[venus_pipeline->count++];
+  command->message_id = message_id;
+  command->response_id = response_id;
+  command->state = venus_cmd_queued;
+  command->deadline = 0;
+
+  venus_pipeline->unresolved++;
+  return 0;
+}
+
+int venus_pipelineResolve(VENUS_pipeline* venus_pipeline, VENUS_command* command, VENUS_command_state state){
+
+  command->state = state;
+  venus_pipeline->in_flight--;
+  venus_pipeline->unresolved--;
+  return 0;
+}
+
+int venus_pipelineMatch(VENUS_pipeline* venus_pipeline, uint8_t* payload){
+
+  uint8_t message_id = payload[0];
+
+  for(uint32_t i = 0; i < venus_pipeline->next_tx; i++){
+
+    VENUS_command* command = &venus_pipeline->command[i];
+
+    if(message_id == ID_STATUS_ACK || message_id == ID_STATUS_NACK){
+      if(command->state != venus_cmd_sent || command->message_id != payload[1]){
+        continue;
+      }
+      if(message_id == ID_STATUS_NACK){
+        venus_pipelineResolve(venus_pipeline, command, venus_cmd_nacked);
+      } else if(command->response_id == VENUS_NO_RESPONSE){
+        venus_pipelineResolve(venus_pipeline, command, venus_cmd_done);
+      } else {
+        command->state = venus_cmd_acked;
+        command->deadline = venus_pipeline->now + venus_pipeline->timeout;
+      }
+      return i;
+    }
+
+    //status replies can beat a lost ACK, so sent counts too
+    //
+    if((command->state == venus_cmd_sent || command->state == venus_cmd_acked) && command->response_id == message_id){
+      venus_pipelineResolve(venus_pipeline, command, venus_cmd_done);
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Drive the queue until every command is answered, NACKed or out of time.
+ *
+ * Runs in command mode whatever the configured output mode is, and puts it 
+ * back after. Deadlines come off the host ms tick (_timer_ticks), hosts 
+ * without one fall back to counting Rx chunks (VENUS_REPLY_CHUNKS per 
+ * command). Per command results are left in venus_pipeline->command[].
+ *
+ * Returns EXIT_SUCCESS only if everything came back done.
+ */
+int venus_pipelineRun(void* host_object, int (*host_usart)(), void* ext_dev_object){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+
+  VENUS_message_io* venus_message = venus_object->MPI_data[VENUS_MESSAGE_INDEX];  
+  VENUS_nmea_store* venus_nmea = venus_object->MPI_data[VENUS_NMEA_INDEX];    
+  VENUS_pipeline* venus_pipeline = venus_object->MPI_data[VENUS_PIPELINE_INDEX];
+  VENUS_op_mode* venus_mode = (VENUS_op_mode*)venus_object->MPI_conf[VENUS_OP_INDEX];
+
+  if(venus_pipeline == NULL){
+    return -1;
+  }
+
+  int_callback host_ticks = (host_ptr != NULL ? host_ptr->_periph_periphconf._timer_ticks : NULL);
+  VENUS_op_mode op_mode = *venus_mode;
+
+  venus_pipeline->timeout = (host_ticks != NULL ? VENUS_COMMAND_TIMEOUT_MS : VENUS_REPLY_CHUNKS);
+  venus_binaryParserReset(&venus_nmea->binary_parser);
+  *venus_mode = command;
+
+  while(venus_pipeline->unresolved > 0){
+
+    venus_pipeline->now = (host_ticks != NULL ? (uint32_t)host_ticks() : venus_pipeline->rx_chunks);
+
+    //top the window up
+    //
+    while(venus_pipeline->in_flight < VENUS_PIPELINE_WINDOW && venus_pipeline->next_tx < venus_pipeline->count){
+
+      VENUS_command* command = &venus_pipeline->command[venus_pipeline->next_tx++];
+      venus_message->message_id = command->message_id;
+
+      if(venus638_Tx(host_object, host_usart, ext_dev_object) != 0){
+        command->state = venus_cmd_error;
+        venus_pipeline->unresolved--;
+      } else {
+        command->state = venus_cmd_sent;
+        command->deadline = venus_pipeline->now + venus_pipeline->timeout;
+        venus_pipeline->in_flight++;
+      }
+    }
+
+    if(venus_pipeline->in_flight == 0){
+      continue;
+    }
+
+    //replies are matched as they are framed, see venus638_Rx()
+    //
+    venus638_Rx(host_object, host_usart, ext_dev_object);
+    venus_pipeline->rx_chunks++;
+
+    venus_pipeline->now = (host_ticks != NULL ? (uint32_t)host_ticks() : venus_pipeline->rx_chunks);
+
+    for(uint32_t i = 0; i < venus_pipeline->next_tx; i++){
+      VENUS_command* command = &venus_pipeline->command[i];
+
+      if((command->state == venus_cmd_sent || command->state == venus_cmd_acked) &&
+         (int32_t)(venus_pipeline->now - command->deadline) >= 0){
+        venus_pipelineResolve(venus_pipeline, command, venus_cmd_timeout);
+      }
+    }
+  }
+
+  *venus_mode = op_mode;
+
+  for(uint32_t i = 0; i < venus_pipeline->count; i++){
+    if(venus_pipeline->command[i].state != venus_cmd_done){
+      return -1;
     }
-  } else if (*venus_mode == command){
-
-     if((venus_message->message_in[0] & RES_ID_STATUS_ACK ) == 0){
-       venus_response->ack_message_id = venus_message->message_in[1];
-       return 0;
-     } else if((venus_message->message_in[0] & RES_ID_STATUS_NACK ) == 0) {
-       venus_response->nack_message_id = venus_message->message_in[1];
-       return -1;
-     } else {
-       uint8_t* table = venus_response_lookup_table; 
-            
-       for(int i = 0; i < 10; i++){
-         if((venus_message->message_in[0] & table[i]) == 0){
-         //store Id in struct
-         venus_response->response_id = venus_message->message_in[0]; 
-         venus_message->payload_len = venus_query_lookup_table_member_length[i];
-         //call to usart again to get message body
-         host_usart(host_object, read_write, venus_message->message_in, venus_message->payload_len);
-         //store in struct member appropriately 
-         int(*response_handler)() = venus_handler_table[i];
-         response_handler(venus_message, venus_response);
-         } else {
-           continue;
-         } 
-       }
-     }
   }
   return EXIT_SUCCESS;
 }
@@ -199,77 +488,104 @@ int venus638_Rx(void* host_object, int (*host_usart)(), void* ext_dev_object){
 
 int venus_buildMessageOut(VENUS_message_io* venus_message, VENUS_config* venus_config){
 
-  venus_nullMessageArray(venus_message);
-  
+  venus_message->final_message_len = 0;
+
+  if(venus_message->message_id > VENUS_QUERY_ID_MAX || venus_query_desc_table[venus_message->message_id].build == NULL){
+    return -1;
+  }
+
   /*
    * buid the message:
    * <start of sequene><payload length><message ID><message body><checksum><end of sequence>
    *      2 bytes           2 byte       1 byte       n bytes      1 byte       2 bytes
+   *
+   * payload length covers the message ID and body
    */
+  uint32_t payload_len = venus_query_desc_table[venus_message->message_id].payload_len;
+  uint32_t body_len = payload_len - LEN_MESSAGE_ID;
 
-
-  //<start of sequence>
-  venus_message->message_out[0] = SEQUENCE_START_0;
-  venus_message->message_out[1] = SEQUENCE_START_1;
-
-  //<message id and payload length>
-  for(int i = 0; i < VENUS_QUERY_LOOKUP_TABLE_LENGTH; i++){
-     if(venus_message->message_id == venus_query_lookup_table[i]){
-        venus_message->payload_len = venus_query_lookup_table_member_length[i];          
-     }
-  } 
-  venus_message->message_out[2] = venus_message->payload_len;
-
-  //<message ID>
-  venus_message->message_out[3] = venus_message->message_id;    
+  if(body_len > VENUS_MESSAGE_BODY_LEN || (payload_len + LEN_FRAME_OVERHEAD) > VENUS_MESSAGE_OUT_LEN){
+    return -1;
+  }
+  venus_message->payload_len = payload_len;
 
   //<message body>
   //
+  //only the bytes this message sends are cleared, builders fill what they know
+  for(uint32_t i = 0; i < body_len; i++){
+    venus_message->message_body[i] = 0;
+  }
   venus_buildMessageBody(venus_message, venus_config);
 
-  for(int i = 0; i < venus_message->payload_len; i++){
-    venus_message->message_out[i+4] = venus_message->message_body[i];
-  }
- 
   //<checksum>
   //
   venus_makeChecksum(venus_message);
-  venus_message->message_out[venus_message->payload_len + 5] = venus_message->checksum; 
- 
-  //<ending sequence>
-  //
-  venus_message->message_out[venus_message->payload_len + 6] = venus_message->sequence_end[0];
-  venus_message->message_out[venus_message->payload_len + 7] = venus_message->sequence_end[1];
- 
+
+  uint8_t header[] = {
+    SEQUENCE_START_0,
+    SEQUENCE_START_1,
+    (payload_len >> SINGLE_BYTE_SHIFT) & 0xFF,
+    payload_len & 0xFF,
+    venus_message->message_id
+  };
+  uint8_t trailer[] = {
+    venus_message->checksum,
+    SEQUENCE_END_0,
+    SEQUENCE_END_1
+  };
+
+  if(venus_messagePut(venus_message, header, sizeof(header)) != 0 ||
+     venus_messagePut(venus_message, venus_message->message_body, body_len) != 0 ||
+     venus_messagePut(venus_message, trailer, sizeof(trailer)) != 0){
+    venus_message->final_message_len = 0;
+    return -1;
+  }
   return 0;
 }
 
 
 
-int venus_decodeNmeaId(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
+/*
+ * sentence holds at least NMEA_ID_LEN bytes. Returns the *_INDEX of the 
+ * sentence, or NMEA_HASH_EMPTY if it isn't one we decode. The parser calls 
+ * this too, as soon as the id is in, to drop unsubscribed sentences.
+ */
+uint8_t venus_nmeaSentenceIndex(uint8_t* sentence){
 
-  for(int i = 0; i < ID_NMEA_LEN; i++){
-    for(int j = 0; j < ID_NMEA_LEN; j++){
-      if((venus_message->message_in[j] & venus_nmea_id_table[i][j]) == 0){
-       if(j == ID_NMEA_LEN){
-         
-         //assign i and that will give us our index for the jump table to identify which nmea string it is
-         nmea_store->decode_id_index = i;
-          
-         //call to nmea jump table
-         //get the message length
-         nmea_store->nmea_len = nmea_sent_len[i];
-         
-         return 0;
-       } else {
-         continue; //if j != ID_NMEA_LEN then we are still parsing the id array
-       }  
-      } else {
-        continue; //if the characters do not match then simply move to the next loop
-      }
+  //hash picks the only candidate, one compare confirms it
+  //
+  uint8_t index = venus_nmea_hash_table[NMEA_HASH(sentence[NMEA_HASH_ID_OFFSET], sentence[NMEA_HASH_ID_OFFSET +1])];
+
+  if(index == NMEA_HASH_EMPTY){
+    return NMEA_HASH_EMPTY;
+  }
+  for(int j = 0; j < NMEA_ID_LEN; j++){
+    if(sentence[j] != venus_nmea_id_table[index][j]){
+      return NMEA_HASH_EMPTY;
     }
   }
-  return 1;
+  return index;
+}
+
+int venus_decodeNmeaId(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
+
+  if(nmea_store->parser.len < NMEA_ID_LEN){
+    return 1;
+  }
+
+  uint8_t index = venus_nmeaSentenceIndex(nmea_store->parser.sentence);
+
+  if(index == NMEA_HASH_EMPTY){
+    return 1;
+  }
+
+  //index into the nmea jump table
+  nmea_store->decode_id_index = index;
+
+  //the parser already knows how long the sentence was
+  nmea_store->nmea_len = nmea_store->parser.len;
+
+  return 0;
 }
 
 
@@ -279,44 +595,70 @@ int venus_decodeNmeaMessage(VENUS_message_io* venus_message, VENUS_nmea_store* n
    int(*const nmea_handler)() = nmea_decode_table[nmea_store->decode_id_index];
    nmea_handler(venus_message, nmea_store);
 
+   VENUS_nmea_subscription* subscription = &nmea_store->subscription[nmea_store->decode_id_index];
+   if(subscription->callback != NULL){
+     subscription->callback(subscription->context, &nmea_store->fix, nmea_store->decode_id_index);
+   }
+
    return 0;
 }
 
 
 
-void venus_nullMessageArray(VENUS_message_io* venus_message){
+int venus_buildMessageBody(VENUS_message_io* venus_message,  VENUS_config* venus_config){
 
-  for(int i = 2; i < 1024; i++){
-    venus_message->message_out[i] = '\0';     
-  }
+  //id is range checked in venus_buildMessageOut
+  //
+  int(*build_msg)() = venus_query_desc_table[venus_message->message_id].build;
+  return build_msg(venus_message, venus_config);
 }
 
 
 
-int venus_buildMessageBody(VENUS_message_io* venus_message,  VENUS_config* venus_config){
+int venus_makeChecksum(VENUS_message_io* venus_message){
 
-  //call to query jump table, run the function of the same index
-  for(int i = 0; i < VENUS_QUERY_LOOKUP_TABLE_LENGTH; i++){
-     if(venus_message->message_id == venus_query_lookup_table[i]){
-       int(*build_msg)() = venus_config_query_fn_table[i];
-       build_msg(venus_message, venus_config);
-     }
-  } 
+  //xor over the whole payload, message ID included
+  venus_message->checksum = venus_message->message_id ^ venus_xorChecksum(venus_message->message_body, venus_message->payload_len - LEN_MESSAGE_ID);
   return 0;
 }
 
 
 
-int venus_makeChecksum(VENUS_message_io* venus_message){
+/*
+ * One framed payload: nav data into the fix, replies to their handler. 0 
+ * when it was decoded or isn't one of ours, -1 if it was short or the 
+ * decode failed.
+ */
+int venus_decodeBinaryMessage(VENUS_message_io* venus_message, VENUS_response_store* venus_response, VENUS_nmea_store* nmea_store){
 
-  int CS = 0;
-  
-  for(int i = 0; i < venus_message->payload_len ; i++){
-    CS ^= venus_message->message_body[i];
+  VENUS_binary_parser* parser = &nmea_store->binary_parser;
+  uint8_t message_id = parser->payload[0];
+
+  if(message_id == ID_NAV_DATA){
+    return (venus_decodeNavData(parser, &nmea_store->fix) < 0 ? -1 : 0);
   }
 
-  venus_message->checksum = CS; 
-  return 0;
+  //everything else is a reply to a command (ACK/NACK/status). The handlers 
+  //read <id><body> out of message_in, so hand them the payload there. 
+  //Output we have no handler for is passed over, not an error
+  //
+  if(message_id < VENUS_RESPONSE_ID_BASE || message_id > VENUS_RESPONSE_ID_MAX){
+    return 0;
+  }
+
+  const VENUS_response_desc* response = &venus_response_desc_table[message_id - VENUS_RESPONSE_ID_BASE];
+
+  if(response->handler == NULL){
+    return 0;
+  }
+  if(parser->payload_len < response->payload_len){
+    return -1;
+  }
+  for(int j = 0; j < parser->payload_len; j++){
+    venus_message->message_in[j] = parser->payload[j];
+  }
+  venus_response->response_id = message_id;
+  return response->handler(venus_message, venus_response);
 }
 
 /*****************************************
@@ -325,63 +667,133 @@ int venus_makeChecksum(VENUS_message_io* venus_message){
  *
  *****************************************/
 
+/*
+ * Each handler tokenizes the sentence in place and converts only the fields
+ * it cares about into nmea_store->fix. Nothing is copied out of the parser.
+ */
+
 int decode_gga_fn(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
 
-  int len = nmea_store->nmea_len;
+  VENUS_fix* fix = &nmea_store->fix;
+  uint32_t value;
+
+  venus_nmeaTokenize(&nmea_store->parser, &nmea_store->fields);
+
+  venus_nmeaTime(venus_nmeaField(nmea_store, GGA_FIELD_TIME), &fix->utc_time);
+  venus_nmeaLatLon(venus_nmeaField(nmea_store, GGA_FIELD_LAT), venus_nmeaField(nmea_store, GGA_FIELD_LAT_HEMI), &fix->latitude);
+  venus_nmeaLatLon(venus_nmeaField(nmea_store, GGA_FIELD_LON), venus_nmeaField(nmea_store, GGA_FIELD_LON_HEMI), &fix->longitude);
+  venus_nmeaSigned(venus_nmeaField(nmea_store, GGA_FIELD_ALT), 2, &fix->altitude);
 
-  for(int i = 0; i < len; i++){
-    nmea_store->decode_gga[i] = venus_message->message_in[i];
-  }   
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, GGA_FIELD_QUALITY), 0, &value) == NMEA_FIELD_OK){
+    fix->fix_quality = value;
+  }
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, GGA_FIELD_SATS), 0, &value) == NMEA_FIELD_OK){
+    fix->satellites_used = value;
+  }
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, GGA_FIELD_HDOP), 2, &value) == NMEA_FIELD_OK){
+    fix->hdop = value;
+  }
+
+  fix->updated |= (1 << GGA_INDEX);
   return 0;
 }
 
 int decode_gll_fn(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
- 
-  int len = nmea_store->nmea_len;
 
-  for(int i = 0; i < len; i++){
-    nmea_store->decode_gll[i] = venus_message->message_in[i];
-  } 
+  VENUS_fix* fix = &nmea_store->fix;
+
+  venus_nmeaTokenize(&nmea_store->parser, &nmea_store->fields);
+
+  venus_nmeaLatLon(venus_nmeaField(nmea_store, GLL_FIELD_LAT), venus_nmeaField(nmea_store, GLL_FIELD_LAT_HEMI), &fix->latitude);
+  venus_nmeaLatLon(venus_nmeaField(nmea_store, GLL_FIELD_LON), venus_nmeaField(nmea_store, GLL_FIELD_LON_HEMI), &fix->longitude);
+  venus_nmeaTime(venus_nmeaField(nmea_store, GLL_FIELD_TIME), &fix->utc_time);
+
+  fix->valid = (*venus_nmeaField(nmea_store, GLL_FIELD_STATUS) == NMEA_STATUS_VALID);
+
+  fix->updated |= (1 << GLL_INDEX);
   return 0; 
 }
 
 int decode_gsa_fn(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
- 
-  int len = nmea_store->nmea_len;
 
-  for(int i = 0; i < len; i++){
-    nmea_store->decode_gsa[i] = venus_message->message_in[i];
-  }  
+  VENUS_fix* fix = &nmea_store->fix;
+  uint32_t value;
+  uint8_t used = 0;
+
+  venus_nmeaTokenize(&nmea_store->parser, &nmea_store->fields);
+
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, GSA_FIELD_MODE), 0, &value) == NMEA_FIELD_OK){
+    fix->fix_mode = value;
+  }
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, GSA_FIELD_HDOP), 2, &value) == NMEA_FIELD_OK){
+    fix->hdop = value;
+  }
+
+  //one PRN per slot, unused slots are empty
+  for(int i = GSA_FIELD_PRN_FIRST; i <= GSA_FIELD_PRN_LAST; i++){
+    if(!venus_nmeaFieldEnd(*venus_nmeaField(nmea_store, i))){
+      used++;
+    }
+  }
+  fix->satellites_used = used;
+
+  fix->updated |= (1 << GSA_INDEX);
   return 0;
 }
 
 int decode_gsv_fn(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
- 
-  int len = nmea_store->nmea_len;
 
-  for(int i = 0; i < len; i++){
-    nmea_store->decode_gsv[i] = venus_message->message_in[i];
-  } 
+  VENUS_fix* fix = &nmea_store->fix;
+  uint32_t value;
+
+  venus_nmeaTokenize(&nmea_store->parser, &nmea_store->fields);
+
+  //per satellite elevation/azimuth/snr is not kept, only the count
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, GSV_FIELD_IN_VIEW), 0, &value) == NMEA_FIELD_OK){
+    fix->satellites_in_view = value;
+  }
+
+  fix->updated |= (1 << GSV_INDEX);
   return 0; 
 }
 
 int decode_rmc_fn(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
- 
-  int len = nmea_store->nmea_len;
 
-  for(int i = 0; i < len; i++){
-    nmea_store->decode_rmc[i] = venus_message->message_in[i];
-  } 
+  VENUS_fix* fix = &nmea_store->fix;
+  uint32_t value;
+
+  venus_nmeaTokenize(&nmea_store->parser, &nmea_store->fields);
+
+  venus_nmeaTime(venus_nmeaField(nmea_store, RMC_FIELD_TIME), &fix->utc_time);
+  venus_nmeaLatLon(venus_nmeaField(nmea_store, RMC_FIELD_LAT), venus_nmeaField(nmea_store, RMC_FIELD_LAT_HEMI), &fix->latitude);
+  venus_nmeaLatLon(venus_nmeaField(nmea_store, RMC_FIELD_LON), venus_nmeaField(nmea_store, RMC_FIELD_LON_HEMI), &fix->longitude);
+  venus_nmeaSpeed(venus_nmeaField(nmea_store, RMC_FIELD_SPEED), &fix->speed);
+  venus_nmeaUnsigned(venus_nmeaField(nmea_store, RMC_FIELD_DATE), 0, &fix->utc_date);
+
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, RMC_FIELD_COURSE), 2, &value) == NMEA_FIELD_OK){
+    fix->course = value;
+  }
+
+  fix->valid = (*venus_nmeaField(nmea_store, RMC_FIELD_STATUS) == NMEA_STATUS_VALID);
+
+  fix->updated |= (1 << RMC_INDEX);
   return 0;
 }
 
 int decode_vtg_fn(VENUS_message_io* venus_message, VENUS_nmea_store* nmea_store){
 
-  int len = nmea_store->nmea_len;
+  VENUS_fix* fix = &nmea_store->fix;
+  uint32_t value;
+
+  venus_nmeaTokenize(&nmea_store->parser, &nmea_store->fields);
+
+  venus_nmeaSpeed(venus_nmeaField(nmea_store, VTG_FIELD_SPEED), &fix->speed);
 
-  for(int i = 0; i < len; i++){
-    nmea_store->decode_vtg[i] = venus_message->message_in[i];
-  } 
+  if(venus_nmeaUnsigned(venus_nmeaField(nmea_store, VTG_FIELD_COURSE), 2, &value) == NMEA_FIELD_OK){
+    fix->course = value;
+  }
+
+  fix->updated |= (1 << VTG_INDEX);
   return 0;
 };
 
@@ -433,7 +845,7 @@ int venus_status_nack(VENUS_message_io* venus_message, VENUS_response_store* ven
    * message id of the initial request message  1
    */
   venus_response->nack_message_id       = venus_message->message_in[1];
-  return 0;
+  return -1;
 }
 
 int venus_status_pin_info(VENUS_message_io* venus_message, VENUS_response_store* venus_response){
@@ -455,19 +867,18 @@ int venus_status_eph_data(VENUS_message_io* venus_message, VENUS_response_store*
    * subframedata[2][0-27]   59-86
    *
    */
-  venus_response->sv_id                 = venus_message->message_in[1];
-  //sfd_1 for loop
-  for(int i = 0; i < EPH_SUB_FRAME_DATA_LEN; i++){
-  venus_response->sfd_1[i]              = venus_message->message_in[i+4];
-  }
-  //sfd_2 for loop
-  for(int i = 0; i < EPH_SUB_FRAME_DATA_LEN; i++){
-  venus_response->sfd_2[i]              = venus_message->message_in[i+32];
-  }
-  //sfd_3 for loop
-  for(int i = 0; i < EPH_SUB_FRAME_DATA_LEN; i++){
-  venus_response->sfd_2[i]              = venus_message->message_in[i+60];
+  VENUS_eph_record* eph = &venus_response->eph;
+
+  eph->sv_id[0] = venus_message->message_in[1];
+  eph->sv_id[1] = venus_message->message_in[2];
+
+  for(int i = 0; i < EPH_SUB_FRAMES; i++){
+    for(int j = 0; j < EPH_SUB_FRAME_DATA_LEN; j++){
+      eph->sfd[i][j] = venus_message->message_in[3 + (i * EPH_SUB_FRAME_DATA_LEN) + j];
+    }
   }
+  eph->pad[0] = 0;
+  eph->pad[1] = 0;
   return 0;
 }
 
@@ -639,13 +1050,20 @@ int venus_query_get_eph(VENUS_message_io* message_instance, VENUS_config* venus_
 
 int venus_config_set_eph(VENUS_message_io* message_instance, VENUS_config* venus_config){
 
-  message_instance->message_body[0] = venus_config->config_set_eph_data_sv;
+  /*
+   * SV id                   0-1
+   * subframedata[0][0-27]   2-29
+   * subframedata[1][0-27]   30-57
+   * subframedata[2][0-27]   58-85
+   */
+  message_instance->message_body[0] = (venus_config->config_set_eph_data_sv >> SINGLE_BYTE_SHIFT) & 0xFF;
+  message_instance->message_body[1] = venus_config->config_set_eph_data_sv & 0xFF;
 
-  //for(int i = 0; i < 3; i++){
-  //  for(int j = 0; j < 27; j++){
-  //    message_body->config_set_eph_data_sfd[i][j] = ;
-  //  }
-  //}
+  for(int i = 0; i < EPH_SUB_FRAMES; i++){
+    for(int j = 0; j < EPH_SUB_FRAME_DATA_LEN; j++){
+      message_instance->message_body[2 + (i * EPH_SUB_FRAME_DATA_LEN) + j] = venus_config->config_set_eph_data_sfd[i][j];
+    }
+  }
 
   return 0;
 }
@@ -712,33 +1130,8 @@ int venus_query_1pps_mode(VENUS_message_io* message_instance, VENUS_config* venu
   return 0;
 }
 
-// venus_message table
+// register_enum -> message id, used by the adaptor
 //
-int(*const venus_config_query_fn_table[24])() = 
-{
- venus_config_serial,
- venus_config_nmea,
- venus_config_message,
- venus_config_sys_pwr,
- venus_config_update_rate,
- venus_config_datum,
- venus_config_set_eph,
- venus_config_waas,
- venus_config_pos_pin,
- venus_config_pos_pin_param,
- venus_config_nav_mode,
- venus_config_1pps_mode,
- venus_query_sw_rev,
- venus_query_sw_crc,
- venus_query_update_rate,
- venus_query_datum,
- venus_query_get_eph,
- venus_query_waas,
- venus_query_pos_pin,
- venus_query_nav_mode,
- venus_query_1pps_mode
-};
-
 uint8_t venus_query_lookup_table[VENUS_QUERY_LOOKUP_TABLE_LENGTH] = 
 {
  ID_CONFIG_SERIAL_PORT,     
@@ -764,76 +1157,52 @@ uint8_t venus_query_lookup_table[VENUS_QUERY_LOOKUP_TABLE_LENGTH] =
  ID_QUERY_1PPS_MODE       
 };
 
-uint8_t venus_query_lookup_table_member_length[VENUS_QUERY_LOOKUP_TABLE_LENGTH] = 
-{
- CONFIG_SERIAL_PORT_PL_LEN,           
- CONFIG_NMEA_UPDATE_PL_LEN,           
- CONFIG_MESSAGE_TYPE_PL_LEN,          
- CONFIG_SYS_POWER_MODE_PL_LEN,                  
- CONFIG_SYSTEM_POS_RATE_PL_LEN,  
- CONFIG_EPH_DATA_SET_PL_LEN,
- CONFIG_WAAS_PL_LEN,         
- CONFIG_DATUM_PL_LEN,                   
- CONFIG_POSITION_PIN_PL_LEN,       
- CONFIG_POS_PIN_PARAMS_PL_LEN,               
- CONFIG_NAV_MODE_PL_LEN,  
- CONFIG_1PPS_MODE_PL_LEN, 
- QUERY_SOFTWARE_VERSION_PL_LEN, 
- QUERY_SOFTWARE_CRC_PL_LEN,           
- QUERY_POS_UPDATE_RATE_PL_LEN,               
- QUERY_DATUM_PL_LEN,         
- QUERY_EPH_DATA_GET_PL_LEN,
- QUERY_WAAS_STATUS_PL_LEN,   
- QUERY_POS_PIN_PL_LEN,             
- QUERY_NAV_MODE_PL_LEN,                     
- QUERY_1PPS_MODE_PL_LEN                   
-};
-
-uint8_t venus_response_lookup_table[VENUS_RESPONSE_LOOKUP_TABLE_LENGTH] = 
-{
- RES_ID_STATUS_ACK,         
- RES_ID_STATUS_NACK,   
- RES_ID_STATUS_SW_VERSION, 
- RES_ID_STATUS_SW_CRC,       
- RES_ID_STATUS_PIN_INFO,   
- RES_ID_GET_EPH_DATA,                 
- RES_ID_STATUS_DATUM,       
- RES_ID_STATUS_WAAS,      
- RES_STATUS_PIN,        
- RES_STATUS_NAV,            
- RES_STATUS_1PPS      
-};
-
-uint8_t venus_response_lookup_table_member_length[VENUS_RESPONSE_LOOKUP_TABLE_LENGTH] = 
+// message id -> body builder, payload length, status reply
+//
+const VENUS_query_desc venus_query_desc_table[VENUS_QUERY_ID_MAX +1] = 
 {
- STATUS_ACK_PL_LEN,          
- STATUS_NACK_PL_LEN,   
- STATUS_SW_VERSION_PL_LEN,   
- STATUS_SW_CRC_PL_LEN,       
- STATUS_PIN_INFO_PL_LEN, 
- STATUS_GET_EPH_DATA_PL_LEN, 
- STATUS_DATUM_PL_LEN,        
- STATUS_WAAS_PL_LEN,         
- STATUS_POS_PIN_PL_LEN,      
- STATUS_NAV_MODE_PL_LEN,     
- STATUS_1PPS_MODE_PL_LEN   
+ [ID_SYS_RESET]            = { venus_sys_reset,            SYSTEM_RESTART_PL_LEN },
+ [ID_QUERY_SW_REV]         = { venus_query_sw_rev,         QUERY_SOFTWARE_VERSION_PL_LEN, RES_ID_STATUS_SW_VERSION },
+ [ID_QUERY_SW_CRC]         = { venus_query_sw_crc,         QUERY_SOFTWARE_CRC_PL_LEN, RES_ID_STATUS_SW_CRC },
+ [ID_FACTORY_RESET]        = { venus_factory_reset,        SET_FACTORY_DEFAULTS_PL_LEN },
+ [ID_CONFIG_SERIAL_PORT]   = { venus_config_serial,        CONFIG_SERIAL_PORT_PL_LEN },
+ [ID_CONFIG_NMEA_MESSAGE]  = { venus_config_nmea,          CONFIG_NMEA_UPDATE_PL_LEN },
+ [ID_CONFIG_MESSAGE_TYPE]  = { venus_config_message,       CONFIG_MESSAGE_TYPE_PL_LEN },
+ [ID_CONFIG_SYS_PWR]       = { venus_config_sys_pwr,       CONFIG_SYS_POWER_MODE_PL_LEN },
+ [ID_CONFIG_UPDATE_RATE]   = { venus_config_update_rate,   CONFIG_SYSTEM_POS_RATE_PL_LEN },
+ [ID_QUERY_UPDATE_RATE]    = { venus_query_update_rate,    QUERY_POS_UPDATE_RATE_PL_LEN, RES_ID_STATUS_PIN_INFO },
+ [ID_CONFIG_DATUM]         = { venus_config_datum,         CONFIG_DATUM_PL_LEN },
+ [ID_QUERY_DATUM]          = { venus_query_datum,          QUERY_DATUM_PL_LEN, RES_ID_STATUS_DATUM },
+ [ID_EPH_DATA_GET]         = { venus_query_get_eph,        QUERY_EPH_DATA_GET_PL_LEN, RES_ID_GET_EPH_DATA },
+ [ID_EHP_DATA_SET]         = { venus_config_set_eph,       CONFIG_EPH_DATA_SET_PL_LEN },
+ [ID_CONFIG_WAAS]          = { venus_config_waas,          CONFIG_WAAS_PL_LEN },
+ [ID_QUERY_WAAS_STATUS]    = { venus_query_waas,           QUERY_WAAS_STATUS_PL_LEN, RES_ID_STATUS_WAAS },
+ [ID_CONFIG_PIN]           = { venus_config_pos_pin,       CONFIG_POSITION_PIN_PL_LEN },
+ [ID_QUERY_PIN_STATUS]     = { venus_query_pos_pin,        QUERY_POS_PIN_PL_LEN, RES_STATUS_PIN },
+ [ID_CONFIG_PIN_PARAMS]    = { venus_config_pos_pin_param, CONFIG_POS_PIN_PARAMS_PL_LEN },
+ [ID_CONFIG_NAV_MODE]      = { venus_config_nav_mode,      CONFIG_NAV_MODE_PL_LEN },
+ [ID_QUERY_NAV_MODE]       = { venus_query_nav_mode,       QUERY_NAV_MODE_PL_LEN, RES_STATUS_NAV },
+ [ID_CONFIG_1PPS_MODE]     = { venus_config_1pps_mode,     CONFIG_1PPS_MODE_PL_LEN },
+ [ID_QUERY_1PPS_MODE]      = { venus_query_1pps_mode,      QUERY_1PPS_MODE_PL_LEN, RES_STATUS_1PPS }
 };
 
-// venus handler lookup table
+// message id - VENUS_RESPONSE_ID_BASE -> response handler, minimum payload length
 //
-int (*const venus_handler_table[VENUS_RESPONSE_LOOKUP_TABLE_LENGTH])() = 
+#define RESPONSE_SLOT(X) ((X) - VENUS_RESPONSE_ID_BASE)
+
+const VENUS_response_desc venus_response_desc_table[VENUS_RESPONSE_ID_MAX - VENUS_RESPONSE_ID_BASE +1] = 
 {
- venus_status_ack,
- venus_status_nack,
- venus_status_sw_version, 
- venus_status_sw_crc,
- venus_status_pin_info,
- venus_status_eph_data,
- venus_status_datum,
- venus_status_waas,
- venus_status_pin,
- venus_status_nav,
- venus_status_1pps,
+ [RESPONSE_SLOT(RES_ID_STATUS_SW_VERSION)] = { venus_status_sw_version, STATUS_SW_VERSION_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_STATUS_SW_CRC)]     = { venus_status_sw_crc,     STATUS_SW_CRC_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_STATUS_ACK)]        = { venus_status_ack,        STATUS_ACK_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_STATUS_NACK)]       = { venus_status_nack,       STATUS_NACK_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_STATUS_PIN_INFO)]   = { venus_status_pin_info,   STATUS_PIN_INFO_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_STATUS_DATUM)]      = { venus_status_datum,      STATUS_DATUM_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_GET_EPH_DATA)]      = { venus_status_eph_data,   STATUS_GET_EPH_DATA_PL_LEN },
+ [RESPONSE_SLOT(RES_ID_STATUS_WAAS)]       = { venus_status_waas,       STATUS_WAAS_PL_LEN },
+ [RESPONSE_SLOT(RES_STATUS_PIN)]           = { venus_status_pin,        STATUS_POS_PIN_PL_LEN },
+ [RESPONSE_SLOT(RES_STATUS_NAV)]           = { venus_status_nav,        STATUS_NAV_MODE_PL_LEN },
+ [RESPONSE_SLOT(RES_STATUS_1PPS)]          = { venus_status_1pps,       STATUS_1PPS_MODE_PL_LEN }
 };
 
 int(*const nmea_decode_table[ID_NMEA_LEN])() = 
@@ -72,21 +72,40 @@
 
 typedef enum {
   command,
-  nmea
+  nmea,
+  binary
 }VENUS_op_mode;
 
 
 //Jump tables
 //
-extern uint8_t venus_response_lookup_table[];
 extern uint8_t venus_query_lookup_table[];
-extern uint8_t venus_response_lookup_table_member_length[];
-extern uint8_t venus_query_lookup_table_member_length[];
-extern int (*const venus_handler_table[])();
 extern int(*const venus_message_body_fn_table[])(); 
 extern int(*const venus638_rx_tx_table[])();
 extern int(*const nmea_decode_table[])();
-extern int(*const venus_config_query_fn_table[])(); 
+
+/*
+ * Message id -> builder/handler and payload length, indexed directly by id
+ * (responses by id - VENUS_RESPONSE_ID_BASE). Ids with no entry have a NULL
+ * fn. Saves scanning the id lists on every message in or out.
+ */
+typedef struct {
+  int(*build)();
+  uint8_t payload_len;
+  uint8_t response_id;          //status message that follows the ACK, 0 if the ACK is all we get
+}VENUS_query_desc;
+
+typedef struct {
+  int(*handler)();
+  uint8_t payload_len;
+}VENUS_response_desc;
+
+#define VENUS_QUERY_ID_MAX          0x3F
+#define VENUS_RESPONSE_ID_BASE      0x80
+#define VENUS_RESPONSE_ID_MAX       0xBF
+
+extern const VENUS_query_desc venus_query_desc_table[];
+extern const VENUS_response_desc venus_response_desc_table[];
 
 typedef enum {
  config_serial,
@@ -115,16 +134,20 @@ typedef enum {
 typedef venus_config_query_enum register_enum;
 
 
+#define VENUS_MESSAGE_BODY_LEN  88      //ephemeris set is the longest at 86
+#define VENUS_MESSAGE_OUT_LEN   96
+#define VENUS_MESSAGE_IN_LEN    256
+
 typedef struct VENUS_MESSAGE_IO{
   uint8_t sequence_start[2];
   uint8_t sequence_end[2];
   uint32_t message_id;
-  uint8_t message_body[64];
-  uint32_t payload_len;
+  uint8_t message_body[VENUS_MESSAGE_BODY_LEN];
+  uint32_t payload_len;                       //message id + body, as sent on the wire
   uint32_t checksum;
-  uint8_t message_out[64];
-  uint8_t message_in[256];
-  uint32_t final_message_len;
+  uint8_t message_out[VENUS_MESSAGE_OUT_LEN];
+  uint8_t message_in[VENUS_MESSAGE_IN_LEN];
+  uint32_t final_message_len;                 //bytes of message_out built so far
   uint8_t last_known;
 }VENUS_message_io;
 
@@ -199,6 +222,21 @@ typedef struct VENUS_NMEA_STORE{
 }VENUS_nmea_store;
 */
 
+/*
+ * One SV's ephemeris as get-eph returns it and set-eph takes it, byte for 
+ * byte off the wire (payload minus the message id). Padded to a flash word
+ * so records can go straight to the host's nvm, see venus638_EphStore().
+ */
+#define EPH_SV_COUNT            32
+#define EPH_SUB_FRAMES          3
+#define EPH_RECORD_LEN          88
+
+typedef struct {
+  uint8_t sv_id[2];             //big endian, 0 for an empty slot
+  uint8_t sfd[EPH_SUB_FRAMES][28];
+  uint8_t pad[2];
+}VENUS_eph_record;
+
 typedef struct VENUS_RESPONSE_STORE{
   uint32_t software_version_type;
   uint32_t kernel_version;
@@ -209,10 +247,7 @@ typedef struct VENUS_RESPONSE_STORE{
   uint32_t ack_message_id;
   uint32_t nack_message_id;
   uint32_t update_rate;
-  uint32_t sv_id;
-  uint32_t sfd_1[28];
-  uint32_t sfd_2[28];
-  uint32_t sfd_3[28];
+  VENUS_eph_record eph;         //last get-eph reply
   uint32_t datum_index;
   uint32_t waas_status;
   uint32_t pos_pin_status;
@@ -227,8 +262,6 @@ typedef struct VENUS_RESPONSE_STORE{
  *
  **************************/
 
-#define NMEA_LEN               512
-
 #define ID_HEADER_LEN          1
 #define NMEA_SENTENCE_BEGIN    0x24
 #define ID_NMEA_LEN            6
@@ -246,29 +279,208 @@ typedef struct VENUS_RESPONSE_STORE{
 #define GSV_INDEX 3
 #define RMC_INDEX 4
 #define VTG_INDEX 5
+#define NAV_DATA_INDEX 6  //binary nav data, shares the fix 'updated' bitmask
 
-#define GGA_SENT_LEN 52
-#define GLL_SENT_LEN 39 
-#define GSA_SENT_LEN 50
-#define GSV_SENT_LEN 34
-#define RMC_SENT_LEN 55
-#define VTG_SENT_LEN 22
+/*
+ * Field positions within each sentence (field 0 is the id)
+ */
+
+#define GGA_FIELD_TIME        1
+#define GGA_FIELD_LAT         2
+#define GGA_FIELD_LAT_HEMI    3
+#define GGA_FIELD_LON         4
+#define GGA_FIELD_LON_HEMI    5
+#define GGA_FIELD_QUALITY     6
+#define GGA_FIELD_SATS        7
+#define GGA_FIELD_HDOP        8
+#define GGA_FIELD_ALT         9
+
+#define GLL_FIELD_LAT         1
+#define GLL_FIELD_LAT_HEMI    2
+#define GLL_FIELD_LON         3
+#define GLL_FIELD_LON_HEMI    4
+#define GLL_FIELD_TIME        5
+#define GLL_FIELD_STATUS      6
+
+#define GSA_FIELD_MODE        2
+#define GSA_FIELD_PRN_FIRST   3
+#define GSA_FIELD_PRN_LAST    14
+#define GSA_FIELD_HDOP        16
+
+#define GSV_FIELD_IN_VIEW     3
+
+#define RMC_FIELD_TIME        1
+#define RMC_FIELD_STATUS      2
+#define RMC_FIELD_LAT         3
+#define RMC_FIELD_LAT_HEMI    4
+#define RMC_FIELD_LON         5
+#define RMC_FIELD_LON_HEMI    6
+#define RMC_FIELD_SPEED       7
+#define RMC_FIELD_COURSE      8
+#define RMC_FIELD_DATE        9
+
+#define VTG_FIELD_COURSE      1
+#define VTG_FIELD_SPEED       5
+
+#define NMEA_STATUS_VALID     0x41    //'A'
 
 //#define test ( uint32_t testing = PGGA);
 
 extern const uint8_t venus_nmea_id_table [ID_NMEA_LEN][ID_NMEA_LEN]; 
 
+/*
+ * Perfect hash over the last two characters of the sentence id, e.g. GGA -> 'G','A'.
+ * Collision free for the six sentences above, so a received sentence costs 
+ * one hash and one compare against the single candidate in venus_nmea_id_table.
+ */
+#define NMEA_HASH_LEN               8
+#define NMEA_HASH(X,Y)              ( ((X) + ((Y) << 1)) & (NMEA_HASH_LEN -1) )
+#define NMEA_HASH_EMPTY             0xFF
+#define NMEA_HASH_ID_OFFSET         3   //sentence[3], sentence[4] after the talker id
+
+extern const uint8_t venus_nmea_hash_table[NMEA_HASH_LEN];
+
+/*
+ * Streaming sentence parser, see venus638_nmea.c
+ *
+ * Sentences are variable length, so nothing here is sized per sentence type.
+ * The parser is fed whatever the usart hands back and holds one sentence 
+ * (talker id up to, not including, the '*') at a time.
+ */
+
+#define NMEA_SENTENCE_MAX      82     //NMEA 0183 limit, '$' through <CR><LF>
+#define NMEA_CHECKSUM_DELIM    0x2A   //'*'
+#define NMEA_SENTENCE_CR       0x0D
+#define NMEA_SENTENCE_LF       0x0A
+#define NMEA_RX_CHUNK          16     //bytes read from the usart per parser pass
+#define NMEA_FIELD_MAX         24     //GSV tops out at 20
+#define NMEA_FIELD_DELIM       0x2C   //','
+
+#define NMEA_ID_LEN            (ID_NMEA_LEN -1)  //talker + sentence id, no '$'
+#define NMEA_SENTENCE_TYPES    6      //GGA_INDEX..VTG_INDEX
+#define NMEA_SKIP_UNKNOWN      (1 << 7)
+
+#define NMEA_PARSE_PENDING     0
+#define NMEA_PARSE_COMPLETE    1
+#define NMEA_PARSE_ERROR       -1
+
+#define NMEA_FIELD_OK          0
+#define NMEA_FIELD_EMPTY       -1
+
+typedef enum {
+  nmea_hunt,
+  nmea_body,
+  nmea_checksum_hi,
+  nmea_checksum_lo,
+  nmea_cr,
+  nmea_lf
+}VENUS_nmea_state;
+
+typedef struct {
+  VENUS_nmea_state state;
+  uint8_t checksum;                       //running xor of everything between '$' and '*'
+  uint8_t rx_checksum;
+  uint8_t len;
+  uint8_t sentence[NMEA_SENTENCE_MAX +1]; //null terminated once complete
+  uint8_t skip_mask;                      //(1 << *_INDEX) | NMEA_SKIP_UNKNOWN, see venus_nmeaSubscribe()
+  uint32_t sentence_count;
+  uint32_t skipped_count;                 //dropped on their id, never completed
+  uint32_t checksum_errors;
+  uint32_t framing_errors;
+}VENUS_nmea_parser;
+
+/*
+ * Field offsets into parser.sentence, field 0 is the sentence id. Fields are 
+ * not copied or terminated, they run up to the next ',' or the end of the 
+ * sentence.
+ */
+typedef struct {
+  uint8_t count;
+  uint8_t start[NMEA_FIELD_MAX];
+}VENUS_nmea_fields;
+
+/*
+ * Decoded fix, integer only. Each sentence only touches the members it 
+ * carries and sets its bit ((1 << *_INDEX)) in 'updated'; empty fields 
+ * (no fix yet) leave the previous value alone.
+ */
+typedef struct {
+  int32_t latitude;             //degrees x1e7, north positive
+  int32_t longitude;            //degrees x1e7, east positive
+  int32_t altitude;             //cm above mean sea level
+  uint32_t utc_time;            //ms since midnight utc
+  uint32_t utc_date;            //ddmmyy
+  uint32_t speed;               //mm/s over ground
+  uint16_t course;              //degrees x100, true
+  uint16_t hdop;                //x100
+  uint8_t fix_quality;          //GGA: 0 invalid, 1 gps, 2 dgps ...
+  uint8_t fix_mode;             //GSA: 1 none, 2 2D, 3 3D
+  uint8_t satellites_used;
+  uint8_t satellites_in_view;
+  uint8_t valid;                //RMC/GLL status 'A'
+  uint8_t updated;
+}VENUS_fix;
+
+/*
+ * Streaming binary frame parser, see venus638_binary.c
+ *
+ * <A0 A1><payload len, 2 bytes><payload: id + body><xor checksum><0D 0A>
+ *
+ * Only the payload is kept, payload[0] is the message id.
+ */
+
+#define BINARY_PAYLOAD_MAX      96     //largest response is ephemeris at 87
+#define BINARY_RX_CHUNK         16     //bytes read from the usart per parser pass
+
+#define BINARY_PARSE_PENDING    0
+#define BINARY_PARSE_COMPLETE   1
+#define BINARY_PARSE_ERROR      -1
+
+typedef enum {
+  binary_hunt_0,
+  binary_hunt_1,
+  binary_len_hi,
+  binary_len_lo,
+  binary_payload,
+  binary_checksum,
+  binary_end_0,
+  binary_end_1
+}VENUS_binary_state;
+
+typedef struct {
+  VENUS_binary_state state;
+  uint16_t payload_len;
+  uint16_t index;
+  uint8_t rx_checksum;
+  uint8_t payload[BINARY_PAYLOAD_MAX];
+  uint32_t frame_count;
+  uint32_t checksum_errors;
+  uint32_t framing_errors;
+}VENUS_binary_parser;
+
+/*
+ * Sentence subscriptions, see venus_nmeaSubscribe(). rate goes to the 
+ * receiver as the ID_CONFIG_NMEA_MESSAGE interval for that sentence, 
+ * int callback(void* context, VENUS_fix* fix, uint32_t index) runs once 
+ * the sentence is decoded into fix.
+ */
+typedef struct {
+  uint8_t rate;                 //seconds between sentences, 0 unsubscribed
+  int(*callback)();
+  void* context;
+}VENUS_nmea_subscription;
+
 typedef struct {
 
  uint8_t decode_id[ID_NMEA_LEN];
  uint8_t decode_id_index;
  uint8_t nmea_len;
- uint8_t decode_gga[32];
- uint8_t decode_gll[32];
- uint8_t decode_gsa[32];
- uint8_t decode_gsv[32];
- uint8_t decode_rmc[32];
- uint8_t decode_vtg[32];
+ VENUS_nmea_parser parser;
+ VENUS_nmea_fields fields;
+ VENUS_binary_parser binary_parser;
+ VENUS_fix fix;                       //filled from NMEA or binary nav data
+ uint8_t subscribed;                  //(1 << *_INDEX), 0 decodes everything
+ VENUS_nmea_subscription subscription[NMEA_SENTENCE_TYPES];
 
 }VENUS_nmea_store;
 
@@ -280,11 +492,11 @@ typedef struct {
  **************************/
 
 #define VENUS_QUERY_LOOKUP_TABLE_LENGTH     24 
-#define VENUS_RESPONSE_LOOKUP_TABLE_LENGTH  12 
 
 #define VENUS_MESSAGE_INDEX   0
 #define VENUS_RESPONSE_INDEX  1
 #define VENUS_NMEA_INDEX      2
+#define VENUS_PIPELINE_INDEX  3
 
 #define VENUS_CONFIG_INDEX    0
 #define VENUS_OP_INDEX        1
@@ -332,9 +544,73 @@ typedef struct {
 
 #define BR_4800   4800    
 #define BR_9600   9600    
+#define BR_19200  19200   
 #define BR_38400  38400   
+#define BR_57600  57600   
 #define BR_115200 115200  //default baud rate
 
+/*
+ * Baud rate probing/escalation, see venus638_Baud() in the adaptor.
+ * venus_baud_rate_table is indexed by the CONFIG_SERIAL_PORT_BR_* code.
+ */
+#define VENUS_BAUD_CODES          6     //CONFIG_SERIAL_PORT_BR_4800..115200
+#define VENUS_REPLY_CHUNKS        32    //BINARY_RX_CHUNK reads to wait for a reply, ~0.5KB
+
+#define VENUS_REPLY_ACK           0
+#define VENUS_REPLY_NACK          -1
+#define VENUS_REPLY_NONE          -2
+
+extern const uint32_t venus_baud_rate_table[VENUS_BAUD_CODES];
+
+int venus_commandReply(void* host_object, int (*host_usart)(), void* ext_dev_object);
+
+/*
+ * Command pipeline, see venus_pipelineRun()
+ *
+ * Commands are queued by id, sent back to back (up to VENUS_PIPELINE_WINDOW 
+ * in flight) and resolved as their ACK/NACK and status replies turn up in
+ * the binary Rx stream. Each in flight command has a deadline off the host
+ * ms tick (_timer_ticks); hosts without one count Rx chunks instead.
+ */
+#define VENUS_PIPELINE_LEN        16
+#define VENUS_PIPELINE_WINDOW     4     //commands on the wire at once, the receiver only buffers so much
+#define VENUS_COMMAND_TIMEOUT_MS  250   //per command, re-armed on ACK when a status reply is still due
+
+#define VENUS_NO_RESPONSE         0
+
+typedef enum {
+  venus_cmd_queued,
+  venus_cmd_sent,
+  venus_cmd_acked,              //ACKed, waiting on the status reply
+  venus_cmd_done,
+  venus_cmd_nacked,
+  venus_cmd_timeout,
+  venus_cmd_error               //would not build/send
+}VENUS_command_state;
+
+typedef struct {
+  uint8_t message_id;
+  uint8_t response_id;
+  uint8_t state;
+  uint32_t deadline;
+}VENUS_command;
+
+typedef struct VENUS_PIPELINE{
+  VENUS_command command[VENUS_PIPELINE_LEN];
+  uint32_t count;
+  uint32_t next_tx;             //first command not yet sent
+  uint32_t in_flight;
+  uint32_t unresolved;          //queued + in flight
+  uint32_t rx_chunks;           //tick source when the host has no _timer_ticks
+  uint32_t now;                 //tick at the last Rx pass, for re-arming on ACK
+  uint32_t timeout;             //ticks per command
+}VENUS_pipeline;
+
+int venus_pipelineReset(VENUS_pipeline* venus_pipeline);
+int venus_pipelineQueue(VENUS_pipeline* venus_pipeline, uint8_t message_id, uint8_t response_id);
+int venus_pipelineMatch(VENUS_pipeline* venus_pipeline, uint8_t* payload);
+int venus_pipelineRun(void* host_object, int (*host_usart)(), void* ext_dev_object);
+
 /***********************
  *
  *  MESSAGE INDEXES    
@@ -357,6 +633,7 @@ typedef struct {
 #define LEN_PAYLOAD_LEN_LEN       2
 #define LEN_MESSAGE_ID            1
 #define LEN_CHECKSUM              1
+#define LEN_FRAME_OVERHEAD        (LEN_SEQ_START + LEN_PAYLOAD_LEN_LEN + LEN_CHECKSUM + LEN_SEQ_END)
 
 #define NO_BYTE_SHIFT             0
 #define SINGLE_BYTE_SHIFT         8
@@ -516,9 +793,9 @@ typedef struct {
 #define CONFIG_SYSTEM_POS_RATE_4HZ                 0x04
 #define CONFIG_SYSTEM_POS_RATE_5HZ                 0x05
 #define CONFIG_SYSTEM_POS_RATE_8HZ                 0x08
-#define CONFIG_SYSTEM_POS_RATE_10HZ                0x10
+#define CONFIG_SYSTEM_POS_RATE_10HZ                0x0A
 /* baud rate == 115200 */
-#define CONFIG_SYSTEM_POS_RATE_20HZ                0x20
+#define CONFIG_SYSTEM_POS_RATE_20HZ                0x14
 #define CONFIG_SYSTEM_POS_UPDATE_SRAM              0x00
 #define CONFIG_SYSTEM_POS_UPDATE_SRAM_FLASH        0x01
 #define CONFIG_SYSTEM_POS_RATE_PL_LEN              3
@@ -569,7 +846,7 @@ typedef struct {
 #define CONFIG_EPH_DATA_SET_PL_LEN      87
 /******************************* LEARN MORE ABOUT EPHEMERIS DATA AND UNDERSTAND HOW MANY SUB FRAMES ARE POSSIBLE ********************/
 
-#define EPH_SUB_FRAME_DATA_LEN 27
+#define EPH_SUB_FRAME_DATA_LEN 28
 
 //ID_CONFIG_WAAS
 //
@@ -658,6 +935,7 @@ typedef struct {
 #define RES_STATUS_PIN            0xB4 //status of pinning position
 #define RES_STATUS_NAV            0xB5 //navigation mode of GPS
 #define RES_STATUS_1PPS           0xB6 //1PPS mode of GPS
+#define RES_ID_NAV_DATA           0xA8 //navigation data (binary output mode)
 
 //ID_STATUS_SW_VERSION
 //
@@ -716,8 +994,48 @@ typedef struct {
 #define STATUS_1PPS_MODE_PL_LEN    2
 #define ID_STATUS_1PPS            0xB6 //1PPS mode of GPS
 
-
-int(*const usart_rx_tx_table[VENUS_READ_WRITE+1])();
+//ID_NAV_DATA
+//
+/*
+ * Periodic output once CONFIG_MESSAGE_TYPE_BINARY is set, one per update.
+ * 66 bytes framed against ~490 for a GGA/GLL/GSA/GSV/RMC/VTG set, which
+ * is what makes 10-20Hz updates fit in the uart. Offsets are into the 
+ * payload (0 is the id), all big endian.
+ */
+#define STATUS_NAV_DATA_PL_LEN     59
+#define ID_NAV_DATA               0xA8
+
+#define NAV_DATA_FIX_MODE          1   //0 none, 1 2D, 2 3D, 3 3D + DGPS
+#define NAV_DATA_SV_COUNT          2
+#define NAV_DATA_GPS_WEEK          3   //u16
+#define NAV_DATA_TOW               5   //u32, 0.01s
+#define NAV_DATA_LATITUDE          9   //s32, 1e-7 deg
+#define NAV_DATA_LONGITUDE         13  //s32, 1e-7 deg
+#define NAV_DATA_ELLIPSOID_ALT     17  //u32, cm
+#define NAV_DATA_MSL_ALT           21  //u32, cm
+#define NAV_DATA_GDOP              25  //u16, x100
+#define NAV_DATA_PDOP              27
+#define NAV_DATA_HDOP              29
+#define NAV_DATA_VDOP              31
+#define NAV_DATA_TDOP              33
+#define NAV_DATA_ECEF_X            35  //s32, cm
+#define NAV_DATA_ECEF_Y            39
+#define NAV_DATA_ECEF_Z            43
+#define NAV_DATA_ECEF_VX           47  //s32, cm/s
+#define NAV_DATA_ECEF_VY           51
+#define NAV_DATA_ECEF_VZ           55
+
+#define NAV_FIX_MODE_NONE          0
+#define NAV_FIX_MODE_2D            1
+#define NAV_FIX_MODE_3D            2
+#define NAV_FIX_MODE_3D_DGPS       3
+
+#define GPS_UTC_LEAP_SECONDS       18     //as of 2017, check IERS bulletin C
+#define GPS_EPOCH_UNIX_DAYS        3657   //1980-01-06
+#define MS_PER_DAY                 86400000
+
+
+extern int(*const usart_rx_tx_table[])();
 
 #endif
 
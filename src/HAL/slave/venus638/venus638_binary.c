@@ -0,0 +1,293 @@
+ /* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+ 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "venus638.h"
+#include "venus638_binary.h"
+
+int venus_binaryFramingError(VENUS_binary_parser* parser);
+uint32_t venus_binaryU16(uint8_t* buffer);
+uint32_t venus_binaryU32(uint8_t* buffer);
+uint32_t venus_binaryIsqrt(uint64_t value);
+void venus_binaryUtc(uint32_t gps_week, uint32_t tow, VENUS_fix* fix);
+
+/*****************************************
+ *
+ *      Streaming binary frame parser
+ *
+ *****************************************/
+
+/*
+ *  <A0 A1><PL hi><PL lo><id><body...><CS><0D 0A>
+ *
+ *  Same shape as the NMEA parser: fed in ones or chunks, holds one payload
+ *  at a time. Payload bytes can legitimately be A0, so unlike '$' the start
+ *  sequence only resynchronises from the hunt states; any framing or length
+ *  error drops back to hunting.
+ */
+
+uint8_t venus_xorChecksum(uint8_t* buffer, uint32_t buffer_len){
+
+  uint8_t checksum = 0;
+
+  for(uint32_t i = 0; i < buffer_len; i++){
+    checksum ^= buffer[i];
+  }
+  return checksum;
+}
+
+int venus_binaryFramingError(VENUS_binary_parser* parser){
+
+  parser->framing_errors++;
+  parser->state = binary_hunt_0;
+  return BINARY_PARSE_ERROR;
+}
+
+void venus_binaryParserReset(VENUS_binary_parser* parser){
+
+  parser->state = binary_hunt_0;
+  parser->payload_len = 0;
+  parser->index = 0;
+  parser->rx_checksum = 0;
+}
+
+int venus_binaryParseByte(VENUS_binary_parser* parser, uint8_t byte_in){
+
+  switch(parser->state){
+
+    case binary_hunt_0:
+      if(byte_in == SEQUENCE_START_0){
+        parser->state = binary_hunt_1;
+      }
+      return BINARY_PARSE_PENDING;
+
+    case binary_hunt_1:
+      if(byte_in == SEQUENCE_START_1){
+        venus_binaryParserReset(parser);
+        parser->state = binary_len_hi;
+      } else if(byte_in != SEQUENCE_START_0){
+        parser->state = binary_hunt_0;
+      }
+      return BINARY_PARSE_PENDING;
+
+    case binary_len_hi:
+      parser->payload_len = byte_in << SINGLE_BYTE_SHIFT;
+      parser->state = binary_len_lo;
+      return BINARY_PARSE_PENDING;
+
+    case binary_len_lo:
+      parser->payload_len |= byte_in;
+      if(parser->payload_len == 0 || parser->payload_len > BINARY_PAYLOAD_MAX){
+        return venus_binaryFramingError(parser);
+      }
+      parser->state = binary_payload;
+      return BINARY_PARSE_PENDING;
+
+    case binary_payload:
+      parser->payload[parser->index++] = byte_in;
+      if(parser->index == parser->payload_len){
+        parser->state = binary_checksum;
+      }
+      return BINARY_PARSE_PENDING;
+
+    case binary_checksum:
+      parser->rx_checksum = byte_in;
+      parser->state = binary_end_0;
+      return BINARY_PARSE_PENDING;
+
+    case binary_end_0:
+      if(byte_in != SEQUENCE_END_0){
+        return venus_binaryFramingError(parser);
+      }
+      parser->state = binary_end_1;
+      return BINARY_PARSE_PENDING;
+
+    case binary_end_1:
+      if(byte_in != SEQUENCE_END_1){
+        return venus_binaryFramingError(parser);
+      }
+      parser->state = binary_hunt_0;
+
+      //checked once the frame is known to be whole, over the held payload
+      if(venus_xorChecksum(parser->payload, parser->payload_len) != parser->rx_checksum){
+        parser->checksum_errors++;
+        return BINARY_PARSE_ERROR;
+      }
+      parser->frame_count++;
+      return BINARY_PARSE_COMPLETE;
+  }
+
+  return venus_binaryFramingError(parser);
+}
+
+/*
+ * As venus_nmeaParse(): returns on every completed or failed frame with the
+ * payload still in parser->payload, 'consumed' is how far into buffer_in we got.
+ */
+int venus_binaryParse(VENUS_binary_parser* parser, uint8_t* buffer_in, uint32_t buffer_len, uint32_t* consumed){
+
+  for(uint32_t i = 0; i < buffer_len; i++){
+    int ret = venus_binaryParseByte(parser, buffer_in[i]);
+    if(ret != BINARY_PARSE_PENDING){
+      *consumed = i +1;
+      return ret;
+    }
+  }
+  *consumed = buffer_len;
+  return BINARY_PARSE_PENDING;
+}
+
+
+/*****************************************
+ *
+ *         Navigation data decoder
+ *
+ *****************************************/
+
+uint32_t venus_binaryU16(uint8_t* buffer){
+
+  return (buffer[0] << SINGLE_BYTE_SHIFT) | buffer[1];
+}
+
+uint32_t venus_binaryU32(uint8_t* buffer){
+
+  return ((uint32_t)buffer[0] << TRIPLE_BYTE_SHIFT) | ((uint32_t)buffer[1] << DOUBLE_BYTE_SHIFT) | 
+         ((uint32_t)buffer[2] << SINGLE_BYTE_SHIFT) | buffer[3];
+}
+
+uint32_t venus_binaryIsqrt(uint64_t value){
+
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while(bit > value){
+    bit >>= 2;
+  }
+  while(bit != 0){
+    if(value >= root + bit){
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/*
+ * GPS week + time of week -> utc ms since midnight and ddmmyy, matching what
+ * the NMEA decoders leave in the fix. Days since 1970 to a civil date is the
+ * usual era/day-of-era split, integer only.
+ */
+void venus_binaryUtc(uint32_t gps_week, uint32_t tow, VENUS_fix* fix){
+
+  uint32_t ms_of_week = tow * 10;
+  uint32_t leap_ms = GPS_UTC_LEAP_SECONDS * 1000;
+  uint32_t days = (gps_week * 7) + GPS_EPOCH_UNIX_DAYS;
+
+  if(ms_of_week < leap_ms){
+    ms_of_week += 7 * MS_PER_DAY;
+    days -= 7;
+  }
+  ms_of_week -= leap_ms;
+  days += ms_of_week / MS_PER_DAY;
+  fix->utc_time = ms_of_week % MS_PER_DAY;
+
+  days += 719468;
+  uint32_t era = days / 146097;
+  uint32_t day_of_era = days - (era * 146097);
+  uint32_t year_of_era = (day_of_era - (day_of_era / 1460) + (day_of_era / 36524) - (day_of_era / 146096)) / 365;
+  uint32_t day_of_year = day_of_era - ((365 * year_of_era) + (year_of_era / 4) - (year_of_era / 100));
+  uint32_t month_index = ((5 * day_of_year) + 2) / 153;
+  uint32_t day = day_of_year - (((153 * month_index) + 2) / 5) + 1;
+  uint32_t month = (month_index < 10 ? month_index + 3 : month_index - 9);
+  uint32_t year = year_of_era + (era * 400) + (month <= 2);
+
+  fix->utc_date = (day * 10000) + (month * 100) + (year % 100);
+}
+
+/*
+ * Fix time -> seconds since the unix epoch, the other way round (civil date
+ * to days). Only whole seconds, which is what a 1PPS edge marks; sub-second
+ * fixes at the higher update rates and fixes without a date yet fail.
+ */
+int venus_fixUtcSeconds(VENUS_fix* fix, uint64_t* utc_s){
+
+  if(fix->utc_date == 0 || (fix->utc_time % 1000) != 0){
+    return -1;
+  }
+
+  uint32_t day = fix->utc_date / 10000;
+  uint32_t month = (fix->utc_date / 100) % 100;
+  uint32_t year = 2000 + (fix->utc_date % 100) - (month <= 2);
+
+  uint32_t era = year / 400;
+  uint32_t year_of_era = year - (era * 400);
+  uint32_t day_of_year = (((153 * (month > 2 ? month - 3 : month + 9)) + 2) / 5) + day - 1;
+  uint32_t day_of_era = (year_of_era * 365) + (year_of_era / 4) - (year_of_era / 100) + day_of_year;
+  uint64_t days = ((uint64_t)era * 146097) + day_of_era - 719468;
+
+  *utc_s = (days * (MS_PER_DAY / 1000)) + (fix->utc_time / 1000);
+  return 0;
+}
+
+/*
+ * Nav data -> VENUS_fix. Mode and satellite count mirror GSA/GGA so consumers
+ * don't care which output format is running. Position and velocity are only 
+ * taken with a fix, same as empty NMEA fields. The message has no ground 
+ * course and only ECEF velocity, so 'speed' is the 3D speed magnitude and
+ * 'course' is left alone.
+ */
+int venus_decodeNavData(VENUS_binary_parser* parser, VENUS_fix* fix){
+
+  uint8_t* payload = parser->payload;
+
+  if(parser->payload_len < STATUS_NAV_DATA_PL_LEN){
+    return BINARY_PARSE_ERROR;
+  }
+
+  uint8_t mode = payload[NAV_DATA_FIX_MODE];
+
+  fix->fix_mode = (mode == NAV_FIX_MODE_NONE ? 1 : (mode == NAV_FIX_MODE_2D ? 2 : 3));
+  fix->fix_quality = (mode == NAV_FIX_MODE_NONE ? 0 : (mode == NAV_FIX_MODE_3D_DGPS ? 2 : 1));
+  fix->valid = (mode != NAV_FIX_MODE_NONE);
+  fix->satellites_used = payload[NAV_DATA_SV_COUNT];
+
+  venus_binaryUtc(venus_binaryU16(&payload[NAV_DATA_GPS_WEEK]), venus_binaryU32(&payload[NAV_DATA_TOW]), fix);
+
+  if(mode != NAV_FIX_MODE_NONE){
+
+    fix->latitude = (int32_t)venus_binaryU32(&payload[NAV_DATA_LATITUDE]);
+    fix->longitude = (int32_t)venus_binaryU32(&payload[NAV_DATA_LONGITUDE]);
+    fix->altitude = (int32_t)venus_binaryU32(&payload[NAV_DATA_MSL_ALT]);
+    fix->hdop = venus_binaryU16(&payload[NAV_DATA_HDOP]);
+
+    int64_t vx = (int32_t)venus_binaryU32(&payload[NAV_DATA_ECEF_VX]);
+    int64_t vy = (int32_t)venus_binaryU32(&payload[NAV_DATA_ECEF_VY]);
+    int64_t vz = (int32_t)venus_binaryU32(&payload[NAV_DATA_ECEF_VZ]);
+
+    //cm/s -> mm/s
+    fix->speed = venus_binaryIsqrt((vx * vx) + (vy * vy) + (vz * vz)) * 10;
+  }
+
+  fix->updated |= (1 << NAV_DATA_INDEX);
+  return BINARY_PARSE_COMPLETE;
+}
@@ -0,0 +1,17 @@
+#ifndef VENUS638_BINARY_H_
+#define VENUS638_BINARY_H_
+
+#include <stdint.h>
+
+#include "venus638.h"
+
+uint8_t venus_xorChecksum(uint8_t* buffer, uint32_t buffer_len);
+
+void venus_binaryParserReset(VENUS_binary_parser* parser);
+int venus_binaryParseByte(VENUS_binary_parser* parser, uint8_t byte_in);
+int venus_binaryParse(VENUS_binary_parser* parser, uint8_t* buffer_in, uint32_t buffer_len, uint32_t* consumed);
+
+int venus_decodeNavData(VENUS_binary_parser* parser, VENUS_fix* fix);
+int venus_fixUtcSeconds(VENUS_fix* fix, uint64_t* utc_s);
+
+#endif
@@ -0,0 +1,371 @@
+ /* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+  
+#include <stddef.h>
+#include <stdint.h>
+
+#include "venus638.h"
+#include "venus638_nmea.h"
+
+int venus_nmeaHexNibble(uint8_t byte_in);
+int venus_nmeaFramingError(VENUS_nmea_parser* parser);
+
+/*****************************************
+ *
+ *      Streaming NMEA sentence parser
+ *
+ *****************************************/
+
+/*
+ *  $<talker + sentence id>,<fields...>*<hh><CR><LF>
+ *
+ *  Bytes are fed in as they come off the usart, in ones or in chunks. The 
+ *  checksum is xor'd as each body byte arrives so a sentence is verified 
+ *  the moment its last checksum digit lands, without re-scanning the buffer.
+ *
+ *  A '$' anywhere re-synchronises the parser, so a dropped byte costs at most
+ *  the sentence it was in.
+ *
+ *  Once the id is in, sentences in skip_mask go straight back to the hunt, 
+ *  so nothing nobody subscribed to gets checksummed, tokenized or decoded.
+ */
+
+int venus_nmeaHexNibble(uint8_t byte_in){
+
+  if(byte_in >= '0' && byte_in <= '9'){
+    return byte_in - '0';
+  } else if(byte_in >= 'A' && byte_in <= 'F'){
+    return byte_in - 'A' + 10;
+  } else if(byte_in >= 'a' && byte_in <= 'f'){
+    return byte_in - 'a' + 10;
+  }
+  return NMEA_PARSE_ERROR;
+}
+
+int venus_nmeaFramingError(VENUS_nmea_parser* parser){
+
+  parser->framing_errors++;
+  parser->state = nmea_hunt;
+  return NMEA_PARSE_ERROR;
+}
+
+void venus_nmeaParserReset(VENUS_nmea_parser* parser){
+
+  parser->state = nmea_hunt;
+  parser->checksum = 0;
+  parser->rx_checksum = 0;
+  parser->len = 0;
+}
+
+int venus_nmeaParseByte(VENUS_nmea_parser* parser, uint8_t byte_in){
+
+  //start of sentence always wins, whatever state we were in
+  //
+  if(byte_in == NMEA_SENTENCE_BEGIN){
+    int ret = (parser->state == nmea_hunt ? NMEA_PARSE_PENDING : venus_nmeaFramingError(parser));
+    venus_nmeaParserReset(parser);
+    parser->state = nmea_body;
+    return ret;
+  }
+
+  int nibble;
+
+  switch(parser->state){
+
+    case nmea_hunt:
+      return NMEA_PARSE_PENDING;
+
+    case nmea_body:
+      if(byte_in == NMEA_CHECKSUM_DELIM){
+        parser->sentence[parser->len] = '\0';
+        parser->state = nmea_checksum_hi;
+        return NMEA_PARSE_PENDING;
+      }
+      //printable ascii only, and leave room for '$', '*hh' and <CR><LF>
+      if(byte_in < 0x20 || byte_in > 0x7E || parser->len >= (NMEA_SENTENCE_MAX - 6)){
+        return venus_nmeaFramingError(parser);
+      }
+      parser->checksum ^= byte_in;
+      parser->sentence[parser->len++] = byte_in;
+
+      if(parser->len == NMEA_ID_LEN && parser->skip_mask){
+        uint8_t index = venus_nmeaSentenceIndex(parser->sentence);
+        if(parser->skip_mask & (index == NMEA_HASH_EMPTY ? NMEA_SKIP_UNKNOWN : (1 << index))){
+          parser->skipped_count++;
+          parser->state = nmea_hunt;
+        }
+      }
+      return NMEA_PARSE_PENDING;
+
+    case nmea_checksum_hi:
+      nibble = venus_nmeaHexNibble(byte_in);
+      if(nibble < 0){
+        return venus_nmeaFramingError(parser);
+      }
+      parser->rx_checksum = nibble << 4;
+      parser->state = nmea_checksum_lo;
+      return NMEA_PARSE_PENDING;
+
+    case nmea_checksum_lo:
+      nibble = venus_nmeaHexNibble(byte_in);
+      if(nibble < 0){
+        return venus_nmeaFramingError(parser);
+      }
+      parser->rx_checksum |= nibble;
+      if(parser->rx_checksum != parser->checksum){
+        parser->checksum_errors++;
+        parser->state = nmea_hunt;
+        return NMEA_PARSE_ERROR;
+      }
+      parser->state = nmea_cr;
+      return NMEA_PARSE_PENDING;
+
+    case nmea_cr:
+      if(byte_in == NMEA_SENTENCE_CR){
+        parser->state = nmea_lf;
+        return NMEA_PARSE_PENDING;
+      }
+      //some firmware drops the <CR>, accept a bare <LF>
+      if(byte_in == NMEA_SENTENCE_LF){
+        parser->sentence_count++;
+        parser->state = nmea_hunt;
+        return NMEA_PARSE_COMPLETE;
+      }
+      return venus_nmeaFramingError(parser);
+
+    case nmea_lf:
+      if(byte_in == NMEA_SENTENCE_LF){
+        parser->sentence_count++;
+        parser->state = nmea_hunt;
+        return NMEA_PARSE_COMPLETE;
+      }
+      return venus_nmeaFramingError(parser);
+  }
+
+  return venus_nmeaFramingError(parser);
+}
+
+/*
+ * Feed a chunk. Returns as soon as a sentence completes (or fails its checksum)
+ * so the caller can handle it while it is still in parser->sentence, then call 
+ * again with the remainder. 'consumed' is how far into buffer_in we got.
+ */
+int venus_nmeaParse(VENUS_nmea_parser* parser, uint8_t* buffer_in, uint32_t buffer_len, uint32_t* consumed){
+
+  for(uint32_t i = 0; i < buffer_len; i++){
+    int ret = venus_nmeaParseByte(parser, buffer_in[i]);
+    if(ret != NMEA_PARSE_PENDING){
+      *consumed = i +1;
+      return ret;
+    }
+  }
+  *consumed = buffer_len;
+  return NMEA_PARSE_PENDING;
+}
+
+
+/*****************************************
+ *
+ *        Sentence subscriptions
+ *
+ *****************************************/
+
+/*
+ * Register interest in one sentence (GGA_INDEX..VTG_INDEX). rate is the 
+ * receiver's output interval in seconds, 0 unsubscribes. callback may be 
+ * NULL if the fix is all that's wanted.
+ *
+ * With anything subscribed, everything else (unknown sentences included) is
+ * dropped by the parser on its id. With nothing subscribed the filter is off
+ * and every sentence we know is decoded, as before. venus638_NmeaRates() 
+ * pushes the rates down so the receiver stops sending what we'd drop anyway.
+ */
+int venus_nmeaSubscribe(VENUS_nmea_store* nmea_store, uint32_t index, uint8_t rate, int(*callback)(), void* context){
+
+  if(index >= NMEA_SENTENCE_TYPES){
+    return -1;
+  }
+
+  VENUS_nmea_subscription* subscription = &nmea_store->subscription[index];
+
+  subscription->rate = rate;
+  subscription->callback = (rate ? callback : NULL);
+  subscription->context = (rate ? context : NULL);
+
+  if(rate){
+    nmea_store->subscribed |= (1 << index);
+  } else {
+    nmea_store->subscribed &= ~(1 << index);
+  }
+
+  nmea_store->parser.skip_mask = (nmea_store->subscribed ? (uint8_t)~nmea_store->subscribed : 0);
+  return 0;
+}
+
+
+/*****************************************
+ *
+ *     Field tokenizer and converters
+ *
+ *****************************************/
+
+/*
+ * One pass over the sentence recording where each field starts. Nothing is
+ * copied: converters read straight out of parser->sentence up to the next
+ * ',' (or the terminator). Everything below is integer only, no libc.
+ */
+
+uint32_t venus_nmeaTokenize(VENUS_nmea_parser* parser, VENUS_nmea_fields* fields){
+
+  fields->count = 0;
+  fields->start[fields->count++] = 0;
+
+  for(uint32_t i = 0; i < parser->len && fields->count < NMEA_FIELD_MAX; i++){
+    if(parser->sentence[i] == NMEA_FIELD_DELIM){
+      fields->start[fields->count++] = i +1;
+    }
+  }
+  return fields->count;
+}
+
+uint8_t* venus_nmeaField(VENUS_nmea_store* nmea_store, uint32_t field_index){
+
+  //fields past the end of a short sentence read as empty
+  if(field_index >= nmea_store->fields.count){
+    return &nmea_store->parser.sentence[nmea_store->parser.len];
+  }
+  return &nmea_store->parser.sentence[nmea_store->fields.start[field_index]];
+}
+
+int venus_nmeaFieldEnd(uint8_t byte_in){
+
+  return (byte_in == NMEA_FIELD_DELIM || byte_in == '\0');
+}
+
+/*
+ * "iii.fff" -> int_part, frac_part scaled to exactly frac_digits (truncated or
+ * zero padded). Outputs are only written if the field holds a number.
+ */
+int venus_nmeaFixed(uint8_t* field, uint32_t frac_digits, uint32_t* int_part, uint32_t* frac_part){
+
+  uint32_t int_value = 0;
+  uint32_t frac_value = 0;
+  uint32_t digits = 0;
+  int seen = 0;
+  uint8_t* c = field;
+
+  while(*c >= '0' && *c <= '9'){
+    int_value = (int_value * 10) + (*c++ - '0');
+    seen = 1;
+  }
+  if(*c == '.'){
+    c++;
+    while(*c >= '0' && *c <= '9'){
+      if(digits < frac_digits){
+        frac_value = (frac_value * 10) + (*c - '0');
+        digits++;
+      }
+      c++;
+      seen = 1;
+    }
+  }
+  if(!seen || !venus_nmeaFieldEnd(*c)){
+    return NMEA_FIELD_EMPTY;
+  }
+  for(; digits < frac_digits; digits++){
+    frac_value *= 10;
+  }
+
+  *int_part = int_value;
+  *frac_part = frac_value;
+  return NMEA_FIELD_OK;
+}
+
+int venus_nmeaUnsigned(uint8_t* field, uint32_t frac_digits, uint32_t* value){
+
+  uint32_t int_part, frac_part, scale = 1;
+
+  if(venus_nmeaFixed(field, frac_digits, &int_part, &frac_part) != NMEA_FIELD_OK){
+    return NMEA_FIELD_EMPTY;
+  }
+  for(uint32_t i = 0; i < frac_digits; i++){
+    scale *= 10;
+  }
+  *value = (int_part * scale) + frac_part;
+  return NMEA_FIELD_OK;
+}
+
+int venus_nmeaSigned(uint8_t* field, uint32_t frac_digits, int32_t* value){
+
+  uint32_t magnitude;
+  int negative = (*field == '-');
+
+  if(venus_nmeaUnsigned(field + negative, frac_digits, &magnitude) != NMEA_FIELD_OK){
+    return NMEA_FIELD_EMPTY;
+  }
+  *value = (negative ? -(int32_t)magnitude : (int32_t)magnitude);
+  return NMEA_FIELD_OK;
+}
+
+/*
+ * "dddmm.mmmm" + hemisphere -> degrees x1e7. Minutes are carried as 1e-6 
+ * minute units so the /60 is a single /6 at the end: deg x1e7 = min x1e6 * 10 / 60.
+ */
+int venus_nmeaLatLon(uint8_t* field, uint8_t* hemisphere, int32_t* value){
+
+  uint32_t int_part, frac_part;
+
+  if(venus_nmeaFixed(field, 6, &int_part, &frac_part) != NMEA_FIELD_OK || venus_nmeaFieldEnd(*hemisphere)){
+    return NMEA_FIELD_EMPTY;
+  }
+
+  uint32_t degrees = int_part / 100;
+  uint32_t minutes_e6 = ((int_part % 100) * 1000000) + frac_part;
+  int32_t degrees_e7 = (int32_t)((degrees * 10000000) + ((minutes_e6 + 3) / 6));
+
+  *value = ((*hemisphere == 'S' || *hemisphere == 'W') ? -degrees_e7 : degrees_e7);
+  return NMEA_FIELD_OK;
+}
+
+// "hhmmss.sss" -> ms since midnight
+int venus_nmeaTime(uint8_t* field, uint32_t* value){
+
+  uint32_t hhmmss, ms;
+
+  if(venus_nmeaFixed(field, 3, &hhmmss, &ms) != NMEA_FIELD_OK){
+    return NMEA_FIELD_EMPTY;
+  }
+  uint32_t hours = hhmmss / 10000;
+  uint32_t minutes = (hhmmss / 100) % 100;
+  uint32_t seconds = hhmmss % 100;
+
+  *value = (((((hours * 60) + minutes) * 60) + seconds) * 1000) + ms;
+  return NMEA_FIELD_OK;
+}
+
+// knots (x1000) -> mm/s, 1 knot = 1852 m/h
+int venus_nmeaSpeed(uint8_t* field, uint32_t* value){
+
+  uint32_t milli_knots;
+
+  if(venus_nmeaUnsigned(field, 3, &milli_knots) != NMEA_FIELD_OK){
+    return NMEA_FIELD_EMPTY;
+  }
+  *value = ((milli_knots * 1852) + 1800) / 3600;
+  return NMEA_FIELD_OK;
+}
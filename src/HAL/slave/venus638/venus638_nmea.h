@@ -0,0 +1,24 @@
+#ifndef VENUS638_NMEA_H_
+#define VENUS638_NMEA_H_
+
+#include <stdint.h>
+
+#include "venus638.h"
+
+void venus_nmeaParserReset(VENUS_nmea_parser* parser);
+int venus_nmeaParseByte(VENUS_nmea_parser* parser, uint8_t byte_in);
+int venus_nmeaParse(VENUS_nmea_parser* parser, uint8_t* buffer_in, uint32_t buffer_len, uint32_t* consumed);
+uint8_t venus_nmeaSentenceIndex(uint8_t* sentence);
+int venus_nmeaSubscribe(VENUS_nmea_store* nmea_store, uint32_t index, uint8_t rate, int(*callback)(), void* context);
+
+uint32_t venus_nmeaTokenize(VENUS_nmea_parser* parser, VENUS_nmea_fields* fields);
+uint8_t* venus_nmeaField(VENUS_nmea_store* nmea_store, uint32_t field_index);
+int venus_nmeaFieldEnd(uint8_t byte_in);
+int venus_nmeaFixed(uint8_t* field, uint32_t frac_digits, uint32_t* int_part, uint32_t* frac_part);
+int venus_nmeaUnsigned(uint8_t* field, uint32_t frac_digits, uint32_t* value);
+int venus_nmeaSigned(uint8_t* field, uint32_t frac_digits, int32_t* value);
+int venus_nmeaLatLon(uint8_t* field, uint8_t* hemisphere, int32_t* value);
+int venus_nmeaTime(uint8_t* field, uint32_t* value);
+int venus_nmeaSpeed(uint8_t* field, uint32_t* value);
+
+#endif
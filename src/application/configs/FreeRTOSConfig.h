@@ -0,0 +1,63 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/*
+ * FreeRTOS configuration for -DFREERTOS builds, see mpi_rtos.c. The
+ * efm32zg222f32 runs the ARM_CM0 port off SysTick, everything else is
+ * taken to be the POSIX port (tools/freertos).
+ */
+
+#ifdef EFM32ZG222F32
+  #define configCPU_CLOCK_HZ                  24000000  //HFXO, see config_efm32zg222f32.c
+  #define configTICK_RATE_HZ                  1000
+  #define configMINIMAL_STACK_SIZE            64
+  #define configTOTAL_HEAP_SIZE               (2 * 1024)    //of 4KB, two driver tasks and idle
+  #define configMAX_PRIORITIES                4
+
+  //startup_efm32zg.S vector names
+  #define vPortSVCHandler                     SVC_Handler
+  #define xPortPendSVHandler                  PendSV_Handler
+  #define xPortSysTickHandler                 SysTick_Handler
+#else
+  #define configCPU_CLOCK_HZ                  0
+  #define configTICK_RATE_HZ                  1000
+  #define configMINIMAL_STACK_SIZE            1024
+  #define configTOTAL_HEAP_SIZE               (256 * 1024)
+  #define configMAX_PRIORITIES                8
+#endif
+
+#define configUSE_PREEMPTION                  1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_TICKLESS_IDLE               0
+#define configMAX_TASK_NAME_LEN               12
+#define configUSE_16_BIT_TICKS                0
+#define configIDLE_SHOULD_YIELD               1
+#define configUSE_TASK_NOTIFICATIONS          1
+#define configUSE_MUTEXES                     1
+#define configUSE_RECURSIVE_MUTEXES           0
+#define configUSE_COUNTING_SEMAPHORES         1
+#define configQUEUE_REGISTRY_SIZE             0
+#define configUSE_QUEUE_SETS                  0
+#define configUSE_TIME_SLICING                1
+#define configSTACK_DEPTH_TYPE                uint16_t
+
+#define configSUPPORT_STATIC_ALLOCATION       0
+#define configSUPPORT_DYNAMIC_ALLOCATION      1
+
+#define configUSE_IDLE_HOOK                   0
+#define configUSE_TICK_HOOK                   0
+#define configCHECK_FOR_STACK_OVERFLOW        0
+#define configUSE_MALLOC_FAILED_HOOK          0
+
+#define configUSE_TRACE_FACILITY              0
+#define configGENERATE_RUN_TIME_STATS         0
+#define configUSE_CO_ROUTINES                 0
+#define configUSE_TIMERS                      0
+
+#define INCLUDE_vTaskDelay                    1
+#define INCLUDE_vTaskDelete                   0
+#define INCLUDE_vTaskSuspend                  1
+#define INCLUDE_xTaskGetSchedulerState        1
+#define INCLUDE_xTaskGetCurrentTaskHandle     1
+
+#endif
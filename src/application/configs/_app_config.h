@@ -31,6 +31,11 @@
   #include "spidriver.h"
 #endif
 
+#ifdef SPIDEV
+  #include "config_spidev.h"
+  #include "spidev_adaptor.h"
+#endif
+
 /******************************************************************
  *
  *              PUT YOUR INTERRUPT HANLDERS HERE!!!
@@ -54,7 +54,7 @@
   uint8_t sys_time[SYS_TIME_LEN];
   uint8_t tx_frame_ctrl[TX_FRAME_CTRL_LEN]; 
   uint8_t tx_frame_ctrl_sub_reg_4;
-  uint32_t rf_tx_delay[2];         // used to specficy a time in the future to turn on rx or send tx   
+  uint8_t rf_tx_delay[5];          // used to specficy a time in the future to turn on rx or send tx   
   uint8_t rx_frame_timeout[2];
   uint8_t sys_ctrl_reg[4];
   uint8_t sys_event_mask[4];
@@ -203,12 +203,47 @@ DW_nodelist dw_list = {
   .list[0 ... NODELIST_LEN -1].frame_len = 0,
   .list[0 ... NODELIST_LEN -1].frame_in = {0},
   .list[0 ... NODELIST_LEN -1].frame_out = {0},
+  .list[0 ... NODELIST_LEN -1].filter.state = DW_RANGE_FILTER_EMPTY,
   .frame_in = {0},
   .frame_out = {0},
   .frame_out_len = 3,
-  .node_index = 0
+  .node_index = 0,
+  .nearest_pos = {[0 ... NODELIST_LEN -1] = DW_NEAREST_NONE},
+  .nearest_len = 0
 };
 
+//Duty cycle state. sleep_count = 0 sleeps until an SPI/pin wake, set it
+//(and lp_clk_div) to have the AON counter wake the part for the next slot.
+//wake_latency_us (and wake_polls) are filled in by dw_Wakeup for the 
+//scheduler to plan with.
+
+DW_power dw_power = {
+  .mode_level = DW_MODE_LEVEL_TWR,
+  .aon_state = DW_AON_NONE,
+  .lde_loaded = false,
+  .asleep = false,
+  .sleep_count = 0,
+  .lp_clk_div = 0,
+  .aon_wcfg = 0,
+  .aon_cfg0 = 0,
+  .wake_latency_us = 0,
+  .wake_latency_max_us = 0,
+  .wake_polls = 0
+};
+
+
+/*
+ * How the radio wants the bus when it shares one (mpi_bus.c). Mode 0 is 
+ * the DW1000's default with GPIO5/6 low at reset, 3MHz is its limit until
+ * the PLL is up. Give it a cs_port/cs_pin to put a second device on the 
+ * same usart.
+ */
+MPI_bus_conf dw_bus = {
+  .mode = 0,
+  .clock_hz = 3000000,
+  .cs_port = MPI_BUS_NO_CS,
+  .cs_pin = 0
+};
 
 MPI_ext_dev dw1000 = {
 
@@ -219,19 +254,21 @@ MPI_ext_dev dw1000 = {
     ._dev_data = &dw_Data,
     ._dev_config_reg = &dw_ConfigReg,
     ._dev_query_reg = &dw_QueryReg,
-    //._dev_wakeup = &dw_Wakeup,
-    //._dev_sleep = &dw_Sleep,
-    //._dev_mode_level = &dw_ModeLevel,
-    //._dev_reset = &dw_Reset,
-    //._dev_off = &dw_Off
+    ._dev_wakeup = &dw_Wakeup,
+    ._dev_sleep = &dw_Sleep,
+    ._dev_mode_level = &dw_ModeLevel,
+    ._dev_reset = &dw_Reset,
+    ._dev_off = &dw_Off
 
   },
+  ._bus_conf = &dw_bus,
   .MPI_data = {
     &dw_list,
     NULL
   },
   .MPI_conf = {
     &dw_devconf,
+    &dw_power,
     NULL
   }
   
@@ -12,6 +12,8 @@ extern DW_data dw_data;
 //extern DW_network_dev dw_dev;  
 
 extern DW_nodelist dw_list; 
+extern DW_power dw_power;
+extern MPI_bus_conf dw_bus;
 extern MPI_ext_dev dw1000;
 
 #endif 
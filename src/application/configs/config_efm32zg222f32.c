@@ -66,13 +66,18 @@ typedef struct {
 
 // set the frequency of the hfrco and the tuning value as well
 
+// HFCLK runs off the 24MHz HFXO, the timer, usart clkdivs and the 1PPS 
+// time service below all assume a crystal. The HFRCO stays on (EM2 wakes
+// on it) but its band tolerance is a couple of percent, far outside what 
+// mpi_time will track (MPI_TIME_FREQ_MAX_PPB).
+
 CMU_periphconf cmu_periphconf = {
 
  .ctrl = (CMU_CTRL_HFXOTIMEOUT_1KCYCLES | CMU_CTRL_HFXOGLITCHDETEN),
  .hfperclkdiv = CMU_HFPERCLKDIV_HFPERCLKEN, //| CMU_HFPERCLKDIV_HFPERCLKDIV_HFCLK2, 
  .hfrcoctrl = _CMU_HFRCOCTRL_SUDELAY_DEFAULT | CMU_HFRCOCTRL_BAND_14MHZ,
- .oscencmd = CMU_OSCENCMD_HFRCOEN,
- .cmd = CMU_CMD_HFCLKSEL_HFRCO,
+ .oscencmd = CMU_OSCENCMD_HFRCOEN | CMU_OSCENCMD_HFXOEN,
+ .cmd = CMU_CMD_HFCLKSEL_HFXO,
  .hfperclken0 = (CMU_HFPERCLKEN0_USART1 | CMU_HFPERCLKEN0_TIMER0 | CMU_HFPERCLKEN0_GPIO),
  //.intfclear = ???;
  //.inten = ???;
@@ -129,9 +134,11 @@ typedef struct {
 
 TIMER_periphconf timer0_periphconf = {
  .ctrl = TIMER_CTRL_DEBUGRUN,
- .ien = TIMER_IEN_OF, //enable overflow interrupt
+ .ien = TIMER_IEN_OF | TIMER_IEN_CC0, //enable overflow and 1PPS capture interrupts
  .top = TIMER_1MS_24MHZ_DIV0_HFXO,
- .topb = TIMER_1MS_24MHZ_DIV0_HFXO
+ .topb = TIMER_1MS_24MHZ_DIV0_HFXO,
+ .route = TIMER_ROUTE_CC0PEN | TIMER_ROUTE_LOCATION_LOC0, //TIM0_CC0 on PA0, venus 1PPS
+ .cc0_ctrl = TIMER_CC_CTRL_MODE_INPUTCAPTURE | TIMER_CC_CTRL_ICEDGE_RISING
 };
 
 
@@ -226,9 +233,15 @@ USART_status usart_status;
 
 
 /************************** SYNCHRONOUS SPI SETTINGS **************************/
+//AUTOCS drives US1_CS (CSPEN) for a whole usart_Transfer(). For PRS 
+//triggered transactions set .trigctrl = (USART_TRIGCTRL_TSEL_PRSCHx | 
+//USART_TRIGCTRL_TXTEN) and route the trigger to PRS channel x. TXBIL 
+//half full lets usart_Transfer() keep both TX buffer frames filled
+//
 USART_periphconf usart_sync = {
-  .ctrl = (USART_CTRL_OVS_X16 | USART_CTRL_TXBIL_EMPTY | USART_CTRL_SYNC | USART_CTRL_MSBF | USART_CTRL_CLKPHA | USART_CTRL_AUTOCS),
+  .ctrl = (USART_CTRL_OVS_X16 | USART_CTRL_TXBIL_HALFFULL | USART_CTRL_SYNC | USART_CTRL_MSBF | USART_CTRL_CLKPHA | USART_CTRL_AUTOCS),
   .frame = (USART_FRAME_DATABITS_EIGHT),
+  .trigctrl = 0,
   .cmd = (USART_CMD_TXEN | USART_CMD_RXEN | USART_CMD_MASTEREN),
   .clkdiv = CLKDIV_24MHZ_HFXO_16OVS_DIV0_SYNC_1_MBS,
   .route = (USART_ROUTE_LOCATION_LOC3 | USART_ROUTE_TXPEN | USART_ROUTE_RXPEN | USART_ROUTE_CSPEN | USART_ROUTE_CLKPEN),
@@ -345,7 +358,7 @@ GPIO_periphconf gpio_periphconf = {
   .P = {
     [PORTA] = {
       .ctrl = 0,
-      .pinmodeL = 0,
+      .pinmodeL = GPIO_P_MODEL_MODE0_INPUTPULLFILTER, //PA0 TIM0_CC0, venus 1PPS, glitch filtered (DOUT 0, pull down)
       .pinmodeH = 0,
       .pinlockn = 0
     },
@@ -392,6 +405,18 @@ GPIO_periphconf gpio_periphconf = {
 
 MPI_host efm32zg222f32_host = { 
   
+  ._core_mcuconf = {
+
+    ._irq_lock = &core_IrqLock,
+    ._irq_unlock = &core_IrqUnlock,
+    ._irq_attach = &irq_Attach
+
+  },
+  ._core_periphconf = {
+
+    ._mcs_data = &msc_Data
+
+  },
   ._periph_periphconf = {
 
     ._cmu_init = &cmu_Init,
@@ -411,8 +436,18 @@ MPI_host efm32zg222f32_host = {
 
     ._usart_data = &usart_Data,
     ._gpio_data = &gpio_Data,
-
-    ._timer_delay = &timer_Delay
+    ._emu_data = &emu_Data,
+
+    ._timer_delay = &timer_Delay,
+    ._timer_ticks = &timer_Ticks,
+    ._timer_now = &timer_Now,
+    ._timer_capture = &timer_Capture,
+    ._timer_stamp = &timer_Stamp,
+    ._usart_baud = &usart_Baud,
+    ._usart_data_async = &usart_DataAsync,
+    ._usart_select = &usart_Select,
+    ._usart_cs = &usart_Cs,
+    ._usart_transfer = &usart_Transfer
 
   },
   .MPI_data = {
@@ -0,0 +1,45 @@
+#ifdef SPIDEV
+
+#include <stddef.h>
+#include <linux/spi/spidev.h>
+
+#include "mpi_port.h"
+#include "mpi_types.h"
+
+#include "spidev_adaptor.h"
+#include "config_spidev.h"
+
+/*
+ * DW1000 on the pi's SPI0 CE0. Mode 0 is the DW1000 default (GPIO5/6 low
+ * at reset). It only takes up to 3MHz until its PLL is locked, so start
+ * there and raise speed_hz once dw_Init() has the clocks up.
+ */
+
+SPIDEV_STATUS spidev_status;
+
+SPIDEV_CONF spidev_conf = {
+    .device = {"/dev/spidev0.0"},
+    .mode = SPI_MODE_0,
+    .bits_per_word = 8,
+    .speed_hz = 3000000,
+    .delay_usecs = 0
+};
+
+MPI_host spidev_host = {
+    
+    .model = {"spidev"},
+    .revision = {"1.0"},
+    ._periph_periphconf = {
+        ._usart_init = &spidev_Init,
+        ._usart_query_reg = &spidev_RegDump,
+        ._usart_data = &spidev_Data,
+        ._usart_transfer = &spidev_Transfer,
+        ._usart_data_async = &spidev_DataAsync,
+        ._usart_select = &spidev_Select,
+        ._timer_stamp = &spidev_Stamp
+    },
+    .MPI_status[SPIDEV_STATUS_INDEX] = &spidev_status,
+    .MPI_conf[SPIDEV_CONFIG_INDEX] = &spidev_conf
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef CONFIG_SPIDEV_H_
+#define CONFIG_SPIDEV_H_
+
+#include <stddef.h>
+
+#include "mpi_port.h"
+#include "spidev_adaptor.h"
+
+extern SPIDEV_STATUS spidev_status;
+extern SPIDEV_CONF spidev_conf;
+extern MPI_host spidev_host;
+
+
+#endif
@@ -4,6 +4,9 @@
 #include "mpi_types.h"
 
 #include "spidriver_adaptor.h"
+#ifdef SPIDRIVER
+#include "spidriver_async.h"
+#endif
 #include "config_spidriver.h"
 #include "spidriver.h"
 
@@ -38,6 +41,11 @@ SD_DATA sd_data = {
     .rxtx = {'0'},
 };
 
+#ifdef SPIDRIVER
+//I/O thread and request queue, idle until sd_AsyncInit()
+SD_ASYNC sd_async;
+#endif
+
 /*
 MPI_ext_dev sd_intf = {
     
@@ -72,12 +80,19 @@ MPI_host sd_host = {
     
     .model = {"spidriver"},
     .revision = {1.0},
+    ._core_periphconf = {
+        ._mcs_data = &sd_Nvm
+    },
     ._periph_periphconf = {
         ._usart_init = &sd_Init,
         ._usart_query_reg = &sd_RegDump,
-        ._usart_data = &sd_Data
+        ._usart_data = &sd_Data,
+        ._timer_stamp = &sd_Stamp
     },
     .MPI_status[0] = &sd_status,
     .MPI_conf[0] = &sd_conf,
-    .MPI_data[0] = &sd_data
+    .MPI_data[SD_DATA_INDEX] = &sd_data,
+#ifdef SPIDRIVER
+    .MPI_data[SD_ASYNC_INDEX] = &sd_async
+#endif
 };
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #include "mpi_port.h"
 #include "mpi_types.h"
+#include "mpi_time.h"
 
 #include "config_venus638.h"
 
@@ -31,6 +32,10 @@ register_enum venus_config_query;
 VENUS_message_io venus_message; 
 VENUS_response_store venus_response;
 VENUS_nmea_store venus_nmea;
+VENUS_pipeline venus_pipeline;
+
+//disciplined off the venus 1PPS, see venus638_TimeSync()
+MPI_time venus_time_sync;
 
 /*
   uint8_t sys_reset_start_mode;
@@ -88,7 +93,34 @@ VENUS_nmea_store venus_nmea;
 */
 
 VENUS_op_mode venus_op_mode = nmea;
-VENUS_config venus_config;
+VENUS_config venus_config = {
+  .query_software_version_type = QUERY_SOFTWARE_VERSION,
+  .config_serial_port_port = CONFIG_SERIAL_PORT_COM_1,
+  .config_serial_port_baud = CONFIG_SERIAL_PORT_BR_115200,   //venus638_Baud() escalates to this at init
+  .config_serial_port_attr = CONFIG_SERIAL_PORT_UPDATE_SRAM,
+
+  //venus638_Init() sequence
+  //
+  .config_nmea_gga = CONFIG_NMEA_GGA_INTERVAL(1),
+  .config_nmea_gsa = CONFIG_NMEA_GSA_INTERVAL(1),
+  .config_nmea_gsv = CONFIG_NMEA_GSV_INTERVAL(1),
+  .config_nmea_gll = CONFIG_NMEA_GLL_INTERVAL(1),
+  .config_nmea_rmc = CONFIG_NMEA_RMC_INTERVAL(1),
+  .config_nmea_vtg = CONFIG_NMEA_VTG_INTERVAL(1),
+  .config_nmea_zda = CONFIG_NMEA_ZDA_INTERVAL(0),
+  .config_nmea_attr = CONFIG_NMEA_UPDATE_SRAM,
+  .config_message_type = CONFIG_MESSAGE_TYPE_NMEA,
+  .config_sys_power_mode = CONFIG_SYS_POWER_MODE_NORMAL,
+  .config_sys_power_attr = CONFIG_SYS_POWER_MODE_UPDATE_SRAM,
+  .config_sys_pos_rate = CONFIG_SYSTEM_POS_RATE_1HZ,
+  .config_sys_pos_attr = CONFIG_SYSTEM_POS_UPDATE_SRAM,
+  .config_waas_enable = CONFIG_WAAS_EN_ENABLE,
+  .config_pos_pin_enable = CONFIG_POSITION_PIN_DISABLE,
+  .config_nav_mode = CONFIG_NAV_MODE_CAR,
+  .config_nav_attr = CONFIG_NAV_MODE_UPDATE_SRAM,
+  .config_1pps_mode = CONFIG_1PPS_MODE_ON_3SV,
+  .config_1pps_attr = CONFIG_1PPS_MODE_UPDATE_SRAM
+};
 
 MPI_ext_dev venus638 = {
 
@@ -110,6 +142,7 @@ MPI_ext_dev venus638 = {
     &venus_message, 
     &venus_response, 
     &venus_nmea, 
+    &venus_pipeline,
     NULL
   },
   .MPI_conf = {
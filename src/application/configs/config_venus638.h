@@ -1,17 +1,21 @@
 #ifndef CONFIG_VENUS638_H_
 #define CONFIG_VENUS638_H_
 
+#include "mpi_time.h"
 #include "venus638.h"
 
 extern VENUS_message_io venus_message; 
 extern VENUS_response_store venus_response;
 extern VENUS_nmea_store venus_nmea;
+extern VENUS_pipeline venus_pipeline;
+extern MPI_time venus_time_sync;
 extern VENUS_config venus_config;
 extern MPI_ext_dev venus638;
 
 #define VENUS_MSG_INDEX   0
 #define VENUS_RESP_INDEX  1
 #define VENUS_NMEA_INDEX  2
+#define VENUS_PIPELINE_INDEX  3
 
 
 #endif
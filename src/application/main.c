@@ -37,6 +37,11 @@
 #include "mpi_timer.h"
 #include "mpi_port.h"
 #include "mpi_ext_dev.h"
+#include "mpi_sched.h"
+#include "mpi_rtos.h"
+#include "mpi_request.h"
+#include "mpi_bus.h"
+#include "mpi_trace.h"
 
 #include "_app_config.h"
 
@@ -85,6 +90,191 @@ int test_fn(void* host_object,  uint32_t read_write, int(* host_usart_fn)(), voi
 */
   
 
+//There is no superloop. Interrupt handlers, timers and the devices' own
+//callbacks post events and mpi_schedRun() runs them to completion, one at
+//a time, highest priority first, sleeping the core in between (EM2 when 
+//nothing needs the HF clocks). See mpi_sched.c.
+//
+//The demos that used to sit in the while loop are event handlers now.
+//Uncomment the ones that go with your config, as before, along with the 
+//lines that start them at the bottom of main().
+//
+
+#ifdef EFM32ZG222F32
+#define APP_HOST efm32zg222f32_host
+#elif defined(SPIDRIVER)
+#define APP_HOST sd_host
+#elif defined(SPIDEV)
+#define APP_HOST spidev_host
+#endif
+
+MPI_sched app_sched;
+
+//Uncomment the following for 3 LED blink, the next LED every second
+/*
+MPI_sched_timer app_led_timer;
+
+int app_ledBlink(void* context, uint32_t fired){
+
+  static const uint32_t led[3][2] = {{2, 10}, {2, 11}, {5, 4}};
+  const uint32_t* next = led[fired % 3];
+
+  return mpi_gpioData(&efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._gpio_data, TGL, next[0], next[1]);
+}
+*/
+
+//Uncomment the following for the usart/SPI read/write demo, every 100ms
+/*
+MPI_sched_timer app_usart_timer;
+
+int app_usartDemo(void* context, uint32_t fired){
+
+  volatile const int(* efm32zg_usart_data)() = efm32zg222f32_host._periph_periphconf._usart_data;
+
+  mpi_usartData(&efm32zg222f32_host, efm32zg_usart_data, &array, test_fn, READ);
+  return mpi_usartData(&efm32zg222f32_host, efm32zg_usart_data, &array, test_fn, WRITE);
+}
+*/
+
+//Uncomment the following to hear about usart writes finishing. Hold the 
+//scheduler (mpi_schedHold()) before the write, idle stays in EM1 until the
+//last frame has shifted out, EM2 would stop the usart clock under it
+/*
+int app_usartDone(void* context, uint32_t flags){
+
+  //next write, next state, ...
+  return 0;
+}
+
+//interrupt context, post and get out
+int app_usartTxc(void* context, uint32_t flags){
+
+  mpi_schedRelease(&app_sched);
+  return mpi_schedPost(&app_sched, mpi_sched_high, app_usartDone, context, flags);
+}
+*/
+
+//Uncomment the following for the dw1000 demo on efm32zg222f32 host. The
+//radio's IRQ line goes to a gpio pin set up for a rising edge interrupt 
+//(gpio_periphconf extipselect/extirise/ien), each edge reads the radio
+/*
+int app_dw1000Rx(void* context, uint32_t pins){
+
+  return mpi_extdevData(&efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._usart_data, &dw1000, dw1000._interface._dev_data, READ);
+}
+
+//interrupt context, post and get out
+int app_dw1000Irq(void* context, uint32_t pins){
+
+  return mpi_schedPost(&app_sched, mpi_sched_high, app_dw1000Rx, context, pins);
+}
+*/
+
+//Uncomment the following for the venus gps demo. A timer drains the usart
+//into the parser, and each subscribed sentence comes back through 
+//app_venusSentence() as it's decoded, which posts the fix on. The same 
+//read disciplines host time off the venus 1PPS
+/*
+MPI_sched_timer app_venus_timer;
+
+int app_venusFix(void* context, uint32_t index){
+
+  VENUS_fix* fix = (VENUS_fix*)context;
+
+  //latest fix, index says which sentence filled it in
+  return 0;
+}
+
+//decoder context, runs inside app_venusRead()
+int app_venusSentence(void* context, VENUS_fix* fix, uint32_t index){
+
+  return mpi_schedPost(&app_sched, mpi_sched_normal, app_venusFix, fix, index);
+}
+
+int app_venusRead(void* context, uint32_t fired){
+
+  mpi_extdevData(&efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._usart_data, &venus638, venus638._interface._dev_data, READ);
+  return venus638_TimeSync(&efm32zg222f32_host, &venus638, &venus_time_sync);
+}
+*/
+
+//Uncomment the following for the spidriver demo, back to back writes at 
+//low priority so anything else posted still gets in
+/*
+int app_spidriverWrite(void* context, uint32_t count){
+
+  mpi_usartData(&sd_host, sd_Data, &dw1000, dw_Data, WRITE);
+  return mpi_schedPost(&app_sched, mpi_sched_low, app_spidriverWrite, context, count +1);
+}
+*/
+
+//Uncomment the following for the async demo on efm32zg222f32 host. A venus 
+//read and a dw1000 read are both in hand at once, neither call waits; they 
+//run off app_sched and finish through app_asyncDone(). The raw 5 byte 
+//DEV_ID read goes straight to the usart and completes from its interrupts
+/*
+MPI_request app_venus_request;
+MPI_request app_dw1000_request;
+MPI_request app_dev_id_request;
+uint8_t app_dev_id[5];
+
+int app_asyncDone(void* context, MPI_request* request){
+
+  //context is the device, request->result what its fn returned
+  return 0;
+}
+*/
+
+//Uncomment the following for two dw1000s on the one efm32zg222f32 usart.
+//Give each its own MPI_ext_dev with a _bus_conf naming its CS pin (see 
+//dw_bus in config_dw1000.c); mpi_bus only rewrites the usart's mode and 
+//clock when the next transaction is for the other radio
+/*
+MPI_bus app_bus;
+MPI_request app_bus_request;
+
+int app_busRead(void* context, uint32_t fired){
+
+  mpi_busData(&app_bus, &dw1000, dw1000._interface._dev_data, READ);
+  return mpi_busDataAsync(&app_bus, &dw1000_b, dw1000_b._interface._dev_data, READ, &app_bus_request);
+}
+*/
+
+//Uncomment the following to drain the trace ring (build with -DMPI_TRACE)
+//once a second at low priority, out the efm32zg222f32 usart in async (UART)
+//mode. tools/trace decodes what comes out; on Linux drain to a file with
+//sd_TraceWrite()/spidev_TraceWrite() instead
+/*
+MPI_sched_timer app_trace_timer;
+
+int app_traceDrain(void* context, uint32_t fired){
+
+  return mpi_traceDrain(mpi_traceUsartWrite, context);
+}
+*/
+
+//With -DFREERTOS the devices get a driver task each instead (mpi_rtos.c).
+//Uncomment the following for the dw1000 on the efm32zg222f32 host, its IRQ 
+//line deferred to the driver task, which reads the frame
+/*
+MPI_rtos_dev app_dw1000_task;
+
+int app_dw1000IrqTask(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t pins){
+
+  return dw1000._interface._dev_data(host_object, host_usart, ext_dev_object, READ);
+}
+*/
+
+//Uncomment the following for test output on Linux
+/*
+int app_linuxTick(void* context, uint32_t count){
+
+  printf("The programm is running. This message will output every second\n");
+  sleep(1);
+  return mpi_schedPost(&app_sched, mpi_sched_low, app_linuxTick, context, count +1);
+}
+*/
+
 
 int main(void)
 {
@@ -203,68 +393,75 @@ int main(void)
   mpi_timerDelay(efm32zg_timer_delay, 10);
  */ 
 
-  /* Infinite loop */
-  while (1){
-
-    //Uncomment the following for 3 LED blink with 1s delay
-   
-    /* 
-    mpi_timerDelay(&efm32zg222f32_host, efm32zg_timer_delay, 1000);
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 2, 10);
-    mpi_timerDelay(&efm32zg222f32_host, efm32zg_timer_delay, 1000);
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 2, 11);
-    mpi_timerDelay(&efm32zg222f32_host, efm32zg_timer_delay, 1000);
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 5, 4);
-    */
- 
-    //Uncomment the following for usart read/write demo with blinking LED
-    /*
-    mpi_usartData(&efm32zg222f32_host, efm32zg_usart_data, &array, test_fn, READ);
-    mpi_usartData(&efm32zg222f32_host, efm32zg_usart_data, &array, test_fn, WRITE);
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL);
-    */
-
-    //Uncomment the following for venus gps demo with blinky LED
-    /* 
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 2, 10);
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 2, 11);
-    mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 5, 4);
-    
-    mpi_extdevData(&efm32zg222f32_host, efm32zg_usart_data, &venus638, venus638_data, READ);
-    mpi_usartData(&efm32zg222f32_host, efm32zg_usart_data, &venus638_message->message_in, test_fn, WRITE);
-    */
-    
-    //Uncomment the following for the SPI demo with blinking LEDs
-    /* 
-    mpi_usartData(&efm32zg222f32_host, efm32zg_usart_data, &array, test_fn, WRITE);
-    */
-   /* 
-    for(int i = 0; i < 3; i++){
-      mpi_timerDelay(&efm32zg222f32_host, efm32zg_timer_delay, 100);
-      mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 2, 10);
-      mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 2, 11);
-      mpi_gpioData(&efm32zg222f32_host, efm32zg_gpio_data, TGL, 5, 4);
-    }
-   */
-
-    //Uncomment the following for test output on Linux
-    /*
-    printf("The programm is running. This message will output every second\n");
-    sleep(1);
-
-    //Uncomment the following for spidriver demo
-    /*
-    mpi_usartData(&sd_host, sd_Data, &dw1000, dw_Data, WRITE);
-    */
-    
+#ifdef FREERTOS
+  /* Driver tasks */
+
+  //Uncomment for dw1000 demo on efm32zg222f32 host
+  /*
+  mpi_rtosDevStart(&app_dw1000_task, &efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._usart_data, &dw1000, NULL, "dw1000", 2);
+  mpi_rtosIrqAttach(&app_dw1000_task, MPI_IRQ_GPIO, app_dw1000IrqTask);
+  */
+
+  vTaskStartScheduler();
+#endif
 
-    //Uncomment for dw1000 demo on efm32zg222f32 host
-     
-   /*
-    mpi_extdevData(&efm32zg222f32_host, efm32zg_usart_data, &dw1000, dw1000_data, WRITE);
-    mpi_timerDelay(efm32zg_timer_delay, 1);
-   */
+  /* Event loop */
+  mpi_schedInit(&APP_HOST, &app_sched);
 
-   }
-}
+  //Uncomment the following for 3 LED blink with 1s delay
+  /*
+  mpi_schedTimerStart(&app_sched, &app_led_timer, mpi_sched_low, 1000, 1000, app_ledBlink, NULL);
+  */
+
+  //Uncomment the following for usart read/write demo
+  /*
+  mpi_schedTimerStart(&app_sched, &app_usart_timer, mpi_sched_normal, 100, 100, app_usartDemo, NULL);
+  */
+
+  //Uncomment the following for usart completion events
+  /*
+  mpi_schedIrqAttach(&app_sched, MPI_IRQ_USART_TX, app_usartTxc, NULL);
+  */
 
+  //Uncomment for dw1000 demo on efm32zg222f32 host
+  /*
+  mpi_schedIrqAttach(&app_sched, MPI_IRQ_GPIO, app_dw1000Irq, NULL);
+  */
+
+  //Uncomment the following for venus gps demo, GGA and RMC every second
+  //(mpi_timeInit(&venus_time_sync) first)
+  /*
+  venus_nmeaSubscribe(&venus_nmea, GGA_INDEX, 1, app_venusSentence, NULL);
+  venus_nmeaSubscribe(&venus_nmea, RMC_INDEX, 1, app_venusSentence, NULL);
+  mpi_schedTimerStart(&app_sched, &app_venus_timer, mpi_sched_normal, 0, 100, app_venusRead, NULL);
+  */
+
+  //Uncomment the following for the async demo (DW1000 CS held low around
+  //the raw read)
+  /*
+  mpi_requestInit(&app_venus_request, &app_sched, app_asyncDone, &venus638);
+  mpi_requestInit(&app_dw1000_request, &app_sched, app_asyncDone, &dw1000);
+  mpi_requestInit(&app_dev_id_request, NULL, app_asyncDone, &dw1000);
+  mpi_extdevDataAsync(&efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._usart_data, &venus638, venus638._interface._dev_data, READ, &app_venus_request);
+  mpi_extdevDataAsync(&efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._usart_data, &dw1000, dw1000._interface._dev_data, READ, &app_dw1000_request);
+  mpi_usartTransferAsync(&efm32zg222f32_host, efm32zg222f32_host._periph_periphconf._usart_data_async, USART_READ_WRITE, app_dev_id, 5, &app_dev_id_request);
+  */
+
+  //Uncomment the following for spidriver demo
+  /*
+  mpi_schedPost(&app_sched, mpi_sched_low, app_spidriverWrite, NULL, 0);
+  */
+
+  //Uncomment the following for the trace drain
+  /*
+  mpi_traceInit(&efm32zg222f32_host);
+  mpi_schedTimerStart(&app_sched, &app_trace_timer, mpi_sched_low, 1000, 1000, app_traceDrain, &efm32zg222f32_host);
+  */
+
+  //Uncomment the following for test output on Linux
+  /*
+  mpi_schedPost(&app_sched, mpi_sched_low, app_linuxTick, NULL, 0);
+  */
+
+  mpi_schedRun(&app_sched);
+}
@@ -0,0 +1,213 @@
+/* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpi_bus.h"
+#include "mpi_request.h"
+#include "mpi_sched.h"
+#include "mpi_trace.h"
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Shared bus
+ *
+ * Two DW1000s, or a DW1000 and a flash chip, on the one usart. Each
+ * device's _bus_conf says how it wants the bus (SPI mode, clock, CS pin)
+ * and every transaction goes through here, which hands the settings to
+ * the host's _usart_select only when the device changes; back to back
+ * transactions on the same device cost nothing extra. The device fns
+ * then drive CS per transaction through the host's _usart_cs, so a
+ * driver that reads several registers still gets a CS window for each.
+ *
+ * mpi_busData() runs a transaction there and then. Handlers run to
+ * completion, so nothing else can be half way through the bus when it's
+ * called. mpi_busDataAsync() queues it, oldest first, and the bus runs
+ * the queue off the scheduler one transaction per event, so an interrupt
+ * can ask for a read without caring who has the bus.
+ *
+ * Under FreeRTOS MPI_rtos_dev.bus serialises the driver tasks instead.
+ *
+ * The bus remembers which device the usart is set up for. Once a usart
+ * is shared, every access to it has to come through here: anything that
+ * reconfigures it behind the bus's back (usart_Baud, a _usart_config_reg,
+ * mpi_extdevData() straight to a device) leaves that stale, and the next
+ * transaction for the remembered device would run on someone else's
+ * settings. Where that can't be avoided, call mpi_busInvalidate() after
+ * and the next transaction reselects.
+ */
+
+uint32_t mpi_busLock(MPI_bus* bus);
+void mpi_busUnlock(MPI_bus* bus, uint32_t mask);
+int mpi_busRun(MPI_bus* bus, uint32_t arg);
+
+uint32_t mpi_busLock(MPI_bus* bus){
+
+  MPI_host* host_ptr = (MPI_host*)bus->host;
+  int_callback host_irq_lock = host_ptr->_core_mcuconf._irq_lock;
+
+  return (host_irq_lock != NULL ? (uint32_t)host_irq_lock() : 0);
+}
+
+void mpi_busUnlock(MPI_bus* bus, uint32_t mask){
+
+  MPI_host* host_ptr = (MPI_host*)bus->host;
+  int_callback host_irq_unlock = host_ptr->_core_mcuconf._irq_unlock;
+
+  if(host_irq_unlock != NULL){
+    host_irq_unlock(mask);
+  }
+}
+
+int mpi_busInit(MPI_bus* bus, void* host_object, int(*host_comm_interface_fn)(), MPI_sched* sched){
+
+  bus->host = host_object;
+  bus->host_fn = host_comm_interface_fn;
+  bus->sched = sched;
+  bus->current = NULL;
+  bus->head = NULL;
+  bus->tail = NULL;
+  bus->posted = 0;
+  bus->transactions = 0;
+  bus->reconfigs = 0;
+  return 0;
+}
+
+//the usart was reconfigured outside the bus, reselect on the next transaction
+int mpi_busInvalidate(MPI_bus* bus){
+
+  bus->current = NULL;
+  return 0;
+}
+
+/*
+ * A host without _usart_select takes every device on the bus as it is.
+ * A host with one won't take a device without _bus_conf, it would run on
+ * whatever mode, clock and CS the last device left behind.
+ */
+int mpi_busSelect(MPI_bus* bus, void* ext_dev_object){
+
+  MPI_ext_dev* ext_dev_ptr = (MPI_ext_dev*)ext_dev_object;
+  MPI_host* host_ptr = (MPI_host*)bus->host;
+  int_callback host_select = host_ptr->_periph_periphconf._usart_select;
+  MPI_bus_conf* conf = ext_dev_ptr->_bus_conf;
+
+  if(bus->current == ext_dev_object){
+    return 0;
+  }
+
+  if(host_select == NULL){
+    bus->current = ext_dev_object;
+    return 0;
+  }
+  if(conf == NULL){
+    return -1;
+  }
+  bus->current = ext_dev_object;
+
+  bus->reconfigs++;
+  if(MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_SELECT, 0,
+                    host_select(bus->host, conf->mode, conf->clock_hz, conf->cs_port, conf->cs_pin)) != 0){
+    bus->current = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+int mpi_busData(MPI_bus* bus, void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write){
+
+  if(mpi_busSelect(bus, ext_dev_object) != 0){
+    return -1;
+  }
+  bus->transactions++;
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_DATA, 0,
+                        ext_dev_interface_fn(bus->host, bus->host_fn, ext_dev_object, read_write));
+}
+
+//mpi_schedRun() event, the oldest transaction. posted stays up until the queue is seen empty
+int mpi_busRun(MPI_bus* bus, uint32_t arg){
+
+  uint32_t mask = mpi_busLock(bus);
+  MPI_request* request = bus->head;
+
+  bus->head = request->next;
+  if(bus->head == NULL){
+    bus->tail = NULL;
+  }
+  mpi_busUnlock(bus, mask);
+
+  mpi_requestComplete(request, mpi_busData(bus, request->ext_dev, request->ext_dev_fn, request->read_write));
+
+  mask = mpi_busLock(bus);
+  if(bus->head == NULL || mpi_schedPost(bus->sched, bus->head->priority, mpi_busRun, bus, 0) != 0){
+    bus->posted = 0;
+  }
+  mpi_busUnlock(bus, mask);
+  return 0;
+}
+
+/*
+ * Interrupt safe. The request's own sched is not used, the bus's runs it.
+ * -1 if the scheduler is full, the request is completed with it.
+ */
+int mpi_busDataAsync(MPI_bus* bus, void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, MPI_request* request){
+
+  request->call = MPI_REQ_CALL_EXT_DEV;
+  request->host = bus->host;
+  request->host_fn = bus->host_fn;
+  request->ext_dev = ext_dev_object;
+  request->ext_dev_fn = ext_dev_interface_fn;
+  request->read_write = read_write;
+  request->register_enum = NULL;
+  request->next = NULL;
+  request->status = MPI_REQ_PENDING;
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_ASYNC, 0, 0);
+
+  uint32_t mask = mpi_busLock(bus);
+  MPI_request* prev = bus->tail;
+
+  if(prev != NULL){
+    prev->next = request;
+  } else {
+    bus->head = request;
+  }
+  bus->tail = request;
+
+  //anything left queued by an earlier full scheduler goes with this post
+  //
+  if(!bus->posted){
+    if(mpi_schedPost(bus->sched, request->priority, mpi_busRun, bus, 0) != 0){
+      bus->tail = prev;
+      if(prev != NULL){
+        prev->next = NULL;
+      } else {
+        bus->head = NULL;
+      }
+      mpi_busUnlock(bus, mask);
+      mpi_requestComplete(request, -1);
+      return -1;
+    }
+    bus->posted = 1;
+  }
+
+  mpi_busUnlock(bus, mask);
+  return 0;
+}
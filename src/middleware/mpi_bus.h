@@ -0,0 +1,35 @@
+#ifndef MPI_BUS_H_
+#define MPI_BUS_H_
+
+#include <stdint.h>
+
+#include "mpi_types.h"
+#include "mpi_port.h"
+#include "mpi_sched.h"
+#include "mpi_request.h"
+
+/*
+ * Several MPI_ext_devs on one host peripheral, see mpi_bus.c. Each device
+ * carries its own settings in _bus_conf (mode, clock, CS pin), and every
+ * access to a shared usart goes through the bus.
+ */
+
+typedef struct {
+  void* host;
+  int_callback host_fn;           //the host's _usart_data, handed to the device fns
+  MPI_sched* sched;               //runs queued transactions, one per event
+  void* current;                  //MPI_ext_dev the host is set up for
+  MPI_request* head;              //queued transactions, oldest first
+  MPI_request* tail;
+  uint32_t posted;
+  uint32_t transactions;
+  uint32_t reconfigs;
+}MPI_bus;
+
+int mpi_busInit(MPI_bus* bus, void* host_object, int(*host_comm_interface_fn)(), MPI_sched* sched);
+int mpi_busSelect(MPI_bus* bus, void* ext_dev_object);
+int mpi_busInvalidate(MPI_bus* bus);
+int mpi_busData(MPI_bus* bus, void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write);
+int mpi_busDataAsync(MPI_bus* bus, void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, MPI_request* request);
+
+#endif
@@ -17,29 +17,113 @@
  */
 
 
+#include <stddef.h>
+
 #include "mpi_ext_dev.h"
+#include "mpi_request.h"
+#include "mpi_trace.h"
 
 /*
- * As you can see not all the fns are complete (missing mpi_extdevOff, mpi_extdevReset etc)
- *
  * Although initially most of the fns appear identical, I wanted to have separate middleware fns to account for future feature additions, flexibility, readability at the application level and most importantly: any potential issues with thread safety and reentrance. 
  */
 
 int mpi_extdevInit(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)()){
-  return ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object);
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_INIT, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object));
 }
 
 int mpi_extdevConfigReg(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum){
-  return ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object, register_enum);
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_CONFIG_REG, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object, register_enum));
 }
 
 int mpi_extdevQueryReg(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum){
-	return ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object, register_enum);
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_QUERY_REG, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object, register_enum));
 }
 
 int mpi_extdevData(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write){
-  return ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object, read_write);
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_DATA, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object, read_write));
+}
+
+int mpi_extdevSleep(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)()){
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_SLEEP, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object));
+}
+
+int mpi_extdevWakeup(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)()){
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_WAKEUP, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object));
+}
+
+int mpi_extdevOff(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)()){
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_OFF, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object));
+}
+
+int mpi_extdevReset(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)()){
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_RESET, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object));
+}
+
+int mpi_extdevModeLevel(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)()){
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_MODE_LEVEL, 0,
+                        ext_dev_interface_fn(host_object, host_comm_interface_fn, ext_dev_object));
+}
+
+/*
+ * Async variants. The fns without a register or read_write argument get a
+ * zero where the sync ones pass nothing, the HAL fns never look past
+ * ext_dev_object.
+ */
+
+int mpi_extdevDefer(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, void* register_enum, MPI_request* request);
+
+int mpi_extdevDefer(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, void* register_enum, MPI_request* request){
+
+  request->call = MPI_REQ_CALL_EXT_DEV;
+  request->host = host_object;
+  request->host_fn = host_comm_interface_fn;
+  request->ext_dev = ext_dev_object;
+  request->ext_dev_fn = ext_dev_interface_fn;
+  request->read_write = read_write;
+  request->register_enum = register_enum;
+  return mpi_requestDefer(request);
 }
 
+int mpi_extdevInitAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, NULL, request);
+}
 
+int mpi_extdevConfigRegAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum, MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, register_enum, request);
+}
 
+int mpi_extdevQueryRegAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum, MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, register_enum, request);
+}
+
+int mpi_extdevDataAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, read_write, NULL, request);
+}
+
+int mpi_extdevSleepAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, NULL, request);
+}
+
+int mpi_extdevWakeupAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, NULL, request);
+}
+
+int mpi_extdevOffAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, NULL, request);
+}
+
+int mpi_extdevResetAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, NULL, request);
+}
+
+int mpi_extdevModeLevelAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request){
+  return mpi_extdevDefer(host_object, host_comm_interface_fn, ext_dev_object, ext_dev_interface_fn, 0, NULL, request);
+}
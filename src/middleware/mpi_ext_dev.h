@@ -10,6 +10,8 @@
 
 #include <stdint.h>
 
+#include "mpi_request.h"
+
 int mpi_extdevInit(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)());
 
 int mpi_extdevConfigReg(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum);
@@ -18,5 +20,39 @@ int mpi_extdevQueryReg(void* host_object, int(*host_comm_interface_fn)(), void*
 
 int mpi_extdevData(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write);
 
+int mpi_extdevSleep(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)());
+
+int mpi_extdevWakeup(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)());
+
+int mpi_extdevOff(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)());
+
+int mpi_extdevReset(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)());
+
+int mpi_extdevModeLevel(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)());
+
+/*
+ * Async variants, same arguments plus a request set up with
+ * mpi_requestInit(). The fn runs later off the request's scheduler and the
+ * callback gets its return in request->result, see mpi_request.c
+ */
+
+int mpi_extdevInitAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request);
+
+int mpi_extdevConfigRegAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum, MPI_request* request);
+
+int mpi_extdevQueryRegAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), void* register_enum, MPI_request* request);
+
+int mpi_extdevDataAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, MPI_request* request);
+
+int mpi_extdevSleepAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request);
+
+int mpi_extdevWakeupAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request);
+
+int mpi_extdevOffAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request);
+
+int mpi_extdevResetAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request);
+
+int mpi_extdevModeLevelAsync(void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), MPI_request* request);
+
 
 #endif /* MPI_RADIO_H_ */
@@ -66,6 +66,13 @@
  *
  * @param _systick_handler - point to systick handler fn
  *
+ * @param _irq_lock - () mask interrupts, returns the mask it replaced
+ *
+ * @param _irq_unlock - (mask) put back what _irq_lock returned
+ *
+ * @param _irq_attach - (host, MPI_IRQ_*, isr_fn, context) run 
+ * isr_fn(context, flags) from that interrupt handler
+ *
  ******************************************************************/
 
 typedef struct MPI_CORE_MCU{
@@ -77,6 +84,9 @@ typedef struct MPI_CORE_MCU{
   int_callback _nvic_init;
   int_callback _systick_init;
   void_callback _systick_handler;
+  int_callback _irq_lock;
+  int_callback _irq_unlock;
+  int_callback _irq_attach;
 
 }MPI_core_mcuconf;
 
@@ -118,6 +128,27 @@ typedef struct MPI_INTERRUPT{
 
 }MPI_interrupt;
 
+//_irq_attach sources
+//
+#define MPI_IRQ_GPIO          0     //external pin interrupts, flags = pins
+#define MPI_IRQ_USART_TX      1     //transfer complete, last frame shifted out
+#define MPI_IRQ_TIMER         2     //timer capture/overflow, flags = IF
+#define MPI_IRQ_SOURCES       3
+
+//_usart_cs levels, and the per device bus settings _usart_select takes 
+//(see mpi_bus.c). mode is CPOL << 1 | CPHA, the dw_PolAlphaAssert[] order
+//
+#define MPI_CS_ASSERT         0
+#define MPI_CS_DEASSERT       1
+#define MPI_BUS_NO_CS         0xFFFFFFFF    //CS left to the host (AUTOCS, spidev) or tied
+
+typedef struct {
+  uint32_t mode;
+  uint32_t clock_hz;
+  uint32_t cs_port;
+  uint32_t cs_pin;
+}MPI_bus_conf;
+
 
 typedef struct MPI_CORE_PERIPH{
 
@@ -137,7 +168,7 @@ typedef struct MPI_CORE_PERIPH{
   int_callback _mcs_init;
   int_callback _dma_init;
   int_callback _dbg_init;
-  int_callback _mcs_data;
+  int_callback _mcs_data;      //(host, read_write, offset, buffer, len) on the host's nvm
   int_callback _dma_data;
   int_callback _dbg_data;
 
@@ -171,7 +202,7 @@ typedef struct MPI_PERIPH_PERIPHCONF{
   int_callback _gpio_init;
       
   int_callback _rmu_data;
-  int_callback _emu_data;
+  int_callback _emu_data;        //(host, mode) sleep in EMx until the next interrupt
   int_callback _cmu_data;
   int_callback _wdog_data;
   int_callback _prs_data;
@@ -224,6 +255,15 @@ typedef struct MPI_PERIPH_PERIPHCONF{
   int_callback _gpio_query_reg;
 
   int_callback _timer_delay;
+  int_callback _timer_ticks;
+  int_callback _timer_now;           //(host, uint64_t* ns) monotonic
+  int_callback _timer_capture;       //(host, uint64_t* ns) last input capture, returns capture count
+  int_callback _timer_stamp;         //(uint32_t* hz) free running count for mpi_trace, hz filled in when not NULL
+  int_callback _usart_baud;
+  int_callback _usart_transfer;      //(host, RW, header, header_len, payload, payload_len) one CS window
+  int_callback _usart_data_async;    //(host, MPI_request*) queue request->buffer, complete from the usart interrupts
+  int_callback _usart_select;        //(host, mode, clock_hz, cs_port, cs_pin) bus settings for the next device
+  int_callback _usart_cs;            //(host, MPI_CS_*) the selected device's CS, waits out TX on deassert
 
 }MPI_periph_periphconf;
 
@@ -317,6 +357,7 @@ typedef struct MPI_EXT_DEV{
   char model[16];
   char revision[8];
   MPI_ext_dev_interface _interface;
+  MPI_bus_conf* _bus_conf;      //NULL if the device has its peripheral to itself
   void* MPI_data[12];
   void* MPI_status[12];
   void* MPI_conf[12];
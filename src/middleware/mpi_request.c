@@ -0,0 +1,133 @@
+/* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpi_request.h"
+#include "mpi_sched.h"
+#include "mpi_trace.h"
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Requests
+ *
+ * Two kinds of work complete through a request:
+ *
+ *  - host transfers (mpi_usartTransferAsync()). The host queues the buffer
+ *    on its usart and returns; the usart interrupts move the data and call
+ *    mpi_requestComplete() when the last frame is in. Nothing waits.
+ *
+ *  - ext_dev and host calls (mpi_extdevDataAsync() and friends). The
+ *    device drivers are written as straight line code on the host's
+ *    synchronous usart fns, so these are deferred rather than split up:
+ *    the call is posted to the request's scheduler and runs from
+ *    mpi_schedRun() as an event of its own, the caller carrying on in the
+ *    meantime.
+ *
+ * So a GPS read and a DW1000 access can both be in hand at once on a
+ * bare metal host, each finishing through its callback, with no RTOS.
+ */
+
+int mpi_requestRun(MPI_request* request, uint32_t arg);
+void* mpi_requestObject(MPI_request* request);
+
+//who a request is traced against
+void* mpi_requestObject(MPI_request* request){
+
+  return (request->call == MPI_REQ_CALL_EXT_DEV ? request->ext_dev : request->host);
+}
+
+int mpi_requestInit(MPI_request* request, MPI_sched* sched, int(*callback)(), void* context){
+
+  request->next = NULL;
+  request->status = MPI_REQ_IDLE;
+  request->result = 0;
+  request->callback = callback;
+  request->context = context;
+  request->sched = sched;
+  request->priority = mpi_sched_normal;
+  return 0;
+}
+
+//mpi_schedRun() event, the deferred call itself
+int mpi_requestRun(MPI_request* request, uint32_t arg){
+
+  int result;
+
+  if(request->call == MPI_REQ_CALL_HOST){
+    result = request->host_fn(request->host, request->read_write);
+  } else if(request->register_enum != NULL){
+    result = request->ext_dev_fn(request->host, request->host_fn, request->ext_dev, request->register_enum);
+  } else {
+    result = request->ext_dev_fn(request->host, request->host_fn, request->ext_dev, request->read_write);
+  }
+  return mpi_requestComplete(request, result);
+}
+
+/*
+ * The call fields are filled in by the *Async fn. -1 if the scheduler's
+ * queue is full, the request is completed with the error too so the
+ * callback still sees it.
+ */
+int mpi_requestDefer(MPI_request* request){
+
+  request->status = MPI_REQ_PENDING;
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_MPI, mpi_requestObject(request), MPI_TRACE_OP_ASYNC, 0, 0);
+
+  if(request->sched == NULL){
+    mpi_requestRun(request, 0);
+    return 0;
+  }
+  if(mpi_schedPost(request->sched, request->priority, mpi_requestRun, request, 0) != 0){
+    mpi_requestComplete(request, -1);
+    return -1;
+  }
+  return 0;
+}
+
+//interrupt safe, callback first, the request may be reused the moment status changes
+int mpi_requestComplete(MPI_request* request, int result){
+
+  request->result = result;
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_MPI, mpi_requestObject(request), MPI_TRACE_OP_ASYNC | MPI_TRACE_EXIT,
+                  (request->call == MPI_REQ_CALL_HOST ? request->buffer_len : 0), result);
+  if(request->callback != NULL){
+    request->callback(request->context, request);
+  }
+  request->status = (result >= 0 ? MPI_REQ_DONE : MPI_REQ_ERROR);
+  return result;
+}
+
+int mpi_requestPending(MPI_request* request){
+
+  return (request->status == MPI_REQ_PENDING);
+}
+
+/*
+ * Spins until done. Only for host transfers, which complete from
+ * interrupts; a deferred call waited on from inside a handler would never
+ * get to run.
+ */
+int mpi_requestWait(MPI_request* request){
+
+  while(request->status == MPI_REQ_PENDING);
+  return request->result;
+}
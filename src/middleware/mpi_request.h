@@ -0,0 +1,57 @@
+#ifndef MPI_REQUEST_H_
+#define MPI_REQUEST_H_
+
+#include <stdint.h>
+
+#include "mpi_types.h"
+#include "mpi_port.h"
+#include "mpi_sched.h"
+
+/*
+ * Request/completion for the *Async middleware calls, see mpi_request.c
+ *
+ * A request is owned by the caller and must stay put until it completes.
+ * callback(context, request) runs once request->result is in, then status
+ * goes to MPI_REQ_DONE or MPI_REQ_ERROR; after that the request can be
+ * reused, from inside the callback included.
+ */
+
+#define MPI_REQ_IDLE              0
+#define MPI_REQ_PENDING           1
+#define MPI_REQ_DONE              2
+#define MPI_REQ_ERROR             3
+
+#define MPI_REQ_CALL_HOST         0     //fn(host, read_write)
+#define MPI_REQ_CALL_EXT_DEV      1     //fn(host, host_fn, ext_dev, read_write or register_enum)
+
+typedef struct MPI_REQUEST{
+  struct MPI_REQUEST* next;             //host transfer queue
+  volatile uint32_t status;
+  int result;
+  int_callback callback;                //(context, request), interrupt context for host transfers
+  void* context;
+  MPI_sched* sched;                     //where deferred calls run, NULL runs them in the caller
+  MPI_sched_priority priority;
+
+  //deferred call
+  uint32_t call;
+  void* host;
+  int_callback host_fn;
+  void* ext_dev;
+  int_callback ext_dev_fn;
+  uint32_t read_write;
+  void* register_enum;
+
+  //host transfer, _usart_data_async
+  uint32_t RW;
+  uint8_t* buffer;
+  uint32_t buffer_len;
+}MPI_request;
+
+int mpi_requestInit(MPI_request* request, MPI_sched* sched, int(*callback)(), void* context);
+int mpi_requestDefer(MPI_request* request);
+int mpi_requestComplete(MPI_request* request, int result);
+int mpi_requestPending(MPI_request* request);
+int mpi_requestWait(MPI_request* request);
+
+#endif
@@ -0,0 +1,220 @@
+/* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef FREERTOS
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpi_rtos.h"
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * FreeRTOS binding
+ *
+ * The driver task sleeps on its notification value. A request sets
+ * MPI_RTOS_NOTIFY_REQUEST after queueing, an interrupt or's its flags in
+ * from the handler through mpi_rtosIrqDefer() and nothing else, so the
+ * handler is a few instructions and the device work (SPI reads, decoding)
+ * runs at task priority with interrupts on.
+ *
+ * Interrupt work goes before queued requests on each wakeup, a DW1000
+ * frame sitting in the receive buffer matters more than a register dump.
+ *
+ * mpi_rtosDevCall() blocks the caller on a semaphore until the task has
+ * run the request, mpi_rtosDevPost() returns straight away and the result
+ * comes back through the callback, on the driver task.
+ */
+
+void mpi_rtosDevTask(void* dev_object);
+int mpi_rtosDevRun(MPI_rtos_dev* dev, MPI_rtos_request* request);
+
+int mpi_rtosDevRun(MPI_rtos_dev* dev, MPI_rtos_request* request){
+
+  int status;
+
+  if(dev->bus != NULL){
+    xSemaphoreTake(dev->bus, portMAX_DELAY);
+  }
+
+  if(request->register_enum != NULL){
+    status = request->ext_dev_fn(dev->host, dev->host_comm, dev->ext_dev, request->register_enum);
+  } else {
+    status = request->ext_dev_fn(dev->host, dev->host_comm, dev->ext_dev, request->read_write);
+  }
+
+  if(dev->bus != NULL){
+    xSemaphoreGive(dev->bus);
+  }
+
+  dev->requests_run++;
+  return status;
+}
+
+void mpi_rtosDevTask(void* dev_object){
+
+  MPI_rtos_dev* dev = (MPI_rtos_dev*)dev_object;
+  MPI_rtos_request request;
+  uint32_t notified;
+
+  for(;;){
+    xTaskNotifyWait(0, 0xFFFFFFFFUL, &notified, portMAX_DELAY);
+
+    if((notified & MPI_RTOS_NOTIFY_IRQ) && dev->_irq != NULL){
+      if(dev->bus != NULL){
+        xSemaphoreTake(dev->bus, portMAX_DELAY);
+      }
+      dev->_irq(dev->host, dev->host_comm, dev->ext_dev, notified & MPI_RTOS_NOTIFY_IRQ);
+      if(dev->bus != NULL){
+        xSemaphoreGive(dev->bus);
+      }
+      dev->irqs_run++;
+    }
+
+    //one notification can stand for several requests
+    //
+    while(xQueueReceive(dev->requests, &request, 0) == pdTRUE){
+      int status = mpi_rtosDevRun(dev, &request);
+
+      if(request.callback != NULL){
+        request.callback(request.context, status);
+      } else {
+        dev->status = status;
+        xSemaphoreGive(dev->done);
+      }
+    }
+  }
+}
+
+int mpi_rtosDevStart(MPI_rtos_dev* dev, void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, SemaphoreHandle_t bus, const char* name, UBaseType_t priority){
+
+  dev->host = host_object;
+  dev->host_comm = host_comm_interface_fn;
+  dev->ext_dev = ext_dev_object;
+  dev->_irq = NULL;
+  dev->bus = bus;
+  dev->status = 0;
+  dev->requests_run = 0;
+  dev->irqs_run = 0;
+
+  dev->requests = xQueueCreate(MPI_RTOS_QUEUE_LEN, sizeof(MPI_rtos_request));
+  dev->lock = xSemaphoreCreateMutex();
+  dev->done = xSemaphoreCreateBinary();
+
+  if(dev->requests == NULL || dev->lock == NULL || dev->done == NULL){
+    return -1;
+  }
+
+  if(xTaskCreate(mpi_rtosDevTask, name, MPI_RTOS_STACK_WORDS, dev, priority, &dev->task) != pdPASS){
+    return -1;
+  }
+  return 0;
+}
+
+int mpi_rtosDevCall(MPI_rtos_dev* dev, int(*ext_dev_interface_fn)(), uint32_t read_write, void* register_enum, TickType_t timeout){
+
+  MPI_rtos_request request = {
+    .ext_dev_fn = ext_dev_interface_fn,
+    .read_write = read_write,
+    .register_enum = register_enum,
+    .callback = NULL,
+    .context = NULL
+  };
+
+  //the driver task calling itself would wait on itself forever
+  //
+  if(xTaskGetCurrentTaskHandle() == dev->task){
+    return mpi_rtosDevRun(dev, &request);
+  }
+
+  if(xSemaphoreTake(dev->lock, timeout) != pdTRUE){
+    return -1;
+  }
+
+  int status = -1;
+
+  if(xQueueSend(dev->requests, &request, timeout) == pdTRUE){
+    xTaskNotify(dev->task, MPI_RTOS_NOTIFY_REQUEST, eSetBits);
+    xSemaphoreTake(dev->done, portMAX_DELAY);
+    status = dev->status;
+  }
+
+  xSemaphoreGive(dev->lock);
+  return status;
+}
+
+//task context, -1 if the queue is full
+int mpi_rtosDevPost(MPI_rtos_dev* dev, int(*ext_dev_interface_fn)(), uint32_t read_write, void* register_enum, int(*callback)(), void* context){
+
+  MPI_rtos_request request = {
+    .ext_dev_fn = ext_dev_interface_fn,
+    .read_write = read_write,
+    .register_enum = register_enum,
+    .callback = callback,
+    .context = context
+  };
+
+  if(callback == NULL || xQueueSend(dev->requests, &request, 0) != pdTRUE){
+    return -1;
+  }
+  xTaskNotify(dev->task, MPI_RTOS_NOTIFY_REQUEST, eSetBits);
+  return 0;
+}
+
+/*
+ * Hooks the device's interrupt source on the host (_irq_attach) to
+ * mpi_rtosIrqDefer(), irq_fn then runs on the driver task.
+ */
+int mpi_rtosIrqAttach(MPI_rtos_dev* dev, uint32_t irq_source, int(*irq_fn)()){
+
+  MPI_host* host_ptr = (MPI_host*)dev->host;
+  int_callback host_irq_attach = host_ptr->_core_mcuconf._irq_attach;
+
+  if(host_irq_attach == NULL){
+    return -1;
+  }
+  dev->_irq = irq_fn;
+  return host_irq_attach(dev->host, irq_source, mpi_rtosIrqDefer, dev);
+}
+
+//interrupt context
+int mpi_rtosIrqDefer(void* dev_object, uint32_t flags){
+
+  MPI_rtos_dev* dev = (MPI_rtos_dev*)dev_object;
+  BaseType_t woken = pdFALSE;
+
+  //a zero would wake the task for nothing, the bit still says "irq"
+  //
+  flags &= MPI_RTOS_NOTIFY_IRQ;
+  xTaskNotifyFromISR(dev->task, (flags ? flags : 1), eSetBits, &woken);
+  portYIELD_FROM_ISR(woken);
+  return 0;
+}
+
+//for the HAL's delays, busy wait before the scheduler is up
+int mpi_rtosDelay(uint32_t delay_ms){
+
+  if(xTaskGetSchedulerState() != taskSCHEDULER_RUNNING){
+    return -1;
+  }
+  vTaskDelay(pdMS_TO_TICKS(delay_ms) ? pdMS_TO_TICKS(delay_ms) : 1);
+  return 0;
+}
+
+#endif
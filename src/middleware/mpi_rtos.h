@@ -0,0 +1,73 @@
+#ifndef MPI_RTOS_H_
+#define MPI_RTOS_H_
+
+#ifdef FREERTOS
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * FreeRTOS binding, see mpi_rtos.c
+ *
+ * One driver task per MPI_ext_dev. Other tasks hand it requests (an
+ * ext_dev interface fn plus its read_write or register_enum) through its
+ * queue, and its interrupts reach it as task notification bits. Everything
+ * that touches the device happens on that one task.
+ */
+
+#define MPI_RTOS_QUEUE_LEN        4
+#define MPI_RTOS_STACK_WORDS      (configMINIMAL_STACK_SIZE * 2)
+
+#define MPI_RTOS_NOTIFY_REQUEST   (1UL << 31)       //something in the queue
+#define MPI_RTOS_NOTIFY_IRQ       (~MPI_RTOS_NOTIFY_REQUEST)
+
+typedef struct {
+  int_callback ext_dev_fn;        //e.g. ext_dev->_interface._dev_data
+  uint32_t read_write;
+  void* register_enum;            //ConfigReg/QueryReg, else NULL and read_write goes
+  int_callback callback;          //(context, status) on the driver task, NULL if synchronous
+  void* context;
+}MPI_rtos_request;
+
+/*
+ * _irq(host, host_comm, ext_dev, flags) is the deferred half of the
+ * device's interrupt, flags being whatever the host's handler passed (pins
+ * for gpio), or'd together if several came in before the task ran.
+ *
+ * bus is a mutex held around every call into the device, for devices
+ * sharing one host usart, or NULL if the device has the usart to itself.
+ * It's passed to mpi_rtosDevStart() so it's in place before the task
+ * first runs.
+ */
+typedef struct {
+  void* host;
+  int_callback host_comm;
+  void* ext_dev;
+  int_callback _irq;
+  SemaphoreHandle_t bus;
+  TaskHandle_t task;
+  QueueHandle_t requests;
+  SemaphoreHandle_t lock;         //one synchronous caller at a time
+  SemaphoreHandle_t done;
+  int status;                     //last synchronous request
+  uint32_t requests_run;
+  uint32_t irqs_run;
+}MPI_rtos_dev;
+
+int mpi_rtosDevStart(MPI_rtos_dev* dev, void* host_object, int(*host_comm_interface_fn)(), void* ext_dev_object, SemaphoreHandle_t bus, const char* name, UBaseType_t priority);
+int mpi_rtosDevCall(MPI_rtos_dev* dev, int(*ext_dev_interface_fn)(), uint32_t read_write, void* register_enum, TickType_t timeout);
+int mpi_rtosDevPost(MPI_rtos_dev* dev, int(*ext_dev_interface_fn)(), uint32_t read_write, void* register_enum, int(*callback)(), void* context);
+int mpi_rtosIrqAttach(MPI_rtos_dev* dev, uint32_t irq_source, int(*irq_fn)());
+int mpi_rtosIrqDefer(void* dev_object, uint32_t flags);
+int mpi_rtosDelay(uint32_t delay_ms);
+
+#endif
+
+#endif
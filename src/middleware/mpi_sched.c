@@ -0,0 +1,311 @@
+/* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpi_sched.h"
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Event scheduler
+ *
+ * Replaces the superloop. Rather than polling every device in a fixed
+ * order with blocking delays in between, whatever happens (radio irq,
+ * usart done, timer expiry, a GPS sentence decoded) posts an event, and
+ * mpi_schedRun() runs the events as they come, highest priority first.
+ *
+ * One queue per priority, each a ring the interrupt handlers and handlers
+ * post into and mpi_schedRun() alone takes from. Posting is a few stores
+ * under the host's interrupt mask (_irq_lock/_irq_unlock), so it is safe
+ * from any interrupt level. Hosts without them (linux) only post from the
+ * one thread.
+ *
+ * When every queue is empty and no timer is due the core sleeps through
+ * _emu_data(host, mode): EM2 if nothing needs the HF clocks, EM1 otherwise.
+ * The check and the sleep both happen with interrupts masked, so an event
+ * posted in between still wakes the core (WFI wakes on a pending irq with
+ * PRIMASK set, and the handler runs once the mask comes off).
+ */
+
+uint32_t mpi_schedLock(MPI_sched* sched);
+void mpi_schedUnlock(MPI_sched* sched, uint32_t mask);
+uint32_t mpi_schedPending(MPI_sched* sched);
+int mpi_schedTimerInsert(MPI_sched* sched, MPI_sched_timer* timer);
+int mpi_schedTimers(MPI_sched* sched);
+int mpi_schedIdle(MPI_sched* sched);
+
+uint32_t mpi_schedLock(MPI_sched* sched){
+
+  MPI_host* host_ptr = (MPI_host*)sched->host;
+  int_callback host_irq_lock = host_ptr->_core_mcuconf._irq_lock;
+
+  return (host_irq_lock != NULL ? (uint32_t)host_irq_lock() : 0);
+}
+
+void mpi_schedUnlock(MPI_sched* sched, uint32_t mask){
+
+  MPI_host* host_ptr = (MPI_host*)sched->host;
+  int_callback host_irq_unlock = host_ptr->_core_mcuconf._irq_unlock;
+
+  if(host_irq_unlock != NULL){
+    host_irq_unlock(mask);
+  }
+}
+
+int mpi_schedInit(void* host_object, MPI_sched* sched){
+
+  sched->host = host_object;
+  for(int i = 0; i < MPI_SCHED_PRIORITIES; i++){
+    sched->queue[i].head = 0;
+    sched->queue[i].tail = 0;
+    sched->queue[i].dropped = 0;
+  }
+  sched->timers = NULL;
+  sched->em1_holds = 0;
+  sched->dispatched = 0;
+  sched->sleeps_em1 = 0;
+  sched->sleeps_em2 = 0;
+  return 0;
+}
+
+//interrupt safe
+int mpi_schedPost(MPI_sched* sched, MPI_sched_priority priority, int (*handler)(), void* context, uint32_t arg){
+
+  MPI_sched_queue* queue = &sched->queue[priority];
+  int status = 0;
+
+  uint32_t mask = mpi_schedLock(sched);
+
+  if((queue->head - queue->tail) >= MPI_SCHED_QUEUE_LEN){
+    queue->dropped++;
+    status = -1;
+  } else {
+    MPI_sched_event* event = &queue->event[queue->head & MPI_SCHED_QUEUE_MASK];
+    event->handler = handler;
+    event->context = context;
+    event->arg = arg;
+    queue->head++;
+  }
+
+  mpi_schedUnlock(sched, mask);
+  return status;
+}
+
+//called masked
+uint32_t mpi_schedPending(MPI_sched* sched){
+
+  uint32_t pending = 0;
+
+  for(int i = 0; i < MPI_SCHED_PRIORITIES; i++){
+    pending += sched->queue[i].head - sched->queue[i].tail;
+  }
+  return pending;
+}
+
+/*
+ * Runs the oldest event of the highest priority that has one. The event is
+ * copied out before its slot is given back, so the handler can post again
+ * straight away.
+ */
+int mpi_schedDispatch(MPI_sched* sched){
+
+  MPI_sched_event event;
+  int found = 0;
+
+  uint32_t mask = mpi_schedLock(sched);
+
+  for(int i = 0; i < MPI_SCHED_PRIORITIES && !found; i++){
+    MPI_sched_queue* queue = &sched->queue[i];
+
+    if(queue->head != queue->tail){
+      event = queue->event[queue->tail & MPI_SCHED_QUEUE_MASK];
+      queue->tail++;
+      found = 1;
+    }
+  }
+
+  mpi_schedUnlock(sched, mask);
+
+  if(!found){
+    return MPI_SCHED_IDLE;
+  }
+  sched->dispatched++;
+  event.handler(event.context, event.arg);
+  return 0;
+}
+
+//sorted on expiry, wrap safe
+int mpi_schedTimerInsert(MPI_sched* sched, MPI_sched_timer* timer){
+
+  MPI_sched_timer** link = &sched->timers;
+
+  while(*link != NULL && (int32_t)((*link)->expiry - timer->expiry) <= 0){
+    link = &(*link)->next;
+  }
+  timer->next = *link;
+  *link = timer;
+  timer->armed = 1;
+  return 0;
+}
+
+int mpi_schedTimerStart(MPI_sched* sched, MPI_sched_timer* timer, MPI_sched_priority priority, uint32_t delay_ms, uint32_t period_ms, int (*handler)(), void* context){
+
+  MPI_host* host_ptr = (MPI_host*)sched->host;
+  int_callback host_ticks = host_ptr->_periph_periphconf._timer_ticks;
+
+  if(host_ticks == NULL){
+    return -1;
+  }
+
+  mpi_schedTimerStop(sched, timer);
+
+  timer->expiry = (uint32_t)host_ticks() + delay_ms;
+  timer->period = period_ms;
+  timer->priority = priority;
+  timer->handler = handler;
+  timer->context = context;
+  timer->fired = 0;
+  return mpi_schedTimerInsert(sched, timer);
+}
+
+int mpi_schedTimerStop(MPI_sched* sched, MPI_sched_timer* timer){
+
+  MPI_sched_timer** link = &sched->timers;
+
+  while(*link != NULL){
+    if(*link == timer){
+      *link = timer->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+  timer->next = NULL;
+  timer->armed = 0;
+  return 0;
+}
+
+/*
+ * Posts every timer that's due. A periodic timer keeps its phase unless
+ * it has fallen a whole period behind (a long handler), then it restarts
+ * from now rather than firing a burst to catch up.
+ */
+int mpi_schedTimers(MPI_sched* sched){
+
+  MPI_host* host_ptr = (MPI_host*)sched->host;
+  int_callback host_ticks = host_ptr->_periph_periphconf._timer_ticks;
+
+  if(sched->timers == NULL || host_ticks == NULL){
+    return 0;
+  }
+
+  uint32_t now = (uint32_t)host_ticks();
+  int posted = 0;
+
+  while(sched->timers != NULL && (int32_t)(now - sched->timers->expiry) >= 0){
+    MPI_sched_timer* timer = sched->timers;
+
+    sched->timers = timer->next;
+    timer->next = NULL;
+    timer->armed = 0;
+    timer->fired++;
+
+    mpi_schedPost(sched, timer->priority, timer->handler, timer->context, timer->fired);
+    posted++;
+
+    if(timer->period != 0){
+      timer->expiry += timer->period;
+      if((int32_t)(now - timer->expiry) >= 0){
+        timer->expiry = now + timer->period;
+      }
+      mpi_schedTimerInsert(sched, timer);
+    }
+  }
+  return posted;
+}
+
+//interrupt safe, pair every hold with a release
+int mpi_schedHold(MPI_sched* sched){
+
+  uint32_t mask = mpi_schedLock(sched);
+  sched->em1_holds++;
+  mpi_schedUnlock(sched, mask);
+  return 0;
+}
+
+int mpi_schedRelease(MPI_sched* sched){
+
+  uint32_t mask = mpi_schedLock(sched);
+  if(sched->em1_holds > 0){
+    sched->em1_holds--;
+  }
+  mpi_schedUnlock(sched, mask);
+  return 0;
+}
+
+/*
+ * isr_fn(context, flags) is run from the host's interrupt handler for
+ * irq_source (MPI_IRQ_*). It should do no more than post.
+ */
+int mpi_schedIrqAttach(MPI_sched* sched, uint32_t irq_source, int (*isr_fn)(), void* context){
+
+  MPI_host* host_ptr = (MPI_host*)sched->host;
+  int_callback host_irq_attach = host_ptr->_core_mcuconf._irq_attach;
+
+  if(host_irq_attach == NULL){
+    return -1;
+  }
+  return host_irq_attach(sched->host, irq_source, isr_fn, context);
+}
+
+/*
+ * Timers armed keep us in EM1, the ms tick is an HF timer and stops in EM2.
+ */
+int mpi_schedIdle(MPI_sched* sched){
+
+  MPI_host* host_ptr = (MPI_host*)sched->host;
+  int_callback host_sleep = host_ptr->_periph_periphconf._emu_data;
+
+  uint32_t mask = mpi_schedLock(sched);
+
+  if(mpi_schedPending(sched) == 0 && (sched->_idle == NULL || sched->_idle(sched) == 0) && host_sleep != NULL){
+    if(sched->em1_holds > 0 || sched->timers != NULL){
+      sched->sleeps_em1++;
+      host_sleep(sched->host, MPI_SCHED_EM1);
+    } else {
+      sched->sleeps_em2++;
+      host_sleep(sched->host, MPI_SCHED_EM2);
+    }
+  }
+
+  mpi_schedUnlock(sched, mask);
+  return 0;
+}
+
+void mpi_schedRun(MPI_sched* sched){
+
+  while(1){
+    mpi_schedTimers(sched);
+
+    if(mpi_schedDispatch(sched) == MPI_SCHED_IDLE){
+      mpi_schedIdle(sched);
+    }
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef MPI_SCHED_H_
+#define MPI_SCHED_H_
+
+#include <stdint.h>
+
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Run to completion event scheduler, see mpi_sched.c
+ *
+ * Handlers are int handler(void* context, uint32_t arg). They are queued by
+ * mpi_schedPost() from anywhere, interrupt handlers included, and run one
+ * at a time off mpi_schedRun(), highest priority first. A handler never
+ * blocks; anything that has to wait posts or arms a timer and returns.
+ */
+
+#define MPI_SCHED_PRIORITIES      3
+#define MPI_SCHED_QUEUE_LEN       16        //per priority, power of 2
+#define MPI_SCHED_QUEUE_MASK      (MPI_SCHED_QUEUE_LEN -1)
+
+#define MPI_SCHED_IDLE            1         //mpi_schedDispatch(): nothing to run
+
+#define MPI_SCHED_EM1             1         //_emu_data() modes for the idle sleep
+#define MPI_SCHED_EM2             2
+
+typedef enum {
+  mpi_sched_high,                 //radio irq, usart completion
+  mpi_sched_normal,
+  mpi_sched_low                   //housekeeping, LEDs
+}MPI_sched_priority;
+
+typedef struct {
+  int_callback handler;
+  void* context;
+  uint32_t arg;
+}MPI_sched_event;
+
+typedef struct {
+  MPI_sched_event event[MPI_SCHED_QUEUE_LEN];
+  volatile uint32_t head;         //free running, posts
+  volatile uint32_t tail;         //free running, dispatches
+  uint32_t dropped;               //posts that found the queue full
+}MPI_sched_queue;
+
+/*
+ * Software timer off the host ms tick (_timer_ticks). Expiry posts the
+ * handler at the timer's priority with arg = times fired, period 0 is one
+ * shot. Timers are started and stopped from handlers, not interrupts.
+ */
+typedef struct MPI_SCHED_TIMER{
+  struct MPI_SCHED_TIMER* next;
+  uint32_t expiry;                //host ms
+  uint32_t period;
+  MPI_sched_priority priority;
+  int_callback handler;
+  void* context;
+  uint32_t fired;
+  uint32_t armed;
+}MPI_sched_timer;
+
+/*
+ * _idle(sched) is the application's idle hook, run with interrupts masked
+ * just before the core sleeps. Returning nonzero skips the sleep.
+ *
+ * em1_holds counts whoever needs the HF clocks kept running (a transfer
+ * in flight, say). With none, and no timers armed, idle goes down to EM2.
+ */
+typedef struct {
+  void* host;
+  MPI_sched_queue queue[MPI_SCHED_PRIORITIES];
+  MPI_sched_timer* timers;        //armed, soonest first
+  volatile uint32_t em1_holds;
+  int_callback _idle;
+  uint32_t dispatched;
+  uint32_t sleeps_em1;
+  uint32_t sleeps_em2;
+}MPI_sched;
+
+int mpi_schedInit(void* host_object, MPI_sched* sched);
+int mpi_schedPost(MPI_sched* sched, MPI_sched_priority priority, int (*handler)(), void* context, uint32_t arg);
+int mpi_schedDispatch(MPI_sched* sched);
+int mpi_schedTimerStart(MPI_sched* sched, MPI_sched_timer* timer, MPI_sched_priority priority, uint32_t delay_ms, uint32_t period_ms, int (*handler)(), void* context);
+int mpi_schedTimerStop(MPI_sched* sched, MPI_sched_timer* timer);
+int mpi_schedHold(MPI_sched* sched);
+int mpi_schedRelease(MPI_sched* sched);
+int mpi_schedIrqAttach(MPI_sched* sched, uint32_t irq_source, int (*isr_fn)(), void* context);
+void mpi_schedRun(MPI_sched* sched);
+
+#endif
@@ -0,0 +1,177 @@
+/* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdint.h>
+
+#include "mpi_time.h"
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Time service
+ *
+ * Disciplines the host's monotonic clock to utc off a 1PPS edge. Each 
+ * labelled edge gives a phase error between where our utc said the edge
+ * was and where it really was, fed through a PI loop:
+ *
+ *   freq_int += phase / MPI_TIME_FREQ_GAIN      (ppb, the crystal's error)
+ *   freq      = freq_int + phase / MPI_TIME_PHASE_GAIN
+ *
+ * and utc carries on from the edge at the new rate, so time never jumps 
+ * once locked; the phase error is slewed out over the next couple of 
+ * seconds instead. Big errors (first edge, lost a second, receiver reset)
+ * step onto the reference and start over.
+ *
+ * Between edges, utc = utc_ref + elapsed - (elapsed * freq / 1e9). Good to
+ * the host timer resolution plus whatever the crystal wanders in a second.
+ */
+
+int64_t mpi_timeElapsed(MPI_time* time_sync, uint64_t host_ns);
+int mpi_timeStep(MPI_time* time_sync, uint64_t host_ns, uint64_t utc_ns);
+
+int mpi_timeInit(MPI_time* time_sync){
+
+  time_sync->state = mpi_time_free;
+  time_sync->host_ref = 0;
+  time_sync->utc_ref = 0;
+  time_sync->utc_label = 0;
+  time_sync->freq_int = 0;
+  time_sync->freq = 0;
+  time_sync->phase = 0;
+  time_sync->capture_count = 0;
+  time_sync->lock_count = 0;
+  time_sync->steps = 0;
+  time_sync->rejects = 0;
+  return 0;
+}
+
+//utc ns since host_ref at the current rate
+//
+int64_t mpi_timeElapsed(MPI_time* time_sync, uint64_t host_ns){
+
+  int64_t elapsed = (int64_t)(host_ns - time_sync->host_ref);
+  return elapsed - ((elapsed * time_sync->freq) / MPI_TIME_NS_PER_S);
+}
+
+int mpi_timeStep(MPI_time* time_sync, uint64_t host_ns, uint64_t utc_ns){
+
+  time_sync->host_ref = host_ns;
+  time_sync->utc_ref = utc_ns;
+  time_sync->freq = time_sync->freq_int;
+  time_sync->lock_count = 0;
+  time_sync->steps++;
+  time_sync->state = mpi_time_acquiring;
+  return 0;
+}
+
+/*
+ * Feed the last captured edge in, labelled with the utc second it starts.
+ * Call once per fix; nothing happens unless the host has captured a new 
+ * edge since the last call. The label has to belong to the latest edge 
+ * (the receiver sends the fix for a second after that second's pulse), a
+ * label that doesn't fit the edge spacing is rejected.
+ */
+int mpi_timePps(void* host_object, int (*host_timer_capture_fn)(), MPI_time* time_sync, uint64_t utc_s){
+
+  uint64_t capture_ns;
+  int count = host_timer_capture_fn(host_object, &capture_ns);
+
+  if(count < 0 || (uint32_t)count == time_sync->capture_count){
+    return MPI_TIME_PPS_NONE;
+  }
+  time_sync->capture_count = count;
+
+  uint64_t label_ns = utc_s * MPI_TIME_NS_PER_S;
+
+  if(time_sync->state == mpi_time_free){
+    mpi_timeStep(time_sync, capture_ns, label_ns);
+    time_sync->utc_label = label_ns;
+    return 0;
+  }
+
+  //the host should have seen (label - last label) go by, give or take the
+  //crystal. Otherwise the label and edge don't belong together
+  //
+  int64_t interval_s = (int64_t)(label_ns - time_sync->utc_label) / MPI_TIME_NS_PER_S;
+  int64_t interval_error = (int64_t)(capture_ns - time_sync->host_ref) - (interval_s * MPI_TIME_NS_PER_S);
+  int64_t interval_tolerance = interval_s * MPI_TIME_INTERVAL_PPM * 1000;
+
+  if(interval_s <= 0 || interval_error > interval_tolerance || -interval_error > interval_tolerance){
+    time_sync->rejects++;
+    mpi_timeStep(time_sync, capture_ns, label_ns);
+    time_sync->utc_label = label_ns;
+    return MPI_TIME_PPS_REJECTED;
+  }
+  time_sync->utc_label = label_ns;
+
+  //where we thought the edge was against where it was
+  //
+  uint64_t predicted = time_sync->utc_ref + mpi_timeElapsed(time_sync, capture_ns);
+  int64_t phase = (int64_t)(predicted - label_ns);
+
+  if(phase > MPI_TIME_STEP_NS || -phase > MPI_TIME_STEP_NS){
+    mpi_timeStep(time_sync, capture_ns, label_ns);
+    return 0;
+  }
+
+  //phase over the interval is a rate error in ppb
+  //
+  int64_t freq_int = time_sync->freq_int + ((phase / interval_s) / MPI_TIME_FREQ_GAIN);
+  int64_t freq = freq_int + ((phase / interval_s) / MPI_TIME_PHASE_GAIN);
+
+  if(freq_int > MPI_TIME_FREQ_MAX_PPB || -freq_int > MPI_TIME_FREQ_MAX_PPB){
+    time_sync->rejects++;
+    time_sync->freq_int = 0;
+    mpi_timeStep(time_sync, capture_ns, label_ns);
+    return MPI_TIME_PPS_REJECTED;
+  }
+
+  time_sync->freq_int = freq_int;
+  time_sync->freq = freq;
+  time_sync->phase = phase;
+  time_sync->utc_ref = predicted;
+  time_sync->host_ref = capture_ns;
+
+  if(phase < MPI_TIME_LOCK_NS && -phase < MPI_TIME_LOCK_NS){
+    if(++time_sync->lock_count >= MPI_TIME_LOCK_COUNT){
+      time_sync->state = mpi_time_locked;
+    }
+  } else {
+    time_sync->lock_count = 0;
+  }
+  return 0;
+}
+
+/*
+ * utc now, ns since the unix epoch. Fails until there has been an edge;
+ * returns mpi_time_acquiring/mpi_time_locked so callers that need the 
+ * accuracy (TDMA slots) can wait for lock.
+ */
+int mpi_timeUtcNow(void* host_object, int (*host_timer_now_fn)(), MPI_time* time_sync, uint64_t* utc_ns){
+
+  uint64_t host_ns;
+
+  if(time_sync->state == mpi_time_free){
+    return -1;
+  }
+  host_timer_now_fn(host_object, &host_ns);
+
+  *utc_ns = time_sync->utc_ref + mpi_timeElapsed(time_sync, host_ns);
+  return time_sync->state;
+}
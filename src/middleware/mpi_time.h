@@ -0,0 +1,54 @@
+#ifndef MPI_TIME_H_
+#define MPI_TIME_H_
+
+#include <stdint.h>
+
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * GPS disciplined time, see mpi_time.c
+ *
+ * Host time and utc are both ns. A reference (GPS receiver 1PPS) edge is 
+ * captured in host time by the host (_timer_capture) and labelled with the 
+ * utc second it starts by whoever has the fix. 
+ */
+
+#define MPI_TIME_NS_PER_S         1000000000LL
+
+#define MPI_TIME_PHASE_GAIN       2         //phase error slewed out over this many seconds
+#define MPI_TIME_FREQ_GAIN        8         //1/gain of the phase error goes into the frequency estimate
+#define MPI_TIME_FREQ_MAX_PPB     200000    //host crystal plus margin, anything past this is a bad edge
+#define MPI_TIME_STEP_NS          500000    //phase error past this steps rather than slews
+#define MPI_TIME_LOCK_NS          1000      //phase error to count towards lock
+#define MPI_TIME_LOCK_COUNT       4         //edges in a row inside MPI_TIME_LOCK_NS
+#define MPI_TIME_INTERVAL_PPM     1000      //edge interval vs label interval, outside this the pair is rejected
+
+#define MPI_TIME_PPS_NONE         1         //mpi_timePps(): no new edge
+#define MPI_TIME_PPS_REJECTED     -1
+
+typedef enum {
+  mpi_time_free,                  //no reference yet, mpi_timeUtcNow() fails
+  mpi_time_acquiring,             //stepped onto the reference, frequency settling
+  mpi_time_locked
+}MPI_time_state;
+
+typedef struct {
+  MPI_time_state state;
+  uint64_t host_ref;              //host ns at the last reference edge
+  uint64_t utc_ref;               //utc ns (unix epoch) at host_ref, continuous across slews
+  uint64_t utc_label;             //utc ns the last edge was labelled with
+  int32_t freq_int;               //integrated host rate error, ppb (host fast positive)
+  int32_t freq;                   //rate applied since host_ref, freq_int plus the phase slew
+  int32_t phase;                  //last phase error, ns (host ahead positive)
+  uint32_t capture_count;         //last capture consumed
+  uint32_t lock_count;
+  uint32_t steps;
+  uint32_t rejects;
+}MPI_time;
+
+int mpi_timeInit(MPI_time* time_sync);
+int mpi_timePps(void* host_object, int (*host_timer_capture_fn)(), MPI_time* time_sync, uint64_t utc_s);
+int mpi_timeUtcNow(void* host_object, int (*host_timer_now_fn)(), MPI_time* time_sync, uint64_t* utc_ns);
+
+#endif
@@ -40,4 +40,8 @@ int mpi_timerDelay(int (*host_timer_interface_delay_fn)(), uint32_t delay_ms){
   return host_timer_interface_delay_fn(delay_ms); 
 }
 
+uint32_t mpi_timerTicks(int (*host_timer_interface_ticks_fn)()){
+  return (uint32_t)host_timer_interface_ticks_fn(); 
+}
+
 
@@ -8,5 +8,6 @@ int mpi_timerInit(void* host_object, int (*host_timer_interface_global_fn)());
 int mpi_timerConfigReg(void* host_object, int (*host_timer_interface_single_reg_fn)(), uint32_t config_register);
 int mpi_timerQueryReg(void* host_object, int (*host_timer_interface_single_reg_fn)(), uint32_t config_register);
 int mpi_timerDelay(int (*host_timer_interface_delay_fn)(), uint32_t delay_ms);
+uint32_t mpi_timerTicks(int (*host_timer_interface_ticks_fn)());
 
 #endif
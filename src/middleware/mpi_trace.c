@@ -0,0 +1,222 @@
+/* # SpongeCake, an embedded software design philosophy for bare-metal systems
+ * Copyright (C) 2018 Aidan Millar-Powell
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mpi_trace.h"
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Transaction trace
+ *
+ * A record is reserved by bumping head, then filled in place, so a writer
+ * never waits on another one and an interrupt can trace in the middle of
+ * a task's record. Where the core has atomics the bump is one of them;
+ * the M0+ has no ldrex/strex, so there it's done under the host's
+ * _irq_lock for the two instructions it takes. The ring keeps the newest
+ * MPI_TRACE_LEN records, older ones are overwritten and counted as
+ * dropped at the next drain.
+ *
+ * Stamps come from the host's _timer_stamp, a free running count read
+ * once per record, and are taken after the reservation: a record that
+ * got interrupted can carry a later stamp than the one after it.
+ *
+ * Devices go in the records as an index, the object pointer is looked up
+ * in a short table on each event and added the first time it's seen.
+ * Hosts and ext_devs both start with model[16], which is what the drain
+ * names them by.
+ *
+ * mpi_traceDrain() runs from the lowest priority context there is; a task
+ * preempted half way through a record can leave it half written. Nothing
+ * is recorded while a drain is writing, the writer's own transfers would
+ * otherwise be what fills the ring.
+ */
+
+MPI_trace mpi_trace;
+
+static volatile uint32_t mpi_trace_paused;
+
+uint32_t mpi_traceAdd(volatile uint32_t* counter);
+uint32_t mpi_traceDevice(void* object);
+
+uint32_t mpi_traceAdd(volatile uint32_t* counter){
+
+#if defined(__ARM_ARCH_6M__)
+  uint32_t mask = (mpi_trace.lock != NULL ? (uint32_t)mpi_trace.lock() : 0);
+  uint32_t value = (*counter)++;
+
+  if(mpi_trace.unlock != NULL){
+    mpi_trace.unlock(mask);
+  }
+  return value;
+#else
+  return __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/*
+ * Two contexts meeting a new device at once can both add it, the decoder
+ * just sees the name twice.
+ */
+uint32_t mpi_traceDevice(void* object){
+
+  uint32_t devices = mpi_trace.devices;
+
+  if(object == NULL){
+    return MPI_TRACE_NO_DEVICE;
+  }
+  for(uint32_t i = 0; i < devices && i < MPI_TRACE_DEVICES; i++){
+    if(mpi_trace.device[i] == object){
+      return i;
+    }
+  }
+
+  uint32_t index = mpi_traceAdd(&mpi_trace.devices);
+
+  if(index >= MPI_TRACE_DEVICES){
+    return MPI_TRACE_NO_DEVICE;
+  }
+  mpi_trace.device[index] = object;
+  return index;
+}
+
+/*
+ * Records go in from reset, stamped with their record number until this
+ * finds the host's _timer_stamp. Those aren't drained once it has, the
+ * two kinds of stamp don't mix in one timeline.
+ */
+int mpi_traceInit(void* host_object){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  uint32_t stamp_hz = 0;
+
+  mpi_trace.lock = host_ptr->_core_mcuconf._irq_lock;
+  mpi_trace.unlock = host_ptr->_core_mcuconf._irq_unlock;
+
+  if(host_ptr->_periph_periphconf._timer_stamp != NULL){
+    host_ptr->_periph_periphconf._timer_stamp(&stamp_hz);
+    mpi_trace.stamp_hz = stamp_hz;
+    mpi_trace.stamp = host_ptr->_periph_periphconf._timer_stamp;
+    mpi_trace.drained = mpi_trace.head;
+  }
+  return 0;
+}
+
+void mpi_traceEvent(uint32_t layer, void* object, uint32_t op, uint32_t length, int result){
+
+  if(mpi_trace_paused){
+    return;
+  }
+
+  uint32_t index = mpi_traceAdd(&mpi_trace.head);
+  MPI_trace_record* record = &mpi_trace.record[index & (MPI_TRACE_LEN - 1)];
+
+  record->stamp = (mpi_trace.stamp != NULL ? (uint32_t)mpi_trace.stamp(NULL) : index);
+  record->length = (length > UINT16_MAX ? UINT16_MAX : length);
+  record->result = (result < INT16_MIN ? INT16_MIN : (result > INT16_MAX ? INT16_MAX : result));
+  record->layer = layer;
+  record->device = mpi_traceDevice(object);
+  record->op = op;
+  record->seq = index;
+}
+
+/*
+ * Everything since the last drain: header, device names, then the records
+ * oldest first, each handed to write_fn(context, buffer, len) as it sits in
+ * memory (little endian on every target so far). Nothing is written if
+ * there's nothing new. -1 if write_fn fails, the records stay for the next
+ * drain.
+ */
+int mpi_traceDrain(int(*write_fn)(), void* context){
+
+  uint32_t head = mpi_trace.head;
+  uint32_t first = mpi_trace.drained;
+  uint32_t devices = mpi_trace.devices;
+  uint32_t dropped = 0;
+
+  char names[MPI_TRACE_DEVICES][MPI_TRACE_NAME_LEN];
+
+  if(head == first){
+    return 0;
+  }
+  if((head - first) > MPI_TRACE_LEN){
+    dropped = head - first - MPI_TRACE_LEN;
+    first = head - MPI_TRACE_LEN;
+  }
+  if(devices > MPI_TRACE_DEVICES){
+    devices = MPI_TRACE_DEVICES;
+  }
+
+  MPI_trace_header header = {
+    .magic = MPI_TRACE_MAGIC,
+    .version = MPI_TRACE_VERSION,
+    .record_size = sizeof(MPI_trace_record),
+    .stamp_hz = mpi_trace.stamp_hz,
+    .records = head - first,
+    .dropped = dropped,
+    .devices = devices
+  };
+
+  memset(names, 0, sizeof(names));
+  for(uint32_t i = 0; i < devices; i++){
+    if(mpi_trace.device[i] != NULL){
+      memcpy(names[i], mpi_trace.device[i], MPI_TRACE_NAME_LEN - 1);
+    }
+  }
+
+  //the ring in at most two pieces, where it wraps
+  //
+  uint32_t start = first & (MPI_TRACE_LEN - 1);
+  uint32_t count = head - first;
+  uint32_t part = (count < (MPI_TRACE_LEN - start) ? count : (MPI_TRACE_LEN - start));
+  int ret = 0;
+
+  mpi_trace_paused = 1;
+  if(write_fn(context, (uint8_t*)&header, sizeof(header)) != 0 ||
+     (devices && write_fn(context, (uint8_t*)names, devices * MPI_TRACE_NAME_LEN) != 0) ||
+     write_fn(context, (uint8_t*)&mpi_trace.record[start], part * sizeof(MPI_trace_record)) != 0 ||
+     (count > part && write_fn(context, (uint8_t*)&mpi_trace.record[0], (count - part) * sizeof(MPI_trace_record)) != 0)){
+    ret = -1;
+  }
+  mpi_trace_paused = 0;
+
+  if(ret == 0){
+    mpi_trace.drained = head;
+  }
+  return ret;
+}
+
+/*
+ * mpi_traceDrain() writer for a host usart in async (UART) mode, context
+ * is the MPI_host. The linux hosts have a file writer in their adaptor
+ * instead.
+ */
+int mpi_traceUsartWrite(void* host_object, uint8_t* buffer, uint32_t buffer_len){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  int_callback host_usart_data = host_ptr->_periph_periphconf._usart_data;
+
+  if(host_usart_data == NULL){
+    return -1;
+  }
+  return host_usart_data(host_object, WRITE, buffer, buffer_len);
+}
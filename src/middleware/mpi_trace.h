@@ -0,0 +1,105 @@
+#ifndef MPI_TRACE_H_
+#define MPI_TRACE_H_
+
+#include <stdint.h>
+
+#include "mpi_types.h"
+#include "mpi_port.h"
+
+/*
+ * Binary transaction trace, see mpi_trace.c
+ *
+ * Every mpi_* call and host adaptor transfer leaves an entry and an exit
+ * record in a ring; mpi_traceDrain() hands whatever is new to a writer
+ * (a usart, a file on the linux hosts) and tools/trace decodes it.
+ *
+ * Build with '-DMPI_TRACE=1' to turn it on, without it MPI_TRACE_EVENT()
+ * is nothing and MPI_TRACE_CALL() is just the call.
+ */
+
+#ifndef MPI_TRACE_LEN
+#define MPI_TRACE_LEN             64      //records, a power of two
+#endif
+#define MPI_TRACE_DEVICES         8       //distinct hosts/ext_devs named in a drain
+#define MPI_TRACE_NAME_LEN        16      //MPI_host.model, MPI_ext_dev.model
+
+#define MPI_TRACE_MAGIC           0x5254504D  //"MPTR" little endian
+#define MPI_TRACE_VERSION         1
+
+#define MPI_TRACE_LAYER_APP       0
+#define MPI_TRACE_LAYER_MPI       1       //middleware mpi_* calls
+#define MPI_TRACE_LAYER_ADAPTOR   2       //host port adaptor transfers
+#define MPI_TRACE_LAYER_IRQ       3
+
+#define MPI_TRACE_OP_INIT         0
+#define MPI_TRACE_OP_CONFIG_REG   1
+#define MPI_TRACE_OP_QUERY_REG    2
+#define MPI_TRACE_OP_DATA         3
+#define MPI_TRACE_OP_SLEEP        4
+#define MPI_TRACE_OP_WAKEUP       5
+#define MPI_TRACE_OP_OFF          6
+#define MPI_TRACE_OP_RESET        7
+#define MPI_TRACE_OP_MODE_LEVEL   8
+#define MPI_TRACE_OP_TRANSFER     9       //_usart_transfer, header + payload
+#define MPI_TRACE_OP_SELECT       10      //bus reconfigured for another device
+#define MPI_TRACE_OP_IRQ          11
+#define MPI_TRACE_OP_ASYNC        12      //request, entry when queued, exit when completed
+#define MPI_TRACE_OPS             13
+
+#define MPI_TRACE_EXIT            0x80    //op bit, the record is the return
+#define MPI_TRACE_NO_DEVICE       0xFF
+
+//12 bytes, no padding on any of the targets
+typedef struct {
+  uint32_t stamp;                 //host _timer_stamp counts, the record number without one
+  uint16_t length;                //bytes moved, 0 where there's no buffer
+  int16_t result;                 //return value on exit records
+  uint8_t layer;
+  uint8_t device;                 //index into the drain's device names
+  uint8_t op;
+  uint8_t seq;                    //record number, low byte, gaps are records lost to overwrite
+}MPI_trace_record;
+
+//what mpi_traceDrain() writes ahead of the records, then devices * MPI_TRACE_NAME_LEN names
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t stamp_hz;              //0 when stamps are record numbers
+  uint32_t records;
+  uint32_t dropped;               //overwritten since the last drain
+  uint8_t devices;
+  uint8_t pad[3];
+}MPI_trace_header;
+
+typedef struct {
+  MPI_trace_record record[MPI_TRACE_LEN];
+  volatile uint32_t head;         //records ever reserved
+  uint32_t drained;               //head at the last drain
+  int_callback stamp;             //host _timer_stamp
+  uint32_t stamp_hz;
+  int_callback lock;              //host _irq_lock/_irq_unlock, for cores without atomics
+  int_callback unlock;
+  void* volatile device[MPI_TRACE_DEVICES];
+  volatile uint32_t devices;
+}MPI_trace;
+
+int mpi_traceInit(void* host_object);
+void mpi_traceEvent(uint32_t layer, void* object, uint32_t op, uint32_t length, int result);
+int mpi_traceDrain(int(*write_fn)(), void* context);
+int mpi_traceUsartWrite(void* host_object, uint8_t* buffer, uint32_t buffer_len);
+
+#ifdef MPI_TRACE
+#define MPI_TRACE_EVENT(layer, object, op, length, result) \
+  mpi_traceEvent((layer), (object), (op), (length), (result))
+#define MPI_TRACE_CALL(layer, object, op, length, call) \
+  ({ mpi_traceEvent((layer), (object), (op), (length), 0); \
+     int trace_ret_ = (call); \
+     mpi_traceEvent((layer), (object), (op) | MPI_TRACE_EXIT, (length), trace_ret_); \
+     trace_ret_; })
+#else
+#define MPI_TRACE_EVENT(layer, object, op, length, result)
+#define MPI_TRACE_CALL(layer, object, op, length, call) (call)
+#endif
+
+#endif
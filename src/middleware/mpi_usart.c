@@ -16,7 +16,11 @@
  *
  */
 
+#include <stddef.h>
+
 #include "mpi_usart.h"
+#include "mpi_request.h"
+#include "mpi_trace.h"
 #include "mpi_types.h"
 #include "mpi_port.h"  
 
@@ -49,20 +53,80 @@
 
 /* USART peripheral configuration */
 int mpi_usartInit(void* host_object, int(*host_usart_interface_global_fn)()){
-  return host_usart_interface_global_fn(host_object); 
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, host_object, MPI_TRACE_OP_INIT, 0,
+                        host_usart_interface_global_fn(host_object));
 }
 int mpi_usartConfigReg(void* host_object, int(*host_usart_interface_single_reg_fn)(), uint32_t config_register){
-  return host_usart_interface_single_reg_fn(host_object, config_register); 
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, host_object, MPI_TRACE_OP_CONFIG_REG, 0,
+                        host_usart_interface_single_reg_fn(host_object, config_register));
 }
 int mpi_usartQueryReg(void* host_object, int(*host_usart_interface_single_reg_fn)(), uint32_t config_register){
-  return host_usart_interface_single_reg_fn(host_object, config_register); 
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, host_object, MPI_TRACE_OP_QUERY_REG, 0,
+                        host_usart_interface_single_reg_fn(host_object, config_register));
 }
 
 /*
  * We always read from an external device layer, rather than directly from the host usart
  */
 int mpi_usartData(void* host_object, int(*host_usart_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write){
-	return ext_dev_interface_fn(host_object, host_usart_interface_fn, ext_dev_object, read_write);
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_MPI, ext_dev_object, MPI_TRACE_OP_DATA, 0,
+                        ext_dev_interface_fn(host_object, host_usart_interface_fn, ext_dev_object, read_write));
+}
+
+/* Async, deferred onto request->sched like mpi_extdev*Async() */
+int mpi_usartInitAsync(void* host_object, int(*host_usart_interface_global_fn)(), MPI_request* request){
+  request->call = MPI_REQ_CALL_HOST;
+  request->host = host_object;
+  request->host_fn = host_usart_interface_global_fn;
+  request->read_write = 0;
+  return mpi_requestDefer(request);
+}
+int mpi_usartConfigRegAsync(void* host_object, int(*host_usart_interface_single_reg_fn)(), uint32_t config_register, MPI_request* request){
+  request->call = MPI_REQ_CALL_HOST;
+  request->host = host_object;
+  request->host_fn = host_usart_interface_single_reg_fn;
+  request->read_write = config_register;
+  return mpi_requestDefer(request);
+}
+int mpi_usartQueryRegAsync(void* host_object, int(*host_usart_interface_single_reg_fn)(), uint32_t config_register, MPI_request* request){
+  request->call = MPI_REQ_CALL_HOST;
+  request->host = host_object;
+  request->host_fn = host_usart_interface_single_reg_fn;
+  request->read_write = config_register;
+  return mpi_requestDefer(request);
+}
+int mpi_usartDataAsync(void* host_object, int(*host_usart_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, MPI_request* request){
+  request->call = MPI_REQ_CALL_EXT_DEV;
+  request->host = host_object;
+  request->host_fn = host_usart_interface_fn;
+  request->ext_dev = ext_dev_object;
+  request->ext_dev_fn = ext_dev_interface_fn;
+  request->read_write = read_write;
+  request->register_enum = NULL;
+  return mpi_requestDefer(request);
+}
+
+/*
+ * Straight to the host's usart, no scheduler: host_usart_async_fn queues
+ * the buffer and returns, the usart interrupts complete the request. A
+ * host that can't take it completes it here with -1.
+ */
+int mpi_usartTransferAsync(void* host_object, int(*host_usart_async_fn)(), uint32_t RW, uint8_t* buffer, uint32_t buffer_len, MPI_request* request){
+
+  request->call = MPI_REQ_CALL_HOST;
+  request->host = host_object;
+  request->RW = RW;
+  request->buffer = buffer;
+  request->buffer_len = buffer_len;
+  request->next = NULL;
+  request->status = MPI_REQ_PENDING;
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_MPI, host_object, MPI_TRACE_OP_ASYNC, buffer_len, 0);
+
+  if(host_usart_async_fn == NULL || host_usart_async_fn(host_object, request) != 0){
+    mpi_requestComplete(request, -1);
+    return -1;
+  }
+  return 0;
 }
 
 
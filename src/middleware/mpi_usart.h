@@ -10,6 +10,7 @@
 
 #include "mpi_types.h"
 #include "mpi_port.h"
+#include "mpi_request.h"
 
 /******************************************************************************
  * @brief sends data using whatever USART is chosen
@@ -23,4 +24,16 @@ int mpi_usartConfigReg(void* host_object, int (*host_usart_interface_single_reg_
 int mpi_usartQueryReg(void* host_object, int (*host_usart_interface_single_reg_fn)(), uint32_t config_register);
 int mpi_usartData(void* host_object, int(*host_usart_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write);
 
+/******************************************************************************
+ * @brief async variants, completion through request (see mpi_request.c)
+ * @param host_usart_async_fn the host's _usart_data_async, queues buffer and
+ *        completes from the usart interrupts
+ *****************************************************************************/
+
+int mpi_usartInitAsync(void* host_object, int (*host_usart_interface_global_fn)(), MPI_request* request);
+int mpi_usartConfigRegAsync(void* host_object, int (*host_usart_interface_single_reg_fn)(), uint32_t config_register, MPI_request* request);
+int mpi_usartQueryRegAsync(void* host_object, int (*host_usart_interface_single_reg_fn)(), uint32_t config_register, MPI_request* request);
+int mpi_usartDataAsync(void* host_object, int(*host_usart_interface_fn)(), void* ext_dev_object, int(*ext_dev_interface_fn)(), uint32_t read_write, MPI_request* request);
+int mpi_usartTransferAsync(void* host_object, int(*host_usart_async_fn)(), uint32_t RW, uint8_t* buffer, uint32_t buffer_len, MPI_request* request);
+
 #endif /* MPI_SPI_H_ */
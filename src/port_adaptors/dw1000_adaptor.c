@@ -31,6 +31,7 @@
 #include "dw1000_decodeMAC.h"
 #include "dw1000_commRxTx.h"
 #include "dw1000_tofCalcs.h"
+#include "dw1000_power.h"
 
 
 /**************************************************************
@@ -130,19 +131,17 @@ int dw_Init(void* host_object, int(*host_usart)(), void* ext_dev_object){
 
 
 
-  //can't remember why this is here
-  DW_reg_id_enum config_index = unique_id;
-
-  //for loop with call to write into struct members
+  //write every config row of the register descriptor table out from dw_config
   //
-  for(int i = 0; i < CONFIG_STRUCT_MEMBERS; i++){
+  for(DW_reg_id_enum config_index = 0; config_index < CONFIG_STRUCT_MEMBERS; config_index++){
 
     if(host_timer_delay != NULL){
       host_timer_delay(1); 
     }
 
-    void(*config_member_ptr)() = config_table[i]; 
-    config_member_ptr(dw_config);
+    if(dw_regConfig(dw_config, config_index) != EXIT_SUCCESS){
+      return ERROR;
+    }
     
     //if WRITE call to dw_buildMessage()
     //if READ call to dw_decodeMessage()
@@ -168,11 +167,13 @@ int dw_RegDump(void* host_object, int(*host_usart)(), void* ext_dev_object){
   DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
   DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
 
-  DW_reg_id_enum query_index = unique_id;
-
-  for(int i = 0; i < QUERY_STRUCT_MEMBERS -1; i++){
+  //read back every config and query row of the register descriptor table
+  //
+  for(DW_reg_id_enum query_index = 0; query_index < QUERY_STRUCT_MEMBERS; query_index++){
    
-    dw_config->reg_id_index = query_index;
+    if(dw_regQuery(dw_config, query_index) != EXIT_SUCCESS){
+      return ERROR;
+    }
 
     //callback to host usart
     //
@@ -180,9 +181,7 @@ int dw_RegDump(void* host_object, int(*host_usart)(), void* ext_dev_object){
       
     //Write into struct member
     //
-    void(*query_member_ptr)() = query_table[query_index]; 
-    query_member_ptr(dw_config);
-
+    dw_regStore(dw_config, query_index);
   } 
   return EXIT_SUCCESS;
 }
@@ -198,13 +197,11 @@ int dw_ConfigReg(void* host_object, int(*host_usart)(), void* ext_dev_object, DW
   DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
   DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
 
-  DW_reg_id_enum table_index = config_register; 
-  dw_config->reg_id_index = table_index;
-
-  //call to adjust struct member value
+  //load the struct member value into the config buffer
   //
-  void(*config_member_ptr)() = config_table[table_index]; 
-  config_member_ptr(dw_config);
+  if(dw_regConfig(dw_config, config_register) != EXIT_SUCCESS){
+    return ERROR;
+  }
  
   //if tx call to dw_buildMessage()
   //if rx call to dw_decodeMessage()
@@ -216,6 +213,7 @@ int dw_ConfigReg(void* host_object, int(*host_usart)(), void* ext_dev_object, DW
   //
   if(ret == EXIT_SUCCESS){  
     dw_Tx(host_object, host_usart, dw_slave_ptr, dw_nodelist->frame_out, dw_nodelist->frame_out_len);
+    return EXIT_SUCCESS;
   } 
   return ERROR;
 }
@@ -226,8 +224,9 @@ int dw_QueryReg(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_
   DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
   DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
 
-  DW_reg_id_enum query_index = query_register; 
-  dw_config->reg_id_index = query_index;
+  if(dw_regQuery(dw_config, query_register) != EXIT_SUCCESS){
+    return ERROR;
+  }
 
   //callback to host usart
   //
@@ -235,10 +234,7 @@ int dw_QueryReg(void* host_object, int(*host_usart)(), void* ext_dev_object, DW_
   
   //Write into struct member
   //
-  void(*query_member_ptr)() = query_table[query_index]; 
-  query_member_ptr(dw_config);
-  
-  return EXIT_SUCCESS;
+  return dw_regStore(dw_config, query_register);
 }
 
 
@@ -324,204 +320,99 @@ int dw_Data(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_
 }
 
 /*
+ * POWER STATES
+ *
+ *   dw_Reset:     soft reset through PMSC_CTRL0, config is lost
+ *   dw_Off:       transceiver off and DEEPSLEEP, wake on SPI/pin only
+ *   dw_Sleep:     SLEEP between ranging slots, wakes on the AON counter
+ *                 (sleep_count) or on SPI/pin
+ *   dw_Wakeup:    SPI wake, returns once DEV_ID answers. The measured
+ *                 wake-to-ready time is left in DW_power.wake_latency_us,
+ *                 the DEV_ID reads it took in wake_polls
+ *   dw_ModeLevel: apply DW_power.mode_level, this decides whether LDE is
+ *                 reloaded on wake and loads it now if it is missing
+ *
+ * The AON config is only re-uploaded when the sleep type, mode level,
+ * sleep_count or lp_clk_div changes, not on every sleep.
+ */
 
 int dw_Reset(void* host_object, int(*host_usart)(), void* ext_dev_object){
  
   MPI_ext_dev* dw_slave_ptr = (MPI_ext_dev*)ext_dev_object;
-  DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
-  DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
-
-  
-  // set dw_config->query_index member that triggers this function
-  DW_reg_id_enum config_index = 0;
-
+  DW_power* dw_power = (DW_power*)dw_slave_ptr->MPI_conf[DW_POWER_INDEX];
 
+  int ret = dw_softReset(host_object, host_usart, ext_dev_object);
 
-
-  dw_config->reg_id_index = config_index;
-  
-  //call to adjust struct member value
-  //
-  void(*config_member_ptr)() = config_table[config_index]; 
-  config_member_ptr(dw_config);
- 
-  //if tx call to dw_buildMessage()
-  //if rx call to dw_decodeMessage()
-  //
-  uint32_t(*build_msg_ptr)() = dw_decode_build_table[WRITE];
-  int ret = build_msg_ptr(host_object, host_usart, ext_dev_object, WRITE, DW_CONFIG);
-
-  if(ret == EXIT_SUCCESS){
-    return dw_Tx(host_object, host_usart, dw_slave_ptr, dw_nodelist->frame_out, dw_nodelist->frame_out_len);
+  if(dw_power != NULL){
+    dw_power->aon_state = DW_AON_NONE;
+    dw_power->lde_loaded = false;
+    dw_power->asleep = false;
   }
-  return ERROR;
+  return ret;
 }
 
 
-
 int dw_Off(void* host_object, int(*host_usart)(), void* ext_dev_object){
  
   MPI_ext_dev* dw_slave_ptr = (MPI_ext_dev*)ext_dev_object;
-  DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
-  DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
+  DW_power* dw_power = (DW_power*)dw_slave_ptr->MPI_conf[DW_POWER_INDEX];
 
+  if(dw_power == NULL){
+    return dw_trxOff(host_object, host_usart, ext_dev_object);
+  }
 
-
-
-  
-  // set dw_config->query_index member that triggers this function
-  DW_reg_id_enum config_index = 0;
-
-
-
-
-
-
-
-  dw_config->reg_id_index = config_index;
-  
-  //call to adjust struct member value
-  //
-  void(*config_member_ptr)() = config_table[config_index]; 
-  config_member_ptr(dw_config);
- 
-  //if tx call to dw_buildMessage()
-  //if rx call to dw_decodeMessage()
-  //
-  uint32_t(*build_msg_ptr)() = dw_decode_build_table[WRITE];
-  int ret = build_msg_ptr(host_object, host_usart, ext_dev_object, WRITE, DW_CONFIG);
-
-  //callback to host usart
-  //
-  if(ret == EXIT_SUCCESS){
-    return dw_Tx(host_object, host_usart, dw_slave_ptr, dw_nodelist->frame_out, dw_nodelist->frame_out_len);
+  if(dw_aonConfigure(host_object, host_usart, ext_dev_object, dw_power, DW_AON_DEEP) != EXIT_SUCCESS){
+    return ERROR;
   }
-  return ERROR;
+  return dw_aonEnterSleep(host_object, host_usart, ext_dev_object, dw_power);
 }
 
 
-
 int dw_Sleep(void* host_object, int(*host_usart)(), void* ext_dev_object){
  
   MPI_ext_dev* dw_slave_ptr = (MPI_ext_dev*)ext_dev_object;
-  DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
-  DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
-
- 
-
-
-
-
-  // set dw_config->query_index member that triggers this function
-  DW_reg_id_enum config_index = 0;
- 
-
-
-
+  DW_power* dw_power = (DW_power*)dw_slave_ptr->MPI_conf[DW_POWER_INDEX];
 
+  if(dw_power == NULL){
+    return ERROR;
+  }
 
-  dw_config->reg_id_index = config_index;
-  
-  //call to adjust struct member value
-  //
-  void(*config_member_ptr)() = config_table[config_index]; 
-  config_member_ptr(dw_config);
- 
-  //if tx call to dw_buildMessage()
-  //if rx call to dw_decodeMessage()
-  //
-  uint32_t(*build_msg_ptr)() = dw_decode_build_table[WRITE];
-  int ret = build_msg_ptr(host_object, host_usart, ext_dev_object, WRITE, DW_CONFIG);
+  uint32_t aon_state = (dw_power->sleep_count != 0) ? DW_AON_TIMED : DW_AON_DEEP;
 
-  //callback to host usart
-  //
-  if(ret == EXIT_SUCCESS){
-    return dw_Tx(host_object, host_usart, dw_slave_ptr, dw_nodelist->frame_out, dw_nodelist->frame_out_len);
+  if(dw_aonConfigure(host_object, host_usart, ext_dev_object, dw_power, aon_state) != EXIT_SUCCESS){
+    return ERROR;
   }
-  return ERROR;
+  return dw_aonEnterSleep(host_object, host_usart, ext_dev_object, dw_power);
 }
 
 
-
 int dw_Wakeup(void* host_object, int(*host_usart)(), void* ext_dev_object){
  
   MPI_ext_dev* dw_slave_ptr = (MPI_ext_dev*)ext_dev_object;
-  DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
-  DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
-
-  
+  DW_power* dw_power = (DW_power*)dw_slave_ptr->MPI_conf[DW_POWER_INDEX];
 
-
-
-
-  // set dw_config->query_index member that triggers this function
-  DW_reg_id_enum config_index = 0;
-
-
-
-
-
-
-
-  dw_config->reg_id_index = config_index;
-  
-  //call to adjust struct member value
-  //
-  void(*config_member_ptr)() = config_table[config_index]; 
-  config_member_ptr(dw_config);
- 
-  //if tx call to dw_buildMessage()
-  //if rx call to dw_decodeMessage()
-  //
-  uint32_t(*build_msg_ptr)() = dw_decode_build_table[WRITE];
-  int ret = build_msg_ptr(host_object, host_usart, ext_dev_object, WRITE, DW_CONFIG);
-
-  //callback to host usart
-  //
-  if(ret == EXIT_SUCCESS){
-    return dw_Tx(host_object, host_usart, dw_slave_ptr, dw_nodelist->frame_out, dw_nodelist->frame_out_len);
+  if(dw_power == NULL){
+    return ERROR;
   }
-  return ERROR;
+
+  return dw_spiWake(host_object, host_usart, ext_dev_object, dw_power);
 }
 
+
 int dw_ModeLevel(void* host_object, int(*host_usart)(), void* ext_dev_object){
  
   MPI_ext_dev* dw_slave_ptr = (MPI_ext_dev*)ext_dev_object;
-  DW_config* dw_config = (DW_config*)dw_slave_ptr->MPI_conf[DW_CONFIG_INDEX];  
-  DW_nodelist* dw_nodelist = (DW_nodelist*)dw_slave_ptr->MPI_data[NODE_LIST_INDEX];
-
-  
-
-
-
-
-  // set dw_config->query_index member that triggers this function
-  DW_reg_id_enum config_index = 0;
-  
-  
-  
+  DW_power* dw_power = (DW_power*)dw_slave_ptr->MPI_conf[DW_POWER_INDEX];
 
+  if(dw_power == NULL){
+    return ERROR;
+  }
 
-  
+  //ONW_LLDE lives in AON_WCFG, force an upload on the next sleep
+  dw_power->aon_state = DW_AON_NONE;
 
-  dw_config->reg_id_index = config_index;
-  
-  //call to adjust struct member value
-  //
-  void(*config_member_ptr)() = config_table[config_index]; 
-  config_member_ptr(dw_config);
- 
-  //if tx call to dw_buildMessage()
-  //if rx call to dw_decodeMessage()
-  //
-  uint32_t(*build_msg_ptr)() = dw_decode_build_table[WRITE];
-  int ret = build_msg_ptr(host_object, host_usart, ext_dev_object, WRITE, DW_CONFIG);
-
-  //callback to host usart
-  //
-  if(ret == EXIT_SUCCESS){
-    return dw_Tx(host_object, host_usart, dw_slave_ptr, dw_nodelist->frame_out, dw_nodelist->frame_out_len);
+  if((dw_power->mode_level == DW_MODE_LEVEL_TWR) && !dw_power->asleep){
+    return dw_ldeLoad(host_object, host_usart, ext_dev_object, dw_power);
   }
-  return ERROR;
+  return EXIT_SUCCESS;
 }
-*/
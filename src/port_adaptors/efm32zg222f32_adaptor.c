@@ -31,6 +31,51 @@
 #include "efm32zg_gpio_IO_HAL.h"
 #include "efm32zg_timer_HAL.h"
 #include "efm32zg222f32_adaptor.h"
+#include "mpi_request.h"
+#include "mpi_trace.h"
+
+#ifdef FREERTOS
+#include "mpi_rtos.h"
+
+/*
+ * Under FreeRTOS a usart write sleeps the calling task until TXC, rather 
+ * than handing back while the last frame is still going out.
+ */
+static SemaphoreHandle_t usart_txc_done;
+#endif
+
+/*
+ * The usart's TX and RX interrupt hooks belong to the adaptor, see
+ * usart_DataAsync(). An MPI_IRQ_USART_TX hook from irq_Attach() is kept
+ * here and passed TXC when no async transfer is in flight.
+ */
+typedef struct {
+  MPI_request* head;              //in flight
+  MPI_request* tail;
+  uint32_t tx;
+  uint32_t rx;
+}USART_async;
+
+static USART_async usart_async;
+static ZG_irq_hook usart_txc_hook;
+
+//gpio CS of the device usart_Select() last set up for
+//
+typedef struct {
+  uint32_t port;
+  uint32_t pin;
+}USART_cs;
+
+static USART_cs usart_cs = {.port = MPI_BUS_NO_CS};
+static uint32_t usart_tx_sent;
+
+int usart_TxIsr(void* context, uint32_t flags);
+int usart_RxIsr(void* context, uint32_t flags);
+void usart_AsyncStart(MPI_request* request);
+void usart_AsyncFinish(int result);
+void usart_TxIdle(void);
+uint32_t usart_TransferFeed(uint32_t RW, uint8_t* header, uint32_t header_len, uint8_t* payload, uint32_t len, uint32_t tx, uint32_t rx);
+int usart_TriggerWait(void);
 
 
 /**************** USART *******************/
@@ -91,6 +136,14 @@ int usart_Init(void* host_ptr){
   //zg_TxIntSetup(false);
   //zg_RxIntSetup(false);
 
+#ifdef FREERTOS
+  if(usart_txc_done == NULL){
+    usart_txc_done = xSemaphoreCreateBinary();
+  }
+#endif
+  zg_IrqAttach(ZG_IRQ_USART_TX, usart_TxIsr, NULL);
+  zg_IrqAttach(ZG_IRQ_USART_RX, usart_RxIsr, NULL);
+
   if(MPI_usart_periphconf	!= NULL){
 
     int(*fn_ptr)();
@@ -122,6 +175,223 @@ int usart_ConfigReg(void* host_ptr, uint32_t config_register){
 	return fn_ptr(MPI_usart_periphconf);
 }
 
+/*
+ * Retune an async USART to 'baud' (16x oversampling):
+ *
+ *   CLKDIV = 256 * (fHFPERCLK / (16 * baud) - 1)
+ *
+ * rounded to the nearest quarter step the DIV field holds, then pushed out 
+ * through the normal CLKDIV config path. On a usart shared through mpi_bus
+ * follow it with mpi_busInvalidate().
+ */
+int usart_Baud(void* host_ptr, uint32_t baud){
+
+  MPI_host* efm32zg_host_ptr = (MPI_host*)host_ptr;
+  USART_periphconf* MPI_usart_periphconf = (USART_periphconf*)efm32zg_host_ptr->MPI_data[USART_PERIPHCONF_INDEX];
+
+  uint32_t hfperclk_hz = cmu_HfperclkHz();
+
+  if(baud == 0 || baud > (hfperclk_hz / USART_ASYNC_OVS)){
+    return 1;
+  }
+
+  //clkdiv is in 1/256ths, DIV starts at its lowest set bit (a quarter 
+  //step), half of that rounds rather than truncates
+  //
+  uint32_t clkdiv = (((hfperclk_hz * USART_ASYNC_OVS) + (baud / 2)) / baud) - 256;
+  uint32_t step = _USART_CLKDIV_DIV_MASK & -_USART_CLKDIV_DIV_MASK;
+
+  MPI_usart_periphconf->clkdiv = (clkdiv + (step / 2)) & _USART_CLKDIV_DIV_MASK;
+
+  return usart_ConfigReg(host_ptr, USART_CLKDIV);
+}
+
+/******************************************************************
+ *
+ * @breif usart_Select
+ *
+ * The host's _usart_select, called by mpi_busSelect() when the next 
+ * transaction is for a different device. Waits out the last frame, then
+ * sets CLKPOL/CLKPHA for mode (USART_SPIMODE_*) and a sync clock no 
+ * faster than clock_hz:
+ *
+ *   CLKDIV = 256 * (fHFPERCLK / (2 * clock_hz) - 1)
+ *
+ * whole steps only, sync mode ignores the fraction. cs_port/cs_pin is 
+ * the gpio usart_Cs() drives from then on, set up as a push-pull output
+ * idling high in gpio_periphconf. MPI_BUS_NO_CS hands CS to the usart 
+ * (AUTOCS on US1_CS, ROUTE CSPEN), any other pin takes AUTOCS off.
+ *
+ */
+
+static const uint32_t usart_spimode_mask[USART_SPIMODE_HPOL_HPHA + 1] = {
+  USART_LPOL_LPHA_MASK,
+  USART_LPOL_HPHA_MASK,
+  USART_HPOL_LPHA_MASK,
+  USART_HPOL_HPHA_MASK
+};
+
+int usart_Select(void* host_ptr, uint32_t mode, uint32_t clock_hz, uint32_t cs_port, uint32_t cs_pin){
+
+  MPI_host* efm32zg_host_ptr = (MPI_host*)host_ptr;
+  USART_periphconf* MPI_usart_periphconf = (USART_periphconf*)efm32zg_host_ptr->MPI_data[USART_PERIPHCONF_INDEX];
+
+  if(mode > USART_SPIMODE_HPOL_HPHA || clock_hz == 0){
+    return -1;
+  }
+
+  uint32_t hfperclk_hz = cmu_HfperclkHz();
+  uint32_t div = (hfperclk_hz + (2 * clock_hz) - 1) / (2 * clock_hz);
+
+  usart_TxIdle();
+
+  //CTRL's config path only ever sets bits, the clock bits go in directly
+  //
+  uint32_t ctrl = usart_spimode_mask[mode] | (cs_port == MPI_BUS_NO_CS ? USART_CTRL_AUTOCS : 0);
+  uint32_t ctrl_mask = _USART_CTRL_CLKPOL_MASK | _USART_CTRL_CLKPHA_MASK | USART_CTRL_AUTOCS;
+
+  MPI_usart_periphconf->ctrl = (MPI_usart_periphconf->ctrl & ~ctrl_mask) | ctrl;
+  usart->CTRL = (usart->CTRL & ~ctrl_mask) | ctrl;
+
+  MPI_usart_periphconf->clkdiv = ((div > 0 ? div - 1 : 0) << 8) & _USART_CLKDIV_DIV_MASK;
+  usart_ConfigReg(host_ptr, USART_CLKDIV);
+
+  usart_cs.port = cs_port;
+  usart_cs.pin = cs_pin;
+  return 0;
+}
+
+//_usart_cs, deasserting waits for the last frame to shift out first. 
+//Nothing with AUTOCS, the usart asserts CS from the first frame written to 
+//TX going idle
+int usart_Cs(void* host_ptr, uint32_t level){
+
+  if((usart->CTRL & USART_CTRL_AUTOCS) || usart_cs.port == MPI_BUS_NO_CS){
+    return 0;
+  }
+
+  if(level == MPI_CS_DEASSERT){
+    usart_TxIdle();
+    gpio->P[usart_cs.port].DOUTSET = (0x01 << usart_cs.pin);
+  } else {
+    gpio->P[usart_cs.port].DOUTCLR = (0x01 << usart_cs.pin);
+  }
+  return 0;
+}
+
+/******************************************************************
+ *
+ * @breif usart_Transfer
+ *
+ * The host's _usart_transfer: header out, then payload in (READ, zeros 
+ * clocked out), out (WRITE) or both (READ_WRITE), as one unbroken run of
+ * frames. AUTOCS holds CS down only while TX has something to send, so 
+ * the whole transaction runs with interrupts off and TX kept as full as
+ * it goes: up to USART_TX_DEPTH frames ahead of RX, the TX buffer 
+ * (TXBIL half full in usart_sync, so TXBL means room for one more) plus 
+ * the shift register. CS goes when TX runs dry at the end, no gpio
+ * involved.
+ *
+ * With a PRS channel on TRIGCTRL (TSEL, TXTEN, from the config layer) 
+ * TX is disabled first, so the opening frames wait in the buffer and the
+ * trigger starts the transaction, CS included, e.g. a DW1000 delayed TX 
+ * command fired off a timer. Interrupts stay off while it waits, at most
+ * USART_TRIGGER_TIMEOUT_US; after that the frames are dropped and it 
+ * returns -1.
+ *
+ */
+
+//keeps TX up to USART_TX_DEPTH frames ahead of RX, returns the new tx
+uint32_t usart_TransferFeed(uint32_t RW, uint8_t* header, uint32_t header_len, uint8_t* payload, uint32_t len, uint32_t tx, uint32_t rx){
+
+  while(tx < len && (tx - rx) < USART_TX_DEPTH && (usart->STATUS & USART_STATUS_TXBL)){
+    if(tx < header_len){
+      usart->TXDATA = header[tx];
+    } else {
+      usart->TXDATA = (RW == USART_READ ? 0 : payload[tx - header_len]);
+    }
+    tx++;
+  }
+  return tx;
+}
+
+//interrupts are off, so no timer to go by: polls of STATUS at roughly 
+//USART_TRIGGER_POLL_CYCLES core clocks each
+int usart_TriggerWait(void){
+
+  uint32_t polls = (SystemCoreClockGet() / 1000000) * USART_TRIGGER_TIMEOUT_US / USART_TRIGGER_POLL_CYCLES;
+
+  while(!(usart->STATUS & USART_STATUS_TXENS)){
+    if(polls-- == 0){
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int usart_Transfer(void* host_ptr, uint32_t RW, uint8_t* header, uint32_t header_len, uint8_t* payload, uint32_t payload_len){
+
+  uint32_t len = header_len + payload_len;
+  uint32_t tx = 0;
+  uint32_t rx = 0;
+  uint32_t triggered = usart->TRIGCTRL & USART_TRIGCTRL_TXTEN;
+
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_TRANSFER, len, 0);
+  if(usart_async.head != NULL){
+    MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_TRANSFER | MPI_TRACE_EXIT, len, -1);
+    return -1;
+  }
+
+  uint32_t primask = core_IrqLock();
+
+  usart->CMD = USART_CMD_CLEARRX;
+  if(triggered){
+    usart->CMD = USART_CMD_TXDIS;
+  }
+  usart_tx_sent = 1;
+  usart_Cs(host_ptr, MPI_CS_ASSERT);
+
+  if(triggered){
+    tx = usart_TransferFeed(RW, header, header_len, payload, len, tx, rx);
+
+    if(usart_TriggerWait() != 0){
+      //nothing went out, TXC won't come for usart_TxIdle() to wait on
+      //
+      usart->CMD = USART_CMD_CLEARTX | USART_CMD_TXEN;
+      usart_tx_sent = 0;
+      usart_Cs(host_ptr, MPI_CS_DEASSERT);
+      core_IrqUnlock(primask);
+      MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_TRANSFER | MPI_TRACE_EXIT, len, -1);
+      return -1;
+    }
+  }
+
+  while(rx < len){
+    if(usart->STATUS & USART_STATUS_RXDATAV){
+      uint8_t frame = usart->RXDATA;
+
+      if(rx >= header_len && RW != USART_WRITE){
+        payload[rx - header_len] = frame;
+      }
+      rx++;
+    }
+    tx = usart_TransferFeed(RW, header, header_len, payload, len, tx, rx);
+  }
+
+  core_IrqUnlock(primask);
+  usart_Cs(host_ptr, MPI_CS_DEASSERT);
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_TRANSFER | MPI_TRACE_EXIT, len, 0);
+  return 0;
+}
+
+//STATUS.TXC only comes up once something has been sent, so it's only waited on after that
+void usart_TxIdle(void){
+
+  if(usart_tx_sent){
+    while(!(usart->STATUS & USART_STATUS_TXC));
+  }
+}
+
 int usart_QueryReg(void* host_ptr, uint32_t config_register){
 
   MPI_host* efm32zg_host_ptr = (MPI_host*)host_ptr;
@@ -163,20 +433,198 @@ int usart_Data(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_
   int(*usart_IO_ptr)() = usart_IO_table[bitwidth][RW];
   void(*transfer_data_host_slave_ptr)() = usart_IO_host_slave_transfer[RW][bitwidth];
 
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_DATA, array_len, 0);
   if(RW == USART_READ){
     for(int slave_obj_buffer_index = 0; slave_obj_buffer_index < array_len; slave_obj_buffer_index++){
       usart_IO_ptr(MPI_buffer, MPI_frameconf, MPI_error, MPI_status);
       transfer_data_host_slave_ptr(MPI_buffer, ext_dev_array, slave_obj_buffer_index);    
     }
   } else if(RW == USART_WRITE){
+    //TXC can't go up again while the buffer is kept fed, so clearing it
+    //first and arming it after the last frame gives exactly one completion
+    //(usart_TxIsr)
+    //
+    usart->IFC = USART_IFC_TXC;
+    usart_tx_sent = 1;
     for(int slave_obj_buffer_index = 0; slave_obj_buffer_index < array_len; slave_obj_buffer_index++){
       transfer_data_host_slave_ptr(MPI_buffer, ext_dev_array, slave_obj_buffer_index); 
 	    usart_IO_ptr(MPI_buffer, MPI_frameconf, MPI_error, MPI_status);
     }
+#ifdef FREERTOS
+    uint32_t txc_wait = (array_len > 0 && usart_txc_done != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+
+    //every TXC gives, including writes from before the scheduler and ones
+    //nobody waited on. Drop any of those before this write's can arrive
+    //
+    if(txc_wait){
+      xSemaphoreTake(usart_txc_done, 0);
+    }
+#endif
+    usart->IEN |= USART_IEN_TXC;
+
+#ifdef FREERTOS
+    if(txc_wait){
+      xSemaphoreTake(usart_txc_done, portMAX_DELAY);
+    }
+#endif
   }
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_DATA | MPI_TRACE_EXIT, array_len, 0);
   return 0;  
 }
 
+/*****************************************************************
+ *
+ * @breif usart_DataAsync
+ *
+ * The host's _usart_data_async. Queues request->buffer and returns, the
+ * transfer runs off the usart interrupts and the request is completed from
+ * there, callback in interrupt context. Requests queued behind the one in
+ * flight are started from the interrupt as it finishes, so a GPS read and
+ * a DW1000 access can be handed over back to back without waiting on
+ * either.
+ *
+ * Synchronous (SPI) mode clocks a frame in for every frame out, so the
+ * transfer is done at the last RXDATAV and a READ sends zeros. TX is kept
+ * at most two frames ahead of RX, the depth of the RX buffer. Async (UART)
+ * mode READs request->buffer_len frames, WRITEs complete on TXC.
+ *
+ * 8 bit frames only, CS is left to the caller. Don't mix usart_Data() in
+ * while anything is queued here.
+ *
+ */
+
+int usart_DataAsync(void* host_ptr, MPI_request* request){
+
+  if(request->buffer_len == 0){
+    mpi_requestComplete(request, 0);
+    return 0;
+  }
+  request->next = NULL;
+
+  uint32_t primask = core_IrqLock();
+
+  if(usart_async.tail != NULL){
+    usart_async.tail->next = request;
+    usart_async.tail = request;
+  } else {
+    usart_async.head = request;
+    usart_async.tail = request;
+    usart_AsyncStart(request);
+  }
+
+  core_IrqUnlock(primask);
+  return 0;
+}
+
+void usart_AsyncStart(MPI_request* request){
+
+  uint32_t sync = usart->CTRL & USART_CTRL_SYNC;
+
+  usart_async.tx = 0;
+  usart_async.rx = 0;
+  usart_tx_sent = 1;
+
+  if(sync || request->RW == USART_READ){
+    usart->CMD = USART_CMD_CLEARRX;
+    usart->IEN |= USART_IEN_RXDATAV;
+  }
+  if(sync || request->RW != USART_READ){
+    usart->IEN |= USART_IEN_TXBL;
+  }
+}
+
+//interrupt context, the next request starts before this one's callback runs
+void usart_AsyncFinish(int result){
+
+  MPI_request* request = usart_async.head;
+
+  usart->IEN &= ~(USART_IEN_TXBL | USART_IEN_RXDATAV | USART_IEN_TXC);
+
+  usart_async.head = request->next;
+  if(usart_async.head == NULL){
+    usart_async.tail = NULL;
+  } else {
+    usart_AsyncStart(usart_async.head);
+  }
+  mpi_requestComplete(request, result);
+}
+
+int usart_TxIsr(void* context, uint32_t flags){
+
+  MPI_request* request = usart_async.head;
+  uint32_t sync = usart->CTRL & USART_CTRL_SYNC;
+
+  //a usart_Data() write
+  //
+  if(request == NULL){
+    if(flags & USART_IF_TXC){
+      MPI_TRACE_EVENT(MPI_TRACE_LAYER_IRQ, NULL, MPI_TRACE_OP_IRQ, 0, MPI_IRQ_USART_TX);
+#ifdef FREERTOS
+      BaseType_t woken = pdFALSE;
+
+      xSemaphoreGiveFromISR(usart_txc_done, &woken);
+      portYIELD_FROM_ISR(woken);
+#endif
+      if(usart_txc_hook.fn != NULL){
+        usart_txc_hook.fn(usart_txc_hook.context, flags);
+      }
+    }
+    return 0;
+  }
+
+  if(flags & USART_IF_TXBL){
+    while((usart->STATUS & USART_STATUS_TXBL) && usart_async.tx < request->buffer_len){
+      if(sync && (usart_async.tx - usart_async.rx) >= 2){
+        break;
+      }
+      usart->TXDATA = (request->RW == USART_READ ? 0 : request->buffer[usart_async.tx]);
+      usart_async.tx++;
+    }
+
+    //off until RX catches up (sync) or for good, UART writes finish on TXC
+    //
+    if(usart_async.tx == request->buffer_len || sync){
+      usart->IEN &= ~USART_IEN_TXBL;
+    }
+    if(usart_async.tx == request->buffer_len && !sync){
+      usart->IFC = USART_IFC_TXC;
+      usart->IEN |= USART_IEN_TXC;
+    }
+  }
+
+  if((flags & USART_IF_TXC) && !sync){
+    usart_AsyncFinish(0);
+  }
+  return 0;
+}
+
+int usart_RxIsr(void* context, uint32_t flags){
+
+  MPI_request* request = usart_async.head;
+
+  while(usart->STATUS & USART_STATUS_RXDATAV){
+    uint8_t frame = usart->RXDATA;
+
+    if(request == NULL){
+      continue;
+    }
+    if(request->RW != USART_WRITE){
+      request->buffer[usart_async.rx] = frame;
+    }
+    usart_async.rx++;
+
+    if(usart_async.rx == request->buffer_len){
+      usart_AsyncFinish(0);
+      return 0;
+    }
+  }
+
+  if(request != NULL && (usart->CTRL & USART_CTRL_SYNC) && usart_async.tx < request->buffer_len){
+    usart->IEN |= USART_IEN_TXBL;
+  }
+  return 0;
+}
+
 
 /************** GPIO *****************/
 
@@ -407,6 +855,12 @@ int cmu_Init(void* host_ptr){
 
   fn_ptr = cmu_config_table[CMU_OSCENCMD][WRITE];
   ret = fn_ptr(cmu_periphconf);
+
+  //don't switch HFCLK over to a crystal that hasn't started yet
+  //
+  if(cmu_periphconf->oscencmd & CMU_OSCENCMD_HFXOEN){
+    while(!(CMU->STATUS & CMU_STATUS_HFXORDY));
+  }
   fn_ptr = cmu_config_table[CMU_CMD][WRITE];
   ret = fn_ptr(cmu_periphconf);
   
@@ -440,6 +894,19 @@ int cmu_QueryReg(void* host_ptr, uint32_t config_register){
     int(*fn_ptr)() = cmu_config_table[conf_reg][READ];
 		return fn_ptr(cmu_periphconf);
 }
+
+/*
+ * HFPERCLK as the CMU has it now: HFCLK from whichever oscillator
+ * cmu_periphconf selected (HFRCO band or HFXO), over HFPERCLKDIV. Read
+ * back rather than assumed, emu_Data can come back from EM2 on another
+ * oscillator.
+ */
+uint32_t cmu_HfperclkHz(void){
+
+  uint32_t div = (CMU->HFPERCLKDIV & _CMU_HFPERCLKDIV_HFPERCLKDIV_MASK) >> _CMU_HFPERCLKDIV_HFPERCLKDIV_SHIFT;
+
+  return SystemHFClockGet() >> div;
+}
    
     
 
@@ -501,6 +968,10 @@ int timer_Init(void* host_ptr){
       }
 	i+=1;
   }
+
+  //free running from here on, everything below just reads it
+  //
+  timer0->CMD = TIMER_CMD_START;
 	return 0;
 }
 
@@ -528,16 +999,274 @@ int timer_QueryReg(void* host_ptr, uint32_t config_register){
 	return fn_ptr(timer_periphconf);
 }
 
+/*
+ * timer0 counts ms in its overflow irq, free running since timer_Init().
+ * Delay waits on the difference rather than zeroing the count.
+ */
 int timer_Delay(uint32_t dlyTicks)
 {
 
-  timer0_ms_ticks = 0;
-  timer0->CMD = TIMER_CMD_START;
-  while(timer0_ms_ticks < dlyTicks);
-  timer0->CMD = TIMER_CMD_STOP;
+#ifdef FREERTOS
+  //the task sleeps rather than spins once the scheduler is up
+  //
+  if(mpi_rtosDelay(dlyTicks) == 0){
+    return 0;
+  }
+#endif
+
+  uint32_t start = timer0_ms_ticks;
+
+  while((timer0_ms_ticks - start) < dlyTicks);
+
+  return 0;
+}
+
+/*
+ * ms since timer_Init(), wraps at 2^32. Used for deadlines (compare with
+ * (int32_t)(now - deadline)), not for anything absolute.
+ */
+int timer_Ticks(void)
+{
+
+  return (int)timer0_ms_ticks;
+}
+
+/*
+ * Host monotonic time in ns, ms ticks and the count within the tick. This 
+ * and timer_Capture() are what the time service (mpi_time) disciplines.
+ */
+uint64_t timer_CountsNs(uint32_t ticks, uint32_t cnt);
+
+uint64_t timer_CountsNs(uint32_t ticks, uint32_t cnt){
+
+  uint64_t counts = ((uint64_t)ticks * (timer0->TOP + 1)) + cnt;
+  uint32_t count_hz = cmu_HfperclkHz();
+
+  //whole seconds first, counts * 1e9 overflows after a few days
+  //
+  return ((counts / count_hz) * TIMER_NS_PER_S) + (((counts % count_hz) * TIMER_NS_PER_S) / count_hz);
+}
+
+int timer_Now(void* host_ptr, uint64_t* now_ns)
+{
+
+  uint32_t ticks;
+  uint32_t cnt;
+
+  //re-read if the overflow irq got in between
+  //
+  do{
+    ticks = timer0_ms_ticks;
+    cnt = timer0->CNT;
+  }while(ticks != timer0_ms_ticks);
+
+  *now_ns = timer_CountsNs(ticks, cnt);
+  return 0;
+}
+
+/*
+ * _timer_stamp, timer0 counts since timer_Init() at HFPERCLK, the rate 
+ * handed back in stamp_hz (wraps every ~179s at 24MHz). One multiply, no
+ * divide, cheap enough to take per trace record.
+ */
+int timer_Stamp(uint32_t* stamp_hz)
+{
+
+  uint32_t ticks;
+  uint32_t cnt;
+
+  if(stamp_hz != NULL){
+    *stamp_hz = cmu_HfperclkHz();
+  }
+
+  do{
+    ticks = timer0_ms_ticks;
+    cnt = timer0->CNT;
+  }while(ticks != timer0_ms_ticks);
+
+  return (int)((ticks * (timer0->TOP + 1)) + cnt);
+}
+
+/*
+ * Last cc0 capture (1PPS edge) in timer_Now() time. Returns the capture 
+ * count so callers can tell a new edge from one they've already seen, -1 
+ * before the first.
+ */
+int timer_Capture(void* host_ptr, uint64_t* capture_ns)
+{
+
+  uint32_t count;
+  uint32_t ticks;
+  uint32_t ccv;
+
+  do{
+    count = timer0_cc0_count;
+    ticks = timer0_cc0_ticks;
+    ccv = timer0_cc0_ccv;
+  }while(count != timer0_cc0_count);
 
+  if(count == 0){
+    return -1;
+  }
+
+  *capture_ns = timer_CountsNs(ticks, ccv);
+  return (int)(count & 0x7FFFFFFF);
+}
+
+
+
+/**************** MSC *******************/
+
+/******************************************************************
+ *
+ * @breif msc_Data
+ *
+ * Read/write the nvm area at the top of flash (MSC_NVM_BASE). This is 
+ * the host's _mcs_data hook.
+ *
+ * Reads are straight out of the memory map. Writes go a word at a time 
+ * and have to be word aligned; a page is erased as a write reaches its
+ * first word, so writers rewrite the area sequentially from offset 0 
+ * rather than patching it in place.
+ *
+ * The core stalls on the bus while the MSC is busy so this runs from 
+ * flash, irqs included, just slowly.
+ *
+ */
+
+int msc_Data(void* host_ptr, uint32_t RW, uint32_t offset, uint8_t* buffer, uint32_t buffer_len){
+
+  if((offset + buffer_len) > MSC_NVM_LEN){
+    return -1;
+  }
+
+  volatile uint8_t* nvm = (volatile uint8_t*)(MSC_NVM_BASE + offset);
+
+  if(RW == READ){
+    for(uint32_t i = 0; i < buffer_len; i++){
+      buffer[i] = nvm[i];
+    }
+    return 0;
+  }
+
+  if((offset & 0x3) || (buffer_len & 0x3)){
+    return -1;
+  }
+
+  //erase/write timing is counted off HFCORECLK in 1us periods, at
+  //whatever HFCORECLK is running at now
+  //
+  uint32_t hfcoreclk_mhz = SystemCoreClockGet() / 1000000;
+
+  MSC->LOCK = MSC_UNLOCK;
+  MSC->TIMEBASE = (MSC->TIMEBASE & ~(_MSC_TIMEBASE_BASE_MASK | _MSC_TIMEBASE_PERIOD_MASK))
+                  | MSC_TIMEBASE_PERIOD_1US | ((hfcoreclk_mhz + 1) << _MSC_TIMEBASE_BASE_SHIFT);
+  MSC->WRITECTRL |= MSC_WRITECTRL_WREN;
+
+  int ret = 0;
+
+  for(uint32_t i = 0; i < buffer_len && ret == 0; i += 4){
+
+    uint32_t address = MSC_NVM_BASE + offset + i;
+
+    if((address % MSC_PAGE_SIZE) == 0){
+      MSC->ADDRB = address;
+      MSC->WRITECMD = MSC_WRITECMD_LADDRIM;
+      MSC->WRITECMD = MSC_WRITECMD_ERASEPAGE;
+      while(MSC->STATUS & MSC_STATUS_BUSY);
+    }
+
+    MSC->ADDRB = address;
+    MSC->WRITECMD = MSC_WRITECMD_LADDRIM;
+
+    if(MSC->STATUS & (MSC_STATUS_LOCKED | MSC_STATUS_INVADDR)){
+      ret = -1;
+    } else {
+      MSC->WDATA = (uint32_t)buffer[i] | ((uint32_t)buffer[i+1] << 8) | ((uint32_t)buffer[i+2] << 16) | ((uint32_t)buffer[i+3] << 24);
+      MSC->WRITECMD = MSC_WRITECMD_WRITEONCE;
+      while(MSC->STATUS & MSC_STATUS_BUSY);
+    }
+  }
+
+  MSC->WRITECTRL &= ~MSC_WRITECTRL_WREN;
+  MSC->LOCK = 0;
+
+  return ret;
+}
+
+
+
+/**************** CORE / EMU *******************/
+
+/******************************************************************
+ *
+ * @breif core_IrqLock, core_IrqUnlock
+ *
+ * The M0+ has no exclusive access instructions, so anything shared with
+ * an interrupt handler goes under PRIMASK. Lock hands back the PRIMASK it
+ * found so the pair nests.
+ *
+ */
+
+int core_IrqLock(void){
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  return (int)primask;
+}
+
+int core_IrqUnlock(uint32_t primask){
+
+  __set_PRIMASK(primask);
   return 0;
 }
 
+//MPI_IRQ_* and ZG_IRQ_* line up
+int irq_Attach(void* host_ptr, uint32_t irq_source, int(*isr_fn)(), void* context){
 
+  if(irq_source >= MPI_IRQ_SOURCES){
+    return -1;
+  }
+  if(irq_source == MPI_IRQ_USART_TX){
+    usart_txc_hook.fn = NULL;
+    usart_txc_hook.context = context;
+    usart_txc_hook.fn = isr_fn;
+    return 0;
+  }
+  zg_IrqAttach(irq_source, isr_fn, context);
+  return 0;
+}
+
+/******************************************************************
+ *
+ * @breif emu_Data
+ *
+ * Sleep until the next interrupt, EM1 (mode 1) or EM2 (mode 2). 
+ *
+ * Called with PRIMASK set, WFI still returns on a pending interrupt and 
+ * the handler runs once the caller unmasks. EM2 stops HFXO and comes back
+ * on HFRCO, so HFXO is brought back up and reselected before returning
+ * if it was the HF clock going in.
+ *
+ */
 
+int emu_Data(void* host_ptr, uint32_t mode){
+
+  uint32_t hfxo = CMU->STATUS & CMU_STATUS_HFXOSEL;
+
+  if(mode == EMU_MODE_EM2){
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  } else {
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+  }
+
+  __DSB();
+  __WFI();
+
+  if(mode == EMU_MODE_EM2 && hfxo){
+    CMU->OSCENCMD = CMU_OSCENCMD_HFXOEN;
+    while(!(CMU->STATUS & CMU_STATUS_HFXORDY));
+    CMU->CMD = CMU_CMD_HFCLKSEL_HFXO;
+  }
+  return 0;
+}
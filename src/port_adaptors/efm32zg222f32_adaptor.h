@@ -11,6 +11,7 @@
 #include "efm32zg_gpio_HAL.h"
 #include "efm32zg_gpio_IO_HAL.h"
 #include "efm32zg_usart_HAL.h"
+#include "mpi_request.h"
 
 
 
@@ -21,6 +22,7 @@
 int cmu_Init(void* host_ptr);
 int cmu_ConfigReg(void* host_ptr, uint32_t config_register);
 int cmu_QueryReg(void* host_ptr, uint32_t config_register);
+uint32_t cmu_HfperclkHz(void);
 
 /**********************
  *      USART
@@ -31,6 +33,19 @@ int usart_ConfigReg(void* host_ptr, uint32_t config_register);
 int usart_QueryReg(void* host_ptr, uint32_t config_register);
 
 int usart_Data(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len);
+int usart_Baud(void* host_ptr, uint32_t baud);
+int usart_DataAsync(void* host_ptr, MPI_request* request);
+int usart_Select(void* host_ptr, uint32_t mode, uint32_t clock_hz, uint32_t cs_port, uint32_t cs_pin);
+int usart_Cs(void* host_ptr, uint32_t level);
+int usart_Transfer(void* host_ptr, uint32_t RW, uint8_t* header, uint32_t header_len, uint8_t* payload, uint32_t payload_len);
+
+#define USART_ASYNC_OVS     16
+#define USART_TX_DEPTH      3     //usart_Transfer() frames in flight, TX buffer (2) + shift register
+
+#ifndef USART_TRIGGER_TIMEOUT_US
+#define USART_TRIGGER_TIMEOUT_US    2000  //PRS trigger wait in usart_Transfer(), interrupts are off for it
+#endif
+#define USART_TRIGGER_POLL_CYCLES   8
 
 /*********************
  *      GPIO 
@@ -54,10 +69,47 @@ int gpio_Data(void* host_ptr, uint32_t RW, uint32_t port, uint16_t pin);
 #define TIMER_CMD_STOP EFM32ZG_TIMER_CMD_STOP
 #endif
 
+#ifndef TIMER_STATUS_RUNNING
+#define TIMER_STATUS_RUNNING EFM32ZG_TIMER_STATUS_RUNNING
+#endif
+
 
 int timer_Init(void* host_ptr);
 int timer_ConfigReg(void* host_ptr, uint32_t config_register);
 int timer_QueryReg(void* host_ptr, uint32_t config_register);
 int timer_Delay(uint32_t dlyTicks);
+int timer_Ticks(void);
+int timer_Now(void* host_ptr, uint64_t* now_ns);
+int timer_Capture(void* host_ptr, uint64_t* capture_ns);
+int timer_Stamp(uint32_t* stamp_hz);
+
+#define TIMER_NS_PER_S      1000000000ULL   //timer0 counts at HFPERCLK, cmu_HfperclkHz()
+
+/*********************
+ *      MSC 
+ *********************/
+
+/*
+ * Top 3KB of the 32KB flash is kept for device data (venus ephemeris), the
+ * linker script has to stop short of MSC_NVM_BASE.
+ */
+#define MSC_NVM_BASE        0x7400
+#define MSC_NVM_LEN         0x0C00
+#define MSC_PAGE_SIZE       1024
+#define MSC_UNLOCK          0x1B71
+
+int msc_Data(void* host_ptr, uint32_t RW, uint32_t offset, uint8_t* buffer, uint32_t buffer_len);
+
+/*********************
+ *    CORE / EMU 
+ *********************/
+
+int core_IrqLock(void);
+int core_IrqUnlock(uint32_t primask);
+int irq_Attach(void* host_ptr, uint32_t irq_source, int(*isr_fn)(), void* context);
+int emu_Data(void* host_ptr, uint32_t mode);
+
+#define EMU_MODE_EM1        1     //mpi_sched idle modes
+#define EMU_MODE_EM2        2
 
 #endif /* EFM32ZG_GLOBAL_HAL_H_ */
@@ -0,0 +1,205 @@
+#ifdef SPIDEV
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "mpi_port.h"
+#include "mpi_trace.h"
+
+#include "spidev_adaptor.h"
+
+/*
+ * Linux spidev as an MPI host, e.g. a raspberry pi straight onto the
+ * DW1000 with no usb bridge in the way.
+ *
+ * Every call is one SPI_IOC_MESSAGE ioctl, and one ioctl is one CS window.
+ * spidev_Transfer() sends a register header and its payload as two
+ * spi_ioc_transfer segments in that one ioctl, so the header and data
+ * share a CS window without being copied into one buffer first.
+ */
+
+int spidev_Message(SPIDEV_STATUS* spidev_status, SPIDEV_CONF* spidev_conf, struct spi_ioc_transfer* segment, uint32_t segments);
+
+//ioctl() is variadic, it can't go in an int(*)() slot as it is
+int spidev_Ioctl(int fd, unsigned long request, void* arg){
+
+  return ioctl(fd, request, arg);
+}
+
+int spidev_Init(void* host_object){
+
+  MPI_host* spidev_ptr = (MPI_host*)host_object;
+  SPIDEV_CONF* spidev_conf = (SPIDEV_CONF*)spidev_ptr->MPI_conf[SPIDEV_CONFIG_INDEX];
+  SPIDEV_STATUS* spidev_status = (SPIDEV_STATUS*)spidev_ptr->MPI_status[SPIDEV_STATUS_INDEX];
+
+  if(spidev_status->_ioctl == NULL){
+    spidev_status->_ioctl = spidev_Ioctl;
+  }
+
+  spidev_status->connected = 0;
+  spidev_status->fd = open(spidev_conf->device, O_RDWR);
+
+  if(spidev_status->fd < 0){
+    printf("spidev NOT connected on %s\n", spidev_conf->device);
+    return -1;
+  }
+
+  if(spidev_status->_ioctl(spidev_status->fd, SPI_IOC_WR_MODE, &spidev_conf->mode) < 0 ||
+     spidev_status->_ioctl(spidev_status->fd, SPI_IOC_WR_BITS_PER_WORD, &spidev_conf->bits_per_word) < 0 ||
+     spidev_status->_ioctl(spidev_status->fd, SPI_IOC_WR_MAX_SPEED_HZ, &spidev_conf->speed_hz) < 0){
+    printf("spidev %s would not take mode %u, %u bits, %u Hz\n", spidev_conf->device,
+           spidev_conf->mode, spidev_conf->bits_per_word, spidev_conf->speed_hz);
+    close(spidev_status->fd);
+    return -1;
+  }
+
+  spidev_status->connected = 1;
+  return EXIT_SUCCESS;
+}
+
+//what the driver actually settled on
+int spidev_RegDump(void* host_object){
+
+  MPI_host* spidev_ptr = (MPI_host*)host_object;
+  SPIDEV_CONF* spidev_conf = (SPIDEV_CONF*)spidev_ptr->MPI_conf[SPIDEV_CONFIG_INDEX];
+  SPIDEV_STATUS* spidev_status = (SPIDEV_STATUS*)spidev_ptr->MPI_status[SPIDEV_STATUS_INDEX];
+
+  uint8_t mode = 0, bits_per_word = 0;
+  uint32_t speed_hz = 0;
+
+  spidev_status->_ioctl(spidev_status->fd, SPI_IOC_RD_MODE, &mode);
+  spidev_status->_ioctl(spidev_status->fd, SPI_IOC_RD_BITS_PER_WORD, &bits_per_word);
+  spidev_status->_ioctl(spidev_status->fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed_hz);
+
+  printf("device: %s\n", spidev_conf->device);
+  printf("mode: %u\n", mode);
+  printf("bits per word: %u\n", bits_per_word);
+  printf("max speed: %u Hz\n", speed_hz);
+  printf("transfers: %u, errors: %u\n", spidev_status->transfers, spidev_status->errors);
+
+  return 0;
+}
+
+int spidev_Message(SPIDEV_STATUS* spidev_status, SPIDEV_CONF* spidev_conf, struct spi_ioc_transfer* segment, uint32_t segments){
+
+  //CS held across the segments, the delay only after the last
+  //
+  segment[segments -1].delay_usecs = spidev_conf->delay_usecs;
+  for(uint32_t i = 0; i < segments; i++){
+    segment[i].speed_hz = spidev_conf->speed_hz;
+  }
+
+  spidev_status->transfers++;
+  if(spidev_status->_ioctl(spidev_status->fd, SPI_IOC_MESSAGE(segments), segment) < 0){
+    spidev_status->errors++;
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Same contract as sd_Data(): READ/READ_WRITE clock the buffer out and
+ * MISO back into it in place, WRITE leaves the buffer alone.
+ */
+int spidev_Data(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len){
+
+  MPI_host* spidev_ptr = (MPI_host*)host_ptr;
+  SPIDEV_CONF* spidev_conf = (SPIDEV_CONF*)spidev_ptr->MPI_conf[SPIDEV_CONFIG_INDEX];
+  SPIDEV_STATUS* spidev_status = (SPIDEV_STATUS*)spidev_ptr->MPI_status[SPIDEV_STATUS_INDEX];
+
+  struct spi_ioc_transfer segment[1];
+  memset(segment, 0, sizeof(segment));
+
+  segment[0].tx_buf = (unsigned long)ext_dev_array;
+  segment[0].rx_buf = (RW == SPIDEV_WRITE ? 0 : (unsigned long)ext_dev_array);
+  segment[0].len = array_len;
+
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_DATA, array_len,
+                        spidev_Message(spidev_status, spidev_conf, segment, 1));
+}
+
+/*
+ * _usart_transfer: header out, then payload in (READ, MOSI held low), out
+ * (WRITE) or both (READ_WRITE), all in one CS window.
+ */
+int spidev_Transfer(void* host_ptr, uint32_t RW, uint8_t* header, uint32_t header_len, uint8_t* payload, uint32_t payload_len){
+
+  MPI_host* spidev_ptr = (MPI_host*)host_ptr;
+  SPIDEV_CONF* spidev_conf = (SPIDEV_CONF*)spidev_ptr->MPI_conf[SPIDEV_CONFIG_INDEX];
+  SPIDEV_STATUS* spidev_status = (SPIDEV_STATUS*)spidev_ptr->MPI_status[SPIDEV_STATUS_INDEX];
+
+  struct spi_ioc_transfer segment[SPIDEV_SEGMENTS];
+  memset(segment, 0, sizeof(segment));
+
+  segment[0].tx_buf = (unsigned long)header;
+  segment[0].len = header_len;
+
+  segment[1].tx_buf = (RW == SPIDEV_READ ? 0 : (unsigned long)payload);
+  segment[1].rx_buf = (RW == SPIDEV_WRITE ? 0 : (unsigned long)payload);
+  segment[1].len = payload_len;
+
+  return MPI_TRACE_CALL(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_TRANSFER, header_len + payload_len,
+                        spidev_Message(spidev_status, spidev_conf, segment, (payload_len ? SPIDEV_SEGMENTS : 1)));
+}
+
+/*
+ * _usart_select. The clock goes with each transfer, only a mode change
+ * costs an ioctl. CS belongs to the kernel, one per spidev node, so 
+ * cs_port/cs_pin are ignored.
+ */
+int spidev_Select(void* host_ptr, uint32_t mode, uint32_t clock_hz, uint32_t cs_port, uint32_t cs_pin){
+
+  MPI_host* spidev_ptr = (MPI_host*)host_ptr;
+  SPIDEV_CONF* spidev_conf = (SPIDEV_CONF*)spidev_ptr->MPI_conf[SPIDEV_CONFIG_INDEX];
+  SPIDEV_STATUS* spidev_status = (SPIDEV_STATUS*)spidev_ptr->MPI_status[SPIDEV_STATUS_INDEX];
+
+  uint8_t spi_mode = (spidev_conf->mode & ~(SPI_CPOL | SPI_CPHA)) | (mode & (SPI_CPOL | SPI_CPHA));
+
+  spidev_conf->speed_hz = clock_hz;
+  if(spi_mode == spidev_conf->mode){
+    return 0;
+  }
+  if(spidev_status->_ioctl(spidev_status->fd, SPI_IOC_WR_MODE, &spi_mode) < 0){
+    return -1;
+  }
+  spidev_conf->mode = spi_mode;
+  return 0;
+}
+
+/*
+ * _usart_data_async. The ioctl is the whole transfer, so the request is
+ * completed before this returns, callback included.
+ */
+int spidev_DataAsync(void* host_ptr, MPI_request* request){
+
+  mpi_requestComplete(request, spidev_Data(host_ptr, request->RW, request->buffer, request->buffer_len));
+  return 0;
+}
+
+//_timer_stamp, CLOCK_MONOTONIC in us
+int spidev_Stamp(uint32_t* stamp_hz){
+
+  struct timespec now;
+
+  if(stamp_hz != NULL){
+    *stamp_hz = 1000000;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int)(uint32_t)((now.tv_sec * 1000000) + (now.tv_nsec / 1000));
+}
+
+//mpi_traceDrain() writer, context is an open FILE*
+int spidev_TraceWrite(void* context, uint8_t* buffer, uint32_t buffer_len){
+
+  return (fwrite(buffer, 1, buffer_len, (FILE*)context) == buffer_len ? 0 : -1);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SPIDEV_ADAPTOR_H
+#define SPIDEV_ADAPTOR_H
+
+#include <stdint.h>
+
+#include "mpi_request.h"
+
+#define SPIDEV_CONFIG_INDEX   0
+#define SPIDEV_STATUS_INDEX   0
+
+#define SPIDEV_READ           0
+#define SPIDEV_WRITE          1
+#define SPIDEV_READ_WRITE     2
+
+#define SPIDEV_DEVICE_LEN     32
+#define SPIDEV_SEGMENTS       2       //header + payload, see spidev_Transfer()
+
+typedef struct {
+  char device[SPIDEV_DEVICE_LEN];     //e.g. "/dev/spidev0.0"
+  uint8_t mode;                       //SPI_MODE_0..3 (| SPI_CS_HIGH, SPI_NO_CS ...)
+  uint8_t bits_per_word;
+  uint32_t speed_hz;
+  uint16_t delay_usecs;               //after the last segment, before CS goes up
+}SPIDEV_CONF;
+
+/*
+ * _ioctl(fd, request, arg) defaults to the kernel's. A mock can be put in
+ * its place before spidev_Init() to run the adaptor with no spidev at all
+ * (tools/spidev).
+ */
+typedef struct {
+  int fd;
+  int connected;
+  int(*_ioctl)();
+  uint32_t transfers;
+  uint32_t errors;
+}SPIDEV_STATUS;
+
+int spidev_Init(void* host_object);
+int spidev_RegDump(void* host_object);
+int spidev_Data(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len);
+int spidev_Transfer(void* host_ptr, uint32_t RW, uint8_t* header, uint32_t header_len, uint8_t* payload, uint32_t payload_len);
+int spidev_DataAsync(void* host_ptr, MPI_request* request);
+int spidev_Select(void* host_ptr, uint32_t mode, uint32_t clock_hz, uint32_t cs_port, uint32_t cs_pin);
+int spidev_Ioctl(int fd, unsigned long request, void* arg);
+int spidev_Stamp(uint32_t* stamp_hz);
+int spidev_TraceWrite(void* context, uint8_t* buffer, uint32_t buffer_len);
+
+#endif
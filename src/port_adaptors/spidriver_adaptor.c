@@ -5,15 +5,14 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 
 #include "mpi_port.h"
+#include "mpi_trace.h"
 #include "spidriver.h"
 
 #include "spidriver_adaptor.h"
 
-void(* read_write_readwrite[READ_WRITE_RW])() = 
-{&spi_read, &spi_write, &spi_writeread};
-
 /*
 // UNUSED
 //void spi_seta(SPIDriver *sd, char v);
@@ -79,13 +78,18 @@ int sd_Init(void* host_object){
   SD_CONF* sd_conf = (SD_CONF*)spidriver_ptr->MPI_conf[SD_CONFIG_INDEX];  
   SPIDriver* sd_status = (SPIDriver*)spidriver_ptr->MPI_status[SD_STATUS_INDEX];
 
-  //spi_connect
-  spi_connect(sd_status, "/dev/ttyUSB0");
+  //spi_connect, to the usb dongle or anything else that speaks its protocol
+  //(tools/spidriver/sd_emu on a pty)
+  //
+  char port[sizeof(SD_DEV_DIR) + SD_PORT_LEN];
+  snprintf(port, sizeof(port), "%s%s", (sd_conf->port[0] == '/' ? "" : SD_DEV_DIR), sd_conf->port);
+
+  spi_connect(sd_status, port);
 
   if(sd_status->connected){
     printf("spi connected\n");
   } else {
-    printf("spi NOT connected\n");
+    printf("spi NOT connected on %s\n", port);
     return EXIT_SUCCESS;
   }
 
@@ -107,33 +111,194 @@ int sd_Init(void* host_object){
 
 }
 
+/*
+ * libspidriver turns one transfer into a usb round trip each for select, 
+ * every 64 bytes of data and unselect, and for a DW1000 register access 
+ * the round trips are the whole cost. Encode the lot into one buffer, 
+ * write() it once and read() back whatever the writereads clock in.
+ *
+ * READ/READ_WRITE clock the buffer out and MISO back into it in place, as
+ * spi_writeread() did. WRITE uses the write only command so there is 
+ * nothing to wait for.
+ */
+uint16_t sd_Crc(uint16_t crc, uint8_t* array, uint32_t array_len);
+
+uint32_t sd_Encode(uint8_t* batch, uint32_t RW, uint8_t* array, uint32_t array_len){
+
+  uint8_t command = (RW == SD_WRITE ? SD_CMD_WRITE : SD_CMD_WRITEREAD);
+  uint32_t batch_len = 0;
+
+  for(uint32_t i = 0; i < array_len; i += SD_CMD_DATA_MAX){
+    uint32_t len = ((array_len - i) < SD_CMD_DATA_MAX ? (array_len - i) : SD_CMD_DATA_MAX);
+
+    batch[batch_len++] = command + (len -1);
+    memcpy(&batch[batch_len], &array[i], len);
+    batch_len += len;
+  }
+  return batch_len;
+}
+
+//write()/read() until it's all gone through, the tty hands back what it has
+int sd_Serial(int fd, uint32_t RW, uint8_t* buffer, uint32_t buffer_len){
+
+  uint32_t done = 0;
+
+  while(done < buffer_len){
+    ssize_t ret = (RW == SD_WRITE ? write(fd, &buffer[done], buffer_len - done) : read(fd, &buffer[done], buffer_len - done));
+    if(ret <= 0){
+      return -1;
+    }
+    done += ret;
+  }
+  return 0;
+}
+
+uint16_t sd_Crc(uint16_t crc, uint8_t* array, uint32_t array_len){
+
+  for(uint32_t i = 0; i < array_len; i++){
+    crc ^= (array[i] << 8);
+    for(int bit = 0; bit < 8; bit++){
+      crc = (crc & 0x8000 ? (crc << 1) ^ SD_CRC_POLY : (crc << 1));
+    }
+  }
+  return crc;
+}
+
+/*
+ * Keep the host side crc in step with the SPIDriver's for sd_RegDump(). 
+ * Like libspidriver, each command covers what went out (from the encoded
+ * batch, array has been read over by now) then what came back.
+ */
+void sd_CrcUpdate(SPIDriver* sd_status, uint32_t RW, uint8_t* encoded, uint8_t* array, uint32_t array_len){
+
+  uint16_t crc = sd_status->e_ccitt_crc;
+
+  for(uint32_t i = 0; i < array_len; i += SD_CMD_DATA_MAX){
+    uint32_t len = ((array_len - i) < SD_CMD_DATA_MAX ? (array_len - i) : SD_CMD_DATA_MAX);
+
+    encoded++;
+    crc = sd_Crc(crc, encoded, len);
+    encoded += len;
+
+    if(RW != SD_WRITE){
+      crc = sd_Crc(crc, &array[i], len);
+    }
+  }
+  sd_status->e_ccitt_crc = crc;
+}
+
 int sd_Data(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len){
 
   MPI_host* spidriver_ptr = (MPI_host*)host_ptr;
-  SD_DATA* sd_data = (SD_DATA*)spidriver_ptr->MPI_data[SD_DATA_INDEX];  
   SPIDriver* sd_status = (SPIDriver*)spidriver_ptr->MPI_status[SD_STATUS_INDEX];
 
-  // spi_sel
-  spi_sel(sd_status);
+  uint8_t* array = (uint8_t*)ext_dev_array;
+  static uint8_t batch[SD_BATCH_MAX];
+
+#if SD_DEBUG
+  SD_LOG("output: ");
+  for(uint32_t i = 0; i < array_len; i++){
+    SD_LOG("%02hhX ", array[i]);
+  }
+  SD_LOG("\n");
+#endif
+
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_DATA, array_len, 0);
+
+  //CS stays down across batches, only the first selects and the last unselects
+  //
+  uint32_t offset = 0;
+  do {
+    uint32_t len = ((array_len - offset) < SD_BATCH_DATA_MAX ? (array_len - offset) : SD_BATCH_DATA_MAX);
+    uint32_t batch_len = 0;
+
+    if(offset == 0){
+      batch[batch_len++] = SD_CMD_SEL;
+    }
+    batch_len += sd_Encode(&batch[batch_len], RW, &array[offset], len);
+    if((offset + len) == array_len){
+      batch[batch_len++] = SD_CMD_UNSEL;
+    }
+
+    if(sd_Serial(sd_status->port, SD_WRITE, batch, batch_len) != 0 ||
+       (RW != SD_WRITE && sd_Serial(sd_status->port, SD_READ, &array[offset], len) != 0)){
+      MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_DATA | MPI_TRACE_EXIT, array_len, -1);
+      return -1;
+    }
+    sd_CrcUpdate(sd_status, RW, &batch[offset == 0], &array[offset], len);
+
+    offset += len;
+  } while(offset < array_len);
+
+  sd_status->cs = 1;
+  MPI_TRACE_EVENT(MPI_TRACE_LAYER_ADAPTOR, host_ptr, MPI_TRACE_OP_DATA | MPI_TRACE_EXIT, array_len, 0);
+
+#if SD_DEBUG
+  if(RW != SD_WRITE){
+    SD_LOG("input: ");
+    for(uint32_t i = 0; i < array_len; i++){
+      SD_LOG("%02hhX ", array[i]);
+    }
+    SD_LOG("\n");
+  }
+#endif
+
+  return 0;
+}
+
+
+/*
+ * Host side nvm (_mcs_data) for the linux build, backed by SD_NVM_PATH.
+ * Same contract as flash on the efm32: reads of anything never written 
+ * come back zeroed, which the device layers take as empty.
+ */
+int sd_Nvm(void* host_ptr, uint32_t RW, uint32_t offset, uint8_t* buffer, uint32_t buffer_len){
+
+  FILE* nvm = fopen(SD_NVM_PATH, "r+b");
 
-  // store read_write_readwrite
-  void(*rw)() = read_write_readwrite[SD_READ_WRITE];
+  if(nvm == NULL && RW == SD_WRITE){
+    nvm = fopen(SD_NVM_PATH, "w+b");
+  }
+  if(RW == SD_READ){
+    memset(buffer, 0, buffer_len);
+  }
+  if(nvm == NULL){
+    return (RW == SD_READ ? 0 : -1);
+  }
 
-  char * array = (char*)ext_dev_array;
+  int ret = 0;
 
-  printf("output: ");
-  for(int i = 0; i < array_len; i++){
-    printf("%02hhX ", array[i]);
+  if(fseek(nvm, offset, SEEK_SET) != 0){
+    ret = -1;
+  } else if(RW == SD_READ){
+    fread(buffer, 1, buffer_len, nvm);
+  } else if(fwrite(buffer, 1, buffer_len, nvm) != buffer_len){
+    ret = -1;
   }
-  printf("\n");
-  
-  // call rw
-  rw(sd_status, (char*)ext_dev_array, array_len);
 
-  //spi_unsel
-  spi_unsel(sd_status);
+  if(fclose(nvm) != 0){
+    ret = -1;
+  }
+  return ret;
+}
 
-  return 0;
+//_timer_stamp, CLOCK_MONOTONIC in us
+int sd_Stamp(uint32_t* stamp_hz){
 
+  struct timespec now;
+
+  if(stamp_hz != NULL){
+    *stamp_hz = 1000000;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int)(uint32_t)((now.tv_sec * 1000000) + (now.tv_nsec / 1000));
 }
 
+/*
+ * mpi_traceDrain() writer, context is an open FILE* (tools/trace decodes
+ * it). Goes for the emulator (tools/spidriver) as well as the dongle.
+ */
+int sd_TraceWrite(void* context, uint8_t* buffer, uint32_t buffer_len){
+
+  return (fwrite(buffer, 1, buffer_len, (FILE*)context) == buffer_len ? 0 : -1);
+}
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "spidriver.h"
+
 #define SD_CONFIG_INDEX 0
 #define SD_STATUS_INDEX 0
 #define SD_DATA_INDEX   0
@@ -11,17 +13,52 @@
 #define SD_WRITE        1
 #define SD_READ_WRITE   2
 
+#define SD_NVM_PATH     "theseus.nvm"
+
+#define SD_PORT_LEN     32        //SD_CONF.port, a name under SD_DEV_DIR or an absolute path (pty)
+#define SD_DEV_DIR      "/dev/"
+
+/*
+ * SPIDriver command bytes, one transaction is 
+ * SD_CMD_SEL, (SD_CMD_WRITE | SD_CMD_WRITEREAD) + n-1 <n bytes>..., SD_CMD_UNSEL
+ */
+#define SD_CMD_SEL          's'
+#define SD_CMD_UNSEL        'u'
+#define SD_CMD_WRITEREAD    0x80    //+ len-1, clocks back len bytes
+#define SD_CMD_WRITE        0xC0    //+ len-1, nothing comes back
+#define SD_CMD_DATA_MAX     64
+
+#define SD_BATCH_DATA_MAX   1024    //DW1000 tx/rx buffer, longer transfers go in several writes
+#define SD_BATCH_MAX        (SD_BATCH_DATA_MAX + (SD_BATCH_DATA_MAX / SD_CMD_DATA_MAX) + 2)
+
+#define SD_CRC_POLY         0x1021  //CCITT, what the SPIDriver runs over MOSI
+
+//build with '-DSD_DEBUG=1' to dump every transfer
+#if SD_DEBUG
+#define SD_LOG(...)         printf(__VA_ARGS__)
+#else
+#define SD_LOG(...)
+#endif
+
 typedef struct {
     char rxtx[8];
 }SD_DATA;
 
 typedef struct {
-    const char port[8];
+    char port[SD_PORT_LEN];
 }SD_CONF;
 
 //ext_dev_object of type SPIDriver*
 int sd_Init(void* host_object);
 int sd_Data(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len);
 int sd_RegDump(void* host_object);
+int sd_Nvm(void* host_ptr, uint32_t RW, uint32_t offset, uint8_t* buffer, uint32_t buffer_len);
+int sd_Stamp(uint32_t* stamp_hz);
+int sd_TraceWrite(void* context, uint8_t* buffer, uint32_t buffer_len);
+
+//sd_Data() internals, shared with the async backend (spidriver_async.c)
+uint32_t sd_Encode(uint8_t* batch, uint32_t RW, uint8_t* array, uint32_t array_len);
+int sd_Serial(int fd, uint32_t RW, uint8_t* buffer, uint32_t buffer_len);
+void sd_CrcUpdate(SPIDriver* sd_status, uint32_t RW, uint8_t* encoded, uint8_t* array, uint32_t array_len);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,301 @@
+#ifdef SPIDRIVER
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+
+#include "mpi_port.h"
+#include "spidriver.h"
+
+#include "spidriver_adaptor.h"
+#include "spidriver_async.h"
+
+/*
+ * Asynchronous sd_Data() for the linux host.
+ *
+ * Once sd_AsyncInit() has run, one I/O thread owns the tty. Callers queue
+ * SD_REQUESTs from any thread without taking a lock and carry on; the
+ * request completes through its callback or sd_AsyncWait().
+ *
+ * Whatever has queued up by the time the thread gets to it goes out
+ * together: up to SD_ASYNC_BATCH transactions, each still its own
+ * sel ... unsel, in one write() and one read back. So with several in
+ * flight the usb latency is paid per batch rather than per transfer, and
+ * the caller decodes one frame while the next is on the wire.
+ *
+ * Don't mix sd_Data() calls in once the thread is running, queue through
+ * sd_DataQueued() instead, which has the same signature for _usart_data.
+ */
+
+void sd_asyncPush(SD_ASYNC* async, SD_REQUEST* request);
+SD_REQUEST* sd_asyncPop(SD_ASYNC* async);
+void sd_asyncComplete(SD_ASYNC* async, SD_REQUEST* request, int status);
+int sd_asyncFits(SD_ASYNC* async, SD_REQUEST* request);
+void sd_asyncAdd(SD_ASYNC* async, SD_REQUEST* request);
+void sd_asyncFlush(void* host_object, SD_ASYNC* async);
+void* sd_asyncThread(void* host_object);
+
+/*
+ * Vyukov's intrusive MPSC queue. A push is one exchange and one store,
+ * the pop side is the I/O thread alone. stub keeps the queue from ever
+ * being empty, so head and tail never need updating together.
+ */
+void sd_asyncPush(SD_ASYNC* async, SD_REQUEST* request){
+
+  atomic_store_explicit(&request->next, NULL, memory_order_relaxed);
+  SD_REQUEST* prev = atomic_exchange_explicit(&async->head, request, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, request, memory_order_release);
+}
+
+//NULL if empty, or if a producer is between its exchange and its store
+SD_REQUEST* sd_asyncPop(SD_ASYNC* async){
+
+  SD_REQUEST* tail = async->tail;
+  SD_REQUEST* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+  if(tail == &async->stub){
+    if(next == NULL){
+      return NULL;
+    }
+    async->tail = next;
+    tail = next;
+    next = atomic_load_explicit(&next->next, memory_order_acquire);
+  }
+  if(next != NULL){
+    async->tail = next;
+    return tail;
+  }
+  if(tail != atomic_load_explicit(&async->head, memory_order_acquire)){
+    return NULL;
+  }
+  sd_asyncPush(async, &async->stub);
+
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if(next != NULL){
+    async->tail = next;
+    return tail;
+  }
+  return NULL;
+}
+
+void sd_asyncComplete(SD_ASYNC* async, SD_REQUEST* request, int status){
+
+  async->completed++;
+
+  //callback first, the request may be reused the moment status changes
+  //
+  if(request->callback != NULL){
+    request->callback(request->context, request, status);
+  }
+  atomic_store_explicit(&request->status, (status == 0 ? SD_REQ_DONE : SD_REQ_ERROR), memory_order_release);
+
+  pthread_mutex_lock(&async->done_lock);
+  pthread_cond_broadcast(&async->done_cond);
+  pthread_mutex_unlock(&async->done_lock);
+}
+
+int sd_asyncFits(SD_ASYNC* async, SD_REQUEST* request){
+
+  uint32_t commands = (request->buffer_len + SD_CMD_DATA_MAX -1) / SD_CMD_DATA_MAX;
+
+  return (request->RW != SD_ASYNC_STOP && request->buffer_len <= SD_BATCH_DATA_MAX &&
+          async->batch_count < SD_ASYNC_BATCH &&
+          (async->batch_len + request->buffer_len + commands + 2) <= SD_BATCH_MAX);
+}
+
+void sd_asyncAdd(SD_ASYNC* async, SD_REQUEST* request){
+
+  uint8_t* encoded = async->encoded;
+
+  encoded[async->batch_len++] = SD_CMD_SEL;
+  async->batch_offset[async->batch_count] = async->batch_len;
+  async->batch_len += sd_Encode(&encoded[async->batch_len], request->RW, request->buffer, request->buffer_len);
+  encoded[async->batch_len++] = SD_CMD_UNSEL;
+
+  async->batch[async->batch_count++] = request;
+}
+
+//one write for the whole batch, then the writereads come back in order
+void sd_asyncFlush(void* host_object, SD_ASYNC* async){
+
+  MPI_host* spidriver_ptr = (MPI_host*)host_object;
+  SPIDriver* sd_status = (SPIDriver*)spidriver_ptr->MPI_status[SD_STATUS_INDEX];
+
+  int status = sd_Serial(sd_status->port, SD_WRITE, async->encoded, async->batch_len);
+  async->round_trips++;
+
+  for(uint32_t i = 0; i < async->batch_count; i++){
+    SD_REQUEST* request = async->batch[i];
+
+    if(status == 0 && request->RW != SD_WRITE){
+      status = sd_Serial(sd_status->port, SD_READ, request->buffer, request->buffer_len);
+    }
+    if(status == 0){
+      sd_CrcUpdate(sd_status, request->RW, &async->encoded[async->batch_offset[i]], request->buffer, request->buffer_len);
+    }
+    sd_asyncComplete(async, request, status);
+  }
+
+  async->batch_count = 0;
+  async->batch_len = 0;
+}
+
+void* sd_asyncThread(void* host_object){
+
+  MPI_host* spidriver_ptr = (MPI_host*)host_object;
+  SD_ASYNC* async = (SD_ASYNC*)spidriver_ptr->MPI_data[SD_ASYNC_INDEX];
+  SD_REQUEST* request = NULL;
+
+  for(;;){
+
+    //a post only follows a finished push, so a pop that comes back empty
+    //is another producer still mid-push, ours is right behind it
+    //
+    if(request == NULL){
+      sem_wait(&async->pending);
+      while((request = sd_asyncPop(async)) == NULL){
+        sched_yield();
+      }
+    }
+
+    if(request->RW == SD_ASYNC_STOP){
+      sd_asyncComplete(async, request, 0);
+      return NULL;
+    }
+
+    //too big to share a batch, it takes the plain path on its own
+    //
+    if(request->buffer_len > SD_BATCH_DATA_MAX){
+      sd_asyncComplete(async, request, sd_Data(host_object, request->RW, request->buffer, request->buffer_len));
+      async->round_trips++;
+      request = NULL;
+      continue;
+    }
+
+    //take everything else already queued that fits, anything that doesn't
+    //is carried into the next pass
+    //
+    while(request != NULL && sd_asyncFits(async, request)){
+      sd_asyncAdd(async, request);
+
+      request = NULL;
+      if(sem_trywait(&async->pending) == 0){
+        while((request = sd_asyncPop(async)) == NULL){
+          sched_yield();
+        }
+      }
+    }
+    sd_asyncFlush(host_object, async);
+  }
+}
+
+//after sd_Init(), the tty belongs to the I/O thread from here
+int sd_AsyncInit(void* host_object){
+
+  MPI_host* spidriver_ptr = (MPI_host*)host_object;
+  SD_ASYNC* async = (SD_ASYNC*)spidriver_ptr->MPI_data[SD_ASYNC_INDEX];
+  SPIDriver* sd_status = (SPIDriver*)spidriver_ptr->MPI_status[SD_STATUS_INDEX];
+
+  if(async == NULL || async->running || !sd_status->connected){
+    return -1;
+  }
+
+  atomic_store(&async->stub.next, NULL);
+  atomic_store(&async->head, &async->stub);
+  async->tail = &async->stub;
+  async->batch_count = 0;
+  async->batch_len = 0;
+
+  if(sem_init(&async->pending, 0, 0) != 0){
+    return -1;
+  }
+  pthread_mutex_init(&async->done_lock, NULL);
+  pthread_cond_init(&async->done_cond, NULL);
+
+  if(pthread_create(&async->thread, NULL, sd_asyncThread, host_object) != 0){
+    return -1;
+  }
+  async->running = 1;
+  return EXIT_SUCCESS;
+}
+
+//everything queued before the stop still goes out
+int sd_AsyncStop(void* host_object){
+
+  MPI_host* spidriver_ptr = (MPI_host*)host_object;
+  SD_ASYNC* async = (SD_ASYNC*)spidriver_ptr->MPI_data[SD_ASYNC_INDEX];
+  SD_REQUEST stop;
+
+  if(async == NULL || !async->running){
+    return -1;
+  }
+
+  sd_Request(&stop, SD_ASYNC_STOP, NULL, 0, NULL, NULL);
+  sd_DataAsync(host_object, &stop);
+  pthread_join(async->thread, NULL);
+
+  async->running = 0;
+  sem_destroy(&async->pending);
+  pthread_mutex_destroy(&async->done_lock);
+  pthread_cond_destroy(&async->done_cond);
+  return EXIT_SUCCESS;
+}
+
+void sd_Request(SD_REQUEST* request, uint32_t RW, void* buffer, uint32_t buffer_len, int(*callback)(), void* context){
+
+  atomic_store_explicit(&request->status, SD_REQ_DONE, memory_order_relaxed);
+  request->RW = RW;
+  request->buffer = (uint8_t*)buffer;
+  request->buffer_len = buffer_len;
+  request->callback = callback;
+  request->context = context;
+}
+
+int sd_DataAsync(void* host_ptr, SD_REQUEST* request){
+
+  MPI_host* spidriver_ptr = (MPI_host*)host_ptr;
+  SD_ASYNC* async = (SD_ASYNC*)spidriver_ptr->MPI_data[SD_ASYNC_INDEX];
+
+  if(async == NULL || (!async->running && request->RW != SD_ASYNC_STOP)){
+    return -1;
+  }
+
+  atomic_store_explicit(&request->status, SD_REQ_PENDING, memory_order_relaxed);
+  sd_asyncPush(async, request);
+  sem_post(&async->pending);
+  return EXIT_SUCCESS;
+}
+
+int sd_AsyncWait(void* host_ptr, SD_REQUEST* request){
+
+  MPI_host* spidriver_ptr = (MPI_host*)host_ptr;
+  SD_ASYNC* async = (SD_ASYNC*)spidriver_ptr->MPI_data[SD_ASYNC_INDEX];
+
+  if(atomic_load_explicit(&request->status, memory_order_acquire) == SD_REQ_PENDING){
+    pthread_mutex_lock(&async->done_lock);
+    while(atomic_load_explicit(&request->status, memory_order_acquire) == SD_REQ_PENDING){
+      pthread_cond_wait(&async->done_cond, &async->done_lock);
+    }
+    pthread_mutex_unlock(&async->done_lock);
+  }
+  return (atomic_load_explicit(&request->status, memory_order_acquire) == SD_REQ_DONE ? 0 : -1);
+}
+
+//sd_Data() shaped, for _usart_data while the I/O thread is running
+int sd_DataQueued(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len){
+
+  SD_REQUEST request;
+
+  sd_Request(&request, RW, ext_dev_array, array_len, NULL, NULL);
+  if(sd_DataAsync(host_ptr, &request) != 0){
+    return -1;
+  }
+  return sd_AsyncWait(host_ptr, &request);
+}
+
+#endif
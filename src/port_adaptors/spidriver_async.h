@@ -0,0 +1,74 @@
+#ifndef SPIDRIVER_ASYNC_H
+#define SPIDRIVER_ASYNC_H
+
+#ifdef SPIDRIVER
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "spidriver_adaptor.h"
+
+#define SD_ASYNC_INDEX      1       //MPI_host.MPI_data slot for the SD_ASYNC
+
+#define SD_ASYNC_BATCH      16      //transactions coalesced into one usb round trip
+#define SD_ASYNC_STOP       0xFF    //request RW that ends the I/O thread
+
+#define SD_REQ_PENDING      1
+#define SD_REQ_DONE         0
+#define SD_REQ_ERROR        -1
+
+/*
+ * One sd_Data() transaction. Filled by sd_Request(), owned by the I/O
+ * thread from sd_DataAsync() until status leaves SD_REQ_PENDING.
+ *
+ * int callback(void* context, SD_REQUEST* request, int status) runs on
+ * the I/O thread, keep it short. buffer is read back into in place, as
+ * sd_Data().
+ */
+typedef struct SD_REQUEST{
+  _Atomic(struct SD_REQUEST*) next;
+  _Atomic int status;
+  uint32_t RW;
+  uint8_t* buffer;
+  uint32_t buffer_len;
+  int(*callback)();
+  void* context;
+}SD_REQUEST;
+
+typedef struct {
+  pthread_t thread;
+  int running;
+  sem_t pending;                            //one post per queued request
+
+  //intrusive MPSC queue, producers swap in at head, the I/O thread pops at tail
+  _Atomic(SD_REQUEST*) head;
+  SD_REQUEST* tail;
+  SD_REQUEST stub;
+
+  //sd_AsyncWait() sleeps here, the queue itself takes no lock
+  pthread_mutex_t done_lock;
+  pthread_cond_t done_cond;
+
+  //I/O thread only
+  SD_REQUEST* batch[SD_ASYNC_BATCH];
+  uint32_t batch_offset[SD_ASYNC_BATCH];    //each request's commands in encoded
+  uint32_t batch_count;
+  uint32_t batch_len;
+  uint8_t encoded[SD_BATCH_MAX];
+
+  uint32_t round_trips;
+  uint32_t completed;
+}SD_ASYNC;
+
+int sd_AsyncInit(void* host_object);
+int sd_AsyncStop(void* host_object);
+void sd_Request(SD_REQUEST* request, uint32_t RW, void* buffer, uint32_t buffer_len, int(*callback)(), void* context);
+int sd_DataAsync(void* host_ptr, SD_REQUEST* request);
+int sd_AsyncWait(void* host_ptr, SD_REQUEST* request);
+int sd_DataQueued(void* host_ptr, uint32_t RW, void* ext_dev_array, uint32_t array_len);
+
+#endif
+
+#endif
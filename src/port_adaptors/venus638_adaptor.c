@@ -16,12 +16,16 @@
  *
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "mpi_port.h"
 #include "mpi_types.h"
 
+#include "mpi_time.h"
+
 #include "venus638.h"
+#include "venus638_binary.h"
 #include "venus638_adaptor.h"
 
 /**********************************************************
@@ -32,40 +36,347 @@
  *********************************************************/
 
 
-int venus638_Init(void* host_object, int(*host_usart)(), void* ext_dev_object){
+/*
+ * Find the rate the receiver is at, move it to config_serial_port_baud and
+ * retune the host to match.
+ *
+ *  - probe: query the software version at each rate (the target first, 
+ *    then highest to lowest) until something ACKs or NACKs
+ *  - configure serial port, the ACK comes back at the old rate
+ *  - retune the host usart, verify with another query
+ *
+ * If the verify fails the host goes back to the rate we found. Hosts without
+ * a _usart_baud hook stay at whatever their usart was configured for.
+ */
+int venus638_Baud(void* host_object, int(*host_usart)(), void* ext_dev_object){
 
+  MPI_host* host_ptr = (MPI_host*)host_object;
   MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
   VENUS_message_io* venus_message = (VENUS_message_io*)venus_object->MPI_data[VENUS_MESSAGE_INDEX];
+  VENUS_config* venus_config = (VENUS_config*)venus_object->MPI_conf[VENUS_CONFIG_INDEX];
 
-  int(* venus_data)() = venus638_rx_tx_table[WRITE];
+  int_callback host_usart_baud = host_ptr->_periph_periphconf._usart_baud;
+  uint32_t target = venus_config->config_serial_port_baud;
+  int current = -1;
+
+  if(host_usart_baud == NULL){
+    return EXIT_SUCCESS;
+  }
+  if(target >= VENUS_BAUD_CODES){
+    return -1;
+  }
+
+  for(int i = 0; i <= VENUS_BAUD_CODES && current < 0; i++){
+    uint32_t code = (i == 0 ? target : VENUS_BAUD_CODES - i);
+    if(i > 0 && code == target){
+      continue;
+    }
+    host_usart_baud(host_object, venus_baud_rate_table[code]);
+
+    venus_message->message_id = ID_QUERY_SW_REV;
+    if(venus_commandReply(host_object, host_usart, ext_dev_object) != VENUS_REPLY_NONE){
+      current = code;
+    }
+  }
+
+  if(current < 0){
+    return -1;
+  }
+  if(current == target){
+    return EXIT_SUCCESS;
+  }
 
-  for(int i = 0; i < 11; i++){
-      venus_message->message_id = venus_query_lookup_table[i]; 
-      venus_data(host_object, host_usart, ext_dev_object); 
-      int(* venus_data)() = venus638_rx_tx_table[READ];
-      venus_data(host_object, host_usart, ext_dev_object); 
+  venus_message->message_id = ID_CONFIG_SERIAL_PORT;
+  if(venus_commandReply(host_object, host_usart, ext_dev_object) != VENUS_REPLY_ACK){
+    return -1;
   }
 
+  host_usart_baud(host_object, venus_baud_rate_table[target]);
+
+  venus_message->message_id = ID_QUERY_SW_REV;
+  if(venus_commandReply(host_object, host_usart, ext_dev_object) == VENUS_REPLY_NONE){
+    host_usart_baud(host_object, venus_baud_rate_table[current]);
+    return -1;
+  }
   return EXIT_SUCCESS;
 }
 
-int venus638_RegDump(void* host_object, int(*host_usart)(), void* ext_dev_object){
+/*
+ * What init pushes down once the link is up, and what regdump reads back.
+ * Serial port is venus638_Baud()'s job. Datum and pinning parameters still
+ * need the datasheet encodings before they can go out, ephemeris has its own
+ * store/restore.
+ */
+const register_enum venus_init_sequence[VENUS_INIT_SEQUENCE_LEN] = {
+  config_nmea,
+  config_message,
+  config_sys_pwr,
+  config_update_rate,
+  config_waas,
+  config_pos_pin,
+  config_nav_mode,
+  config_1pps_mode
+};
+
+const register_enum venus_reg_dump_sequence[VENUS_REG_DUMP_SEQUENCE_LEN] = {
+  query_sw_rev,
+  query_sw_crc,
+  query_update_rate,
+  query_datum,
+  query_waas,
+  query_pos_pin,
+  query_nav_mode,
+  query_1pps_mode
+};
+
+/*
+ * Queue the whole sequence and let the pipeline put it on the wire, rather 
+ * than send-wait-read one register at a time.
+ */
+int venus638_Sequence(void* host_object, int(*host_usart)(), void* ext_dev_object, const register_enum* sequence, uint32_t sequence_len){
 
   MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
-  VENUS_message_io* venus_message = (VENUS_message_io*)venus_object->MPI_data[VENUS_MESSAGE_INDEX];
+  VENUS_pipeline* venus_pipeline = (VENUS_pipeline*)venus_object->MPI_data[VENUS_PIPELINE_INDEX];
 
-  int(* venus_data)() = venus638_rx_tx_table[WRITE];
+  if(venus_pipeline == NULL){
+    return -1;
+  }
 
-  for(int i = 0; i < 11; i++){
-      venus_message->message_id = venus_query_lookup_table[i]; 
-      venus_data(host_object, host_usart, ext_dev_object); 
-      int(* venus_data)() = venus638_rx_tx_table[READ];
-      venus_data(host_object, host_usart, ext_dev_object); 
+  venus_pipelineReset(venus_pipeline);
+
+  for(uint32_t i = 0; i < sequence_len; i++){
+    uint8_t message_id = venus_query_lookup_table[sequence[i]];
+    if(venus_pipelineQueue(venus_pipeline, message_id, venus_query_desc_table[message_id].response_id) != 0){
+      return -1;
+    }
   }
 
+  return venus_pipelineRun(host_object, host_usart, ext_dev_object);
+}
+
+/*
+ * Ephemeris store/restore (AGPS) through the host's nvm hook, _mcs_data.
+ *
+ * One EPH_RECORD_LEN slot per SV from VENUS_EPH_NVM_OFFSET, slot n holding
+ * SV n+1. A slot only counts if its SV id matches, so erased flash (0xFF) 
+ * and never written file space (zeros) both read back as empty. 
+ *
+ * Ephemeris is good for about 4 hours, nothing here checks its age. Store 
+ * while tracking (before power down, or periodically) and restore at boot.
+ */
+int venus638_EphValid(VENUS_eph_record* eph, uint32_t sv);
+
+int venus638_EphValid(VENUS_eph_record* eph, uint32_t sv){
+
+  if(((eph->sv_id[0] << SINGLE_BYTE_SHIFT) | eph->sv_id[1]) != sv){
+    return 0;
+  }
+  for(int i = 0; i < EPH_SUB_FRAMES; i++){
+    for(int j = 0; j < EPH_SUB_FRAME_DATA_LEN; j++){
+      if(eph->sfd[i][j] != 0){
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+ * Pull each SV's ephemeris one get-eph at a time and write it straight out,
+ * so only one record is ever held. Every slot is rewritten in order (SVs 
+ * without ephemeris as empty slots), which is what flash wants.
+ */
+int venus638_EphStore(void* host_object, int(*host_usart)(), void* ext_dev_object){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+  VENUS_response_store* venus_response = (VENUS_response_store*)venus_object->MPI_data[VENUS_RESPONSE_INDEX];
+  VENUS_pipeline* venus_pipeline = (VENUS_pipeline*)venus_object->MPI_data[VENUS_PIPELINE_INDEX];
+  VENUS_config* venus_config = (VENUS_config*)venus_object->MPI_conf[VENUS_CONFIG_INDEX];
+
+  int_callback host_nvm = (host_ptr != NULL ? host_ptr->_core_periphconf._mcs_data : NULL);
+  VENUS_eph_record* eph = &venus_response->eph;
+
+  if(host_nvm == NULL || venus_pipeline == NULL){
+    return -1;
+  }
+
+  for(uint32_t sv = 1; sv <= EPH_SV_COUNT; sv++){
+
+    eph->sv_id[0] = 0;
+    eph->sv_id[1] = 0;
+    venus_config->config_get_eph_data_sv = sv;
+
+    venus_pipelineReset(venus_pipeline);
+    venus_pipelineQueue(venus_pipeline, ID_EPH_DATA_GET, RES_ID_GET_EPH_DATA);
+
+    //receiver gone quiet, leave the rest of what's stored alone
+    //
+    if(venus_pipelineRun(host_object, host_usart, ext_dev_object) != EXIT_SUCCESS){
+      return -1;
+    }
+
+    if(!venus638_EphValid(eph, sv)){
+      for(uint32_t i = 0; i < EPH_RECORD_LEN; i++){
+        ((uint8_t*)eph)[i] = 0;
+      }
+    }
+
+    if(host_nvm(host_object, WRITE, VENUS_EPH_NVM_OFFSET + ((sv - 1) * EPH_RECORD_LEN), (uint8_t*)eph, EPH_RECORD_LEN) != 0){
+      return -1;
+    }
+  }
   return EXIT_SUCCESS;
 }
 
+/*
+ * Stream stored ephemeris back with set-eph. Flow controlled by the ACK: 
+ * the next record only goes out once the last one is answered, the 
+ * receiver can't take 32 of them back to back. A NACKed or lost record 
+ * doesn't stop the rest.
+ */
+int venus638_EphRestore(void* host_object, int(*host_usart)(), void* ext_dev_object){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+  VENUS_pipeline* venus_pipeline = (VENUS_pipeline*)venus_object->MPI_data[VENUS_PIPELINE_INDEX];
+  VENUS_config* venus_config = (VENUS_config*)venus_object->MPI_conf[VENUS_CONFIG_INDEX];
+
+  int_callback host_nvm = (host_ptr != NULL ? host_ptr->_core_periphconf._mcs_data : NULL);
+  VENUS_eph_record eph;
+  int ret = EXIT_SUCCESS;
+
+  if(host_nvm == NULL || venus_pipeline == NULL){
+    return -1;
+  }
+
+  for(uint32_t sv = 1; sv <= EPH_SV_COUNT; sv++){
+
+    if(host_nvm(host_object, READ, VENUS_EPH_NVM_OFFSET + ((sv - 1) * EPH_RECORD_LEN), (uint8_t*)&eph, EPH_RECORD_LEN) != 0){
+      return -1;
+    }
+    if(!venus638_EphValid(&eph, sv)){
+      continue;
+    }
+
+    venus_config->config_set_eph_data_sv = sv;
+    for(int i = 0; i < EPH_SUB_FRAMES; i++){
+      for(int j = 0; j < EPH_SUB_FRAME_DATA_LEN; j++){
+        venus_config->config_set_eph_data_sfd[i][j] = eph.sfd[i][j];
+      }
+    }
+
+    venus_pipelineReset(venus_pipeline);
+    venus_pipelineQueue(venus_pipeline, ID_EHP_DATA_SET, VENUS_NO_RESPONSE);
+
+    if(venus_pipelineRun(host_object, host_usart, ext_dev_object) != EXIT_SUCCESS){
+      ret = -1;
+    }
+  }
+  return ret;
+}
+
+/*
+ * Carry the sentence subscriptions (venus_nmeaSubscribe()) over into the
+ * ID_CONFIG_NMEA_MESSAGE intervals, so the receiver only sends what the 
+ * parser would keep. Does nothing to the config with nothing subscribed.
+ */
+int venus638_NmeaRateConfig(VENUS_nmea_store* venus_nmea, VENUS_config* venus_config);
+
+int venus638_NmeaRateConfig(VENUS_nmea_store* venus_nmea, VENUS_config* venus_config){
+
+  if(!venus_nmea->subscribed){
+    return 1;
+  }
+
+  VENUS_nmea_subscription* subscription = venus_nmea->subscription;
+
+  venus_config->config_nmea_gga = CONFIG_NMEA_GGA_INTERVAL(subscription[GGA_INDEX].rate);
+  venus_config->config_nmea_gsa = CONFIG_NMEA_GSA_INTERVAL(subscription[GSA_INDEX].rate);
+  venus_config->config_nmea_gsv = CONFIG_NMEA_GSV_INTERVAL(subscription[GSV_INDEX].rate);
+  venus_config->config_nmea_gll = CONFIG_NMEA_GLL_INTERVAL(subscription[GLL_INDEX].rate);
+  venus_config->config_nmea_rmc = CONFIG_NMEA_RMC_INTERVAL(subscription[RMC_INDEX].rate);
+  venus_config->config_nmea_vtg = CONFIG_NMEA_VTG_INTERVAL(subscription[VTG_INDEX].rate);
+  venus_config->config_nmea_zda = CONFIG_NMEA_ZDA_INTERVAL(0);   //no decoder, the parser drops it
+
+  return EXIT_SUCCESS;
+}
+
+int venus638_NmeaRates(void* host_object, int(*host_usart)(), void* ext_dev_object){
+
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+  VENUS_nmea_store* venus_nmea = (VENUS_nmea_store*)venus_object->MPI_data[VENUS_NMEA_INDEX];
+  VENUS_config* venus_config = (VENUS_config*)venus_object->MPI_conf[VENUS_CONFIG_INDEX];
+
+  static const register_enum nmea_rate_sequence[1] = { config_nmea };
+
+  if(venus638_NmeaRateConfig(venus_nmea, venus_config) != EXIT_SUCCESS){
+    return -1;
+  }
+  return venus638_Sequence(host_object, host_usart, ext_dev_object, nmea_rate_sequence, 1);
+}
+
+int venus638_Init(void* host_object, int(*host_usart)(), void* ext_dev_object){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+
+  //get the link up to speed before anything else goes over it
+  //
+  if(venus638_Baud(host_object, host_usart, ext_dev_object) != EXIT_SUCCESS){
+    return -1;
+  }
+
+  //whatever ephemeris we kept from last time, a failure here just means
+  //a cold start
+  //
+  if(host_ptr != NULL && host_ptr->_core_periphconf._mcs_data != NULL){
+    venus638_EphRestore(host_object, host_usart, ext_dev_object);
+  }
+
+  //subscriptions made before init override the configured nmea rates
+  //
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+  venus638_NmeaRateConfig(venus_object->MPI_data[VENUS_NMEA_INDEX], venus_object->MPI_conf[VENUS_CONFIG_INDEX]);
+
+  return venus638_Sequence(host_object, host_usart, ext_dev_object, venus_init_sequence, VENUS_INIT_SEQUENCE_LEN);
+}
+
+int venus638_RegDump(void* host_object, int(*host_usart)(), void* ext_dev_object){
+
+  return venus638_Sequence(host_object, host_usart, ext_dev_object, venus_reg_dump_sequence, VENUS_REG_DUMP_SEQUENCE_LEN);
+}
+
+/*
+ * Label the host's last 1PPS capture with the second the fix just reported 
+ * and hand it to the time service. Call after each Rx pass; only acts once
+ * per RMC or binary nav data fix (it clears their 'updated' bits), which 
+ * the receiver sends after the pulse that starts that second.
+ */
+int venus638_TimeSync(void* host_object, void* ext_dev_object, MPI_time* time_sync){
+
+  MPI_host* host_ptr = (MPI_host*)host_object;
+  MPI_ext_dev* venus_object = (MPI_ext_dev*)ext_dev_object;
+  VENUS_nmea_store* venus_nmea = (VENUS_nmea_store*)venus_object->MPI_data[VENUS_NMEA_INDEX];
+
+  int_callback host_capture = host_ptr->_periph_periphconf._timer_capture;
+  VENUS_fix* fix = &venus_nmea->fix;
+  uint32_t time_fix = (1 << RMC_INDEX) | (1 << NAV_DATA_INDEX);
+  uint64_t utc_s;
+
+  if(host_capture == NULL){
+    return -1;
+  }
+  if(!(fix->updated & time_fix)){
+    return MPI_TIME_PPS_NONE;
+  }
+  fix->updated &= ~time_fix;
+
+  if(!fix->valid || venus_fixUtcSeconds(fix, &utc_s) != 0){
+    return MPI_TIME_PPS_NONE;
+  }
+  return mpi_timePps(host_object, host_capture, time_sync, utc_s);
+}
+
 int venus638_ConfigReg(void* host_object, int(*host_usart)(), void* ext_dev_object, void* config_register){
   
   register_enum reg_enum = (register_enum)config_register;
@@ -68,10 +68,26 @@
 
 #include <stdint.h>
 
+#include "mpi_time.h"
+
 #include "venus638.h"
 
+#define VENUS_INIT_SEQUENCE_LEN       8
+#define VENUS_REG_DUMP_SEQUENCE_LEN   8
+
+#define VENUS_EPH_NVM_OFFSET          0     //EPH_SV_COUNT * EPH_RECORD_LEN from here
+
+extern const register_enum venus_init_sequence[VENUS_INIT_SEQUENCE_LEN];
+extern const register_enum venus_reg_dump_sequence[VENUS_REG_DUMP_SEQUENCE_LEN];
+
 int venus638_Init(void* host_object, int(*host_usart)(), void* ext_dev_object);
+int venus638_Baud(void* host_object, int(*host_usart)(), void* ext_dev_object);
 int venus638_RegDump(void* host_object, int(*host_usart)(), void* ext_dev_object);
+int venus638_EphStore(void* host_object, int(*host_usart)(), void* ext_dev_object);
+int venus638_EphRestore(void* host_object, int(*host_usart)(), void* ext_dev_object);
+int venus638_NmeaRates(void* host_object, int(*host_usart)(), void* ext_dev_object);
+int venus638_TimeSync(void* host_object, void* ext_dev_object, MPI_time* time_sync);
+int venus638_Sequence(void* host_object, int(*host_usart)(), void* ext_dev_object, const register_enum* sequence, uint32_t sequence_len);
 int venus638_Reset(void* host_object, int(*host_usart)(), void* ext_dev_object);
 int venus638_Off(void* host_object, int(*host_usart)(), void* ext_dev_object);
 int venus638_Data(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t read_write);
@@ -0,0 +1,235 @@
+// nodelist_check.c
+//
+// dw1000_nodeMgmt.c on the host: fills a node list through the
+// DW_NODE_CREATE/DW_NODE_DELETE entries of node_list_table, ranges the
+// nodes into the nearest-n heap with dw_nearestUpdate(), then deletes from
+// the bottom, the middle and the top of the list and checks after each one
+// that
+//
+//  - the surviving nodes are still packed at the bottom, in order
+//  - dw_nodeSearch() finds every survivor where it now is
+//  - dw_nearestQuery() returns the survivors, and only them, closest first,
+//    a shorter query the front of that and one past DW_NEAREST_MAX nothing
+//
+// and that a slot freed by a delete comes back clean from dw_nodeCreate().
+//
+// make -C tools/dw1000 && ./tools/dw1000/nodelist_check
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mpi_port.h"
+#include "dw1000_types.h"
+#include "dw1000_nodeMgmt.h"
+
+#define CHECK_NODES           6
+
+#if NODELIST_LEN < CHECK_NODES
+#error "build with -DNODELIST_LEN=8 or more, see the makefile"
+#endif
+#if NODELIST_LEN > DW_NEAREST_MAX
+#error "the full nearest query needs -DDW_NEAREST_MAX=NODELIST_LEN or more"
+#endif
+
+typedef struct {
+  uint8_t tag_id[BLINK_SRC_ADDR_LEN];
+  float distance;
+  int present;
+}CHECK_node;
+
+static DW_nodelist check_list;
+static CHECK_node check_nodes[CHECK_NODES];
+static uint32_t check_failed;
+
+void check_reset(void);
+void check_tag(uint8_t* tag_id, uint32_t n);
+void check_fail(const char* step, const char* what, uint32_t n);
+void check_state(const char* step);
+void check_delete(uint32_t n);
+
+void check_reset(void){
+
+  memset(&check_list, 0, sizeof(check_list));
+  for(uint32_t i = 0; i < NODELIST_LEN; i++){
+    check_list.list[i].dev_status = DW_DEV_DISABLED;
+    check_list.nearest_pos[i] = DW_NEAREST_NONE;
+  }
+}
+
+//distinct in every byte, a search that only looks at one byte still has to get it right
+void check_tag(uint8_t* tag_id, uint32_t n){
+
+  for(uint32_t j = 0; j < BLINK_SRC_ADDR_LEN; j++){
+    tag_id[j] = (uint8_t)(0x10 * (n + 1) + j);
+  }
+}
+
+void check_fail(const char* step, const char* what, uint32_t n){
+
+  printf("FAIL %s: %s (node %u)\n", step, what, n);
+  check_failed++;
+}
+
+void check_state(const char* step){
+
+  uint32_t(* node_search)() = node_list_table[DW_NODE_SEARCH];
+  uint16_t nearest[NODELIST_LEN];
+  uint32_t expected_index = 0;
+  uint32_t present = 0;
+
+  //survivors packed at the bottom in creation order, everything above disabled
+  //
+  for(uint32_t n = 0; n < CHECK_NODES; n++){
+    if(!check_nodes[n].present){
+      if(node_search(&check_list, check_nodes[n].tag_id) != (uint32_t)ERROR){
+        check_fail(step, "deleted node still found", n);
+      }
+      continue;
+    }
+    if(node_search(&check_list, check_nodes[n].tag_id) != expected_index){
+      check_fail(step, "search did not find the node where it should be", n);
+    }
+    if(memcmp(check_list.list[expected_index].tag_id, check_nodes[n].tag_id, BLINK_SRC_ADDR_LEN) != 0 ||
+       check_list.list[expected_index].distance != check_nodes[n].distance){
+      check_fail(step, "list record does not belong to the node", n);
+    }
+    expected_index++;
+  }
+  present = expected_index;
+  for(uint32_t i = present; i < NODELIST_LEN; i++){
+    if(check_list.list[i].dev_status == DW_DEV_ACTIVE){
+      check_fail(step, "active slot above the packed nodes", i);
+    }
+    if(check_list.nearest_pos[i] != DW_NEAREST_NONE){
+      check_fail(step, "empty slot still in the nearest heap", i);
+    }
+  }
+
+  //every survivor comes back from the heap exactly once, closest first
+  //
+  uint32_t count = dw_nearestQuery(&check_list, nearest, NODELIST_LEN);
+
+  if(count != present){
+    printf("FAIL %s: nearest query returned %u nodes, %u expected\n", step, count, present);
+    check_failed++;
+    return;
+  }
+  for(uint32_t i = 0; i < count; i++){
+    if(nearest[i] >= present){
+      check_fail(step, "nearest query returned an empty slot", nearest[i]);
+      continue;
+    }
+    if(i > 0 && check_list.list[nearest[i]].distance < check_list.list[nearest[i-1]].distance){
+      check_fail(step, "nearest query out of order", nearest[i]);
+    }
+    for(uint32_t j = 0; j < i; j++){
+      if(nearest[j] == nearest[i]){
+        check_fail(step, "nearest query returned a node twice", nearest[i]);
+      }
+    }
+  }
+
+  //a shorter query is the front of the full one, past DW_NEAREST_MAX it's refused
+  //
+  uint16_t front[NODELIST_LEN];
+  uint32_t front_count = dw_nearestQuery(&check_list, front, 2);
+
+  if(front_count != (present < 2 ? present : 2) || (front_count && memcmp(front, nearest, front_count * sizeof(front[0])) != 0)){
+    check_fail(step, "nearest 2 isn't the front of the full query", front_count);
+  }
+  if(dw_nearestQuery(&check_list, front, DW_NEAREST_MAX + 1) != 0){
+    check_fail(step, "query past DW_NEAREST_MAX wasn't refused", DW_NEAREST_MAX + 1);
+  }
+
+  printf("%-24s %u nodes, nearest", step, present);
+  for(uint32_t i = 0; i < count; i++){
+    printf(" %.1f", check_list.list[nearest[i]].distance);
+  }
+  printf("\n");
+}
+
+void check_delete(uint32_t n){
+
+  uint32_t(* node_delete)() = node_list_table[DW_NODE_DELETE];
+  char step[32];
+
+  snprintf(step, sizeof(step), "delete node %u", n);
+  if(node_delete(&check_list, check_nodes[n].tag_id) != EXIT_SUCCESS){
+    check_fail(step, "delete failed", n);
+  }
+  check_nodes[n].present = 0;
+  check_state(step);
+}
+
+int main(void)
+{
+  uint32_t(* node_create)() = node_list_table[DW_NODE_CREATE];
+  uint32_t(* node_delete)() = node_list_table[DW_NODE_DELETE];
+  const float distances[CHECK_NODES] = {4.5f, 1.5f, 3.0f, 0.5f, 6.0f, 2.5f};
+
+  check_reset();
+
+  for(uint32_t n = 0; n < CHECK_NODES; n++){
+    uint32_t index;
+
+    check_tag(check_nodes[n].tag_id, n);
+    index = node_create(&check_list, check_nodes[n].tag_id);
+    if(index != n){
+      check_fail("create", "node not created in the next free slot", n);
+      continue;
+    }
+    check_nodes[n].distance = distances[n];
+    check_nodes[n].present = 1;
+    check_list.list[index].distance = distances[n];
+    dw_nearestUpdate(&check_list, index);
+  }
+  check_state("create");
+
+  //middle, bottom, top
+  //
+  check_delete(2);
+  check_delete(0);
+  check_delete(CHECK_NODES - 1);
+
+  uint8_t unknown[BLINK_SRC_ADDR_LEN];
+
+  check_tag(unknown, CHECK_NODES);
+  if(node_delete(&check_list, unknown) == EXIT_SUCCESS){
+    check_fail("delete unknown", "delete of a node that isn't there succeeded", CHECK_NODES);
+  }
+  check_state("delete unknown");
+
+  //the freed slot is reused, without the old node's filter or heap place
+  //
+  uint32_t index = node_create(&check_list, check_nodes[2].tag_id);
+
+  if(check_list.list[index].filter.state != DW_RANGE_FILTER_EMPTY ||
+     check_list.nearest_pos[index] != DW_NEAREST_NONE){
+    check_fail("recreate", "reused slot not clean", 2);
+  }
+  check_nodes[2].present = 1;
+  check_nodes[2].distance = 0.25f;
+  check_list.list[index].distance = 0.25f;
+  dw_nearestUpdate(&check_list, index);
+
+  //creation order is list order, the recreated node is now the newest
+  //
+  CHECK_node recreated = check_nodes[2];
+
+  memmove(&check_nodes[2], &check_nodes[3], sizeof(CHECK_node) * (CHECK_NODES - 3));
+  check_nodes[CHECK_NODES - 1] = recreated;
+  check_state("recreate");
+
+  //and down to nothing
+  //
+  for(uint32_t n = 0; n < CHECK_NODES; n++){
+    if(check_nodes[n].present){
+      check_delete(n);
+    }
+  }
+
+  printf("%s\n", check_failed ? "FAILED" : "ok");
+  return (check_failed ? 1 : 0);
+}
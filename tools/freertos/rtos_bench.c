@@ -0,0 +1,180 @@
+// rtos_bench.c
+//
+// The FreeRTOS binding (mpi_rtos.c) on the FreeRTOS POSIX port, so the
+// driver task, its queue and the irq deferral run on linux. The device is
+// the sd_emu DW1000 register file behind the mock spidev host
+// (tools/spidev), all in process, so what's timed is the binding itself:
+//
+//  - DEV_ID reads through mpi_rtosDevCall(), one request round trip each
+//  - DEV_ID reads through mpi_rtosDevPost(), RTOS_BENCH_DEPTH in flight
+//  - "interrupts" through mpi_rtosIrqDefer() from the client task,
+//    each one a DEV_ID read on the driver task
+//
+// make -C tools/freertos FREERTOS_DIR=<FreeRTOS-Kernel> && ./tools/freertos/rtos_bench [iterations]
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "mpi_port.h"
+#include "mpi_rtos.h"
+#include "spidev_adaptor.h"
+#include "config_spidev.h"
+#include "dw1000_types.h"
+#include "dw1000_regs.h"
+#include "dw1000_commRxTx.h"
+
+#include "sd_emu.h"
+#include "spidev_mock.h"
+
+#define RTOS_BENCH_ITERATIONS_DEFAULT 100000
+#define RTOS_BENCH_DEV_ID             0xDECA0130
+#define RTOS_BENCH_DEPTH              MPI_RTOS_QUEUE_LEN
+#define RTOS_BENCH_DRIVER_PRIORITY    (tskIDLE_PRIORITY + 2)
+#define RTOS_BENCH_CLIENT_PRIORITY    (tskIDLE_PRIORITY + 1)
+
+typedef struct {
+  uint32_t reads;
+  uint32_t bad;
+  SemaphoreHandle_t slots;        //RTOS_BENCH_DEPTH posts in flight
+}RTOS_BENCH_count;
+
+double rtos_benchNow(void);
+int rtos_benchDevId(void* host_object, int(*host_comm)(), void* ext_dev_object, uint32_t read_write);
+int rtos_benchIrq(void* host_object, int(*host_comm)(), void* ext_dev_object, uint32_t flags);
+int rtos_benchDone(RTOS_BENCH_count* count, int status);
+void rtos_benchClient(void* iterations_ptr);
+
+MPI_rtos_dev rtos_bench_dw;
+RTOS_BENCH_count rtos_bench_count;
+MPI_ext_dev rtos_bench_dev = {
+  .model = {"DW1000"},
+  ._interface = {
+    ._dev_data = &rtos_benchDevId
+  }
+};
+
+double rtos_benchNow(void){
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+//_dev_data shaped, runs on the driver task
+int rtos_benchDevId(void* host_object, int(*host_comm)(), void* ext_dev_object, uint32_t read_write){
+
+  uint8_t dev_id[DEV_ID_LEN];
+
+  if(dw_RxReg(host_object, host_comm, ext_dev_object, DEV_ID_ID, 0, dev_id, DEV_ID_LEN) != 0){
+    return -1;
+  }
+  uint32_t value = dev_id[0] | (dev_id[1] << 8) | (dev_id[2] << 16) | ((uint32_t)dev_id[3] << 24);
+  return (value == RTOS_BENCH_DEV_ID ? 0 : -1);
+}
+
+int rtos_benchIrq(void* host_object, int(*host_comm)(), void* ext_dev_object, uint32_t flags){
+
+  if(rtos_benchDevId(host_object, host_comm, ext_dev_object, READ) != 0){
+    rtos_bench_count.bad++;
+  }
+  return 0;
+}
+
+int rtos_benchDone(RTOS_BENCH_count* count, int status){
+
+  count->reads++;
+  if(status != 0){
+    count->bad++;
+  }
+  xSemaphoreGive(count->slots);
+  return 0;
+}
+
+void rtos_benchClient(void* iterations_ptr){
+
+  uint32_t iterations = *(uint32_t*)iterations_ptr;
+  uint32_t bad = 0;
+  double start, call_s, post_s, irq_s;
+
+  //synchronous, one round trip through the driver task per read
+  //
+  start = rtos_benchNow();
+  for(uint32_t i = 0; i < iterations; i++){
+    bad += (mpi_rtosDevCall(&rtos_bench_dw, rtos_benchDevId, READ, NULL, portMAX_DELAY) != 0);
+  }
+  call_s = rtos_benchNow() - start;
+
+  //queued, completions counted on the driver task
+  //
+  rtos_bench_count.slots = xSemaphoreCreateCounting(RTOS_BENCH_DEPTH, RTOS_BENCH_DEPTH);
+
+  start = rtos_benchNow();
+  for(uint32_t i = 0; i < iterations; i++){
+    xSemaphoreTake(rtos_bench_count.slots, portMAX_DELAY);
+    mpi_rtosDevPost(&rtos_bench_dw, rtos_benchDevId, READ, NULL, rtos_benchDone, &rtos_bench_count);
+  }
+  for(uint32_t i = 0; i < RTOS_BENCH_DEPTH; i++){
+    xSemaphoreTake(rtos_bench_count.slots, portMAX_DELAY);
+  }
+  post_s = rtos_benchNow() - start;
+
+  //deferred interrupts. The driver task is above us, so each defer's
+  //portYIELD_FROM_ISR() switches straight to it, as it would out of a
+  //real handler
+  //
+  uint32_t irqs_before = rtos_bench_dw.irqs_run;
+
+  start = rtos_benchNow();
+  for(uint32_t i = 0; i < iterations; i++){
+    mpi_rtosIrqDefer(&rtos_bench_dw, 1);
+  }
+  irq_s = rtos_benchNow() - start;
+
+  printf("DEV_ID, mpi_rtosDevCall   %9.0f reads/s %6.2f us/read, %u bad\n", iterations / call_s, (call_s * 1e6) / iterations, bad);
+  printf("DEV_ID, mpi_rtosDevPost   %9.0f reads/s %6.2f us/read, %u bad of %u\n", iterations / post_s, (post_s * 1e6) / iterations,
+         rtos_bench_count.bad, rtos_bench_count.reads);
+  printf("irq, mpi_rtosIrqDefer     %9.0f irqs/s  %6.2f us/irq, %u run of %u deferred\n", iterations / irq_s, (irq_s * 1e6) / iterations,
+         rtos_bench_dw.irqs_run - irqs_before, iterations);
+  printf("spidev: %u transfers, %u errors\n", spidev_status.transfers, spidev_status.errors);
+
+  exit((bad != 0 || rtos_bench_count.bad != 0) ? 1 : 0);
+}
+
+int main(int argc, char **argv)
+{
+  static uint32_t iterations;
+  static SD_EMU_dw1000 dw;
+  static SD_EMU_slave slave_dev;
+
+  iterations = (argc > 1 ? strtoul(argv[1], NULL, 10) : RTOS_BENCH_ITERATIONS_DEFAULT);
+
+  sd_emuDwReset(&dw);
+  sd_emuDwSlave(&slave_dev, &dw);
+  spidev_mock.slave_dev = &slave_dev;
+  spidev_status._ioctl = spidev_mockIoctl;
+  snprintf(spidev_conf.device, SPIDEV_DEVICE_LEN, "%s", "/dev/null");
+
+  if(spidev_Init(&spidev_host) != 0){
+    return 1;
+  }
+
+  if(mpi_rtosDevStart(&rtos_bench_dw, &spidev_host, spidev_Data, &rtos_bench_dev, NULL, "dw1000", RTOS_BENCH_DRIVER_PRIORITY) != 0){
+    printf("could not start the driver task\n");
+    return 1;
+  }
+
+  //the mock host has no interrupts to attach, the bench defers by hand
+  //
+  rtos_bench_dw._irq = rtos_benchIrq;
+
+  xTaskCreate(rtos_benchClient, "client", MPI_RTOS_STACK_WORDS, &iterations, RTOS_BENCH_CLIENT_PRIORITY, NULL);
+  vTaskStartScheduler();
+
+  return 1;
+}
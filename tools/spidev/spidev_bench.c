@@ -0,0 +1,112 @@
+// spidev_bench.c
+//
+// Runs the spidev host adaptor (config_spidev.c) end to end against the
+// mock spidev (spidev_mock.c) and the sd_emu DW1000 register file, so it
+// needs no pi and no root. Checks
+//
+//  - DEV_ID through dw_RxReg(), which takes the host's _usart_transfer and
+//    should cost exactly one SPI_IOC_MESSAGE (header + payload segments)
+//  - a full TX_BUFFER write and read back through spidev_Transfer()
+//
+// then times DEV_ID reads. The mock is in-process, so the number is the
+// adaptor's own overhead; on a pi with SPIDEV_BENCH_DEVICE=/dev/spidev0.0
+// and a DW1000 on CE0 it is the real thing.
+//
+// make -C tools/spidev && ./tools/spidev/spidev_bench [iterations]
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpi_port.h"
+#include "spidev_adaptor.h"
+#include "config_spidev.h"
+#include "dw1000_types.h"
+#include "dw1000_regs.h"
+#include "dw1000_commRxTx.h"
+
+#include "sd_emu.h"
+#include "spidev_mock.h"
+
+#define BENCH_ITERATIONS_DEFAULT 100000
+#define BENCH_DEV_ID             0xDECA0130
+#define BENCH_MOCK_DEVICE        "/dev/null"
+
+double bench_now(void);
+uint32_t bench_devId(void);
+
+double bench_now(void){
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+uint32_t bench_devId(void){
+
+  uint8_t dev_id[DEV_ID_LEN];
+
+  if(dw_RxReg(&spidev_host, spidev_Data, NULL, DEV_ID_ID, 0, dev_id, DEV_ID_LEN) != 0){
+    return 0;
+  }
+  return dev_id[0] | (dev_id[1] << 8) | (dev_id[2] << 16) | ((uint32_t)dev_id[3] << 24);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t iterations = (argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_ITERATIONS_DEFAULT);
+  const char* device = getenv("SPIDEV_BENCH_DEVICE");
+
+  static SD_EMU_dw1000 dw;
+  SD_EMU_slave slave_dev;
+
+  if(device == NULL){
+    sd_emuDwReset(&dw);
+    sd_emuDwSlave(&slave_dev, &dw);
+    spidev_mock.slave_dev = &slave_dev;
+    spidev_status._ioctl = spidev_mockIoctl;
+    device = BENCH_MOCK_DEVICE;
+  }
+  snprintf(spidev_conf.device, SPIDEV_DEVICE_LEN, "%s", device);
+
+  if(spidev_Init(&spidev_host) != 0){
+    return 1;
+  }
+  spidev_RegDump(&spidev_host);
+
+  //one register read, one ioctl
+  //
+  uint32_t messages = spidev_mock.messages;
+  uint32_t dev_id = bench_devId();
+  int one_message = (spidev_status._ioctl != spidev_mockIoctl || (spidev_mock.messages - messages) == 1);
+
+  uint8_t header[DW_REG_HEADER_MAX];
+  static uint8_t tx_out[TX_BUFFER_LEN], tx_in[TX_BUFFER_LEN];
+
+  for(int i = 0; i < TX_BUFFER_LEN; i++){
+    tx_out[i] = (i * 7) + 3;
+  }
+  uint32_t header_len = dw_regHeader(header, DW_WRITE, TX_BUFFER_ID, 0);
+  spidev_Transfer(&spidev_host, SPIDEV_WRITE, header, header_len, tx_out, TX_BUFFER_LEN);
+  header_len = dw_regHeader(header, DW_READ, TX_BUFFER_ID, 0);
+  spidev_Transfer(&spidev_host, SPIDEV_READ, header, header_len, tx_in, TX_BUFFER_LEN);
+  int tx_match = (memcmp(tx_out, tx_in, TX_BUFFER_LEN) == 0);
+
+  printf("DEV_ID 0x%08X %s in %s, TX_BUFFER round trip %s\n", dev_id, (dev_id == BENCH_DEV_ID ? "ok" : "BAD"),
+         (one_message ? "one ioctl" : "SEVERAL ioctls"), (tx_match ? "ok" : "BAD"));
+  if(dev_id != BENCH_DEV_ID || !one_message || !tx_match){
+    return 1;
+  }
+
+  uint32_t bad = 0;
+  double start = bench_now();
+  for(uint32_t i = 0; i < iterations; i++){
+    bad += (bench_devId() != BENCH_DEV_ID);
+  }
+  double seconds = bench_now() - start;
+
+  printf("DEV_ID, spidev %.0f accesses/s, %.2f us/access, %u bad\n", iterations / seconds, (seconds * 1e6) / iterations, bad);
+  return (bad != 0);
+}
@@ -0,0 +1,82 @@
+// spidev_mock.c
+//
+// Stands in for the kernel's spidev ioctls so spidev_adaptor.c runs with no
+// SPI hardware (CI, a laptop). Put spidev_mockIoctl in SPIDEV_STATUS._ioctl
+// before spidev_Init() and point SPIDEV_CONF.device at anything that opens,
+// /dev/null will do. Each SPI_IOC_MESSAGE is one CS window onto an
+// SD_EMU_slave model (tools/spidriver, the DW1000 register file to start).
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "sd_emu.h"
+#include "spidev_mock.h"
+
+SPIDEV_MOCK spidev_mock;
+
+int spidev_mockMessage(struct spi_ioc_transfer* segment, uint32_t segments);
+
+int spidev_mockMessage(struct spi_ioc_transfer* segment, uint32_t segments){
+
+  SD_EMU_slave* slave_dev = spidev_mock.slave_dev;
+  int len = 0;
+
+  slave_dev->_select(slave_dev->model);
+
+  for(uint32_t i = 0; i < segments; i++){
+    uint8_t* tx = (uint8_t*)(uintptr_t)segment[i].tx_buf;
+    uint8_t* rx = (uint8_t*)(uintptr_t)segment[i].rx_buf;
+
+    for(uint32_t j = 0; j < segment[i].len; j++){
+      uint8_t miso = slave_dev->_transfer(slave_dev->model, (tx != NULL ? tx[j] : 0));
+      if(rx != NULL){
+        rx[j] = miso;
+      }
+    }
+    len += segment[i].len;
+
+    //cs_change between segments drops CS for a moment, as the kernel does
+    //
+    if(segment[i].cs_change && i < (segments -1)){
+      slave_dev->_unselect(slave_dev->model);
+      slave_dev->_select(slave_dev->model);
+    }
+  }
+
+  slave_dev->_unselect(slave_dev->model);
+  spidev_mock.messages++;
+  spidev_mock.segments += segments;
+  return len;
+}
+
+int spidev_mockIoctl(int fd, unsigned long request, void* arg){
+
+  if(_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0 && _IOC_DIR(request) == _IOC_WRITE){
+    return spidev_mockMessage((struct spi_ioc_transfer*)arg, _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer));
+  }
+
+  switch(request){
+
+    case SPI_IOC_WR_MODE:
+      spidev_mock.mode = *(uint8_t*)arg;
+      return 0;
+    case SPI_IOC_RD_MODE:
+      *(uint8_t*)arg = spidev_mock.mode;
+      return 0;
+    case SPI_IOC_WR_BITS_PER_WORD:
+      spidev_mock.bits_per_word = *(uint8_t*)arg;
+      return 0;
+    case SPI_IOC_RD_BITS_PER_WORD:
+      *(uint8_t*)arg = spidev_mock.bits_per_word;
+      return 0;
+    case SPI_IOC_WR_MAX_SPEED_HZ:
+      spidev_mock.speed_hz = *(uint32_t*)arg;
+      return 0;
+    case SPI_IOC_RD_MAX_SPEED_HZ:
+      *(uint32_t*)arg = spidev_mock.speed_hz;
+      return 0;
+  }
+  return -1;
+}
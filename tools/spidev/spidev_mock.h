@@ -0,0 +1,25 @@
+// spidev_mock.h
+//
+// spidev ioctls against an sd_emu slave model, see spidev_mock.c
+
+#ifndef SPIDEV_MOCK_H
+#define SPIDEV_MOCK_H
+
+#include <stdint.h>
+
+#include "sd_emu.h"
+
+typedef struct {
+  SD_EMU_slave* slave_dev;
+  uint8_t mode;
+  uint8_t bits_per_word;
+  uint32_t speed_hz;
+  uint32_t messages;                  //SPI_IOC_MESSAGE ioctls, one CS window each
+  uint32_t segments;
+}SPIDEV_MOCK;
+
+extern SPIDEV_MOCK spidev_mock;
+
+int spidev_mockIoctl(int fd, unsigned long request, void* arg);
+
+#endif
@@ -0,0 +1,299 @@
+// sd_bench.c
+//
+// Host throughput benchmark for the spidriver port adaptor, against the
+// pty emulator (sd_emu.c) with a DW1000 register file behind it, so it runs
+// anywhere without the dongle. Connects through sd_Init() on the emulator's
+// pty (SD_CONF.port), checks DEV_ID and a TX_BUFFER round trip, then times
+//
+//  - DEV_ID reads the way libspidriver does them, spi_sel, spi_write,
+//    spi_read, spi_unsel, one usb round trip each
+//  - DEV_ID reads through sd_Data(), header and data in one transaction
+//  - full TX_BUFFER (1024 byte) writes and reads through sd_Data()
+//  - DEV_ID reads through the async I/O thread, BENCH_DEPTH in flight
+//
+// make -C tools/spidriver && ./tools/spidriver/sd_bench [iterations]
+//
+// Built with 'make TRACE=1' it first does a short run of DEV_ID reads and
+// TX_BUFFER writes through mpi_usartData(), drained to BENCH_TRACE_PATH as
+// it goes, for tools/trace.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "mpi_port.h"
+#include "mpi_usart.h"
+#include "mpi_trace.h"
+#include "spidriver.h"
+#include "spidriver_adaptor.h"
+#include "spidriver_async.h"
+#include "config_spidriver.h"
+#include "dw1000_types.h"
+#include "dw1000_regs.h"
+#include "dw1000_commRxTx.h"
+
+#include "sd_emu.h"
+
+#define BENCH_ITERATIONS_DEFAULT 2000
+#define BENCH_DEV_ID             0xDECA0130
+#define BENCH_DEPTH              SD_ASYNC_BATCH
+#define BENCH_RESULTS            5
+#define BENCH_TRACE_PATH         "sd_bench.trace"
+#define BENCH_TRACE_ITERATIONS   256
+#define BENCH_TRACE_DRAIN        8      //iterations per drain, 4 records each, inside MPI_TRACE_LEN
+
+typedef struct {
+  const char* name;
+  uint32_t iterations;
+  uint32_t bytes;
+  double seconds;
+}BENCH_result;
+
+void* bench_emu(void* emu);
+double bench_now(void);
+int bench_regRead(uint8_t reg_id, uint16_t offset, uint8_t* buffer_in, uint32_t buffer_len);
+int bench_regWrite(uint8_t reg_id, uint16_t offset, uint8_t* buffer_out, uint32_t buffer_len);
+uint32_t bench_devIdLib(void);
+void bench_report(BENCH_result* result);
+int bench_devIdCheck(uint32_t* bad, SD_REQUEST* request, int status);
+int bench_dwData(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t read_write);
+int bench_trace(void);
+
+//a DW1000 as the middleware sees it, for the traced run
+MPI_ext_dev bench_dw = {
+  .model = {"dw1000 (emu)"}
+};
+
+void* bench_emu(void* emu){
+
+  sd_emuServe((SD_EMU*)emu);
+  return NULL;
+}
+
+double bench_now(void){
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+//header and data in one sd_Data() transaction, data lands after the header
+int bench_regRead(uint8_t reg_id, uint16_t offset, uint8_t* buffer_in, uint32_t buffer_len){
+
+  static uint8_t frame[DW_REG_HEADER_MAX + TX_BUFFER_LEN];
+  uint32_t header_len = dw_regHeader(frame, DW_READ, reg_id, offset);
+
+  memset(&frame[header_len], 0, buffer_len);
+  if(sd_Data(&sd_host, SD_READ_WRITE, frame, header_len + buffer_len) != 0){
+    return -1;
+  }
+  memcpy(buffer_in, &frame[header_len], buffer_len);
+  return 0;
+}
+
+int bench_regWrite(uint8_t reg_id, uint16_t offset, uint8_t* buffer_out, uint32_t buffer_len){
+
+  static uint8_t frame[DW_REG_HEADER_MAX + TX_BUFFER_LEN];
+  uint32_t header_len = dw_regHeader(frame, DW_WRITE, reg_id, offset);
+
+  memcpy(&frame[header_len], buffer_out, buffer_len);
+  return sd_Data(&sd_host, SD_WRITE, frame, header_len + buffer_len);
+}
+
+//what sd_Data() used to cost per register access
+uint32_t bench_devIdLib(void){
+
+  char header[DW_REG_HEADER_MAX];
+  char dev_id[DEV_ID_LEN];
+  uint32_t header_len = dw_regHeader((uint8_t*)header, DW_READ, DEV_ID_ID, 0);
+
+  spi_sel(&sd_status);
+  spi_write(&sd_status, header, header_len);
+  spi_read(&sd_status, dev_id, DEV_ID_LEN);
+  spi_unsel(&sd_status);
+
+  return (uint8_t)dev_id[0] | ((uint8_t)dev_id[1] << 8) | ((uint8_t)dev_id[2] << 16) | ((uint32_t)(uint8_t)dev_id[3] << 24);
+}
+
+//async completion, runs on the I/O thread
+int bench_devIdCheck(uint32_t* bad, SD_REQUEST* request, int status){
+
+  uint8_t* dev_id = &request->buffer[request->buffer_len - DEV_ID_LEN];
+  uint32_t value = dev_id[0] | (dev_id[1] << 8) | (dev_id[2] << 16) | ((uint32_t)dev_id[3] << 24);
+
+  if(status != 0 || value != BENCH_DEV_ID){
+    (*bad)++;
+  }
+  return 0;
+}
+
+//ext_dev _dev_data for bench_dw, READ is DEV_ID, WRITE a full TX_BUFFER
+int bench_dwData(void* host_object, int(*host_usart)(), void* ext_dev_object, uint32_t read_write){
+
+  static uint8_t buffer[TX_BUFFER_LEN];
+
+  if(read_write == READ){
+    return bench_regRead(DEV_ID_ID, 0, buffer, DEV_ID_LEN);
+  }
+  return bench_regWrite(TX_BUFFER_ID, 0, buffer, TX_BUFFER_LEN);
+}
+
+int bench_trace(void){
+
+  FILE* trace = fopen(BENCH_TRACE_PATH, "wb");
+
+  if(trace == NULL){
+    return -1;
+  }
+  mpi_traceInit(&sd_host);
+
+  for(uint32_t i = 0; i < BENCH_TRACE_ITERATIONS; i++){
+    mpi_usartData(&sd_host, sd_Data, &bench_dw, bench_dwData, ((i % 4) == 3 ? WRITE : READ));
+    if((i % BENCH_TRACE_DRAIN) == (BENCH_TRACE_DRAIN - 1)){
+      mpi_traceDrain(sd_TraceWrite, trace);
+    }
+  }
+  mpi_traceDrain(sd_TraceWrite, trace);
+
+  printf("trace: %u traced accesses in %s\n", BENCH_TRACE_ITERATIONS, BENCH_TRACE_PATH);
+  return fclose(trace);
+}
+
+void bench_report(BENCH_result* result){
+
+  printf("%-28s %8.0f accesses/s %8.3f MB/s %8.1f us/access\n", result->name,
+         result->iterations / result->seconds, ((double)result->bytes * result->iterations) / result->seconds / 1e6,
+         (result->seconds * 1e6) / result->iterations);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t iterations = (argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_ITERATIONS_DEFAULT);
+
+  static SD_EMU emu;
+  static SD_EMU_dw1000 dw;
+  SD_EMU_slave slave_dev;
+  pthread_t emu_thread;
+
+  sd_emuDwReset(&dw);
+  sd_emuDwSlave(&slave_dev, &dw);
+
+  if(sd_emuOpen(&emu, &slave_dev) != 0){
+    printf("could not open a pty\n");
+    return 1;
+  }
+  pthread_create(&emu_thread, NULL, bench_emu, &emu);
+
+  SD_CONF* sd_conf = (SD_CONF*)sd_host.MPI_conf[SD_CONFIG_INDEX];
+  snprintf(sd_conf->port, SD_PORT_LEN, "%s", emu.path);
+
+  sd_Init(&sd_host);
+  if(!sd_status.connected){
+    return 1;
+  }
+
+  //make sure the whole path is right before timing it
+  //
+  uint8_t dev_id[DEV_ID_LEN];
+  static uint8_t tx_out[TX_BUFFER_LEN], tx_in[TX_BUFFER_LEN];
+
+  for(int i = 0; i < TX_BUFFER_LEN; i++){
+    tx_out[i] = (i * 7) + 3;
+  }
+  bench_regRead(DEV_ID_ID, 0, dev_id, DEV_ID_LEN);
+  bench_regWrite(TX_BUFFER_ID, 0, tx_out, TX_BUFFER_LEN);
+  bench_regRead(TX_BUFFER_ID, 0, tx_in, TX_BUFFER_LEN);
+
+  uint32_t dev_id_value = dev_id[0] | (dev_id[1] << 8) | (dev_id[2] << 16) | ((uint32_t)dev_id[3] << 24);
+  int tx_match = (memcmp(tx_out, tx_in, TX_BUFFER_LEN) == 0);
+  int lib_match = (bench_devIdLib() == BENCH_DEV_ID);
+
+  printf("DEV_ID 0x%08X %s, TX_BUFFER round trip %s, libspidriver DEV_ID %s\n", dev_id_value,
+         (dev_id_value == BENCH_DEV_ID ? "ok" : "BAD"), (tx_match ? "ok" : "BAD"), (lib_match ? "ok" : "BAD"));
+  if(dev_id_value != BENCH_DEV_ID || !tx_match || !lib_match){
+    return 1;
+  }
+
+#ifdef MPI_TRACE
+  if(bench_trace() != 0){
+    return 1;
+  }
+#endif
+
+  BENCH_result result[BENCH_RESULTS] = {
+    {"DEV_ID, libspidriver calls", iterations, DEV_ID_LEN},
+    {"DEV_ID, sd_Data", iterations, DEV_ID_LEN},
+    {"TX_BUFFER write, sd_Data", iterations, TX_BUFFER_LEN},
+    {"TX_BUFFER read, sd_Data", iterations, TX_BUFFER_LEN},
+    {"DEV_ID, sd_DataAsync", iterations, DEV_ID_LEN}
+  };
+  double start;
+
+  start = bench_now();
+  for(uint32_t i = 0; i < iterations; i++){
+    bench_devIdLib();
+  }
+  result[0].seconds = bench_now() - start;
+
+  start = bench_now();
+  for(uint32_t i = 0; i < iterations; i++){
+    bench_regRead(DEV_ID_ID, 0, dev_id, DEV_ID_LEN);
+  }
+  result[1].seconds = bench_now() - start;
+
+  start = bench_now();
+  for(uint32_t i = 0; i < iterations; i++){
+    bench_regWrite(TX_BUFFER_ID, 0, tx_out, TX_BUFFER_LEN);
+  }
+  result[2].seconds = bench_now() - start;
+
+  start = bench_now();
+  for(uint32_t i = 0; i < iterations; i++){
+    bench_regRead(TX_BUFFER_ID, 0, tx_in, TX_BUFFER_LEN);
+  }
+  result[3].seconds = bench_now() - start;
+
+  //keep BENCH_DEPTH reads queued, resubmitting each as it completes
+  //
+  static SD_REQUEST request[BENCH_DEPTH];
+  static uint8_t frame[BENCH_DEPTH][DW_REG_HEADER_MAX + DEV_ID_LEN];
+  uint32_t header_len = 0, bad = 0, submitted = 0;
+
+  if(sd_AsyncInit(&sd_host) != 0){
+    printf("could not start the I/O thread\n");
+    return 1;
+  }
+
+  start = bench_now();
+  for(uint32_t i = 0; i < iterations; i++){
+    SD_REQUEST* next = &request[i % BENCH_DEPTH];
+
+    if(i >= BENCH_DEPTH){
+      sd_AsyncWait(&sd_host, next);
+    }
+    header_len = dw_regHeader(frame[i % BENCH_DEPTH], DW_READ, DEV_ID_ID, 0);
+    sd_Request(next, SD_READ_WRITE, frame[i % BENCH_DEPTH], header_len + DEV_ID_LEN, bench_devIdCheck, &bad);
+    sd_DataAsync(&sd_host, next);
+    submitted++;
+  }
+  for(uint32_t i = 0; i < BENCH_DEPTH && i < submitted; i++){
+    sd_AsyncWait(&sd_host, &request[i]);
+  }
+  result[4].seconds = bench_now() - start;
+
+  SD_ASYNC* async = (SD_ASYNC*)sd_host.MPI_data[SD_ASYNC_INDEX];
+  uint32_t round_trips = async->round_trips;
+  sd_AsyncStop(&sd_host);
+
+  for(int i = 0; i < BENCH_RESULTS; i++){
+    bench_report(&result[i]);
+  }
+  printf("async: %u bad reads, %u transactions in %u round trips\n", bad, submitted, round_trips);
+  printf("emulator: %u transactions, %lu bytes, crc %04X (host %04X)\n", emu.transactions,
+         (unsigned long)emu.bytes, emu.crc, sd_status.e_ccitt_crc);
+
+  return 0;
+}
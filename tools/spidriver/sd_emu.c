@@ -0,0 +1,224 @@
+// sd_emu.c
+//
+// SPIDriver emulator. Opens a pseudo-terminal and answers on it with the
+// command set lib/spidriver.so speaks, handing the SPI traffic to a slave
+// model (sd_emu_dw1000.c to start with). Point SD_CONF.port at emu.path and
+// the linux host build runs without the usb dongle.
+//
+//  '@'                  nop, spi_connect() flushes with these
+//  'e' <c>              echo c
+//  '?'                  80 byte status "[model serial uptime V mA C a b cs crc ]"
+//  's' / 'u'            CS low / high
+//  'a' <v> / 'b' <v>    output lines A / B
+//  0x80 + n-1 <n>       write n bytes, read n back
+//  0xC0 + n-1 <n>       write n bytes
+//
+// Replies are held until the client has nothing more queued, so a batch
+// written in one go (sd_Data()) is answered in one go.
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sd_emu.h"
+
+int sd_emuFlush(SD_EMU* emu);
+int sd_emuByte(SD_EMU* emu, uint8_t* byte_out);
+int sd_emuReply(SD_EMU* emu, uint8_t* buffer, uint32_t buffer_len);
+int sd_emuStatus(SD_EMU* emu);
+void sd_emuCrc(SD_EMU* emu, uint8_t byte_in);
+
+static time_t sd_emu_start;
+
+int sd_emuOpen(SD_EMU* emu, SD_EMU_slave* slave_dev){
+
+  memset(emu, 0, sizeof(SD_EMU));
+  emu->slave_dev = slave_dev;
+  emu->cs = 1;
+  emu->crc = 0xFFFF;
+  sd_emu_start = time(NULL);
+
+  emu->master = posix_openpt(O_RDWR | O_NOCTTY);
+  if(emu->master < 0 || grantpt(emu->master) != 0 || unlockpt(emu->master) != 0){
+    return -1;
+  }
+  snprintf(emu->path, sizeof(emu->path), "%s", ptsname(emu->master));
+
+  //raw before anyone opens it, no echo or line editing of binary traffic
+  //
+  emu->slave = open(emu->path, O_RDWR | O_NOCTTY);
+  if(emu->slave < 0){
+    return -1;
+  }
+
+  struct termios tty;
+  if(tcgetattr(emu->slave, &tty) != 0){
+    return -1;
+  }
+  cfmakeraw(&tty);
+  return tcsetattr(emu->slave, TCSANOW, &tty);
+}
+
+void sd_emuClose(SD_EMU* emu){
+
+  close(emu->slave);
+  close(emu->master);
+}
+
+int sd_emuFlush(SD_EMU* emu){
+
+  uint32_t done = 0;
+
+  while(done < emu->tx_len){
+    ssize_t ret = write(emu->master, &emu->tx[done], emu->tx_len - done);
+    if(ret <= 0){
+      return -1;
+    }
+    done += ret;
+  }
+  emu->tx_len = 0;
+  return 0;
+}
+
+//next command byte, answering everything so far before blocking for more
+int sd_emuByte(SD_EMU* emu, uint8_t* byte_out){
+
+  if(emu->rx_index == emu->rx_len){
+    if(sd_emuFlush(emu) != 0){
+      return -1;
+    }
+    ssize_t ret = read(emu->master, emu->rx, SD_EMU_BUFFER_LEN);
+    if(ret <= 0){
+      return -1;
+    }
+    emu->rx_len = ret;
+    emu->rx_index = 0;
+  }
+  *byte_out = emu->rx[emu->rx_index++];
+  return 0;
+}
+
+int sd_emuReply(SD_EMU* emu, uint8_t* buffer, uint32_t buffer_len){
+
+  if((emu->tx_len + buffer_len) > SD_EMU_BUFFER_LEN && sd_emuFlush(emu) != 0){
+    return -1;
+  }
+  memcpy(&emu->tx[emu->tx_len], buffer, buffer_len);
+  emu->tx_len += buffer_len;
+  return 0;
+}
+
+void sd_emuCrc(SD_EMU* emu, uint8_t byte_in){
+
+  emu->crc ^= (byte_in << 8);
+  for(int bit = 0; bit < 8; bit++){
+    emu->crc = (emu->crc & 0x8000 ? (emu->crc << 1) ^ SD_EMU_CRC_POLY : (emu->crc << 1));
+  }
+}
+
+//fixed width, spi_getstatus() blocks until it has all SD_EMU_STATUS_LEN bytes
+int sd_emuStatus(SD_EMU* emu){
+
+  char status[SD_EMU_STATUS_LEN +1];
+  unsigned long uptime = (unsigned long)(time(NULL) - sd_emu_start);
+
+  int len = snprintf(status, sizeof(status), "[spidriver1 EMU00001 %lu 5.000 0.000 25.0 %u %u %u %04x ]",
+                     uptime, emu->a, emu->b, emu->cs, emu->crc);
+
+  memset(&status[len], ' ', SD_EMU_STATUS_LEN - len);
+  return sd_emuReply(emu, (uint8_t*)status, SD_EMU_STATUS_LEN);
+}
+
+/*
+ * Runs until the pty goes away. We hold the slave end open ourselves, so
+ * clients can come and go (connect, run, exit) without that happening.
+ */
+int sd_emuServe(SD_EMU* emu){
+
+  SD_EMU_slave* slave_dev = emu->slave_dev;
+  uint8_t command, value;
+
+  while(sd_emuByte(emu, &command) == 0){
+
+    if(command >= SD_EMU_WRITEREAD){
+
+      uint32_t len = (command & (SD_EMU_DATA_MAX -1)) +1;
+      uint8_t miso[SD_EMU_DATA_MAX];
+
+      for(uint32_t i = 0; i < len; i++){
+        if(sd_emuByte(emu, &value) != 0){
+          return -1;
+        }
+        sd_emuCrc(emu, value);
+        miso[i] = slave_dev->_transfer(slave_dev->model, value);
+      }
+      emu->bytes += len;
+
+      //the device crc runs over the chunk out, then the chunk back
+      //
+      if(command < SD_EMU_WRITE){
+        for(uint32_t i = 0; i < len; i++){
+          sd_emuCrc(emu, miso[i]);
+        }
+        if(sd_emuReply(emu, miso, len) != 0){
+          return -1;
+        }
+      }
+      continue;
+    }
+
+    switch(command){
+
+      case SD_EMU_SYNC:
+        break;
+
+      case SD_EMU_ECHO:
+        if(sd_emuByte(emu, &value) != 0 || sd_emuReply(emu, &value, 1) != 0){
+          return -1;
+        }
+        break;
+
+      case SD_EMU_STATUS:
+        if(sd_emuStatus(emu) != 0){
+          return -1;
+        }
+        break;
+
+      case SD_EMU_SEL:
+        if(emu->cs){
+          emu->cs = 0;
+          slave_dev->_select(slave_dev->model);
+        }
+        break;
+
+      case SD_EMU_UNSEL:
+        if(!emu->cs){
+          emu->cs = 1;
+          emu->transactions++;
+          slave_dev->_unselect(slave_dev->model);
+        }
+        break;
+
+      case SD_EMU_SETA:
+      case SD_EMU_SETB:
+        if(sd_emuByte(emu, &value) != 0){
+          return -1;
+        }
+        *(command == SD_EMU_SETA ? &emu->a : &emu->b) = value;
+        break;
+
+      default:
+        //unknown commands are dropped, as on the device
+        break;
+    }
+  }
+  return -1;
+}
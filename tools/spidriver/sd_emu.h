@@ -0,0 +1,91 @@
+// sd_emu.h
+//
+// SPIDriver emulator on a pseudo-terminal, see sd_emu.c
+
+#ifndef SD_EMU_H
+#define SD_EMU_H
+
+#include <stdint.h>
+
+#define SD_EMU_STATUS_LEN     80      //spi_getstatus() reads exactly this many
+#define SD_EMU_SYNC           '@'     //spi_connect() flushes with 64 of these
+#define SD_EMU_ECHO           'e'
+#define SD_EMU_STATUS         '?'
+#define SD_EMU_SEL            's'
+#define SD_EMU_UNSEL          'u'
+#define SD_EMU_SETA           'a'
+#define SD_EMU_SETB           'b'
+#define SD_EMU_WRITEREAD      0x80    //0x80-0xBF, + len-1
+#define SD_EMU_WRITE          0xC0    //0xC0-0xFF, + len-1
+#define SD_EMU_DATA_MAX       64
+
+#define SD_EMU_BUFFER_LEN     4096
+#define SD_EMU_PATH_LEN       32
+
+#define SD_EMU_CRC_POLY       0x1021
+
+/*
+ * The device on the far side of the SPIDriver. All three take the model
+ * pointer first:
+ *
+ *  _select(model)           CS low
+ *  _transfer(model, mosi)   one byte each way, returns miso
+ *  _unselect(model)         CS high
+ */
+typedef struct {
+  void* model;
+  int(*_select)();
+  int(*_transfer)();
+  int(*_unselect)();
+}SD_EMU_slave;
+
+typedef struct {
+  int master;                         //our end of the pty
+  int slave;                          //held open so the pty outlives the client closing it
+  char path[SD_EMU_PATH_LEN];         //what goes in SD_CONF.port
+
+  SD_EMU_slave* slave_dev;
+  unsigned int a, b, cs;
+  uint16_t crc;                       //CCITT over everything clocked out on MOSI
+
+  uint8_t rx[SD_EMU_BUFFER_LEN];
+  uint32_t rx_len;
+  uint32_t rx_index;
+  uint8_t tx[SD_EMU_BUFFER_LEN];
+  uint32_t tx_len;
+
+  uint64_t bytes;                     //MOSI bytes through the slave
+  uint32_t transactions;              //select/unselect pairs
+}SD_EMU;
+
+int sd_emuOpen(SD_EMU* emu, SD_EMU_slave* slave_dev);
+int sd_emuServe(SD_EMU* emu);
+void sd_emuClose(SD_EMU* emu);
+
+
+/*
+ * DW1000 register file, see sd_emu_dw1000.c
+ */
+
+#define SD_EMU_DW_REG_IDS     64
+#define SD_EMU_DW_REG_LEN     4096    //covers ACC_MEM, the largest at 4064
+#define SD_EMU_DW_HEADER_MAX  3
+
+typedef struct {
+  uint8_t header[SD_EMU_DW_HEADER_MAX];
+  uint8_t header_len;
+  uint8_t header_done;
+  uint8_t reg_id;
+  uint8_t write;
+  uint16_t offset;
+
+  uint8_t regs[SD_EMU_DW_REG_IDS][SD_EMU_DW_REG_LEN];
+
+  uint32_t reads;
+  uint32_t writes;
+}SD_EMU_dw1000;
+
+void sd_emuDwReset(SD_EMU_dw1000* dw);
+void sd_emuDwSlave(SD_EMU_slave* slave_dev, SD_EMU_dw1000* dw);
+
+#endif
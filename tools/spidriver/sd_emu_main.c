@@ -0,0 +1,32 @@
+// sd_emu_main.c
+//
+// Standalone SPIDriver emulator with a DW1000 behind it. Prints the pty to
+// put in SD_CONF.port (config_spidriver.c), then serves until killed.
+//
+// ./sd_emu
+
+#include <stdio.h>
+
+#include "sd_emu.h"
+
+int main(void)
+{
+  static SD_EMU emu;
+  static SD_EMU_dw1000 dw;
+  SD_EMU_slave slave_dev;
+
+  sd_emuDwReset(&dw);
+  sd_emuDwSlave(&slave_dev, &dw);
+
+  if(sd_emuOpen(&emu, &slave_dev) != 0){
+    printf("could not open a pty\n");
+    return 1;
+  }
+
+  printf("%s\n", emu.path);
+  fflush(stdout);
+
+  sd_emuServe(&emu);
+  sd_emuClose(&emu);
+  return 0;
+}
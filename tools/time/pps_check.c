@@ -0,0 +1,150 @@
+// pps_check.c
+//
+// mpi_time (src/middleware/mpi_time.c) against a simulated efm32 host:
+// timer0 counting at the oscillator's real rate, turned into ns the way
+// timer_CountsNs() does at the rate the adaptor believes, and a 1PPS edge
+// captured at every true utc second with some jitter, labelled with its
+// second. For each case it reports
+//
+//  - edges until mpi_time_locked, and the steps and rejects on the way
+//  - worst utc error half way between edges once locked
+//
+// and fails if a case that should lock doesn't, or one that shouldn't
+// does. The HFRCO cases are why cmu_periphconf runs off the HFXO.
+//
+// make -C tools/time && ./tools/time/pps_check [edges]
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "mpi_port.h"
+#include "mpi_time.h"
+
+#define CHECK_EDGES_DEFAULT   120
+#define CHECK_JITTER_NS       50          //capture jitter, uniform +-
+#define CHECK_UTC_START_S     1700000000ULL
+#define CHECK_HOST_START_NS   3217000000ULL //host time at the first true second
+#define CHECK_NS_PER_S        1000000000ULL
+
+typedef struct {
+  const char* name;
+  double count_hz;                //what timer0 really counts at
+  uint32_t assumed_hz;            //what the adaptor converts with
+  int expect_lock;
+}CHECK_case;
+
+typedef struct {
+  double count_hz;
+  uint32_t assumed_hz;
+  int64_t true_ns;                //since the first edge
+  uint64_t capture_ns;
+  int capture_count;
+}CHECK_host;
+
+static const CHECK_case check_cases[] = {
+  {"HFXO 24MHz +30ppm",                  24000000.0 * (1 + 30e-6),  24000000, 1},
+  {"HFXO 24MHz -50ppm",                  24000000.0 * (1 - 50e-6),  24000000, 1},
+  {"HFXO 24MHz +150ppm",                 24000000.0 * (1 + 150e-6), 24000000, 1},
+  {"HFRCO 14MHz counted as 24MHz",       14000000.0,                24000000, 0},
+  {"HFRCO 14MHz band, +0.5%",            14000000.0 * 1.005,        14000000, 0},
+  {"HFRCO 14MHz band, 14308/ms",         14308000.0,                14000000, 0}
+};
+
+uint64_t check_hostNs(CHECK_host* host, int64_t true_ns);
+int check_capture(void* host_object, uint64_t* capture_ns);
+int check_now(void* host_object, uint64_t* now_ns);
+int check_run(const CHECK_case* check_case, uint32_t edges);
+
+//timer_CountsNs() on counts taken at the real rate
+uint64_t check_hostNs(CHECK_host* host, int64_t true_ns){
+
+  uint64_t counts = (uint64_t)((double)(true_ns + CHECK_HOST_START_NS) * host->count_hz / 1e9);
+
+  return ((counts / host->assumed_hz) * CHECK_NS_PER_S) + (((counts % host->assumed_hz) * CHECK_NS_PER_S) / host->assumed_hz);
+}
+
+int check_capture(void* host_object, uint64_t* capture_ns){
+
+  CHECK_host* host = (CHECK_host*)host_object;
+
+  *capture_ns = host->capture_ns;
+  return host->capture_count;
+}
+
+int check_now(void* host_object, uint64_t* now_ns){
+
+  CHECK_host* host = (CHECK_host*)host_object;
+
+  *now_ns = check_hostNs(host, host->true_ns);
+  return 0;
+}
+
+int check_run(const CHECK_case* check_case, uint32_t edges){
+
+  CHECK_host host = {
+    .count_hz = check_case->count_hz,
+    .assumed_hz = check_case->assumed_hz
+  };
+  MPI_time time_sync;
+  uint32_t lock_edge = 0;
+  int64_t worst = 0;
+
+  mpi_timeInit(&time_sync);
+  srand(1);
+
+  for(uint32_t s = 0; s < edges; s++){
+    int64_t jitter = (rand() % (2 * CHECK_JITTER_NS + 1)) - CHECK_JITTER_NS;
+
+    host.capture_ns = check_hostNs(&host, (int64_t)(s * CHECK_NS_PER_S) + jitter);
+    host.capture_count++;
+    mpi_timePps(&host, check_capture, &time_sync, CHECK_UTC_START_S + s);
+
+    if(time_sync.state != mpi_time_locked){
+      lock_edge = 0;
+      continue;
+    }
+    if(lock_edge == 0){
+      lock_edge = s + 1;
+    }
+
+    //half way to the next edge
+    //
+    uint64_t utc_ns;
+
+    host.true_ns = (s * CHECK_NS_PER_S) + (CHECK_NS_PER_S / 2);
+    mpi_timeUtcNow(&host, check_now, &time_sync, &utc_ns);
+
+    int64_t error = (int64_t)(utc_ns - (((CHECK_UTC_START_S + s) * CHECK_NS_PER_S) + (CHECK_NS_PER_S / 2)));
+
+    if(error > worst || -error > worst){
+      worst = (error < 0 ? -error : error);
+    }
+  }
+
+  int locked = (time_sync.state == mpi_time_locked);
+
+  printf("%-32s %-9s", check_case->name, (locked ? "locked" : "unlocked"));
+  if(locked){
+    printf(" edge %3u, freq %+9d ppb, worst %5lld ns", lock_edge, time_sync.freq_int, (long long)worst);
+  } else {
+    printf(" %44s", "");
+  }
+  printf(", %u steps, %u rejects%s\n", time_sync.steps, time_sync.rejects,
+         (locked == check_case->expect_lock ? "" : "   <-- unexpected"));
+
+  return (locked == check_case->expect_lock ? 0 : 1);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t edges = (argc > 1 ? strtoul(argv[1], NULL, 0) : CHECK_EDGES_DEFAULT);
+  uint32_t failed = 0;
+
+  for(uint32_t i = 0; i < sizeof(check_cases) / sizeof(check_cases[0]); i++){
+    failed += check_run(&check_cases[i], edges);
+  }
+
+  printf("%s\n", (failed ? "FAILED" : "ok"));
+  return (failed ? 1 : 0);
+}
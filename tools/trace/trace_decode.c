@@ -0,0 +1,369 @@
+// trace_decode.c
+//
+// Decodes what mpi_traceDrain() writes (src/middleware/mpi_trace.h): a
+// file from the linux hosts' sd_TraceWrite()/spidev_TraceWrite(), or a
+// capture off the efm32 usart drain (mpi_traceUsartWrite()). Prints
+//
+//  - a timeline, one line per record, calls nested under the call they
+//    were made from, each return with how long the call took
+//  - per op latency: count, min/avg/max and a log2 histogram, for each
+//    layer and device the op was seen on
+//
+// A capture can start part way through a drain, anything before the first
+// header is skipped, as is anything that doesn't parse after one.
+//
+// make -C tools/trace && ./tools/trace/trace_decode [-s] <trace file | ->
+//
+//  -s  summary only, no timeline
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mpi_trace.h"
+
+#define DECODE_DEPTH          32      //open calls followed at once
+#define DECODE_BUCKETS        24      //log2 us, 1us .. 8s
+#define DECODE_KEYS           (4 * (MPI_TRACE_DEVICES + 1) * MPI_TRACE_OPS)
+#define DECODE_BAR            40
+
+typedef struct {
+  uint8_t layer;
+  uint8_t device;
+  uint8_t op;
+  int64_t start;
+}DECODE_open;
+
+typedef struct {
+  uint32_t count;
+  uint32_t errors;
+  double min;
+  double max;
+  double sum;
+  uint32_t bucket[DECODE_BUCKETS];
+}DECODE_stat;
+
+typedef struct {
+  char names[MPI_TRACE_DEVICES][MPI_TRACE_NAME_LEN];
+  uint32_t stamp_hz;
+  uint32_t last_stamp;
+  int64_t time;                   //stamps widened to 64 bits
+  int64_t origin;
+  int started;
+  uint32_t seq;
+  DECODE_open open[DECODE_DEPTH];
+  uint32_t depth;
+  DECODE_stat stat[DECODE_KEYS];
+  uint32_t records;
+  uint32_t dropped;
+  uint32_t lost;
+  uint32_t unmatched;
+}DECODE_state;
+
+static const char* decode_layer[] = {"app", "mpi", "adaptor", "irq"};
+
+static const char* decode_op[MPI_TRACE_OPS] = {
+  "init", "config_reg", "query_reg", "data", "sleep", "wakeup", "off",
+  "reset", "mode_level", "transfer", "select", "irq", "async"
+};
+
+uint8_t* decode_read(const char* path, uint32_t* len);
+const char* decode_device(DECODE_state* state, uint32_t device);
+double decode_us(DECODE_state* state, int64_t counts);
+uint32_t decode_key(uint32_t layer, uint32_t device, uint32_t op);
+void decode_record(DECODE_state* state, MPI_trace_record* record, int timeline);
+uint32_t decode_block(DECODE_state* state, uint8_t* data, uint32_t len, int timeline);
+void decode_summary(DECODE_state* state);
+
+uint8_t* decode_read(const char* path, uint32_t* len){
+
+  FILE* file = (strcmp(path, "-") == 0 ? stdin : fopen(path, "rb"));
+  uint8_t* data = NULL;
+  uint32_t size = 0;
+
+  *len = 0;
+  if(file == NULL){
+    return NULL;
+  }
+  for(;;){
+    if(*len == size){
+      size = (size ? size * 2 : 65536);
+      data = realloc(data, size);
+    }
+    size_t got = fread(&data[*len], 1, size - *len, file);
+
+    if(got == 0){
+      break;
+    }
+    *len += got;
+  }
+  if(file != stdin){
+    fclose(file);
+  }
+  return data;
+}
+
+const char* decode_device(DECODE_state* state, uint32_t device){
+
+  if(device >= MPI_TRACE_DEVICES){
+    return "-";
+  }
+  return (state->names[device][0] ? state->names[device] : "?");
+}
+
+//stamp counts to us, or record numbers as they are when the host had no _timer_stamp
+double decode_us(DECODE_state* state, int64_t counts){
+
+  return (state->stamp_hz ? (counts * 1e6) / state->stamp_hz : (double)counts);
+}
+
+uint32_t decode_key(uint32_t layer, uint32_t device, uint32_t op){
+
+  if(device >= MPI_TRACE_DEVICES){
+    device = MPI_TRACE_DEVICES;
+  }
+  return (((layer & 3) * (MPI_TRACE_DEVICES + 1)) + device) * MPI_TRACE_OPS + op;
+}
+
+void decode_record(DECODE_state* state, MPI_trace_record* record, int timeline){
+
+  uint32_t op = record->op & ~MPI_TRACE_EXIT;
+  uint32_t exit = record->op & MPI_TRACE_EXIT;
+
+  if(op >= MPI_TRACE_OPS || record->layer > MPI_TRACE_LAYER_IRQ){
+    state->unmatched++;
+    return;
+  }
+
+  //stamps wrap at 32 bits, an interrupted record can be a little behind the one before it
+  //
+  if(!state->started){
+    state->time = record->stamp;
+    state->origin = record->stamp;
+    state->started = 1;
+  } else {
+    state->time += (int32_t)(record->stamp - state->last_stamp);
+    if(((state->seq + 1) & 0xFF) != record->seq){
+      state->lost += (record->seq - state->seq - 1) & 0xFF;
+      if(timeline){
+        printf("            -- %u records missing --\n", (record->seq - state->seq - 1) & 0xFF);
+      }
+    }
+  }
+  state->last_stamp = record->stamp;
+  state->seq = record->seq;
+  state->records++;
+
+  double now = decode_us(state, state->time - state->origin);
+
+  if(!exit){
+    if(timeline){
+      printf("%12.1f %*s%s %s %s", now, state->depth * 2, "", decode_layer[record->layer],
+             decode_device(state, record->device), decode_op[op]);
+      printf(record->length ? " %u\n" : "\n", record->length);
+    }
+    if(op == MPI_TRACE_OP_IRQ){
+      return;
+    }
+    if(state->depth == DECODE_DEPTH){
+      memmove(&state->open[0], &state->open[1], sizeof(DECODE_open) * (DECODE_DEPTH - 1));
+      state->depth--;
+    }
+    state->open[state->depth].layer = record->layer;
+    state->open[state->depth].device = record->device;
+    state->open[state->depth].op = op;
+    state->open[state->depth].start = state->time;
+    state->depth++;
+    return;
+  }
+
+  //innermost open call that matches, async requests don't nest
+  //
+  int i = state->depth - 1;
+
+  while(i >= 0 && (state->open[i].layer != record->layer || state->open[i].device != record->device || state->open[i].op != op)){
+    i--;
+  }
+  if(i < 0){
+    state->unmatched++;
+    if(timeline){
+      printf("%12.1f %*s%s %s %s -> %d (no entry)\n", now, state->depth * 2, "", decode_layer[record->layer],
+             decode_device(state, record->device), decode_op[op], record->result);
+    }
+    return;
+  }
+
+  double us = decode_us(state, state->time - state->open[i].start);
+  DECODE_stat* stat = &state->stat[decode_key(record->layer, record->device, op)];
+  uint32_t bucket = 0;
+
+  memmove(&state->open[i], &state->open[i + 1], sizeof(DECODE_open) * (state->depth - i - 1));
+  state->depth--;
+
+  if(timeline){
+    printf("%12.1f %*s%s %s %s -> %d, %.1f\n", now, state->depth * 2, "", decode_layer[record->layer],
+           decode_device(state, record->device), decode_op[op], record->result, us);
+  }
+
+  if(stat->count == 0 || us < stat->min){
+    stat->min = us;
+  }
+  if(us > stat->max){
+    stat->max = us;
+  }
+  stat->sum += us;
+  stat->count++;
+  stat->errors += (record->result < 0);
+
+  while(bucket < (DECODE_BUCKETS - 1) && us >= (double)(2u << bucket)){
+    bucket++;
+  }
+  stat->bucket[bucket]++;
+}
+
+//one drain: header, names, records. Bytes consumed, 0 if there's no header here
+uint32_t decode_block(DECODE_state* state, uint8_t* data, uint32_t len, int timeline){
+
+  MPI_trace_header header;
+
+  if(len < sizeof(header)){
+    return 0;
+  }
+  memcpy(&header, data, sizeof(header));
+  if(header.magic != MPI_TRACE_MAGIC || header.version != MPI_TRACE_VERSION ||
+     header.record_size != sizeof(MPI_trace_record) || header.devices > MPI_TRACE_DEVICES){
+    return 0;
+  }
+
+  uint32_t names_len = header.devices * MPI_TRACE_NAME_LEN;
+  uint32_t block_len = sizeof(header) + names_len + (header.records * sizeof(MPI_trace_record));
+
+  if(header.records > (len / sizeof(MPI_trace_record)) || block_len > len){
+    return 0;
+  }
+
+  memcpy(state->names, &data[sizeof(header)], names_len);
+  for(uint32_t i = 0; i < header.devices; i++){
+    state->names[i][MPI_TRACE_NAME_LEN - 1] = 0;
+  }
+  state->stamp_hz = header.stamp_hz;
+
+  //whatever was open when the ring overwrote its return is never coming back
+  //
+  if(header.dropped){
+    state->dropped += header.dropped;
+    state->depth = 0;
+    if(timeline){
+      printf("            -- %u records dropped --\n", header.dropped);
+    }
+  }
+
+  for(uint32_t i = 0; i < header.records; i++){
+    MPI_trace_record record;
+
+    memcpy(&record, &data[sizeof(header) + names_len + (i * sizeof(record))], sizeof(record));
+    if(header.dropped && i == 0){
+      state->seq = record.seq - 1;
+    }
+    decode_record(state, &record, timeline);
+  }
+  return block_len;
+}
+
+void decode_summary(DECODE_state* state){
+
+  const char* unit = (state->stamp_hz ? "us" : "records");
+
+  printf("\n%u records", state->records);
+  if(state->dropped || state->lost){
+    printf(", %u dropped by the ring, %u missing", state->dropped, state->lost);
+  }
+  if(state->unmatched){
+    printf(", %u returns with no entry", state->unmatched);
+  }
+  printf(", %s\n", (state->stamp_hz ? "host stamps" : "no host stamps, times are record counts"));
+
+  for(uint32_t layer = 0; layer <= MPI_TRACE_LAYER_IRQ; layer++){
+    for(uint32_t device = 0; device <= MPI_TRACE_DEVICES; device++){
+      for(uint32_t op = 0; op < MPI_TRACE_OPS; op++){
+        DECODE_stat* stat = &state->stat[decode_key(layer, device, op)];
+        uint32_t most = 0;
+        uint32_t first = DECODE_BUCKETS;
+        uint32_t last = 0;
+
+        if(stat->count == 0){
+          continue;
+        }
+        printf("\n%s %s %s: %u calls, %u errors, min %.1f avg %.1f max %.1f %s\n", decode_layer[layer],
+               decode_device(state, device), decode_op[op], stat->count, stat->errors,
+               stat->min, stat->sum / stat->count, stat->max, unit);
+
+        for(uint32_t i = 0; i < DECODE_BUCKETS; i++){
+          if(stat->bucket[i]){
+            most = (stat->bucket[i] > most ? stat->bucket[i] : most);
+            first = (i < first ? i : first);
+            last = i;
+          }
+        }
+        for(uint32_t i = first; i <= last; i++){
+          uint32_t bar = (stat->bucket[i] * DECODE_BAR + most - 1) / most;
+
+          printf("  %9u .. %-9u %7u |%.*s\n", (i ? 1u << i : 0), 2u << i, stat->bucket[i], bar,
+                 "########################################");
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int timeline = 1;
+  const char* path = NULL;
+
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i], "-s") == 0){
+      timeline = 0;
+    } else {
+      path = argv[i];
+    }
+  }
+  if(path == NULL){
+    printf("usage: %s [-s] <trace file | ->\n", argv[0]);
+    return 1;
+  }
+
+  uint32_t len;
+  uint8_t* data = decode_read(path, &len);
+
+  if(data == NULL){
+    printf("could not read %s\n", path);
+    return 1;
+  }
+
+  static DECODE_state state;
+  uint32_t offset = 0;
+  uint32_t skipped = 0;
+
+  if(timeline){
+    printf("%12s layer device op [len] -> result, duration\n", "time");
+  }
+  while(offset < len){
+    uint32_t used = decode_block(&state, &data[offset], len - offset, timeline);
+
+    if(used == 0){
+      offset++;
+      skipped++;
+    } else {
+      offset += used;
+    }
+  }
+  if(skipped){
+    printf("%u bytes that weren't a drain skipped\n", skipped);
+  }
+
+  decode_summary(&state);
+  free(data);
+  return 0;
+}
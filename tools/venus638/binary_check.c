@@ -0,0 +1,237 @@
+// binary_check.c
+//
+// The venus638 binary output path on the host: frames a nav data message,
+// an ACK, output we have no handler for and a short nav data message, and
+// feeds each through venus638_Rx() in binary mode as the usart would hand
+// it over (BINARY_RX_CHUNK bytes per call). Checks that
+//
+//  - a good nav data frame reads back with status 0 and the fix decoded
+//    (position, altitude, hdop, 3D speed, utc time and date, mode)
+//  - an ACK goes to its handler with status 0
+//  - ids we have no handler for, in and out of the response range, are
+//    passed over with status 0 and leave the fix alone
+//  - a nav data frame too short to decode still fails Rx with -1
+//  - short reads are parsed only as far as they go, a failed read fails Rx
+//
+// make -C tools/venus638 && ./tools/venus638/binary_check
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mpi_port.h"
+#include "venus638.h"
+#include "venus638_binary.h"
+
+#define CHECK_STREAM_LEN      256
+#define CHECK_FILL            0x00    //between frames, never frames itself
+
+//nav data, 3D fix
+#define CHECK_WEEK            2338
+#define CHECK_TOW             12345600        //0.01s, 123456s into the week
+#define CHECK_LATITUDE        (-379087300)
+#define CHECK_LONGITUDE       1451363600
+#define CHECK_MSL_ALT         11230
+#define CHECK_HDOP            90
+#define CHECK_SV_COUNT        9
+#define CHECK_VX              300             //cm/s, 500cm/s in all
+#define CHECK_VY              (-400)
+
+#define CHECK_UTC_TIME        37038000        //tow less 18 leap seconds, a day in
+#define CHECK_UTC_DATE        281024
+#define CHECK_SPEED           5000            //mm/s
+
+typedef struct {
+  uint8_t stream[CHECK_STREAM_LEN];
+  uint32_t len;
+  uint32_t offset;
+  uint32_t short_len;             //most handed over per read, 0 for whole chunks
+  int fail;
+}CHECK_usart;
+
+static CHECK_usart check_usart;
+static VENUS_message_io check_message;
+static VENUS_response_store check_response;
+static VENUS_nmea_store check_nmea;
+static VENUS_config check_config;
+static VENUS_op_mode check_mode = binary;
+static MPI_ext_dev check_venus;
+static uint32_t check_failed;
+
+int check_usartData(void* host_object, int read_write, uint8_t* buffer, uint32_t buffer_len);
+void check_put32(uint8_t* buffer, uint32_t value);
+void check_frame(uint8_t* payload, uint32_t payload_len);
+int check_rx(void);
+void check_expect(const char* step, const char* what, int64_t got, int64_t expected);
+
+// stands in for the host usart, the queued frames then fill. A short read
+// returns the count and leaves the rest of the buffer as it was
+int check_usartData(void* host_object, int read_write, uint8_t* buffer, uint32_t buffer_len){
+
+  CHECK_usart* usart = (CHECK_usart*)host_object;
+
+  if(usart->fail){
+    return -1;
+  }
+  if(usart->short_len && usart->short_len < buffer_len){
+    buffer_len = usart->short_len;
+  }
+  for(uint32_t i = 0; i < buffer_len; i++){
+    buffer[i] = (usart->offset < usart->len ? usart->stream[usart->offset++] : CHECK_FILL);
+  }
+  return (usart->short_len ? buffer_len : 0);
+}
+
+void check_put32(uint8_t* buffer, uint32_t value){
+
+  buffer[0] = value >> 24;
+  buffer[1] = value >> 16;
+  buffer[2] = value >> 8;
+  buffer[3] = value;
+}
+
+//<A0 A1><PL><payload><CS><0D 0A> onto the end of the stream
+void check_frame(uint8_t* payload, uint32_t payload_len){
+
+  uint8_t* out = &check_usart.stream[check_usart.len];
+
+  out[0] = SEQUENCE_START_0;
+  out[1] = SEQUENCE_START_1;
+  out[2] = payload_len >> 8;
+  out[3] = payload_len;
+  memcpy(&out[4], payload, payload_len);
+  out[4 + payload_len] = venus_xorChecksum(payload, payload_len);
+  out[5 + payload_len] = SEQUENCE_END_0;
+  out[6 + payload_len] = SEQUENCE_END_1;
+  check_usart.len += payload_len + 7;
+}
+
+//reads until the stream is used up and one more, fill only, chunk has been through. The worst status seen
+int check_rx(void){
+
+  int(*venus_rx)() = venus638_rx_tx_table[VENUS_READ];
+  int status = 0;
+  int ret;
+
+  do{
+    ret = venus_rx(&check_usart, check_usartData, &check_venus);
+    status = (ret < status ? ret : status);
+  }while(check_usart.offset < check_usart.len);
+
+  ret = venus_rx(&check_usart, check_usartData, &check_venus);
+  status = (ret < status ? ret : status);
+
+  check_usart.len = 0;
+  check_usart.offset = 0;
+  return status;
+}
+
+void check_expect(const char* step, const char* what, int64_t got, int64_t expected){
+
+  if(got != expected){
+    printf("FAIL %s: %s %lld, expected %lld\n", step, what, (long long)got, (long long)expected);
+    check_failed++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint8_t payload[BINARY_PAYLOAD_MAX];
+
+  check_venus.MPI_data[VENUS_MESSAGE_INDEX] = &check_message;
+  check_venus.MPI_data[VENUS_RESPONSE_INDEX] = &check_response;
+  check_venus.MPI_data[VENUS_NMEA_INDEX] = &check_nmea;
+  check_venus.MPI_conf[VENUS_CONFIG_INDEX] = &check_config;
+  check_venus.MPI_conf[VENUS_OP_INDEX] = &check_mode;
+  venus_binaryParserReset(&check_nmea.binary_parser);
+
+  //nav data, split across chunks
+  //
+  memset(payload, 0, sizeof(payload));
+  payload[0] = ID_NAV_DATA;
+  payload[NAV_DATA_FIX_MODE] = NAV_FIX_MODE_3D;
+  payload[NAV_DATA_SV_COUNT] = CHECK_SV_COUNT;
+  payload[NAV_DATA_GPS_WEEK] = CHECK_WEEK >> 8;
+  payload[NAV_DATA_GPS_WEEK + 1] = CHECK_WEEK & 0xFF;
+  check_put32(&payload[NAV_DATA_TOW], CHECK_TOW);
+  check_put32(&payload[NAV_DATA_LATITUDE], (uint32_t)CHECK_LATITUDE);
+  check_put32(&payload[NAV_DATA_LONGITUDE], CHECK_LONGITUDE);
+  check_put32(&payload[NAV_DATA_MSL_ALT], CHECK_MSL_ALT);
+  payload[NAV_DATA_HDOP] = CHECK_HDOP >> 8;
+  payload[NAV_DATA_HDOP + 1] = CHECK_HDOP & 0xFF;
+  check_put32(&payload[NAV_DATA_ECEF_VX], (uint32_t)CHECK_VX);
+  check_put32(&payload[NAV_DATA_ECEF_VY], (uint32_t)CHECK_VY);
+  check_frame(payload, STATUS_NAV_DATA_PL_LEN);
+
+  check_expect("nav data", "status", check_rx(), 0);
+  check_expect("nav data", "frames", check_nmea.binary_parser.frame_count, 1);
+  check_expect("nav data", "updated", check_nmea.fix.updated, 1 << NAV_DATA_INDEX);
+  check_expect("nav data", "latitude", check_nmea.fix.latitude, CHECK_LATITUDE);
+  check_expect("nav data", "longitude", check_nmea.fix.longitude, CHECK_LONGITUDE);
+  check_expect("nav data", "altitude", check_nmea.fix.altitude, CHECK_MSL_ALT);
+  check_expect("nav data", "hdop", check_nmea.fix.hdop, CHECK_HDOP);
+  check_expect("nav data", "speed", check_nmea.fix.speed, CHECK_SPEED);
+  check_expect("nav data", "utc time", check_nmea.fix.utc_time, CHECK_UTC_TIME);
+  check_expect("nav data", "utc date", check_nmea.fix.utc_date, CHECK_UTC_DATE);
+  check_expect("nav data", "fix mode", check_nmea.fix.fix_mode, 3);
+  check_expect("nav data", "quality", check_nmea.fix.fix_quality, 1);
+  check_expect("nav data", "satellites", check_nmea.fix.satellites_used, CHECK_SV_COUNT);
+  check_expect("nav data", "valid", check_nmea.fix.valid, 1);
+
+  //ACK for a nav mode config
+  //
+  check_nmea.fix.updated = 0;
+  payload[0] = RES_ID_STATUS_ACK;
+  payload[1] = ID_CONFIG_NAV_MODE;
+  check_frame(payload, STATUS_ACK_PL_LEN);
+
+  check_expect("ack", "status", check_rx(), 0);
+  check_expect("ack", "response id", check_response.response_id, RES_ID_STATUS_ACK);
+  check_expect("ack", "acked id", check_response.ack_message_id, ID_CONFIG_NAV_MODE);
+
+  //below the response ids, then in range with no handler
+  //
+  payload[0] = VENUS_RESPONSE_ID_BASE - 1;
+  check_frame(payload, 4);
+  payload[0] = VENUS_RESPONSE_ID_MAX;
+  check_frame(payload, 4);
+
+  check_expect("unknown ids", "status", check_rx(), 0);
+  check_expect("unknown ids", "frames", check_nmea.binary_parser.frame_count, 4);
+  check_expect("unknown ids", "updated", check_nmea.fix.updated, 0);
+  check_expect("unknown ids", "latitude", check_nmea.fix.latitude, CHECK_LATITUDE);
+
+  //nav data too short to hold a fix
+  //
+  payload[0] = ID_NAV_DATA;
+  check_frame(payload, 10);
+
+  check_expect("short nav data", "status", check_rx(), -1);
+  check_expect("short nav data", "updated", check_nmea.fix.updated, 0);
+
+  //an ACK in short reads, nothing stale from the chunk before gets parsed again
+  //
+  payload[0] = RES_ID_STATUS_ACK;
+  payload[1] = ID_CONFIG_NAV_MODE;
+  check_frame(payload, STATUS_ACK_PL_LEN);
+  check_usart.short_len = 5;
+
+  check_expect("short reads", "status", check_rx(), 0);
+  check_expect("short reads", "frames", check_nmea.binary_parser.frame_count, 6);
+  check_usart.short_len = 0;
+
+  check_usart.fail = 1;
+  check_expect("failed read", "status", venus638_rx_tx_table[VENUS_READ](&check_usart, check_usartData, &check_venus), -1);
+  check_usart.fail = 0;
+
+  check_expect("stream", "checksum errors", check_nmea.binary_parser.checksum_errors, 0);
+  check_expect("stream", "framing errors", check_nmea.binary_parser.framing_errors, 0);
+
+  if(check_failed){
+    printf("%u checks failed\n", check_failed);
+    return 1;
+  }
+  printf("binary nav data, replies, unknown ids and short reads all read back as expected\n");
+  return 0;
+}
@@ -0,0 +1,112 @@
+// nmea_bench.c
+//
+// Host benchmark for the venus638 NMEA path. Replays a recorded NMEA log
+// through venus638_Rx() exactly as the efm32 usart would hand it over
+// (NMEA_RX_CHUNK bytes per call) and reports sentences/second through the
+// parser, tokenizer and fix decoders.
+//
+// make -C tools/venus638 && cd tools/venus638 && ./nmea_bench [nmea_sample.log] [passes]
+//
+// nmea_sample.log is a synthesized one minute track (GGA, GLL, GSA, 3x GSV,
+// RMC, VTG at 1Hz). Swap in a capture off the real receiver for real numbers.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpi_port.h"
+#include "venus638.h"
+#include "venus638_nmea.h"
+
+#define BENCH_PASSES_DEFAULT 2000
+
+typedef struct {
+  uint8_t* log;
+  uint32_t log_len;
+  uint32_t offset;
+  uint32_t passes;
+}BENCH_replay;
+
+int bench_usart(void* host_object, int read_write, uint8_t* buffer, uint32_t buffer_len);
+
+// stands in for the host usart, wraps around the log until the passes run out
+int bench_usart(void* host_object, int read_write, uint8_t* buffer, uint32_t buffer_len){
+
+  BENCH_replay* replay = (BENCH_replay*)host_object;
+
+  for(uint32_t i = 0; i < buffer_len; i++){
+    if(replay->offset == replay->log_len){
+      replay->offset = 0;
+      replay->passes++;
+    }
+    buffer[i] = replay->log[replay->offset++];
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+  const char* path = (argc > 1 ? argv[1] : "nmea_sample.log");
+  uint32_t passes = (argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_PASSES_DEFAULT);
+
+  FILE* log_file = fopen(path, "rb");
+  if(log_file == NULL){
+    printf("could not open %s\n", path);
+    return 1;
+  }
+  fseek(log_file, 0, SEEK_END);
+  long log_len = ftell(log_file);
+  fseek(log_file, 0, SEEK_SET);
+
+  BENCH_replay replay = {0};
+  replay.log = malloc(log_len);
+  replay.log_len = log_len;
+  if(replay.log == NULL || log_len <= 0 || fread(replay.log, 1, log_len, log_file) != (size_t)log_len){
+    printf("could not read %s\n", path);
+    return 1;
+  }
+  fclose(log_file);
+
+  static VENUS_message_io message;
+  static VENUS_response_store response;
+  static VENUS_nmea_store nmea_store;
+  static VENUS_config config;
+  VENUS_op_mode op_mode = nmea;
+
+  MPI_ext_dev venus = {0};
+  venus.MPI_data[VENUS_MESSAGE_INDEX] = &message;
+  venus.MPI_data[VENUS_RESPONSE_INDEX] = &response;
+  venus.MPI_data[VENUS_NMEA_INDEX] = &nmea_store;
+  venus.MPI_conf[VENUS_CONFIG_INDEX] = &config;
+  venus.MPI_conf[VENUS_OP_INDEX] = &op_mode;
+
+  venus_nmeaParserReset(&nmea_store.parser);
+
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  int(*venus_rx)() = venus638_rx_tx_table[VENUS_READ];
+
+  while(replay.passes < passes){
+    venus_rx(&replay, bench_usart, &venus);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  double seconds = (stop.tv_sec - start.tv_sec) + ((stop.tv_nsec - start.tv_nsec) / 1e9);
+  double bytes = (double)replay.log_len * passes;
+
+  printf("%u sentences in %.3f s: %.0f sentences/s, %.1f MB/s\n",
+         nmea_store.parser.sentence_count, seconds, nmea_store.parser.sentence_count / seconds, bytes / seconds / 1e6);
+  printf("checksum errors %u, framing errors %u\n", nmea_store.parser.checksum_errors, nmea_store.parser.framing_errors);
+  printf("last fix: lat %d lon %d (deg x1e7) alt %d cm, utc %u ms, date %06u\n",
+         nmea_store.fix.latitude, nmea_store.fix.longitude, nmea_store.fix.altitude, nmea_store.fix.utc_time, nmea_store.fix.utc_date);
+  printf("          speed %u mm/s, course %u, hdop %u, quality %u, mode %u, sats %u/%u, valid %u\n",
+         nmea_store.fix.speed, nmea_store.fix.course, nmea_store.fix.hdop, nmea_store.fix.fix_quality, nmea_store.fix.fix_mode,
+         nmea_store.fix.satellites_used, nmea_store.fix.satellites_in_view, nmea_store.fix.valid);
+
+  free(replay.log);
+  return 0;
+}